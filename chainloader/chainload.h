@@ -0,0 +1,98 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    chainload.h
+ * @brief   Chainloader wire protocol and image stream format.
+ * @details Session, all integers little-endian:
+ *          - The loader sends @p CL_REQUEST at boot and waits
+ *            @p LOADER_WAIT_MS for a @p ClHeader.
+ *          - It answers the header with @p CL_ACCEPT, @p CL_NO_BASE (delta
+ *            requested but the staged image does not match @p base_sha, the
+ *            host should send a full image instead) or @p CL_REJECT.
+ *          - The host sends the stream in chunks: seq (16 bit), len (16 bit),
+ *            payload, CRC-32 (IEEE) of seq..payload. Every chunk is answered
+ *            with @p CL_ACK or @p CL_NAK; a repeated chunk is acked again.
+ *          - The loader unpacks the stream to 0x8000, checks the size and
+ *            SHA-256, answers @p CL_DONE or @p CL_FAILED and boots either
+ *            the new image or the staged one.
+ *          .
+ *          Stream format, a sequence of tokens, @p op in the top two bits
+ *          and @p n in the lower six:
+ *          - op 0, literal: n+1 bytes follow.
+ *          - op 1, copy from the output: n+4 bytes, distance-1 as a varint.
+ *          - op 2, copy from the base image: n+4 bytes, the source offset
+ *            relative to the output position as a zigzag varint.
+ *          - op 3, end of stream.
+ *          .
+ *          When @p n is 63 a varint with the remaining length follows the
+ *          token. Varints are LEB128.
+ */
+
+#ifndef _CHAINLOAD_H_
+#define _CHAINLOAD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CL_MAGIC            0x444C4843      /* "CHLD" */
+#define CL_CHUNK_SIZE       1024
+
+#define CL_FLAG_DELTA       0x01
+
+/**
+ * @name    Loader to host responses
+ * @{
+ */
+#define CL_REQUEST          "\x03\x03\x03"
+#define CL_ACCEPT           'K'
+#define CL_NO_BASE          'B'
+#define CL_REJECT           'R'
+#define CL_ACK              'A'
+#define CL_NAK              'N'
+#define CL_DONE             'D'
+#define CL_FAILED           'F'
+/** @} */
+
+/**
+ * @brief   Session header, followed by its CRC-32.
+ */
+typedef struct {
+  uint32_t              magic;
+  uint32_t              image_size;         /**< @brief Unpacked size.      */
+  uint32_t              stream_size;        /**< @brief Bytes to follow.    */
+  uint32_t              flags;
+  uint32_t              base_size;          /**< @brief Delta base size.    */
+  uint8_t               base_sha[32];       /**< @brief Delta base digest.  */
+  uint8_t               image_sha[32];      /**< @brief Unpacked digest.    */
+} ClHeader;
+
+#define CL_HEADER_SIZE      84
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  long clUnpack(const uint8_t *sp, size_t slen, const uint8_t *base,
+                size_t blen, uint8_t *dp, size_t dlen);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CHAINLOAD_H_ */
@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+"""Pushes an application image to the chainloader over a serial port.
+
+The image is packed (LZ77 style, see ../chainload.h) and, when --base names
+the image currently on the node's card, delta encoded against it. If the
+node's staged image does not match --base, a full image is sent instead.
+
+Usage: chainload.py [--base kernel-on-card.img] [--baud 115200] PORT IMAGE
+
+Reset the node after starting this (or pass --reset "reboot" to type a
+command into the running application's shell first).
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+import time
+import zlib
+
+import serial
+
+MAGIC = b"CHLD"
+CHUNK = 1024
+FLAG_DELTA = 0x01
+MIN_MATCH = 4
+
+
+def _varint(v):
+    out = bytearray()
+    while True:
+        b = v & 0x7F
+        v >>= 7
+        if v:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def _token(op, n, bias):
+    n -= bias
+    if n < 63:
+        return bytes([(op << 6) | n])
+    return bytes([(op << 6) | 63]) + _varint(n - 63)
+
+
+def _match_len(a, ai, b, bi, limit):
+    n = 0
+    # Compare in slices first, then byte by byte.
+    step = 64
+    while n + step <= limit and a[ai + n:ai + n + step] == b[bi + n:bi + n + step]:
+        n += step
+    while n < limit and a[ai + n] == b[bi + n]:
+        n += 1
+    return n
+
+
+def pack(data, base=b""):
+    """Encodes data, copying from base where that is cheaper."""
+    out = bytearray()
+    lits = bytearray()
+    hist = {}
+    bidx = {}
+    for i in range(len(base) - MIN_MATCH + 1):
+        bidx.setdefault(base[i:i + MIN_MATCH], i)
+
+    def flush():
+        if lits:
+            out.extend(_token(0, len(lits), 1))
+            out.extend(lits)
+            lits.clear()
+
+    shift = 0
+    i = 0
+    n = len(data)
+    while i < n:
+        key = data[i:i + MIN_MATCH]
+        best, kind, arg = 0, None, None
+        if len(key) == MIN_MATCH:
+            for cand in (i + shift, bidx.get(key)):
+                if cand is not None and 0 <= cand < len(base):
+                    m = _match_len(base, cand, data, i, min(len(base) - cand, n - i))
+                    if m > best:
+                        best, kind, arg = m, 2, cand - i
+            cand = hist.get(key)
+            if cand is not None:
+                m = _match_len(data, cand, data, i, n - i)
+                if m > best:
+                    best, kind, arg = m, 1, i - cand
+        if best < MIN_MATCH:
+            hist[key] = i
+            lits.append(data[i])
+            i += 1
+            continue
+        flush()
+        out.extend(_token(kind, best, MIN_MATCH))
+        if kind == 1:
+            out.extend(_varint(arg - 1))
+        else:
+            out.extend(_varint((arg << 1) if arg >= 0 else ((-arg - 1) << 1) | 1))
+            shift = arg
+        for j in range(i, min(i + best, n - MIN_MATCH + 1)):
+            hist[data[j:j + MIN_MATCH]] = j
+        i += best
+    flush()
+    out.append(0xC0)
+    return bytes(out)
+
+
+def _wait_for(port, accept, timeout):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        c = port.read(1)
+        if c and c in accept:
+            return c
+    return None
+
+
+def _wait_request(port, timeout):
+    deadline = time.monotonic() + timeout
+    seen = 0
+    while time.monotonic() < deadline:
+        c = port.read(1)
+        if c == b"\x03":
+            seen += 1
+            if seen == 3:
+                return True
+        elif c:
+            seen = 0
+            sys.stdout.write(c.decode("ascii", "replace"))
+    return False
+
+
+def _header(image, stream, base):
+    flags = FLAG_DELTA if base else 0
+    base_sha = hashlib.sha256(base).digest() if base else bytes(32)
+    hdr = MAGIC + struct.pack("<IIII", len(image), len(stream), flags, len(base))
+    hdr += base_sha + hashlib.sha256(image).digest()
+    return hdr + struct.pack("<I", zlib.crc32(hdr))
+
+
+def _send_stream(port, stream):
+    for seq, off in enumerate(range(0, len(stream), CHUNK)):
+        payload = stream[off:off + CHUNK]
+        frame = struct.pack("<HH", seq & 0xFFFF, len(payload)) + payload
+        frame += struct.pack("<I", zlib.crc32(frame))
+        for _ in range(20):
+            port.write(frame)
+            if _wait_for(port, b"AN", 5.0) == b"A":
+                break
+        else:
+            raise RuntimeError("chunk %d not acknowledged" % seq)
+
+
+def push(port, image, base, timeout):
+    attempts = [base, b""] if base else [b""]
+    for attempt in attempts:
+        stream = pack(image, attempt)
+        if not _wait_request(port, timeout):
+            raise RuntimeError("no chainloader request seen")
+        port.write(_header(image, stream, attempt))
+        reply = _wait_for(port, b"KBR", 5.0)
+        if reply == b"B":
+            print("node does not hold the base image, sending it in full")
+            continue
+        if reply != b"K":
+            raise RuntimeError("header refused (%r)" % reply)
+        print("sending %d bytes for a %d byte image%s" %
+              (len(stream), len(image), " (delta)" if attempt else ""))
+        _send_stream(port, stream)
+        if _wait_for(port, b"DF", 10.0) != b"D":
+            raise RuntimeError("node rejected the image, it boots the on-card one")
+        return
+    raise RuntimeError("session failed")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("port")
+    ap.add_argument("image")
+    ap.add_argument("--base", help="image currently on the node's card")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--reset", help="shell command that reboots the node")
+    ap.add_argument("--timeout", type=float, default=60.0,
+                    help="seconds to wait for the node to ask for an image")
+    args = ap.parse_args()
+
+    image = open(args.image, "rb").read()
+    base = open(args.base, "rb").read() if args.base else b""
+    with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+        if args.reset:
+            port.write(args.reset.encode() + b"\r\n")
+        start = time.monotonic()
+        push(port, image, base, args.timeout)
+        print("done in %.1f s" % (time.monotonic() - start))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,376 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    main.c
+ * @brief   Resident chainloader: receives an application image over the
+ *          mini UART, or boots the on-card one.
+ * @details Runs without ChibiOS, polled, with interrupts off. See
+ *          chainload.h for the protocol and loader.ld for the memory map.
+ */
+
+#include <string.h>
+
+#include "bcm2835.h"
+#include "chainload.h"
+#include "sha256.h"
+
+#if !defined(LOADER_BAUD)
+#define LOADER_BAUD         115200
+#endif
+
+/* How long the loader listens for a host before booting the staged image.*/
+#if !defined(LOADER_WAIT_MS)
+#define LOADER_WAIT_MS      1000
+#endif
+
+/* Longest gap tolerated inside a session.*/
+#define SESSION_TIMEOUT_MS  3000
+
+#define APP_BASE            ((uint8_t *)0x00008000)
+#define APP_MAX_SIZE        (0x01000000 - 0x00008000)
+#define STREAM_BASE         ((uint8_t *)0x02100000)
+#define STREAM_MAX_SIZE     (0x01000000 - CL_CHUNK_SIZE)
+
+#define ATAG_NONE           0x00000000
+#define ATAG_INITRD2        0x54420005
+#define ATAGS_DEFAULT       0x00000100
+#define MACH_BCM2708        0x00000C42
+
+#define MU_BAUD(b)          ((BCM2835_CLOCK_FREQ / (8 * (b))) - 1)
+
+static const uint8_t *staged;
+static size_t staged_size;
+
+/*===========================================================================*/
+/* Mini UART and timing.                                                     */
+/*===========================================================================*/
+
+static void uart_init(void) {
+
+  AUX_ENABLES = 1;
+  AUX_MU_IER_REG  = 0x00;
+  AUX_MU_CNTL_REG = 0x00;
+  AUX_MU_LCR_REG  = 0x03;
+  AUX_MU_MCR_REG  = 0x00;
+  AUX_MU_IIR_REG  = 0xC6;
+  AUX_MU_BAUD_REG = MU_BAUD(LOADER_BAUD);
+
+  /* GPIO14/15 to ALT5.*/
+  GPFSEL1 = (GPFSEL1 & ~((7 << 12) | (7 << 15))) |
+            (GPFN_ALT5 << 12) | (GPFN_ALT5 << 15);
+
+  AUX_MU_CNTL_REG = 0x03;
+}
+
+static void uart_put(uint8_t c) {
+
+  while (!AUX_MU_LSR_TX_RDY)
+    ;
+  AUX_MU_IO_REG = c;
+}
+
+static void uart_puts(const char *s) {
+
+  while (*s != '\0')
+    uart_put((uint8_t)*s++);
+}
+
+static void uart_puthex(uint32_t v) {
+  int i;
+
+  for (i = 28; i >= 0; i -= 4)
+    uart_put("0123456789abcdef"[(v >> i) & 0xF]);
+}
+
+/**
+ * @brief   Receives one byte, -1 on timeout.
+ */
+static int uart_get(uint32_t timeout_ms) {
+  uint32_t start = SYSTIMER_CLO;
+
+  while (!AUX_MU_LSR_RX_RDY) {
+    if (SYSTIMER_CLO - start >= timeout_ms * 1000)
+      return -1;
+  }
+  return AUX_MU_IO_REG & 0xFF;
+}
+
+static int uart_read(uint8_t *bp, size_t n, uint32_t timeout_ms) {
+
+  while (n--) {
+    int c = uart_get(timeout_ms);
+    if (c < 0)
+      return -1;
+    *bp++ = (uint8_t)c;
+  }
+  return 0;
+}
+
+static void uart_flush_rx(void) {
+
+  while (uart_get(20) >= 0)
+    ;
+}
+
+/*===========================================================================*/
+/* Helpers.                                                                  */
+/*===========================================================================*/
+
+static uint32_t crc32(uint32_t crc, const uint8_t *bp, size_t n) {
+  unsigned i;
+
+  crc = ~crc;
+  while (n--) {
+    crc ^= *bp++;
+    for (i = 0; i < 8; i++)
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+  }
+  return ~crc;
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief   Looks up the image staged by the firmware's "initramfs" line.
+ */
+static void find_staged(uint32_t atags) {
+  const uint32_t *tag = (const uint32_t *)(atags != 0 ? atags : ATAGS_DEFAULT);
+  unsigned guard;
+
+  for (guard = 0; guard < 64 && tag[0] >= 2; guard++) {
+    if (tag[1] == ATAG_NONE)
+      break;
+    if ((tag[1] == ATAG_INITRD2) && (tag[3] > 0) && (tag[3] <= APP_MAX_SIZE)) {
+      staged = (const uint8_t *)tag[2];
+      staged_size = tag[3];
+      return;
+    }
+    tag += tag[0];
+  }
+}
+
+extern void loader_jump(uint32_t entry, uint32_t r0, uint32_t r1,
+                        uint32_t r2);
+
+static void boot(size_t size, uint32_t atags) {
+
+  uart_puts("chainloader: booting ");
+  uart_puthex(size);
+  uart_puts(" bytes\r\n");
+  while (!(AUX_MU_LSR_REG & BIT(6)))        /* Transmitter idle.*/
+    ;
+  loader_jump((uint32_t)APP_BASE, 0, MACH_BCM2708, atags);
+}
+
+static void boot_staged(uint32_t atags) {
+
+  if (staged == NULL)
+    return;
+  memcpy(APP_BASE, staged, staged_size);
+  boot(staged_size, atags);
+}
+
+/*===========================================================================*/
+/* Session.                                                                  */
+/*===========================================================================*/
+
+/**
+ * @brief   Receives a header, 0 if none arrived within @p timeout_ms.
+ */
+static int receive_header(ClHeader *hp, uint32_t timeout_ms) {
+  uint8_t buf[CL_HEADER_SIZE + 4];
+  uint32_t window = 0;
+  int c;
+
+  /* Sync on the magic, anything before it is noise.*/
+  while (window != CL_MAGIC) {
+    if ((c = uart_get(timeout_ms)) < 0)
+      return 0;
+    window = (window >> 8) | ((uint32_t)c << 24);
+  }
+  buf[0] = 'C'; buf[1] = 'H'; buf[2] = 'L'; buf[3] = 'D';
+  if (uart_read(&buf[4], sizeof(buf) - 4, SESSION_TIMEOUT_MS) < 0)
+    return -1;
+  if (crc32(0, buf, CL_HEADER_SIZE) != get_le32(&buf[CL_HEADER_SIZE]))
+    return -1;
+  memcpy(hp, buf, CL_HEADER_SIZE);
+  return 1;
+}
+
+/**
+ * @brief   Receives the stream into @p STREAM_BASE.
+ */
+static int receive_stream(size_t size) {
+  uint8_t hdr[4], tail[4];
+  uint16_t expected = 0;
+  size_t got = 0;
+  unsigned naks = 0;
+
+  while (got < size) {
+    uint16_t seq, len;
+    uint8_t *dst = STREAM_BASE + got;
+    uint32_t crc;
+
+    if (naks > 20)
+      return -1;
+    if (uart_read(hdr, 4, SESSION_TIMEOUT_MS) < 0) {
+      naks++;
+      uart_flush_rx();
+      uart_put(CL_NAK);
+      continue;
+    }
+    seq = hdr[0] | (hdr[1] << 8);
+    len = hdr[2] | (hdr[3] << 8);
+    if ((len == 0) || (len > CL_CHUNK_SIZE)) {
+      naks++;
+      uart_flush_rx();
+      uart_put(CL_NAK);
+      continue;
+    }
+
+    /* A repeat of the previous chunk (our ack was lost) lands past the end
+       of the data and is then dropped.*/
+    if (seq != expected)
+      dst = STREAM_BASE + size;
+    if ((uart_read(dst, len, SESSION_TIMEOUT_MS) < 0) ||
+        (uart_read(tail, 4, SESSION_TIMEOUT_MS) < 0)) {
+      naks++;
+      uart_flush_rx();
+      uart_put(CL_NAK);
+      continue;
+    }
+    crc = crc32(crc32(0, hdr, 4), dst, len);
+    if (crc != get_le32(tail)) {
+      naks++;
+      uart_flush_rx();
+      uart_put(CL_NAK);
+      continue;
+    }
+    if (seq == expected) {
+      if (len > size - got) {
+        uart_put(CL_NAK);
+        return -1;
+      }
+      got += len;
+      expected++;
+      naks = 0;
+    }
+    uart_put(CL_ACK);
+  }
+  return 0;
+}
+
+/**
+ * @brief   Serves one host session.
+ * @return              The size of the image now at 0x8000, 0 if no host
+ *                      showed up, -1 if the session failed.
+ */
+static long session(uint32_t timeout_ms) {
+  ClHeader h;
+  uint8_t digest[SHA256_SIZE];
+  const uint8_t *base = NULL;
+  size_t blen = 0;
+  long n;
+  int r;
+
+  r = receive_header(&h, timeout_ms);
+  if (r == 0)
+    return 0;
+  if ((r < 0) || (h.image_size == 0) || (h.image_size > APP_MAX_SIZE) ||
+      (h.stream_size == 0) || (h.stream_size > STREAM_MAX_SIZE)) {
+    uart_put(CL_REJECT);
+    return -1;
+  }
+
+  if (h.flags & CL_FLAG_DELTA) {
+    if ((staged == NULL) || (h.base_size != staged_size)) {
+      uart_put(CL_NO_BASE);
+      return -1;
+    }
+    sha256(staged, staged_size, digest);
+    if (memcmp(digest, h.base_sha, SHA256_SIZE) != 0) {
+      uart_put(CL_NO_BASE);
+      return -1;
+    }
+    base = staged;
+    blen = staged_size;
+  }
+  uart_put(CL_ACCEPT);
+
+  if (receive_stream(h.stream_size) < 0)
+    return -1;
+
+  n = clUnpack(STREAM_BASE, h.stream_size, base, blen,
+               APP_BASE, APP_MAX_SIZE);
+  if (n != (long)h.image_size) {
+    uart_put(CL_FAILED);
+    return -1;
+  }
+  sha256(APP_BASE, h.image_size, digest);
+  if (memcmp(digest, h.image_sha, SHA256_SIZE) != 0) {
+    uart_put(CL_FAILED);
+    return -1;
+  }
+  uart_put(CL_DONE);
+  return (long)h.image_size;
+}
+
+/**
+ * @brief   Loader entry, called from start.s.
+ */
+void loader_main(uint32_t r0, uint32_t r1, uint32_t atags) {
+  unsigned attempts;
+  long size;
+
+  (void)r0;
+  (void)r1;
+
+  uart_init();
+  find_staged(atags);
+  uart_puts("\r\nchainloader: staged image ");
+  uart_puthex(staged_size);
+  uart_puts(" bytes\r\n");
+
+  /* A host that is waiting answers the request at once. After a refused
+     delta it retries with a full image, so a few sessions are allowed.*/
+  for (attempts = 0; attempts < 3; attempts++) {
+    uart_puts(CL_REQUEST);
+    size = session(attempts == 0 ? LOADER_WAIT_MS : SESSION_TIMEOUT_MS);
+    if (size > 0)
+      boot((size_t)size, atags);
+    if (size == 0)
+      break;
+  }
+
+  uart_puts("chainloader: no new image\r\n");
+  boot_staged(atags);
+
+  /* Nothing to boot: keep listening.*/
+  while (1) {
+    uart_puts(CL_REQUEST);
+    size = session(SESSION_TIMEOUT_MS);
+    if (size > 0)
+      boot((size_t)size, atags);
+  }
+}
@@ -0,0 +1,80 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Chainloader entry point.
+ *
+ * The firmware loads chainload.img at 0x8000 like any kernel, but the
+ * application must go there, so the loader first copies itself to its link
+ * address (see loader.ld) and continues from the copy. The code up to the
+ * jump is position independent.
+ *
+ * r0-r2 from the firmware (r2 = ATAGS) are handed to loader_main() and,
+ * eventually, to the application.
+ */
+
+        .section .start
+        .code   32
+        .balign 4
+
+        .global _start
+_start:
+        adr     r3, _start              /* Where we run now.                */
+        ldr     r4, =_start             /* Where we are linked.             */
+        ldr     r5, =__image_end
+copy:
+        ldmia   r3!, {r6, r7, r8, r9}
+        stmia   r4!, {r6, r7, r8, r9}
+        cmp     r4, r5
+        blo     copy
+        ldr     pc, =relocated
+
+relocated:
+        ldr     sp, =__stack_top
+        mov     r3, #0
+        ldr     r4, =__bss_start
+        ldr     r5, =__bss_end
+bssloop:
+        cmp     r4, r5
+        strlo   r3, [r4], #4
+        blo     bssloop
+        bl      loader_main
+halt:
+        b       halt
+
+/*
+ * void loader_jump(uint32_t entry, uint32_t r0, uint32_t r1, uint32_t r2)
+ *
+ * Makes freshly written code visible to the instruction side and enters it.
+ */
+        .text
+        .global loader_jump
+loader_jump:
+        mov     r12, r0
+        mov     r0, #0
+        mcr     p15, 0, r0, c7, c14, 0  /* Clean+invalidate D cache.        */
+        mcr     p15, 0, r0, c7, c10, 4  /* Drain write buffer (DSB).        */
+        mcr     p15, 0, r0, c7, c5, 0   /* Invalidate I cache.              */
+        mcr     p15, 0, r0, c7, c5, 6   /* Flush branch target cache.       */
+        mcr     p15, 0, r0, c7, c5, 4   /* Flush prefetch buffer (ISB).     */
+        mov     r0, r1
+        mov     r1, r2
+        mov     r2, r3
+        bx      r12
@@ -0,0 +1,109 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    unpack.c
+ * @brief   Chainloader image stream decoder, see chainload.h.
+ */
+
+#include "chainload.h"
+
+typedef struct {
+  const uint8_t         *p;
+  const uint8_t         *end;
+  int                   bad;
+} reader_t;
+
+static uint32_t varint(reader_t *rp) {
+  uint32_t v = 0;
+  unsigned shift = 0;
+
+  while (rp->p < rp->end) {
+    uint8_t b = *rp->p++;
+    v |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80))
+      return v;
+    shift += 7;
+    if (shift > 28)
+      break;
+  }
+  rp->bad = 1;
+  return 0;
+}
+
+/**
+ * @brief   Unpacks an image stream.
+ *
+ * @param[in] sp        stream
+ * @param[in] slen      stream length
+ * @param[in] base      delta base image, can be @p NULL if unused
+ * @param[in] blen      delta base length
+ * @param[out] dp       output buffer
+ * @param[in] dlen      output buffer size
+ * @return              The unpacked size, -1 if the stream is malformed or
+ *                      references data out of bounds.
+ */
+long clUnpack(const uint8_t *sp, size_t slen, const uint8_t *base,
+              size_t blen, uint8_t *dp, size_t dlen) {
+  reader_t r = {sp, sp + slen, 0};
+  size_t o = 0;
+
+  while (r.p < r.end) {
+    uint8_t t = *r.p++;
+    unsigned op = t >> 6;
+    size_t n = t & 0x3F;
+    const uint8_t *src;
+
+    if (op == 3)
+      return (long)o;
+
+    n += (op == 0) ? 1 : 4;
+    if ((t & 0x3F) == 0x3F)
+      n += varint(&r);
+    if (r.bad || (n > dlen - o))
+      return -1;
+
+    if (op == 0) {
+      if (n > (size_t)(r.end - r.p))
+        return -1;
+      src = r.p;
+      r.p += n;
+    }
+    else if (op == 1) {
+      size_t dist = (size_t)varint(&r) + 1;
+      if (r.bad || (dist > o))
+        return -1;
+      src = dp + o - dist;
+    }
+    else {
+      uint32_t z = varint(&r);
+      long pos = (long)o + ((z & 1) ? -(long)(z >> 1) - 1 : (long)(z >> 1));
+      if (r.bad || (base == NULL) || (pos < 0) || ((size_t)pos > blen) ||
+          (n > blen - (size_t)pos))
+        return -1;
+      src = base + pos;
+    }
+
+    /* Byte by byte, output copies may overlap.*/
+    while (n--)
+      dp[o++] = *src++;
+  }
+  return -1;
+}
@@ -0,0 +1,253 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Coroutine timing test. A driver coroutine starts the test cases one
+ * after the other in the same scheduler and each case records its wake up
+ * times, checked once all of them are done. The work between the waits
+ * blocks the scheduler thread, as slow driver code would.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ch.h"
+#include "hal.h"
+#include "coro.h"
+
+#define ROUNDS              10
+#define PERIOD              MS2ST(50)
+#define WORK                MS2ST(7)
+/* The coro.h example, scaled down.*/
+#define CONV_TIME           MS2ST(9)
+#define CONV_PERIOD         MS2ST(100)
+#define SIGNAL_AFTER        MS2ST(5)
+#define EVENT_TIMEOUT       MS2ST(20)
+/* Accepted wake up lateness, below WORK and CONV_TIME so that a period
+   lengthened by either fails.*/
+#define TOLERANCE           3
+
+#define EVT_TEST            EVENT_MASK(0)
+
+typedef struct {
+  Coro          coro;
+  const char    *name;
+  corofunc_t    func;
+  unsigned      round;
+  bool_t        done;
+  systime_t     start;
+  systime_t     t[ROUNDS];
+  systime_t     u[ROUNDS];
+} Case;
+
+typedef struct {
+  Coro          coro;
+  unsigned      i;
+} Driver;
+
+static CoroScheduler sched;
+static Driver driver;
+static SEMAPHORE_DECL(finished, 0);
+static VirtualTimer vt;
+
+/*
+ * Periodic loop on CORO_SLEEP_NEXT, the wake ups stay on the grid.
+ */
+static msg_t next_task(Coro *cp) {
+  Case *cs = (Case *)cp;
+
+  CORO_BEGIN(cp);
+  for (cs->round = 0; cs->round < ROUNDS; cs->round++) {
+    CORO_SLEEP_NEXT(cp, PERIOD);
+    cs->t[cs->round] = chTimeNow();
+    chThdSleep(WORK);
+  }
+  cs->done = TRUE;
+  CORO_END(cp);
+}
+
+/*
+ * Same loop on CORO_SLEEP, every period is lengthened by the work.
+ */
+static msg_t sleep_task(Coro *cp) {
+  Case *cs = (Case *)cp;
+
+  CORO_BEGIN(cp);
+  for (cs->round = 0; cs->round < ROUNDS; cs->round++) {
+    CORO_SLEEP(cp, PERIOD);
+    cs->t[cs->round] = chTimeNow();
+    chThdSleep(WORK);
+  }
+  cs->done = TRUE;
+  CORO_END(cp);
+}
+
+/*
+ * The coro.h example, conversion starts in t[] and reads in u[].
+ */
+static msg_t example_task(Coro *cp) {
+  Case *cs = (Case *)cp;
+
+  CORO_BEGIN(cp);
+  for (cs->round = 0; cs->round < ROUNDS; cs->round++) {
+    cs->t[cs->round] = chTimeNow();
+    CORO_SLEEP(cp, CONV_TIME);
+    cs->u[cs->round] = chTimeNow();
+    chThdSleep(WORK);
+    CORO_SLEEP_NEXT(cp, CONV_PERIOD - CONV_TIME);
+  }
+  cs->done = TRUE;
+  CORO_END(cp);
+}
+
+static void signal_cb(void *p) {
+
+  (void)p;
+  chSysLockFromIsr();
+  coroSignalI(&sched, EVT_TEST);
+  chSysUnlockFromIsr();
+}
+
+/*
+ * Event wait answered by a timer, then one that times out.
+ */
+static msg_t events_task(Coro *cp) {
+  Case *cs = (Case *)cp;
+
+  CORO_BEGIN(cp);
+  chSysLock();
+  chVTSetI(&vt, SIGNAL_AFTER, signal_cb, NULL);
+  chSysUnlock();
+  CORO_WAIT_EVENTS_TIMEOUT(cp, EVT_TEST, EVENT_TIMEOUT);
+  cs->t[0] = chTimeNow();
+  cs->u[0] = coroGetEvents(cp);
+  CORO_WAIT_EVENTS_TIMEOUT(cp, EVT_TEST, EVENT_TIMEOUT);
+  cs->t[1] = chTimeNow();
+  cs->u[1] = coroGetEvents(cp);
+  cs->done = TRUE;
+  CORO_END(cp);
+}
+
+static Case cases[] = {
+  {{0}, "next",    next_task,    0, FALSE, 0, {0}, {0}},
+  {{0}, "sleep",   sleep_task,   0, FALSE, 0, {0}, {0}},
+  {{0}, "example", example_task, 0, FALSE, 0, {0}, {0}},
+  {{0}, "events",  events_task,  0, FALSE, 0, {0}, {0}}
+};
+
+#define CASES               (sizeof(cases) / sizeof(cases[0]))
+
+static msg_t driver_task(Coro *cp) {
+  Driver *dp = (Driver *)cp;
+
+  CORO_BEGIN(cp);
+  for (dp->i = 0; dp->i < CASES; dp->i++) {
+    cases[dp->i].start = chTimeNow();
+    coroStart(&sched, &cases[dp->i].coro, cases[dp->i].func, NULL, EVT_TEST);
+    CORO_WAIT_UNTIL(cp, cases[dp->i].done);
+  }
+  chSemSignal(&finished);
+  CORO_END(cp);
+}
+
+static WORKING_AREA(waScheduler, 2048);
+static msg_t Scheduler(void *p) {
+
+  (void)p;
+  coroSchedRun(&sched);
+  return 0;
+}
+
+static bool_t within(systime_t t, systime_t expected) {
+
+  return (t >= expected) && (t <= expected + TOLERANCE);
+}
+
+static bool_t check(const char *name, bool_t ok, const char *what) {
+
+  if (!ok)
+    printf("%-8s FAIL, %s\n", name, what);
+  return ok;
+}
+
+/*------------------------------------------------------------------------*
+ * Simulator main.                                                        *
+ *------------------------------------------------------------------------*/
+int main(void) {
+  Case *cs;
+  systime_t late;
+  bool_t pass = TRUE;
+  unsigned k;
+
+  halInit();
+  chSysInit();
+
+  coroSchedInit(&sched);
+  coroStart(&sched, &driver.coro, driver_task, NULL, 0);
+  chThdCreateStatic(waScheduler, sizeof(waScheduler), NORMALPRIO + 1,
+                    Scheduler, NULL);
+  chSemWait(&finished);
+
+  cs = &cases[0];
+  late = 0;
+  for (k = 0; k < ROUNDS; k++) {
+    systime_t deadline = cs->start + (k + 1) * PERIOD;
+
+    pass &= check(cs->name, within(cs->t[k], deadline), "off the period grid");
+    if (cs->t[k] - deadline > late)
+      late = cs->t[k] - deadline;
+  }
+  printf("%-8s %u periods of %u ticks, max lateness %u ticks\n",
+         cs->name, ROUNDS, (unsigned)PERIOD, (unsigned)late);
+
+  cs = &cases[1];
+  late = cs->t[ROUNDS - 1] - (cs->start + ROUNDS * PERIOD);
+  pass &= check(cs->name, late >= (ROUNDS - 1) * WORK, "no drift");
+  printf("%-8s %u periods of %u ticks, drifted %u ticks\n",
+         cs->name, ROUNDS, (unsigned)PERIOD, (unsigned)late);
+
+  cs = &cases[2];
+  late = 0;
+  for (k = 0; k < ROUNDS; k++) {
+    pass &= check(cs->name, cs->u[k] - cs->t[k] >= CONV_TIME,
+                  "read before the conversion time");
+    pass &= check(cs->name, within(cs->t[k], cs->t[0] + k * CONV_PERIOD),
+                  "conversions off the period grid");
+    if (cs->t[k] - (cs->t[0] + k * CONV_PERIOD) > late)
+      late = cs->t[k] - (cs->t[0] + k * CONV_PERIOD);
+  }
+  printf("%-8s %u conversions every %u ticks, max lateness %u ticks\n",
+         cs->name, ROUNDS, (unsigned)CONV_PERIOD, (unsigned)late);
+
+  cs = &cases[3];
+  pass &= check(cs->name, (cs->u[0] == EVT_TEST) &&
+                          within(cs->t[0], cs->start + SIGNAL_AFTER),
+                "signal not received in time");
+  pass &= check(cs->name, (cs->u[1] == 0) &&
+                          within(cs->t[1], cs->t[0] + EVENT_TIMEOUT),
+                "no timeout");
+  printf("%-8s signalled after %u ticks, timed out after %u ticks\n",
+         cs->name, (unsigned)(cs->t[0] - cs->start),
+         (unsigned)(cs->t[1] - cs->t[0]));
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  fflush(stdout);
+  exit(pass ? 0 : 1);
+}
@@ -0,0 +1,199 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * MS8607 trace replay. The sensor driver talks to the Posix I2C replay
+ * backend, which answers from a trace captured on the target, and runs
+ * the firmware sequence until the trace ends.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ch.h"
+#include "hal.h"
+#include "ms8607.h"
+
+/* Pause between readings, as in the firmware.*/
+#define READING_PERIOD_MS   1000
+
+static I2CConfig i2c_config = {NULL, I2C_REPLAY_TIMING};
+static ms8607_host_functions host_funcs;
+static unsigned callback_errors, nacks;
+
+/*
+ * A recorded timeout leaves the driver locked, restarting it keeps the
+ * replay position.
+ */
+static enum ms8607_status i2c_status(I2CDriver *i2cp, msg_t msg) {
+
+  if (msg == RDY_OK)
+    return ms8607_status_ok;
+  if (msg == RDY_TIMEOUT)
+    i2cStart(i2cp, &i2c_config);
+  if ((msg == RDY_RESET) && (i2cGetErrors(i2cp) == I2CD_ACK_FAILURE)) {
+    nacks++;
+    return ms8607_status_callback_i2c_nack;
+  }
+  callback_errors++;
+  return ms8607_status_callback_error;
+}
+
+static enum ms8607_status i2c_read(void *ctx,
+                                   ms8607_i2c_controller_packet *const pp) {
+  I2CDriver *i2cp = ctx;
+
+  return i2c_status(i2cp, i2cMasterReceive(i2cp, pp->address,
+                                           pp->data, pp->data_length));
+}
+
+static enum ms8607_status i2c_write(void *ctx,
+                                    ms8607_i2c_controller_packet *const pp) {
+  I2CDriver *i2cp = ctx;
+  uint8_t rxbuf[1];
+
+  return i2c_status(i2cp, i2cMasterTransmit(i2cp, pp->address, pp->data,
+                                            pp->data_length, rxbuf, 0));
+}
+
+static enum ms8607_status i2c_write_no_stop(void *ctx,
+                                            ms8607_i2c_controller_packet *const pp) {
+
+  (void)ctx;
+  (void)pp;
+  return ms8607_status_callback_error;
+}
+
+static enum ms8607_status sleep_ms(void *ctx, uint32_t ms) {
+
+  (void)ctx;
+  if (ms > 0)
+    chThdSleepMilliseconds(ms);
+  return ms8607_status_ok;
+}
+
+static void print_string(void *ctx, const char *text) {
+
+  (void)ctx;
+  printf("%s", text);
+}
+
+static void print_int64(void *ctx, int64_t number, uint8_t pad_width,
+                        ms8607_bool pad_with_zeroes) {
+
+  (void)ctx;
+  printf(pad_with_zeroes ? "%0*lld" : "%*lld", pad_width, (long long)number);
+}
+
+static void assign_functions(ms8607_host_functions *deps, void *ctx) {
+
+  (void)ctx;
+  deps->i2c_controller_read          = i2c_read;
+  deps->i2c_controller_write         = i2c_write;
+  deps->i2c_controller_write_no_stop = i2c_write_no_stop;
+  deps->sleep_ms                     = sleep_ms;
+  deps->print_string                 = print_string;
+  deps->print_int64                  = print_int64;
+}
+
+/*
+ * Setup steps are retried, as the firmware does, for as long as the trace
+ * lasts.
+ */
+static bool_t setup_step(const char *what, enum ms8607_status status) {
+
+  if (status != ms8607_status_ok)
+    printf("%s: %s\n", what, ms8607_stringize_error(status));
+  return (status == ms8607_status_ok) || I2CD1.ended;
+}
+
+int main(int argc, char *argv[]) {
+  ms8607_sensor sensor;
+  I2CDriver *i2cp = &I2CD1;
+  unsigned readings = 0, failed = 0;
+  systime_t start;
+  bool_t pass;
+
+  if ((argc == 3) && (strcmp(argv[1], "-f") == 0))
+    i2c_config.flags &= ~I2C_REPLAY_TIMING;
+  else if (argc != 2) {
+    printf("usage: %s [-f] trace\n", argv[0]);
+    exit(2);
+  }
+  i2c_config.path = argv[argc - 1];
+
+  halInit();
+  chSysInit();
+
+  if ((ms8607_init_and_assign_host_functions(&host_funcs, NULL,
+                                             assign_functions) != ms8607_status_ok) ||
+      (ms8607_init_sensor(&sensor, &host_funcs) != ms8607_status_ok)) {
+    printf("MS8607 driver initialization failed\n");
+    exit(2);
+  }
+  i2cStart(i2cp, &i2c_config);
+  start = chTimeNow();
+
+  while (!setup_step("reset", ms8607_reset(&sensor, i2cp)))
+    chThdSleepMilliseconds(1000);
+  while (!setup_step("heater", ms8607_disable_heater(&sensor, i2cp)))
+    chThdSleepMilliseconds(1000);
+  while (!setup_step("humidity resolution",
+                     ms8607_set_humidity_resolution(&sensor,
+                         ms8607_humidity_resolution_12b, i2cp)))
+    chThdSleepMilliseconds(1000);
+  ms8607_set_pressure_resolution(&sensor, ms8607_pressure_resolution_osr_2048,
+                                 i2cp);
+  ms8607_set_humidity_i2c_controller_mode(&sensor, ms8607_i2c_no_hold, i2cp);
+
+  while (!i2cp->ended) {
+    int32_t temperature, pressure, humidity;
+    enum ms8607_status status;
+
+    status = ms8607_read_temperature_pressure_humidity_int32(
+        &sensor, &temperature, &pressure, &humidity, i2cp);
+    if (status == ms8607_status_ok) {
+      readings++;
+      printf("%8u ms  %.3f degC  %.3f mbar  %.3f %%RH\n",
+             (unsigned)((chTimeNow() - start) * 1000 / CH_FREQUENCY),
+             temperature / 1000.0, pressure / 1000.0, humidity / 1000.0);
+    }
+    else if (!i2cp->ended) {
+      failed++;
+      printf("reading: %s\n", ms8607_stringize_error(status));
+    }
+    chThdSleepMilliseconds(READING_PERIOD_MS);
+  }
+
+  printf("readings: %u taken, %u failed\n", readings, failed);
+  printf("bus: %u NACKs, %u errors\n", nacks, callback_errors);
+  printf("replay: %u transactions, %u mismatched, %u after dropped records\n",
+         (unsigned)i2cp->replayed, (unsigned)i2cp->mismatches,
+         (unsigned)i2cp->gaps);
+  printf("time: %u ms simulated\n",
+         (unsigned)((chTimeNow() - start) * 1000 / CH_FREQUENCY));
+
+  pass = (i2cp->replayed > 0) && (i2cp->mismatches == 0);
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  fflush(stdout);
+  i2cStop(i2cp);
+  exit(pass ? 0 : 1);
+}
@@ -0,0 +1,207 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Latest value table stress test. One writer publishes records whose
+ * values are derived from the channel and the write count, so a reader can
+ * tell a torn record. The readers are preempted in the middle of their
+ * copies through LV_READ_HOOK, once with the lock free table and once with
+ * a mutex protected copy of the same records for comparison.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ch.h"
+#include "hal.h"
+#include "lvtable.h"
+
+#define CHANNELS            4
+#define READERS             8
+#define RUN_TIME            S2ST(10)
+/* Every this many copies a reader is preempted in the middle, for this
+   long. Longer than the writer period, so that a writer waiting for a
+   reader misses its deadline.*/
+#define PREEMPT_EVERY       4
+#define PREEMPT_TICKS       2
+
+typedef struct {
+  const char    *name;
+  bool_t        locked;
+  uint32_t      reads;
+  uint32_t      retries;
+  uint32_t      torn;
+  uint32_t      writes;
+  systime_t     max_latency;
+  uint64_t      sum_latency;
+} run_t;
+
+static LvTable table;
+static LvChannel channels[CHANNELS];
+
+/* Mutex protected reference.*/
+static MUTEX_DECL(mtx);
+static LvRecord records[CHANNELS];
+
+static run_t *current;
+
+static WORKING_AREA(waWriter, 2048);
+static WORKING_AREA(waReaders[READERS], 2048);
+
+/*
+ * Reader copy hook, sleeping inside every PREEMPT_EVERY-th copy lets the
+ * writer run in the middle of it.
+ */
+void lv_read_hook(void) {
+  static unsigned copies;
+
+  if (++copies % PREEMPT_EVERY == 0)
+    chThdSleep(PREEMPT_TICKS);
+}
+
+static void make_values(unsigned ch, uint32_t count, int32_t *values) {
+  unsigned i;
+
+  for (i = 0; i < LV_VALUES; i++)
+    values[i] = (int32_t)(count * 1000 + ch * 10 + i);
+}
+
+static bool_t is_torn(unsigned ch, const LvRecord *rp) {
+  int32_t values[LV_VALUES];
+  unsigned i;
+
+  if (rp->count == 0)
+    return FALSE;
+  make_values(ch, rp->count, values);
+  for (i = 0; i < LV_VALUES; i++)
+    if (rp->value[i] != values[i])
+      return TRUE;
+  return FALSE;
+}
+
+static msg_t Writer(void *arg) {
+  systime_t next = chTimeNow();
+  int32_t values[LV_VALUES];
+  uint32_t count = 0;
+  unsigned ch, i;
+
+  (void)arg;
+  while (!chThdShouldTerminate()) {
+    next += 1;
+    if ((int32_t)(next - chTimeNow()) > 0)
+      chThdSleepUntil(next);
+    count++;
+    for (ch = 0; ch < CHANNELS; ch++) {
+      make_values(ch, count, values);
+      if (current->locked) {
+        chMtxLock(&mtx);
+        records[ch].stamp = chTimeNow();
+        records[ch].count = count;
+        for (i = 0; i < LV_VALUES; i++)
+          records[ch].value[i] = values[i];
+        chMtxUnlock();
+      }
+      else
+        lvWrite(&table, ch, values);
+    }
+    current->writes++;
+    current->sum_latency += chTimeNow() - next;
+    if (chTimeNow() - next > current->max_latency)
+      current->max_latency = chTimeNow() - next;
+    /* Missed deadlines are dropped rather than caught up in a burst.*/
+    if ((int32_t)(chTimeNow() - next) > 0)
+      next = chTimeNow();
+  }
+  return 0;
+}
+
+static msg_t Reader(void *arg) {
+  unsigned ch = (unsigned)(uintptr_t)arg % CHANNELS;
+  LvRecord rec;
+
+  while (!chThdShouldTerminate()) {
+    if (current->locked) {
+      chMtxLock(&mtx);
+      rec = records[ch];
+      LV_READ_HOOK(ch);
+      chMtxUnlock();
+    }
+    else
+      current->retries += lvRead(&table, ch, &rec);
+    current->reads++;
+    if (is_torn(ch, &rec))
+      current->torn++;
+    ch = (ch + 1) % CHANNELS;
+  }
+  return 0;
+}
+
+static void run(run_t *rp) {
+  Thread *threads[READERS + 1];
+  unsigned i, rate;
+
+  current = rp;
+  lvObjectInit(&table, channels, CHANNELS);
+  for (i = 0; i < CHANNELS; i++)
+    records[i].count = 0;
+
+  threads[0] = chThdCreateStatic(waWriter, sizeof(waWriter), HIGHPRIO,
+                                 Writer, NULL);
+  for (i = 0; i < READERS; i++)
+    threads[1 + i] = chThdCreateStatic(waReaders[i], sizeof(waReaders[i]),
+                                       NORMALPRIO, Reader,
+                                       (void *)(uintptr_t)i);
+  chThdSleep(RUN_TIME);
+  for (i = 0; i < READERS + 1; i++)
+    chThdTerminate(threads[i]);
+  for (i = 0; i < READERS + 1; i++)
+    chThdWait(threads[i]);
+
+  rate = (unsigned)((uint64_t)rp->retries * 10000 / rp->reads);
+  printf("%-8s %7u reads, %6u retried (%u.%.2u%%), %u torn, "
+         "writer latency avg %u.%.2u max %u ticks over %u writes\n",
+         rp->name, rp->reads, rp->retries, rate / 100, rate % 100, rp->torn,
+         (unsigned)(rp->sum_latency / rp->writes),
+         (unsigned)(rp->sum_latency * 100 / rp->writes % 100),
+         (unsigned)rp->max_latency, rp->writes);
+}
+
+/*------------------------------------------------------------------------*
+ * Simulator main.                                                        *
+ *------------------------------------------------------------------------*/
+int main(void) {
+  static run_t lockfree = {"lvtable", FALSE, 0, 0, 0, 0, 0, 0};
+  static run_t locked = {"mutex", TRUE, 0, 0, 0, 0, 0, 0};
+  bool_t pass;
+
+  halInit();
+  chSysInit();
+
+  printf("%u channels, %u readers, a preemption every %u copies\n",
+         CHANNELS, READERS, PREEMPT_EVERY);
+  run(&lockfree);
+  run(&locked);
+
+  pass = (lockfree.torn == 0) && (lockfree.retries > 0) &&
+         (locked.torn == 0);
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  fflush(stdout);
+  exit(pass ? 0 : 1);
+}
@@ -0,0 +1,167 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Memory routines check. memops.c replaces the C library memcpy, memmove,
+ * memset and strlen in this program, as armmem.s does on the target, and
+ * is compared with plain byte loops over every length up to a few bursts,
+ * every alignment of source and destination and, for memmove, every
+ * overlap. Guard bytes around the destination catch stray writes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ch.h"
+#include "hal.h"
+
+#define MAX_LEN             200
+#define MAX_OFFSET          8
+#define GUARD               0xA5
+#define AREA_SIZE           (MAX_LEN + 4 * MAX_OFFSET)
+
+static uint8_t src[AREA_SIZE] __attribute__((aligned(8)));
+static uint8_t dst[AREA_SIZE] __attribute__((aligned(8)));
+static uint8_t ref[AREA_SIZE] __attribute__((aligned(8)));
+
+static unsigned cases, failures;
+
+static void ref_copy(uint8_t *d, const uint8_t *s, size_t n) {
+
+  while (n-- > 0)
+    *d++ = *s++;
+}
+
+static void ref_move(uint8_t *d, const uint8_t *s, size_t n) {
+  uint8_t tmp[AREA_SIZE];
+
+  ref_copy(tmp, s, n);
+  ref_copy(d, tmp, n);
+}
+
+static void fill(uint8_t *p, size_t n, unsigned seed) {
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    p[i] = (uint8_t)(seed + i * 7 + (i >> 8));
+}
+
+static void check(const char *name, bool_t ok, size_t n, size_t doff,
+                  size_t soff) {
+
+  cases++;
+  if (!ok) {
+    if (failures++ < 10)
+      printf("%s: n=%u dst+%u src+%u failed\n", name, (unsigned)n,
+             (unsigned)doff, (unsigned)soff);
+  }
+}
+
+static void check_memcpy(void) {
+  size_t n, doff, soff;
+
+  for (n = 0; n <= MAX_LEN; n++)
+    for (doff = 0; doff < MAX_OFFSET; doff++)
+      for (soff = 0; soff < MAX_OFFSET; soff++) {
+        size_t i;
+        void *r;
+
+        fill(src, AREA_SIZE, (unsigned)n);
+        for (i = 0; i < AREA_SIZE; i++)
+          dst[i] = ref[i] = GUARD;
+        ref_copy(ref + doff, src + soff, n);
+        r = memcpy(dst + doff, src + soff, n);
+        check("memcpy", r == dst + doff &&
+              memcmp(dst, ref, AREA_SIZE) == 0, n, doff, soff);
+      }
+}
+
+/* Source and destination in the same area, the destination anywhere from
+   MAX_OFFSET bytes below the source to MAX_OFFSET bytes past its end.*/
+static void check_memmove(void) {
+  size_t n, doff, soff = 2 * MAX_OFFSET;
+
+  for (n = 0; n <= MAX_LEN; n++)
+    for (doff = soff - MAX_OFFSET; doff <= soff + n + MAX_OFFSET; doff++) {
+      void *r;
+
+      if (doff + n > AREA_SIZE)
+        break;
+      fill(dst, AREA_SIZE, (unsigned)doff);
+      ref_copy(ref, dst, AREA_SIZE);
+      ref_move(ref + doff, ref + soff, n);
+      r = memmove(dst + doff, dst + soff, n);
+      check("memmove", r == dst + doff &&
+            memcmp(dst, ref, AREA_SIZE) == 0, n, doff, soff);
+    }
+}
+
+static void check_memset(void) {
+  static const int values[] = {0x00, 0xFF, 0x5A, 0x1C3};
+  size_t n, doff, v;
+
+  for (n = 0; n <= MAX_LEN; n++)
+    for (doff = 0; doff < MAX_OFFSET; doff++)
+      for (v = 0; v < sizeof values / sizeof values[0]; v++) {
+        size_t i;
+        void *r;
+
+        for (i = 0; i < AREA_SIZE; i++)
+          dst[i] = ref[i] = GUARD;
+        for (i = 0; i < n; i++)
+          ref[doff + i] = (uint8_t)values[v];
+        r = memset(dst + doff, values[v], n);
+        check("memset", r == dst + doff &&
+              memcmp(dst, ref, AREA_SIZE) == 0, n, doff, v);
+      }
+}
+
+/* Every byte value up to the terminator, 0x80 and 0x01 included, which
+   would fool a sloppier zero byte test.*/
+static void check_strlen(void) {
+  size_t n, soff;
+
+  for (n = 0; n <= MAX_LEN; n++)
+    for (soff = 0; soff < MAX_OFFSET; soff++) {
+      size_t i;
+
+      for (i = 0; i < AREA_SIZE; i++)
+        src[i] = (uint8_t)(1 + (i + n) % 255);
+      src[soff + n] = '\0';
+      check("strlen", strlen((const char *)src + soff) == n, n, 0, soff);
+    }
+}
+
+int main(void) {
+
+  halInit();
+  chSysInit();
+
+  check_memcpy();
+  check_memmove();
+  check_memset();
+  check_strlen();
+
+  printf("%u cases, %u failures\n", cases, failures);
+  printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+  fflush(stdout);
+  exit(failures == 0 ? 0 : 1);
+}
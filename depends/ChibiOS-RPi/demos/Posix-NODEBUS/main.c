@@ -0,0 +1,357 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Node bus collector model. One collector and NODES nodes share a
+ * simulated half duplex line: a wire thread moves the bytes the ports
+ * queued at the line speed and garbles everything when two ports drive the
+ * line in the same tick. The run injects bit errors and takes a node off
+ * the line for a while, then checks that every node joined, that records
+ * got through without loss or duplicates and that first-time batches met
+ * the TDMA latency bound.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ch.h"
+#include "hal.h"
+#include "chprintf.h"
+#include "bulkxfer.h"
+#include "nodebus.h"
+
+#define NODES               24
+#define BAUD                115200
+#define SLOT_MS             10
+#define GUARD_MS            1
+#define RECORD_PERIOD       MS2ST(50)
+#define QUEUE_DEPTH         64
+#define RUN_TIME            S2ST(40)
+#define OFFLINE_NODE        5
+#define OFFLINE_FROM        S2ST(15)
+#define OFFLINE_TO          S2ST(20)
+/* One flipped bit in this many bytes.*/
+#define BIT_ERROR_RATE      20000
+
+#define PORTS               (NODES + 1)
+#define CYCLE               MS2ST(NB_CYCLE_MS(NODES, SLOT_MS))
+
+/*
+ * Record layout: origin time, node index, per node counter.
+ */
+typedef struct {
+  uint32_t      stamp;
+  uint16_t      node;
+  uint16_t      counter;
+} record_t;
+
+static SerialDriver ports[PORTS];
+static bool_t offline[PORTS];
+static uint32_t wire_collisions, wire_errors;
+
+static NbCollector collector;
+static NbNode nodes[NODES];
+static NbNodeConfig node_configs[NODES];
+static uint8_t queues[NODES][QUEUE_DEPTH * sizeof(record_t)];
+
+static uint16_t next_counter[NODES];
+static uint8_t last_flags[NODES];
+static uint32_t delivered, lost, duplicated;
+static systime_t max_latency, max_delayed_latency;
+
+static WORKING_AREA(waWire, 2048);
+static WORKING_AREA(waCollector, 4096);
+static WORKING_AREA(waProducer, 2048);
+static WORKING_AREA(waNodes[NODES], 4096);
+
+/*
+ * Standard output stream, the simulated serial ports carry the bus.
+ */
+static msg_t out_put(void *ip, uint8_t b) {
+
+  (void)ip;
+  putchar(b);
+  return RDY_OK;
+}
+
+static size_t out_write(void *ip, const uint8_t *bp, size_t n) {
+
+  (void)ip;
+  return fwrite(bp, 1, n, stdout);
+}
+
+static size_t out_read(void *ip, uint8_t *bp, size_t n) {
+
+  (void)ip;
+  (void)bp;
+  (void)n;
+  return 0;
+}
+
+static msg_t out_get(void *ip) {
+
+  (void)ip;
+  return RDY_RESET;
+}
+
+static const struct BaseSequentialStreamVMT out_vmt = {
+  out_write, out_read, out_put, out_get
+};
+
+static BaseSequentialStream out = {&out_vmt};
+
+/*
+ * Simulated line. Every tick each transmitting port shifts out what the
+ * line speed allows, a port alone on the line is heard by all the others.
+ */
+static msg_t WireThread(void *arg) {
+  static uint32_t credit[PORTS];
+  static uint8_t bytes[PORTS][4 * (BAUD / 10 / CH_FREQUENCY + 1)];
+  static size_t n[PORTS];
+  uint32_t rng = 12345;
+  systime_t last = chTimeNow();
+
+  (void)arg;
+  chRegSetThreadName("wire");
+  while (!chThdShouldTerminate()) {
+    unsigned i, j, talkers = 0;
+    systime_t elapsed;
+
+    chThdSleep(1);
+    elapsed = chTimeNow() - last;
+    last += elapsed;
+
+    chSysLock();
+    for (i = 0; i < PORTS; i++) {
+      n[i] = 0;
+      if (chOQIsEmptyI(&ports[i].oqueue)) {
+        credit[i] = 0;
+        continue;
+      }
+      credit[i] += BAUD / 10 * elapsed;
+      while ((credit[i] >= CH_FREQUENCY) && (n[i] < sizeof(bytes[i]))) {
+        msg_t b = sdRequestDataI(&ports[i]);
+
+        if (b < Q_OK)
+          break;
+        credit[i] -= CH_FREQUENCY;
+        bytes[i][n[i]++] = (uint8_t)b;
+      }
+      if (n[i] == sizeof(bytes[i]))
+        credit[i] = 0;
+      if ((n[i] > 0) && !offline[i])
+        talkers++;
+    }
+    if (talkers > 1)
+      wire_collisions++;
+
+    for (i = 0; i < PORTS; i++) {
+      size_t k;
+
+      if (offline[i])
+        continue;
+      for (k = 0; k < n[i]; k++) {
+        uint8_t b = bytes[i][k];
+
+        rng = rng * 1664525 + 1013904223;
+        if (talkers > 1)
+          b ^= (uint8_t)(rng >> 24) | 1;
+        else if ((rng >> 8) % BIT_ERROR_RATE == 0) {
+          b ^= (uint8_t)(1 << ((rng >> 4) & 7));
+          wire_errors++;
+        }
+        for (j = 0; j < PORTS; j++)
+          if ((j != i) && !offline[j])
+            sdIncomingDataI(&ports[j], b);
+      }
+    }
+    chSysUnlock();
+  }
+  return 0;
+}
+
+static void data_cb(NbCollector *cp, uint8_t addr, uint8_t flags,
+                    const uint8_t *records, unsigned count) {
+  systime_t now = chTimeNow();
+  unsigned i;
+  bool_t delayed;
+
+  /* The TDMA bound holds for records that found the queue short, neither
+     this batch nor the previous one was resent or left records behind.*/
+  (void)cp;
+  delayed = (flags | last_flags[addr - 1]) != 0;
+  for (i = 0; i < count; i++) {
+    record_t r;
+    systime_t latency;
+    uint16_t gap;
+
+    memcpy(&r, &records[i * sizeof(record_t)], sizeof(record_t));
+    if (r.node >= NODES)
+      continue;
+    gap = r.counter - next_counter[r.node];
+    if ((int16_t)gap < 0) {
+      duplicated++;
+      continue;
+    }
+    lost += gap;
+    next_counter[r.node] = r.counter + 1;
+    delivered++;
+
+    latency = now - r.stamp;
+    if (delayed) {
+      if (latency > max_delayed_latency)
+        max_delayed_latency = latency;
+    }
+    else if (latency > max_latency)
+      max_latency = latency;
+  }
+  last_flags[addr - 1] = flags;
+}
+
+static const NbCollectorConfig collector_config = {
+  (BaseChannel *)&ports[0],
+  BAUD,
+  NODES,
+  SLOT_MS,
+  GUARD_MS,
+  sizeof(record_t),
+  data_cb
+};
+
+static msg_t CollectorThread(void *arg) {
+
+  (void)arg;
+  chRegSetThreadName("collector");
+  nbCollectorRun(&collector);
+  return 0;
+}
+
+static msg_t NodeThread(void *arg) {
+
+  chRegSetThreadName("node");
+  nbNodeRun(arg);
+  return 0;
+}
+
+/*
+ * Every node samples at the same rate, the counters reveal losses on the
+ * collector side. Records dropped on a full node queue are counted by the
+ * node.
+ */
+static msg_t ProducerThread(void *arg) {
+  static uint16_t counters[NODES];
+
+  (void)arg;
+  chRegSetThreadName("producer");
+  while (!chThdShouldTerminate()) {
+    unsigned i;
+
+    chThdSleep(RECORD_PERIOD);
+    for (i = 0; i < NODES; i++) {
+      record_t r;
+
+      r.stamp = chTimeNow();
+      r.node = i;
+      r.counter = counters[i];
+      if (nbNodePost(&nodes[i], &r))
+        counters[i]++;
+    }
+  }
+  return 0;
+}
+
+/*------------------------------------------------------------------------*
+ * Simulator main.                                                        *
+ *------------------------------------------------------------------------*/
+int main(void) {
+  Thread *threads[NODES + 3];
+  uint32_t overruns = 0, resent = 0;
+  unsigned i, joined = 0;
+  bool_t pass;
+
+  halInit();
+  chSysInit();
+
+  for (i = 0; i < PORTS; i++)
+    sdObjectInit(&ports[i], NULL, NULL);
+
+  printf("%u nodes, %u ms slots, %u ms cycle, %u records per slot\n",
+         NODES, SLOT_MS, NB_CYCLE_MS(NODES, SLOT_MS),
+         nbSlotCapacity(BAUD, SLOT_MS, GUARD_MS, sizeof(record_t)));
+
+  nbCollectorInit(&collector, &collector_config);
+  for (i = 0; i < NODES; i++) {
+    node_configs[i].chp = (BaseChannel *)&ports[i + 1];
+    node_configs[i].baud = BAUD;
+    node_configs[i].uid = 0x4E420000 + i * 7 + 1;
+    node_configs[i].record_size = sizeof(record_t);
+    node_configs[i].buffer = queues[i];
+    node_configs[i].depth = QUEUE_DEPTH;
+    nbNodeInit(&nodes[i], &node_configs[i]);
+  }
+
+  threads[0] = chThdCreateStatic(waWire, sizeof(waWire), HIGHPRIO,
+                                 WireThread, NULL);
+  threads[1] = chThdCreateStatic(waCollector, sizeof(waCollector),
+                                 NORMALPRIO + 2, CollectorThread, NULL);
+  for (i = 0; i < NODES; i++)
+    threads[2 + i] = chThdCreateStatic(waNodes[i], sizeof(waNodes[i]),
+                                       NORMALPRIO + 1, NodeThread, &nodes[i]);
+  threads[2 + NODES] = chThdCreateStatic(waProducer, sizeof(waProducer),
+                                         NORMALPRIO, ProducerThread, NULL);
+
+  chThdSleepUntil(OFFLINE_FROM);
+  offline[OFFLINE_NODE + 1] = TRUE;
+  printf("node %u off the line\n", OFFLINE_NODE);
+  chThdSleepUntil(OFFLINE_TO);
+  offline[OFFLINE_NODE + 1] = FALSE;
+  printf("node %u back\n", OFFLINE_NODE);
+  chThdSleepUntil(RUN_TIME);
+
+  for (i = 0; i < NODES + 3; i++)
+    chThdTerminate(threads[i]);
+  for (i = 0; i < NODES + 3; i++)
+    chThdWait(threads[i]);
+
+  nbCollectorPrintStats(&out, &collector);
+  for (i = 0; i < NODES; i++) {
+    if (nodes[i].addr != 0)
+      joined++;
+    overruns += nodes[i].overruns;
+    resent += nodes[i].resent;
+  }
+  printf("wire: %u collisions, %u bit errors\n", wire_collisions, wire_errors);
+  printf("nodes: %u/%u addressed, %u batches resent, %u queue overruns\n",
+         joined, NODES, resent, overruns);
+  printf("records: %u delivered, %u lost, %u duplicated\n",
+         delivered, lost, duplicated);
+  printf("latency: %u ticks on time, %u ticks delayed, bound %u ticks\n",
+         (unsigned)max_latency, (unsigned)max_delayed_latency,
+         (unsigned)(CYCLE + MS2ST(SLOT_MS)));
+
+  /* Records dropped on a full node queue never got a counter, any gap is a
+     loss on the bus.*/
+  pass = (joined == NODES) && (delivered > 0) && (lost == 0) &&
+         (duplicated == 0) && (max_latency <= CYCLE + MS2ST(SLOT_MS));
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  fflush(stdout);
+  exit(pass ? 0 : 1);
+}
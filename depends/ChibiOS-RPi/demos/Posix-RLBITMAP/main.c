@@ -0,0 +1,94 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Runs the kernel test suite with the priority bitmap ready list of
+ * os/ports/common/chrlbitmap.c, kernel checks and assertions enabled. The
+ * mutex tests move boosted owners through chSchReadyRemoveI() and the
+ * benchmarks 14 and 16 score the ready list insertion and the wakeup
+ * latency against the number of ready threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ch.h"
+#include "hal.h"
+#include "test.h"
+
+/*
+ * Standard output as a stream, for the test suite report.
+ */
+static size_t writes(void *ip, const uint8_t *bp, size_t n) {
+  size_t ret;
+
+  (void)ip;
+  ret = fwrite(bp, 1, n, stdout);
+  fflush(stdout);
+  return ret;
+}
+
+static size_t reads(void *ip, uint8_t *bp, size_t n) {
+
+  (void)ip;
+  (void)bp;
+  (void)n;
+  return 0;
+}
+
+static msg_t put(void *ip, uint8_t b) {
+
+  (void)ip;
+  fputc(b, stdout);
+  fflush(stdout);
+  return RDY_OK;
+}
+
+static msg_t get(void *ip) {
+
+  (void)ip;
+  return RDY_RESET;
+}
+
+static const struct BaseSequentialStreamVMT vmt = {writes, reads, put, get};
+static BaseSequentialStream out = {&vmt};
+
+/*
+ * Simulator main.
+ */
+int main(int argc, char *argv[]) {
+  msg_t result;
+
+  (void)argc;
+  (void)argv;
+
+  /*
+   * System initializations.
+   * - HAL initialization, this also initializes the configured device drivers
+   *   and performs the board-specific initializations.
+   * - Kernel initialization, the main() function becomes a thread and the
+   *   RTOS is active.
+   */
+  halInit();
+  chSysInit();
+
+  result = TestThread(&out);
+  exit(result ? 1 : 0);
+}
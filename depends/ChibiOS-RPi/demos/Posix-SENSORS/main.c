@@ -0,0 +1,401 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Sensor acquisition model. Mock sensors of different kinds share one
+ * simulated bus and are read through the BaseSensor interface, first one
+ * after the other, then in overlapped batches. Each mock returns readings
+ * derived from its index and measurement count, so a reading delivered to
+ * the wrong job or a lost measurement is detected. Last, the MS8607 driver
+ * of os/various/devices_lib/sensors is read through the engine from the
+ * I2C replay backend.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ch.h"
+#include "hal.h"
+#include "sensoracq.h"
+#include "ms8607sensor.h"
+
+#define SENSORS             8
+#define ROUNDS              50
+#define BUS_HZ              100000
+/* Address and command, or address and a three byte result.*/
+#define CMD_BYTES           2
+#define READ_BYTES          4
+
+/* Trace of tools/i2ctrace/ms8607sim -s, the datasheet calibration and
+   three readings, the humidity collect of the second one NACKed.*/
+#define MS8607_TRACE        "ms8607.bin"
+#define MS8607_READINGS     3
+
+/*
+ * Mock sensor: up to three conversions per measurement, each announced
+ * with its nominal time. With @p late set the conversion really takes up
+ * to two milliseconds longer, every third measurement, and an early
+ * collect is turned away as a real part would NACK it.
+ */
+typedef struct {
+  BaseSensor    base;
+  SensorInfo    info;
+  uint32_t      conv_us[3];
+  bool_t        late;
+  unsigned      index;
+  unsigned      phase;
+  systime_t     ready;
+  int32_t       count;
+  uint32_t      early;
+} MockSensor;
+
+static uint32_t bus_us;
+static uint32_t bus_bytes;
+
+/*
+ * Charges a transfer to the simulated bus, the time is slept in whole
+ * ticks as it accumulates.
+ */
+static void bus_transfer(unsigned n) {
+
+  bus_bytes += n;
+  bus_us += n * 9 * 1000000 / BUS_HZ;
+  if (bus_us >= 1000000 / CH_FREQUENCY) {
+    chThdSleep(bus_us / (1000000 / CH_FREQUENCY));
+    bus_us %= 1000000 / CH_FREQUENCY;
+  }
+}
+
+static void mock_begin(MockSensor *msp, uint32_t *wait_us) {
+  uint32_t us = msp->conv_us[msp->phase];
+
+  if (msp->late)
+    us += 1000 * (msp->count % 3);
+  msp->ready = chTimeNow() + US2ST(us);
+  *wait_us = msp->conv_us[msp->phase];
+}
+
+static const SensorInfo *mock_get_info(void *ip) {
+
+  return &((MockSensor *)ip)->info;
+}
+
+static msg_t mock_start(void *ip, uint32_t *wait_us) {
+  MockSensor *msp = ip;
+
+  bus_transfer(CMD_BYTES);
+  msp->phase = 0;
+  mock_begin(msp, wait_us);
+  return SNS_PENDING;
+}
+
+static msg_t mock_collect(void *ip, uint32_t *wait_us) {
+  MockSensor *msp = ip;
+
+  if ((int32_t)(msp->ready - chTimeNow()) > 0) {
+    bus_transfer(1);
+    msp->early++;
+    *wait_us = 1000;
+    return SNS_PENDING;
+  }
+  bus_transfer(READ_BYTES);
+  if (++msp->phase < msp->info.conversions) {
+    bus_transfer(CMD_BYTES);
+    mock_begin(msp, wait_us);
+    return SNS_PENDING;
+  }
+  return SNS_DONE;
+}
+
+static msg_t mock_convert(void *ip, SensorReading *rp) {
+  MockSensor *msp = ip;
+  unsigned q;
+
+  rp->quantities = msp->info.quantities;
+  for (q = 0; q < SNS_QUANTITIES; q++)
+    rp->value[q] = (int32_t)(msp->index * 100000 + q * 10000) + msp->count;
+  msp->count++;
+  return SNS_DONE;
+}
+
+static const struct BaseSensorVMT mock_vmt = {
+  mock_get_info, mock_start, mock_collect, mock_convert
+};
+
+/*
+ * Mock kinds: a pressure part with two 9 ms conversions, a humidity part
+ * with a 16 ms conversion that runs late, a fast thermometer and a three
+ * conversion combined part.
+ */
+typedef struct {
+  const char    *name;
+  uint32_t      quantities;
+  uint32_t      conversions;
+  uint32_t      conv_us[3];
+  bool_t        late;
+} mock_kind_t;
+
+static const mock_kind_t kinds[] = {
+  {"mock.tp", SNS_MASK(SNS_TEMPERATURE) | SNS_MASK(SNS_PRESSURE),
+   2, {9000, 9000, 0}, FALSE},
+  {"mock.rh", SNS_MASK(SNS_HUMIDITY), 1, {16000, 0, 0}, TRUE},
+  {"mock.t", SNS_MASK(SNS_TEMPERATURE), 1, {3000, 0, 0}, FALSE},
+  {"mock.tph", SNS_MASK(SNS_TEMPERATURE) | SNS_MASK(SNS_PRESSURE) |
+   SNS_MASK(SNS_HUMIDITY), 3, {5000, 5000, 4000}, FALSE}
+};
+
+static MockSensor mocks[SENSORS];
+static SensorJob jobs[SENSORS];
+
+static void mock_init(MockSensor *msp, unsigned index, const mock_kind_t *kp) {
+  unsigned i;
+
+  msp->base.vmt = &mock_vmt;
+  msp->index = index;
+  msp->late = kp->late;
+  msp->info.name = kp->name;
+  msp->info.quantities = kp->quantities;
+  msp->info.conversions = kp->conversions;
+  msp->info.first_us = kp->conv_us[0];
+  msp->info.measurement_us = 0;
+  for (i = 0; i < kp->conversions; i++) {
+    msp->conv_us[i] = kp->conv_us[i];
+    msp->info.measurement_us += kp->conv_us[i];
+  }
+  msp->info.bus_bytes = CMD_BYTES + kp->conversions * (READ_BYTES + CMD_BYTES);
+  msp->count = 0;
+  msp->early = 0;
+}
+
+/*
+ * Runs the rounds in one mode, returns the elapsed time and counts the
+ * readings that arrived intact.
+ */
+static systime_t run(size_t (*readfn)(SensorJob *, size_t), const char *mode,
+                     unsigned *intact) {
+  systime_t start = chTimeNow(), elapsed;
+  uint32_t collects = 0, early = 0, bytes = bus_bytes;
+  unsigned r, i, q;
+
+  *intact = 0;
+  for (r = 0; r < ROUNDS; r++) {
+    for (i = 0; i < SENSORS; i++)
+      jobs[i].sensor = &mocks[i].base;
+    readfn(jobs, SENSORS);
+    for (i = 0; i < SENSORS; i++) {
+      bool_t ok = jobs[i].status == SNS_DONE &&
+                  jobs[i].reading.quantities == mocks[i].info.quantities;
+
+      collects += jobs[i].collects;
+      for (q = 0; q < SNS_QUANTITIES && ok; q++)
+        ok = jobs[i].reading.value[q] ==
+             (int32_t)(i * 100000 + q * 10000) + mocks[i].count - 1;
+      if (ok)
+        (*intact)++;
+    }
+  }
+  elapsed = chTimeNow() - start;
+  for (i = 0; i < SENSORS; i++) {
+    early += mocks[i].early;
+    mocks[i].early = 0;
+  }
+  printf("%-10s %4u readings in %5u ms, %4u.%u readings/s, "
+         "%u collects, %u early, %u bus bytes\n",
+         mode, *intact, (unsigned)(elapsed * 1000 / CH_FREQUENCY),
+         *intact * 10 * CH_FREQUENCY / (unsigned)elapsed / 10,
+         *intact * 10 * CH_FREQUENCY / (unsigned)elapsed % 10,
+         collects, early, bus_bytes - bytes);
+  return elapsed;
+}
+
+/*
+ * MS8607 host functions over the I2C driver.
+ */
+static enum ms8607_status i2c_status(I2CDriver *i2cp, msg_t msg) {
+
+  if (msg == RDY_OK)
+    return ms8607_status_ok;
+  if ((msg == RDY_RESET) && (i2cGetErrors(i2cp) == I2CD_ACK_FAILURE))
+    return ms8607_status_callback_i2c_nack;
+  return ms8607_status_callback_error;
+}
+
+static enum ms8607_status i2c_read(void *ctx,
+                                   ms8607_i2c_controller_packet *const pp) {
+  I2CDriver *i2cp = ctx;
+
+  return i2c_status(i2cp, i2cMasterReceive(i2cp, pp->address,
+                                           pp->data, pp->data_length));
+}
+
+static enum ms8607_status i2c_write(void *ctx,
+                                    ms8607_i2c_controller_packet *const pp) {
+  I2CDriver *i2cp = ctx;
+  uint8_t rxbuf[1];
+
+  return i2c_status(i2cp, i2cMasterTransmit(i2cp, pp->address, pp->data,
+                                            pp->data_length, rxbuf, 0));
+}
+
+static enum ms8607_status i2c_write_no_stop(void *ctx,
+                                            ms8607_i2c_controller_packet *const pp) {
+
+  (void)ctx;
+  (void)pp;
+  return ms8607_status_callback_error;
+}
+
+static enum ms8607_status sleep_ms(void *ctx, uint32_t ms) {
+
+  (void)ctx;
+  if (ms > 0)
+    chThdSleepMilliseconds(ms);
+  return ms8607_status_ok;
+}
+
+static void print_string(void *ctx, const char *text) {
+
+  (void)ctx;
+  printf("%s", text);
+}
+
+static void print_int64(void *ctx, int64_t number, uint8_t pad_width,
+                        ms8607_bool pad_with_zeroes) {
+
+  (void)ctx;
+  printf(pad_with_zeroes ? "%0*lld" : "%*lld", pad_width, (long long)number);
+}
+
+static void assign_functions(ms8607_host_functions *deps, void *ctx) {
+
+  (void)ctx;
+  deps->i2c_controller_read          = i2c_read;
+  deps->i2c_controller_write         = i2c_write;
+  deps->i2c_controller_write_no_stop = i2c_write_no_stop;
+  deps->sleep_ms                     = sleep_ms;
+  deps->print_string                 = print_string;
+  deps->print_int64                  = print_int64;
+}
+
+/* Readings of the simulated part, 0.001 degC, mbar and %RH.*/
+static const int32_t ms8607_expected[MS8607_READINGS][SNS_QUANTITIES] = {
+  {20000, 1100020, 31244},
+  {20000, 1100050, 31732},
+  {20000, 1100070, 32220}
+};
+
+/*
+ * Reads the MS8607 through the engine until the trace ends, every reading
+ * must match the simulated part and every transaction the trace.
+ */
+static bool_t run_ms8607(void) {
+  static const I2CConfig i2c_config = {MS8607_TRACE, 0};
+  static ms8607_host_functions host_funcs;
+  static ms8607_sensor dev;
+  static MS8607Sensor ms;
+  I2CDriver *i2cp = &I2CD1;
+  SensorJob job;
+  unsigned r, q, intact = 0;
+  bool_t pass;
+
+  if ((ms8607_init_and_assign_host_functions(&host_funcs, NULL,
+                                             assign_functions) != ms8607_status_ok) ||
+      (ms8607_init_sensor(&dev, &host_funcs) != ms8607_status_ok)) {
+    printf("MS8607 driver initialization failed\n");
+    return FALSE;
+  }
+  i2cStart(i2cp, &i2c_config);
+  if ((ms8607_reset(&dev, i2cp) != ms8607_status_ok) ||
+      (ms8607_disable_heater(&dev, i2cp) != ms8607_status_ok) ||
+      (ms8607_set_humidity_resolution(&dev, ms8607_humidity_resolution_12b,
+                                      i2cp) != ms8607_status_ok)) {
+    printf("MS8607 setup failed\n");
+    i2cStop(i2cp);
+    return FALSE;
+  }
+  ms8607_set_pressure_resolution(&dev, ms8607_pressure_resolution_osr_2048,
+                                 i2cp);
+  ms8607_set_humidity_i2c_controller_mode(&dev, ms8607_i2c_no_hold, i2cp);
+  ms8607ObjectInit(&ms, &dev, i2cp);
+
+  /* One more measurement than recorded, it must find the trace ended.*/
+  for (r = 0; r <= MS8607_READINGS; r++) {
+    bool_t ok;
+
+    job.sensor = (BaseSensor *)&ms;
+    sacqRead(&job, 1);
+    if (r == MS8607_READINGS) {
+      if ((job.status != SNS_ERROR) || !i2cp->ended)
+        printf("ms8607: the trace has not ended\n");
+      break;
+    }
+    ok = (job.status == SNS_DONE) &&
+         (job.reading.quantities == ms.info.quantities);
+    for (q = 0; (q < SNS_QUANTITIES) && ok; q++)
+      ok = job.reading.value[q] == ms8607_expected[r][q];
+    if (ok)
+      intact++;
+    printf("ms8607: %.3f degC  %.3f mbar  %.3f %%RH, %u collects%s\n",
+           job.reading.value[SNS_TEMPERATURE] / 1000.0,
+           job.reading.value[SNS_PRESSURE] / 1000.0,
+           job.reading.value[SNS_HUMIDITY] / 1000.0,
+           (unsigned)job.collects, ok ? "" : ", WRONG");
+  }
+  printf("ms8607: %u of %u readings intact, %u transactions, "
+         "%u mismatched\n", intact, MS8607_READINGS,
+         (unsigned)i2cp->replayed, (unsigned)i2cp->mismatches);
+  pass = (intact == MS8607_READINGS) && (job.status == SNS_ERROR) &&
+         i2cp->ended && (i2cp->mismatches == 0) && (i2cp->gaps == 0);
+  i2cStop(i2cp);
+  return pass;
+}
+
+/*------------------------------------------------------------------------*
+ * Simulator main.                                                        *
+ *------------------------------------------------------------------------*/
+int main(void) {
+  systime_t sequential, batched;
+  unsigned i, seq_ok, batch_ok;
+  bool_t pass, ms8607_ok;
+
+  halInit();
+  chSysInit();
+
+  for (i = 0; i < SENSORS; i++) {
+    mock_init(&mocks[i], i, &kinds[i % (sizeof kinds / sizeof kinds[0])]);
+    printf("%u: %-9s %u conversions, %5u us, %2u bus bytes\n", i,
+           snsGetInfo(&mocks[i].base)->name,
+           mocks[i].info.conversions, mocks[i].info.measurement_us,
+           mocks[i].info.bus_bytes);
+  }
+
+  sequential = run(sacqReadSequential, "sequential", &seq_ok);
+  batched = run(sacqRead, "batched", &batch_ok);
+  printf("speedup %u.%.2ux\n", (unsigned)(sequential * 100 / batched) / 100,
+         (unsigned)(sequential * 100 / batched) % 100);
+
+  ms8607_ok = run_ms8607();
+
+  pass = (seq_ok == ROUNDS * SENSORS) && (batch_ok == ROUNDS * SENSORS) &&
+         (batched * 2 <= sequential) && ms8607_ok;
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  fflush(stdout);
+  exit(pass ? 0 : 1);
+}
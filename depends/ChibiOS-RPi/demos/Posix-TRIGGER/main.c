@@ -0,0 +1,171 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Trigger engine test. Each case feeds a series of values to channel 0,
+ * timestamped with the frame number, reads the captured frames after every
+ * frame and compares the capture starts, ends and read frames with the
+ * expected ones.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ch.h"
+#include "hal.h"
+#include "trigger.h"
+
+#define CHANNELS            2
+#define DEPTH               16
+#define PRE                 4
+#define POST                3
+#define MAX_FRAMES          32
+#define MAX_EDGES           4
+
+typedef struct {
+  const char            *name;
+  TrgCondition          condition;
+  /* Channel 0 values.*/
+  int32_t               series[MAX_FRAMES];
+  unsigned              nframes;
+  /* Frames starting and ending the captures.*/
+  unsigned              starts[MAX_EDGES];
+  unsigned              stops[MAX_EDGES];
+  unsigned              ncaptures;
+  /* Readable frames, first and last of each capture.*/
+  unsigned              first[MAX_EDGES];
+  unsigned              last[MAX_EDGES];
+} test_t;
+
+static const test_t tests[] = {
+  /* Fires at 100, holds down to 50: frames 11 and 12 keep the capture
+     going and the 80s after it do not start a new one.*/
+  {"level", {TRG_LEVEL, 0, 0, 0, 0, 0, 100, 50},
+   {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 120, 80, 60, 40, 0, 0,
+    80, 80, 100, 0, 0, 0, 0, 0},
+   24, {10, 18}, {15, 21}, 2, {6, 16}, {15, 21}},
+  /* Same on falling values, the first capture has only two frames of
+     history.*/
+  {"falling", {TRG_LEVEL, 0, 0, 0, 0, 0, -100, -50},
+   {0, 0, -150, -60, -40, 0, 0, 0, 0, 0, -80, 0},
+   12, {2}, {6}, 1, {0}, {6}},
+  /* A step of 50 seen for the 4 frames of the lag. The ring starts empty,
+     the high start values must not read as a rate.*/
+  {"rate", {TRG_RATE, 0, 4, 0, 0, 0, 40, 20},
+   {1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1050, 1050, 1050,
+    1050, 1050, 1050, 1050, 1050, 1050, 1050},
+   18, {8}, {14}, 1, {4}, {14}},
+  /* Fires when a ramp stalls. The rate over an empty ring is no rate,
+     not zero, or this would fire on the first frame.*/
+  {"stall", {TRG_RATE, 0, 4, 0, 0, 0, 10, 20},
+   {0, 10, 20, 30, 40, 50, 60, 70, 80, 90, 90, 90, 90, 90, 90, 90, 120,
+    150, 180},
+   19, {12}, {18}, 1, {8}, {18}}
+};
+
+static unsigned frame_no;
+static unsigned starts[MAX_EDGES + 1], stops[MAX_EDGES + 1];
+static unsigned nstarts, nstops;
+
+static void mode_cb(TrgEngine *tp, bool_t capturing) {
+
+  (void)tp;
+  if (capturing) {
+    if (nstarts <= MAX_EDGES)
+      starts[nstarts++] = frame_no;
+  }
+  else if (nstops <= MAX_EDGES)
+    stops[nstops++] = frame_no;
+}
+
+static bool_t check(const char *name, bool_t ok, const char *what) {
+
+  if (!ok)
+    printf("%-8s FAIL, %s\n", name, what);
+  return ok;
+}
+
+static bool_t run(const test_t *tp) {
+  static int32_t buffer[DEPTH * (CHANNELS + 1)];
+  static TrgEngine trg;
+  TrgConfig cfg = {CHANNELS, &tp->condition, 1, buffer, DEPTH, PRE, POST,
+                   mode_cb};
+  bool_t pass = TRUE;
+  unsigned expected = 0, nread = 0, capture = 0;
+
+  nstarts = nstops = 0;
+  trgInit(&trg, &cfg);
+  for (frame_no = 0; frame_no < tp->nframes; frame_no++) {
+    int32_t values[CHANNELS] = {tp->series[frame_no], (int32_t)frame_no};
+    uint32_t time;
+
+    trgPut(&trg, frame_no, values);
+    while (trgRead(&trg, &time, values)) {
+      if (capture < tp->ncaptures && nread == 0)
+        expected = tp->first[capture];
+      pass &= check(tp->name, (capture < tp->ncaptures) &&
+                              (time == expected) &&
+                              (values[0] == tp->series[time]) &&
+                              (values[1] == (int32_t)time),
+                    "unexpected frame read");
+      if (!pass)
+        return FALSE;
+      expected++;
+      nread++;
+      if (time == tp->last[capture]) {
+        capture++;
+        nread = 0;
+      }
+    }
+  }
+
+  pass &= check(tp->name, capture == tp->ncaptures, "frames missing");
+  pass &= check(tp->name, (nstarts == tp->ncaptures) &&
+                          (nstops == tp->ncaptures) &&
+                          (trg.captures == tp->ncaptures) &&
+                          (memcmp(starts, tp->starts,
+                                  nstarts * sizeof starts[0]) == 0) &&
+                          (memcmp(stops, tp->stops,
+                                  nstops * sizeof stops[0]) == 0),
+                "wrong capture edges");
+  pass &= check(tp->name, (trg.cause == 1) && (trg.overruns == 0),
+                "wrong cause or overruns");
+  printf("%-8s %u frames, %u captures, %s\n", tp->name, tp->nframes,
+         tp->ncaptures, pass ? "ok" : "failed");
+  return pass;
+}
+
+/*------------------------------------------------------------------------*
+ * Simulator main.                                                        *
+ *------------------------------------------------------------------------*/
+int main(void) {
+  bool_t pass = TRUE;
+  unsigned i;
+
+  halInit();
+  chSysInit();
+
+  for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    pass &= run(&tests[i]);
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  fflush(stdout);
+  exit(pass ? 0 : 1);
+}
@@ -0,0 +1,214 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Virtual time check. Periodic threads and a looped I2C trace replay run
+ * through an hour long schedule with SIM_VIRTUAL_TIME. Every wakeup must
+ * happen at its deadline, the replay must keep the recorded pace, every
+ * tick must be charged to a thread and the hour must pass in a few seconds
+ * of host time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "ch.h"
+#include "hal.h"
+
+#if !SIM_VIRTUAL_TIME
+#error "the demo checks the virtual time, build it with SIM_VIRTUAL_TIME"
+#endif
+
+/* Simulated run time.*/
+#define RUN_S               3600
+#define RUN_TIME            S2ST(RUN_S)
+
+/* Host time the run may take at most.*/
+#define HOST_LIMIT_S        60
+
+/* Looped I2C record, the gap is not a whole number of ticks.*/
+#define I2C_ADDR            0x40
+#define I2C_GAP_US          10500
+#define I2C_DURATION_US     300
+
+/* Counter reading over a one second sleep, one tick either side.*/
+#define COUNTER_NS          1000000000UL
+#define COUNTER_SLACK_NS    (1000000000UL / CH_FREQUENCY)
+
+typedef struct {
+  systime_t                 period;
+  unsigned                  wakeups;
+  unsigned                  late;
+} periodic_t;
+
+static periodic_t periodics[] = {
+  {MS2ST(3), 0, 0},
+  {MS2ST(50), 0, 0},
+  {S2ST(1), 0, 0},
+  {S2ST(60), 0, 0}
+};
+
+#define PERIODICS           (sizeof periodics / sizeof periodics[0])
+
+static WORKING_AREA(waPeriodic[PERIODICS], 2048);
+static WORKING_AREA(waReplay, 2048);
+
+static char trace_path[] = "/tmp/vtimeXXXXXX";
+static I2CConfig i2c_config = {trace_path, I2C_REPLAY_TIMING | I2C_REPLAY_LOOP};
+static unsigned i2c_failed;
+
+static void put_varint(FILE *f, uint32_t v) {
+
+  while (v >= 0x80) {
+    fputc((int)(v & 0x7F) | 0x80, f);
+    v >>= 7;
+  }
+  fputc((int)v, f);
+}
+
+/*
+ * One successful two byte read, replayed in a loop.
+ */
+static void write_trace(void) {
+  FILE *f;
+  int fd;
+
+  if (((fd = mkstemp(trace_path)) < 0) || ((f = fdopen(fd, "wb")) == NULL)) {
+    printf("cannot create %s\n", trace_path);
+    exit(2);
+  }
+  fwrite(I2C_TRACE_MAGIC, 1, 4, f);
+  fputc(I2C_TRACE_VERSION, f);
+  fputc(I2C_TRACE_RX | I2C_TRACE_OK, f);
+  fputc(I2C_ADDR, f);
+  put_varint(f, I2C_GAP_US);
+  put_varint(f, I2C_DURATION_US);
+  put_varint(f, 2);
+  fputc(0x12, f);
+  fputc(0x34, f);
+  fputc(I2C_TRACE_END, f);
+  fclose(f);
+}
+
+static msg_t PeriodicThread(void *arg) {
+  periodic_t *pp = arg;
+  systime_t t = chTimeNow();
+
+  while (t + pp->period <= RUN_TIME) {
+    t += pp->period;
+    chThdSleepUntil(t);
+    if (chTimeNow() != t)
+      pp->late++;
+    pp->wakeups++;
+  }
+  chThdSleep(TIME_INFINITE);
+  return 0;
+}
+
+static msg_t ReplayThread(void *arg) {
+  uint8_t rxbuf[2];
+
+  (void)arg;
+  i2cStart(&I2CD1, &i2c_config);
+  while (chTimeNow() < RUN_TIME) {
+    if ((i2cMasterReceiveTimeout(&I2CD1, I2C_ADDR, rxbuf, sizeof rxbuf,
+                                 TIME_INFINITE) != RDY_OK) ||
+        (rxbuf[0] != 0x12) || (rxbuf[1] != 0x34))
+      i2c_failed++;
+  }
+  chThdSleep(TIME_INFINITE);
+  return 0;
+}
+
+int main(void) {
+  struct timeval host_start, host_end;
+  halrtcnt_t cnt;
+  uint32_t cnt_ns, charged = 0;
+  unsigned i, expected, late = 0, missing = 0;
+  long host_ms;
+  Thread *tp;
+  bool_t pass;
+
+  write_trace();
+  gettimeofday(&host_start, NULL);
+
+  halInit();
+  chSysInit();
+
+  /* The realtime counter follows the system time.*/
+  cnt = halGetCounterValue();
+  chThdSleepSeconds(1);
+  cnt_ns = (uint32_t)(halGetCounterValue() - cnt);
+
+  for (i = 0; i < PERIODICS; i++)
+    chThdCreateStatic(waPeriodic[i], sizeof(waPeriodic[i]), NORMALPRIO + 1,
+                      PeriodicThread, &periodics[i]);
+  chThdCreateStatic(waReplay, sizeof(waReplay), NORMALPRIO, ReplayThread,
+                    NULL);
+
+  chThdSleepUntil(RUN_TIME + S2ST(1));
+  gettimeofday(&host_end, NULL);
+
+  for (i = 0; i < PERIODICS; i++) {
+    printf("every %6u ticks: %7u wakeups, %u late\n",
+           (unsigned)periodics[i].period, periodics[i].wakeups,
+           periodics[i].late);
+    if (periodics[i].wakeups != (RUN_TIME - S2ST(1)) / periodics[i].period)
+      missing++;
+    late += periodics[i].late;
+  }
+
+  /* One transaction per recorded gap from the start at one second, the
+     first and the one finishing after the hour on top.*/
+  expected = (unsigned)((uint64_t)(RUN_S - 1) * 1000000 / I2C_GAP_US);
+  printf("replay: %u transactions, %u to %u expected, %u mismatched, "
+         "%u failed\n", (unsigned)I2CD1.replayed, expected, expected + 2,
+         (unsigned)I2CD1.mismatches, i2c_failed);
+
+  tp = chRegFirstThread();
+  do {
+    charged += tp->p_time;
+    tp = chRegNextThread(tp);
+  } while (tp != NULL);
+  printf("ticks: %u elapsed, %u charged to threads\n",
+         (unsigned)chTimeNow(), (unsigned)charged);
+
+  printf("counter: %u ns over one second\n", (unsigned)cnt_ns);
+
+  host_ms = (host_end.tv_sec - host_start.tv_sec) * 1000 +
+            (host_end.tv_usec - host_start.tv_usec) / 1000;
+  printf("time: %u s simulated in %ld ms\n",
+         (unsigned)(chTimeNow() / CH_FREQUENCY), host_ms);
+
+  pass = (missing == 0) && (late == 0) &&
+         (I2CD1.replayed >= expected) && (I2CD1.replayed <= expected + 2) &&
+         (I2CD1.mismatches == 0) &&
+         (i2c_failed == 0) && (charged == chTimeNow()) &&
+         (cnt_ns + COUNTER_SLACK_NS >= COUNTER_NS) &&
+         (cnt_ns <= COUNTER_NS + COUNTER_SLACK_NS) &&
+         (host_ms < HOST_LIMIT_S * 1000);
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  fflush(stdout);
+  unlink(trace_path);
+  exit(pass ? 0 : 1);
+}
@@ -6,6 +6,7 @@ HALSRC = ${CHIBIOS}/os/hal/src/hal.c \
          ${CHIBIOS}/os/hal/src/ext.c \
          ${CHIBIOS}/os/hal/src/gpt.c \
          ${CHIBIOS}/os/hal/src/i2c.c \
+         ${CHIBIOS}/os/hal/src/i2s.c \
          ${CHIBIOS}/os/hal/src/icu.c \
          ${CHIBIOS}/os/hal/src/mac.c \
          ${CHIBIOS}/os/hal/src/mmc_spi.c \
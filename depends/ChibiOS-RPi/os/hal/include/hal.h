@@ -38,6 +38,7 @@
 /* Abstract interfaces.*/
 #include "io_channel.h"
 #include "io_block.h"
+#include "io_sensor.h"
 
 /* Shared headers.*/
 #include "mmcsd.h"
@@ -50,6 +51,7 @@
 #include "ext.h"
 #include "gpt.h"
 #include "i2c.h"
+#include "i2s.h"
 #include "icu.h"
 #include "mac.h"
 #include "pwm.h"
@@ -55,6 +55,48 @@
 #define I2CD_SMB_ALERT              0x40   /**< @brief SMBus Alert.         */
 /** @} */
 
+/**
+ * @name    Capture trace format
+ * @details A trace starts with the four bytes @p I2C_TRACE_MAGIC followed by
+ *          the @p I2C_TRACE_VERSION byte, then holds one record per
+ *          transaction:
+ *          <pre>
+ *          tag                 kind, status and flag bits below
+ *          addr                7 bit slave address
+ *          start   (varint)    microseconds since the previous record start,
+ *                              or since the capture start for the first one
+ *          duration (varint)   microseconds spent in the transaction
+ *          [errors]            error flags, only if I2C_TRACE_ERRORS is set
+ *          [txlen (varint)     transmitted bytes, I2C_TRACE_TX kind only
+ *           tx[txlen]]
+ *          rxlen   (varint)    received bytes, zero for a plain write
+ *          rx[rxlen]
+ *          </pre>
+ *          Varints are unsigned LEB128, seven bits per byte, least
+ *          significant group first. The trace ends with a lone
+ *          @p I2C_TRACE_END tag.
+ * @{
+ */
+#define I2C_TRACE_MAGIC             "I2CT"
+#define I2C_TRACE_VERSION           1
+#define I2C_TRACE_HEADER_SIZE       5
+#define I2C_TRACE_END               0xFF
+/** @brief Kind mask: @p i2cMasterTransmitTimeout(), maybe reading back.*/
+#define I2C_TRACE_KIND_MASK         0x03
+#define I2C_TRACE_TX                0x01
+/** @brief @p i2cMasterReceiveTimeout().*/
+#define I2C_TRACE_RX                0x02
+/** @brief Status mask: the @p msg_t returned, see below.*/
+#define I2C_TRACE_STATUS_MASK       0x0C
+#define I2C_TRACE_OK                0x00
+#define I2C_TRACE_RESET             0x04
+#define I2C_TRACE_TIMEOUT           0x08
+/** @brief The error flags byte follows the duration.*/
+#define I2C_TRACE_ERRORS            0x10
+/** @brief Records before this one were dropped, the queue was full.*/
+#define I2C_TRACE_GAP               0x20
+/** @} */
+
 /*===========================================================================*/
 /* Driver pre-compile time settings.                                         */
 /*===========================================================================*/
@@ -66,6 +108,16 @@
 #define I2C_USE_MUTUAL_EXCLUSION    TRUE
 #endif
 
+/**
+ * @brief   Enables the transaction capture APIs.
+ * @details Every transaction of a driver with a capture attached is
+ *          appended to the capture queue as a trace record, see
+ *          @p I2C_TRACE_MAGIC for the format.
+ */
+#if !defined(I2C_USE_CAPTURE) || defined(__DOXYGEN__)
+#define I2C_USE_CAPTURE             FALSE
+#endif
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
@@ -90,6 +142,33 @@ typedef enum {
   I2C_LOCKED = 5                            /**> Bus or driver locked.      */
 } i2cstate_t;
 
+#if I2C_USE_CAPTURE || defined(__DOXYGEN__)
+/**
+ * @brief   Type of a transaction capture.
+ */
+typedef struct I2CCapture I2CCapture;
+
+/**
+ * @brief   Transaction capture.
+ * @details The records are queued by the transaction functions and read
+ *          out by a thread streaming them off the device. A record that
+ *          does not fit in the queue is dropped whole and the next one
+ *          carries @p I2C_TRACE_GAP.
+ */
+struct I2CCapture {
+  /** @brief Trace bytes waiting to be read.*/
+  InputQueue                queue;
+  /** @brief Records queued.*/
+  uint32_t                  records;
+  /** @brief Records dropped.*/
+  uint32_t                  dropped;
+  /** @brief Start of the last queued transaction, in capture clock units.*/
+  uint32_t                  last;
+  /** @brief A record was dropped since the last queued one.*/
+  bool_t                    gap;
+};
+#endif /* I2C_USE_CAPTURE */
+
 #include "i2c_lld.h"
 
 /*===========================================================================*/
@@ -111,6 +190,23 @@ typedef enum {
 #define i2cMasterReceive(i2cp, addr, rxbuf, rxbytes)                        \
   (i2cMasterReceiveTimeout(i2cp, addr, rxbuf, rxbytes, TIME_INFINITE))
 
+#if I2C_USE_CAPTURE || defined(__DOXYGEN__)
+/**
+ * @brief   Reads trace bytes from a capture.
+ * @details Returns when @p n bytes were read or the timeout expired.
+ *
+ * @param[in] capp      pointer to the @p I2CCapture object
+ * @param[out] bp       destination buffer
+ * @param[in] n         maximum number of bytes to read
+ * @param[in] time      the number of ticks before the operation timeouts
+ * @return              The number of bytes read.
+ *
+ * @api
+ */
+#define i2cCaptureRead(capp, bp, n, time)                                   \
+  (chIQReadTimeout(&(capp)->queue, bp, n, time))
+#endif /* I2C_USE_CAPTURE */
+
 /*===========================================================================*/
 /* External declarations.                                                    */
 /*===========================================================================*/
@@ -136,6 +232,11 @@ extern "C" {
   void i2cAcquireBus(I2CDriver *i2cp);
   void i2cReleaseBus(I2CDriver *i2cp);
 #endif /* I2C_USE_MUTUAL_EXCLUSION */
+#if I2C_USE_CAPTURE
+  void i2cCaptureObjectInit(I2CCapture *capp, uint8_t *bp, size_t size);
+  void i2cCaptureStart(I2CDriver *i2cp, I2CCapture *capp);
+  void i2cCaptureStop(I2CDriver *i2cp);
+#endif /* I2C_USE_CAPTURE */
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,205 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    io_sensor.h
+ * @brief   Measurement sensors access.
+ * @details This header defines an abstract interface to sensors that
+ *          convert on their own once started, so that a single acquisition
+ *          loop can drive several of them without knowing their types.
+ *
+ * @addtogroup IO_SENSOR
+ * @details A measurement goes through three steps:
+ *          - @p start() begins the first conversion and tells how long it
+ *            takes.
+ *          - @p collect() is called once that time has passed. It fetches
+ *            the results and either starts the next conversion of the
+ *            measurement, returning @p SNS_PENDING with its duration, or
+ *            returns @p SNS_DONE. A part that is not ready yet is also
+ *            reported as @p SNS_PENDING, with the time to retry after.
+ *          - @p convert() turns the collected raw data into a reading,
+ *            without any bus access.
+ *          .
+ *          None of the methods blocks waiting for a conversion, the caller
+ *          owns the waiting and can overlap the conversions of many sensors
+ *          on the same bus. The @p SensorInfo descriptor tells what a
+ *          sensor measures and how long its conversions take, so that a
+ *          schedule can be planned without knowing the sensor type.
+ * @{
+ */
+
+#ifndef _IO_SENSOR_H_
+#define _IO_SENSOR_H_
+
+/**
+ * @name    Sensor method results
+ * @{
+ */
+#define SNS_DONE            0       /**< @brief Measurement collected.      */
+#define SNS_PENDING         1       /**< @brief Call @p collect() again.    */
+#define SNS_ERROR           -1      /**< @brief Bus or device failure.      */
+/** @} */
+
+/**
+ * @brief   Measured quantities, each the index of its value in a reading.
+ */
+typedef enum {
+  SNS_TEMPERATURE = 0,              /**< 0.001 degC.                        */
+  SNS_PRESSURE = 1,                 /**< 0.001 mbar.                        */
+  SNS_HUMIDITY = 2,                 /**< 0.001 %RH.                         */
+  SNS_QUANTITIES = 3
+} snsquantity_t;
+
+/**
+ * @brief   Mask bit of a quantity in @p SensorInfo and @p SensorReading.
+ */
+#define SNS_MASK(q)         (1U << (q))
+
+/**
+ * @brief   Sensor capabilities and timing.
+ */
+typedef struct {
+  /** @brief Part name.*/
+  const char    *name;
+  /** @brief Quantities measured, @p SNS_MASK() bits.*/
+  uint32_t      quantities;
+  /** @brief Conversions per measurement, each followed by a @p collect().*/
+  uint32_t      conversions;
+  /** @brief Wait before the first @p collect().*/
+  uint32_t      first_us;
+  /** @brief Sum of the conversion times of a measurement, worst case.*/
+  uint32_t      measurement_us;
+  /** @brief Bytes on the bus per measurement, addressing included.*/
+  uint32_t      bus_bytes;
+} SensorInfo;
+
+/**
+ * @brief   One measurement in engineering units.
+ */
+typedef struct {
+  /** @brief Quantities present, @p SNS_MASK() bits.*/
+  uint32_t      quantities;
+  /** @brief Values indexed by @p snsquantity_t, see there for the units.*/
+  int32_t       value[SNS_QUANTITIES];
+} SensorReading;
+
+/**
+ * @brief   @p BaseSensor specific methods.
+ */
+#define _base_sensor_methods                                                \
+  /* Capabilities and timing descriptor.*/                                  \
+  const SensorInfo *(*get_info)(void *instance);                            \
+  /* Starts a measurement.*/                                                \
+  msg_t (*start)(void *instance, uint32_t *wait_us);                        \
+  /* Collects a conversion, may start the next one.*/                       \
+  msg_t (*collect)(void *instance, uint32_t *wait_us);                      \
+  /* Converts the collected data.*/                                         \
+  msg_t (*convert)(void *instance, SensorReading *rp);
+
+/**
+ * @brief   @p BaseSensor specific data.
+ * @note    It is empty because @p BaseSensor is only an interface without
+ *          implementation.
+ */
+#define _base_sensor_data
+
+/**
+ * @brief   @p BaseSensor virtual methods table.
+ */
+struct BaseSensorVMT {
+  _base_sensor_methods
+};
+
+/**
+ * @brief   Base sensor class.
+ * @details This class represents a generic, split-phase, measurement
+ *          sensor.
+ */
+typedef struct {
+  /** @brief Virtual Methods Table.*/
+  const struct BaseSensorVMT *vmt;
+  _base_sensor_data
+} BaseSensor;
+
+/**
+ * @name    Macro Functions (BaseSensor)
+ * @{
+ */
+/**
+ * @brief   Returns the capabilities and timing descriptor.
+ *
+ * @param[in] ip        pointer to a @p BaseSensor or derived class
+ *
+ * @return              Pointer to a @p SensorInfo, valid as long as the
+ *                      sensor configuration does not change.
+ *
+ * @api
+ */
+#define snsGetInfo(ip) ((ip)->vmt->get_info(ip))
+
+/**
+ * @brief   Starts a measurement.
+ *
+ * @param[in] ip        pointer to a @p BaseSensor or derived class
+ * @param[out] wait_us  time before the first @p snsCollect()
+ *
+ * @return              The operation status.
+ * @retval SNS_PENDING  measurement started.
+ * @retval SNS_ERROR    bus or device failure.
+ *
+ * @api
+ */
+#define snsStart(ip, wait_us) ((ip)->vmt->start(ip, wait_us))
+
+/**
+ * @brief   Collects the conversion in progress.
+ *
+ * @param[in] ip        pointer to a @p BaseSensor or derived class
+ * @param[out] wait_us  time before the next @p snsCollect(), only set
+ *                      when @p SNS_PENDING is returned
+ *
+ * @return              The operation status.
+ * @retval SNS_DONE     measurement complete, ready for @p snsConvert().
+ * @retval SNS_PENDING  another conversion is running or the device was
+ *                      not ready.
+ * @retval SNS_ERROR    bus or device failure, the measurement is abandoned.
+ *
+ * @api
+ */
+#define snsCollect(ip, wait_us) ((ip)->vmt->collect(ip, wait_us))
+
+/**
+ * @brief   Converts the last collected measurement.
+ *
+ * @param[in] ip        pointer to a @p BaseSensor or derived class
+ * @param[out] rp       pointer to the @p SensorReading to fill
+ *
+ * @return              The operation status.
+ * @retval SNS_DONE     reading valid.
+ * @retval SNS_ERROR    the raw data is invalid.
+ *
+ * @api
+ */
+#define snsConvert(ip, rp) ((ip)->vmt->convert(ip, rp))
+/** @} */
+
+#endif /* _IO_SENSOR_H_ */
+
+/** @} */
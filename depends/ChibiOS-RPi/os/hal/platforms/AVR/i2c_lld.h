@@ -138,6 +138,12 @@ struct I2CDriver {
   Semaphore                 semaphore;
 #endif
 #endif /* I2C_USE_MUTUAL_EXCLUSION */
+#if I2C_USE_CAPTURE || defined(__DOXYGEN__)
+  /**
+   * @brief   Capture the transactions are recorded to, @p NULL if none.
+   */
+  I2CCapture                *capture;
+#endif /* I2C_USE_CAPTURE */
 #if defined(I2C_DRIVER_EXT_FIELDS)
   I2C_DRIVER_EXT_FIELDS
 #endif
@@ -0,0 +1,363 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    BCM2835/adc_lld.c
+ * @brief   External MCP3x08 ADC on SPI0, low level driver code.
+ * @details The converter is clocked continuously by the SPI0 master in DMA
+ *          mode. A TX DMA channel loops endlessly over one header and one
+ *          command word per sequence entry, every header starting a 4 byte
+ *          frame with automatic chip select deassertion, so conversions
+ *          follow each other at the SPI clock without CPU involvement. An
+ *          RX DMA channel drains one result word per conversion into a
+ *          two-halves raw ring and interrupts once per half; the ISR unpacks
+ *          the results into the samples buffer and runs the half and full
+ *          buffer callbacks of the HAL ADC API.
+ *
+ * @addtogroup ADC
+ * @{
+ */
+
+#include "ch.h"
+#include "hal.h"
+
+#if HAL_USE_ADC || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+#define ADC_DMA_RX      DMA_CHANNEL(BCM2835_ADC_DMA_RX_CHANNEL)
+#define ADC_DMA_TX      DMA_CHANNEL(BCM2835_ADC_DMA_TX_CHANNEL)
+
+/* The RX and TX DMA channel control blocks.*/
+#define ADC_CB_TX       2
+
+/* Every conversion is a 4 byte frame: a zero byte, ignored by the converter
+   ahead of the start bit, then the 3 byte command of the datasheet. Frames
+   are thus whole FIFO words and the result lands in the last two bytes.*/
+#define ADC_FRAME_SIZE  4
+
+#define ADC_DMA_CS      (DMA_CS_WAIT_WRITES | DMA_CS_ACTIVE)
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   ADC driver identifier.
+ */
+ADCDriver ADCD1;
+
+/*===========================================================================*/
+/* Driver local variables.                                                   */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Stops a DMA channel and clears its status.
+ *
+ * @notapi
+ */
+static void dma_reset(dmachannel_t *dmap) {
+
+  dmap->cs = DMA_CS_RESET;
+  dmap->cs = DMA_CS_INT | DMA_CS_END;
+  dmap->debug = DMA_DEBUG_ERRORS;
+}
+
+/**
+ * @brief   Command word of a sequence entry, bytes 1 and 2 of the frame.
+ *
+ * @notapi
+ */
+static uint32_t command_word(const ADCConfig *config, uint8_t entry) {
+  uint32_t ch = entry & 7;
+  uint32_t single = !(entry & 0x80);
+  uint32_t b1, b2;
+
+  if (config->device == ADC_DEVICE_MCP3208) {
+    b1 = 0x04 | (single << 1) | (ch >> 2);
+    b2 = (ch & 3) << 6;
+  }
+  else {
+    b1 = 0x01;
+    b2 = (single << 7) | (ch << 4);
+  }
+  return (b1 << 8) | (b2 << 16);
+}
+
+/**
+ * @brief   Plans the next RX chunk.
+ * @details A chunk never crosses the half or the end of the samples buffer,
+ *          so the callbacks run as soon as their rows are converted.
+ *
+ * @return              The chunk length in conversions.
+ *
+ * @notapi
+ */
+static size_t next_chunk(ADCDriver *adcp) {
+  size_t total = adcp->depth * adcp->grpp->num_channels;
+  size_t half = adcp->depth > 1 ? total / 2 : total;
+  size_t n;
+
+  if (adcp->plan >= total) {
+    /* A linear conversion stops before this chunk is unpacked.*/
+    if (!adcp->grpp->circular)
+      return BCM2835_ADC_DMA_CHUNK;
+    adcp->plan = 0;
+  }
+  n = (adcp->plan < half ? half : total) - adcp->plan;
+  if (n > BCM2835_ADC_DMA_CHUNK)
+    n = BCM2835_ADC_DMA_CHUNK;
+  adcp->plan += n;
+  return n;
+}
+
+/**
+ * @brief   Programs an RX ring half with the next chunk.
+ * @note    The DMA engine must not be processing that control block.
+ *
+ * @notapi
+ */
+static void queue_chunk(ADCDriver *adcp, unsigned i) {
+
+  adcp->chunk[i] = next_chunk(adcp);
+  adcp->cb[i].txfr_len = adcp->chunk[i] * sizeof (uint32_t);
+}
+
+/*===========================================================================*/
+/* Driver interrupt handlers.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   RX DMA channel IRQ handler.
+ *
+ * @param[in] adcp      pointer to the @p ADCDriver object
+ *
+ * @notapi
+ */
+void adc_lld_serve_interrupt(ADCDriver *adcp) {
+  dmachannel_t *dmap = ADC_DMA_RX;
+  const uint32_t *rp;
+  adcsample_t *sp;
+  size_t n, total;
+  unsigned cur;
+  uint32_t cs;
+
+  if (!(IRQ_PEND1 & DMA_IRQ(BCM2835_ADC_DMA_RX_CHANNEL)))
+    return;
+
+  cs = dmap->cs;
+  dmap->cs = ADC_DMA_CS | DMA_CS_INT;
+
+  chSysLockFromIsr();
+
+  /* The conversion may have been stopped while the IRQ was pending.*/
+  if (adcp->grpp == NULL) {
+    chSysUnlockFromIsr();
+    return;
+  }
+
+  if (cs & DMA_CS_ERROR) {
+    _adc_isr_error_code(adcp, ADC_ERR_DMAFAILURE);
+    chSysUnlockFromIsr();
+    return;
+  }
+
+  /* The engine must be on the other half by now, back on this one means
+     it has been overwritten already.*/
+  cur = adcp->cur;
+  if (dmap->conblk_ad == DMA_BUS_MEMORY(&adcp->cb[cur])) {
+    _adc_isr_error_code(adcp, ADC_ERR_OVERFLOW);
+    chSysUnlockFromIsr();
+    return;
+  }
+
+  /* Unpacking the 10 or 12 bit results from the last two frame bytes.*/
+  n = adcp->chunk[cur];
+  rp = adcp->raw[cur];
+  sp = adcp->samples + adcp->pos;
+  adcp->pos += n;
+  while (n-- > 0) {
+    uint32_t w = *rp++;
+    *sp++ = (adcsample_t)(((w >> 8) & 0xFF00) | (w >> 24)) & adcp->mask;
+  }
+
+  /* This half is free again, queuing the chunk after the running one.*/
+  queue_chunk(adcp, cur);
+  adcp->cur = cur ^ 1;
+
+  total = adcp->depth * adcp->grpp->num_channels;
+  if ((adcp->depth > 1) && (adcp->pos == total / 2)) {
+    _adc_isr_half_code(adcp);
+  }
+  else if (adcp->pos >= total) {
+    adcp->pos = 0;
+    _adc_isr_full_code(adcp);
+  }
+
+  chSysUnlockFromIsr();
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Low level ADC driver initialization.
+ *
+ * @notapi
+ */
+void adc_lld_init(void) {
+
+  adcObjectInit(&ADCD1);
+}
+
+/**
+ * @brief   Configures and activates the ADC peripheral.
+ *
+ * @param[in] adcp      pointer to the @p ADCDriver object
+ *
+ * @notapi
+ */
+void adc_lld_start(ADCDriver *adcp) {
+
+  if (adcp->state == ADC_STOP) {
+    bcm2835_gpio_fnsel(GPIO7_PAD, GPFN_ALT0);   /* SPI0_CE1_N.*/
+    bcm2835_gpio_fnsel(GPIO8_PAD, GPFN_ALT0);   /* SPI0_CE0_N.*/
+    bcm2835_gpio_fnsel(GPIO9_PAD, GPFN_ALT0);   /* SPI0_MISO.*/
+    bcm2835_gpio_fnsel(GPIO10_PAD, GPFN_ALT0);  /* SPI0_MOSI.*/
+    bcm2835_gpio_fnsel(GPIO11_PAD, GPFN_ALT0);  /* SPI0_SCLK.*/
+
+    DMA_ENABLE |= BIT(BCM2835_ADC_DMA_RX_CHANNEL) |
+                  BIT(BCM2835_ADC_DMA_TX_CHANNEL);
+    dma_reset(ADC_DMA_RX);
+    dma_reset(ADC_DMA_TX);
+    IRQ_ENABLE1 = DMA_IRQ(BCM2835_ADC_DMA_RX_CHANNEL);
+  }
+
+  adcp->mask = adcp->config->device == ADC_DEVICE_MCP3208 ? 0x0FFF : 0x03FF;
+  SPI0_CS = SPI_CS_CLEAR;
+  SPI0_CLK = adcp->config->clock_divider;
+}
+
+/**
+ * @brief   Deactivates the ADC peripheral.
+ *
+ * @param[in] adcp      pointer to the @p ADCDriver object
+ *
+ * @notapi
+ */
+void adc_lld_stop(ADCDriver *adcp) {
+
+  if (adcp->state == ADC_READY) {
+    IRQ_DISABLE1 = DMA_IRQ(BCM2835_ADC_DMA_RX_CHANNEL);
+    dma_reset(ADC_DMA_RX);
+    dma_reset(ADC_DMA_TX);
+    SPI0_CS = SPI_CS_CLEAR;
+
+    bcm2835_gpio_fnsel(GPIO7_PAD, GPFN_IN);
+    bcm2835_gpio_fnsel(GPIO8_PAD, GPFN_IN);
+    bcm2835_gpio_fnsel(GPIO9_PAD, GPFN_IN);
+    bcm2835_gpio_fnsel(GPIO10_PAD, GPFN_IN);
+    bcm2835_gpio_fnsel(GPIO11_PAD, GPFN_IN);
+  }
+}
+
+/**
+ * @brief   Starts an ADC conversion.
+ *
+ * @param[in] adcp      pointer to the @p ADCDriver object
+ *
+ * @notapi
+ */
+void adc_lld_start_conversion(ADCDriver *adcp) {
+  const ADCConversionGroup *grpp = adcp->grpp;
+  uint32_t header;
+  unsigned i;
+
+  chDbgAssert((grpp->num_channels > 0) &&
+              (grpp->num_channels <= BCM2835_ADC_MAX_SEQUENCE),
+              "adc_lld_start_conversion(), #1", "invalid sequence length");
+
+  /* TX loop, one frame per sequence entry, endlessly repeated.*/
+  header = SPI_DMA_HEADER(ADC_FRAME_SIZE,
+                          SPI_CS_TA | (adcp->config->chip_select & SPI_CS_CS));
+  for (i = 0; i < grpp->num_channels; i++) {
+    adcp->cmd[i][0] = header;
+    adcp->cmd[i][1] = command_word(adcp->config, grpp->sequence[i]);
+  }
+  adcp->cb[ADC_CB_TX].ti = DMA_TI_WAIT_RESP | DMA_TI_SRC_INC |
+                           DMA_TI_DEST_DREQ | DMA_TI_PERMAP(SPI_DREQ_TX);
+  adcp->cb[ADC_CB_TX].source_ad = DMA_BUS_MEMORY(adcp->cmd);
+  adcp->cb[ADC_CB_TX].dest_ad = DMA_BUS_PERIPH(&SPI0_FIFO);
+  adcp->cb[ADC_CB_TX].txfr_len = grpp->num_channels * sizeof (adcp->cmd[0]);
+  adcp->cb[ADC_CB_TX].stride = 0;
+  adcp->cb[ADC_CB_TX].nextconbk = DMA_BUS_MEMORY(&adcp->cb[ADC_CB_TX]);
+
+  /* RX ring, the two halves chained into a loop.*/
+  for (i = 0; i < 2; i++) {
+    adcp->cb[i].ti = DMA_TI_INTEN | DMA_TI_WAIT_RESP | DMA_TI_DEST_INC |
+                     DMA_TI_SRC_DREQ | DMA_TI_PERMAP(SPI_DREQ_RX);
+    adcp->cb[i].source_ad = DMA_BUS_PERIPH(&SPI0_FIFO);
+    adcp->cb[i].dest_ad = DMA_BUS_MEMORY(adcp->raw[i]);
+    adcp->cb[i].stride = 0;
+    adcp->cb[i].nextconbk = DMA_BUS_MEMORY(&adcp->cb[i ^ 1]);
+  }
+  adcp->cur = 0;
+  adcp->pos = 0;
+  adcp->plan = 0;
+  queue_chunk(adcp, 0);
+  queue_chunk(adcp, 1);
+
+  /* SPI0 in DMA mode, each header word sets TA and the frame length.*/
+  SPI0_CS = SPI_CS_CLEAR;
+  SPI0_CS = SPI_CS_DMAEN | SPI_CS_ADCS;
+
+  ADC_DMA_RX->conblk_ad = DMA_BUS_MEMORY(&adcp->cb[0]);
+  ADC_DMA_RX->cs = ADC_DMA_CS;
+  ADC_DMA_TX->conblk_ad = DMA_BUS_MEMORY(&adcp->cb[ADC_CB_TX]);
+  ADC_DMA_TX->cs = ADC_DMA_CS;
+}
+
+/**
+ * @brief   Stops an ongoing conversion.
+ *
+ * @param[in] adcp      pointer to the @p ADCDriver object
+ *
+ * @notapi
+ */
+void adc_lld_stop_conversion(ADCDriver *adcp) {
+
+  (void)adcp;
+
+  /* TX first so that no further frame is started.*/
+  dma_reset(ADC_DMA_TX);
+  dma_reset(ADC_DMA_RX);
+  SPI0_CS = SPI_CS_CLEAR;
+}
+
+#endif /* HAL_USE_ADC */
+
+/** @} */
@@ -0,0 +1,329 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    BCM2835/adc_lld.h
+ * @brief   External MCP3x08 ADC on SPI0, low level driver header.
+ *
+ * @addtogroup ADC
+ * @{
+ */
+
+#ifndef _ADC_LLD_H_
+#define _ADC_LLD_H_
+
+#include "bcm2835.h"
+
+#if HAL_USE_ADC || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @name    Converter types
+ * @{
+ */
+#define ADC_DEVICE_MCP3008          0   /**< 10 bit, 8 inputs.              */
+#define ADC_DEVICE_MCP3208          1   /**< 12 bit, 8 inputs.              */
+/** @} */
+
+/**
+ * @name    Sequence entries
+ * @{
+ */
+#define ADC_CHANNEL_IN0             0   /**< @brief CH0, single-ended.      */
+#define ADC_CHANNEL_IN1             1   /**< @brief CH1, single-ended.      */
+#define ADC_CHANNEL_IN2             2   /**< @brief CH2, single-ended.      */
+#define ADC_CHANNEL_IN3             3   /**< @brief CH3, single-ended.      */
+#define ADC_CHANNEL_IN4             4   /**< @brief CH4, single-ended.      */
+#define ADC_CHANNEL_IN5             5   /**< @brief CH5, single-ended.      */
+#define ADC_CHANNEL_IN6             6   /**< @brief CH6, single-ended.      */
+#define ADC_CHANNEL_IN7             7   /**< @brief CH7, single-ended.      */
+/**
+ * @brief   Pseudo-differential pair, @p n selects the D2..D0 code of the
+ *          converter (0 is CH0+/CH1-, 1 is CH0-/CH1+ and so on).
+ */
+#define ADC_CHANNEL_DIFF(n)         (0x80 | ((n) & 7))
+/** @} */
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   DMA channel draining the SPI0 RX FIFO.
+ * @note    Channels 0, 1, 2, 3, 6 and 7 are used by the GPU firmware.
+ */
+#if !defined(BCM2835_ADC_DMA_RX_CHANNEL) || defined(__DOXYGEN__)
+#define BCM2835_ADC_DMA_RX_CHANNEL          4
+#endif
+
+/**
+ * @brief   DMA channel feeding the SPI0 TX FIFO.
+ */
+#if !defined(BCM2835_ADC_DMA_TX_CHANNEL) || defined(__DOXYGEN__)
+#define BCM2835_ADC_DMA_TX_CHANNEL          5
+#endif
+
+/**
+ * @brief   Longest scan sequence of a conversion group.
+ */
+#if !defined(BCM2835_ADC_MAX_SEQUENCE) || defined(__DOXYGEN__)
+#define BCM2835_ADC_MAX_SEQUENCE            8
+#endif
+
+/**
+ * @brief   Conversions collected by DMA between two interrupts.
+ * @details The RX channel fills a raw ring of twice this many words, the
+ *          interrupt of each half unpacks it into the samples buffer. Chunks
+ *          are shortened so that a half or full buffer callback is never
+ *          delayed past its boundary.
+ */
+#if !defined(BCM2835_ADC_DMA_CHUNK) || defined(__DOXYGEN__)
+#define BCM2835_ADC_DMA_CHUNK               64
+#endif
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if !CH_USE_SEMAPHORES
+#error "the ADC driver requires CH_USE_SEMAPHORES"
+#endif
+
+#if HAL_USE_SPI
+#error "the ADC driver takes over SPI0, disable HAL_USE_SPI"
+#endif
+
+#if BCM2835_ADC_DMA_RX_CHANNEL == BCM2835_ADC_DMA_TX_CHANNEL
+#error "the ADC driver needs two distinct DMA channels"
+#endif
+
+#if (BCM2835_ADC_DMA_RX_CHANNEL > 12) || (BCM2835_ADC_DMA_TX_CHANNEL > 14)
+#error "invalid BCM2835 ADC DMA channel"
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   ADC sample data type.
+ */
+typedef uint16_t adcsample_t;
+
+/**
+ * @brief   Channels number in a conversion group.
+ */
+typedef uint16_t adc_channels_num_t;
+
+/**
+ * @brief   Possible ADC failure causes.
+ */
+typedef enum {
+  ADC_ERR_DMAFAILURE = 0,                   /**< DMA operations failure.    */
+  ADC_ERR_OVERFLOW = 1                      /**< Raw ring overrun, the ISR
+                                                 was held off too long.     */
+} adcerror_t;
+
+/**
+ * @brief   Type of a structure representing an ADC driver.
+ */
+typedef struct ADCDriver ADCDriver;
+
+/**
+ * @brief   ADC notification callback type.
+ *
+ * @param[in] adcp      pointer to the @p ADCDriver object triggering the
+ *                      callback
+ * @param[in] buffer    pointer to the most recent samples data
+ * @param[in] n         number of buffer rows available starting from @p buffer
+ */
+typedef void (*adccallback_t)(ADCDriver *adcp, adcsample_t *buffer, size_t n);
+
+/**
+ * @brief   ADC error callback type.
+ *
+ * @param[in] adcp      pointer to the @p ADCDriver object triggering the
+ *                      callback
+ * @param[in] err       ADC error code
+ */
+typedef void (*adcerrorcallback_t)(ADCDriver *adcp, adcerror_t err);
+
+/**
+ * @brief   Conversion group configuration structure.
+ * @details This implementation-dependent structure describes a conversion
+ *          operation.
+ */
+typedef struct {
+  /**
+   * @brief Enables the circular buffer mode for the group.
+   */
+  bool_t                    circular;
+  /**
+   * @brief Number of the analog channels belonging to the conversion group.
+   */
+  adc_channels_num_t        num_channels;
+  /**
+   * @brief Callback function associated to the group or @p NULL.
+   */
+  adccallback_t             end_cb;
+  /**
+   * @brief Error callback or @p NULL.
+   */
+  adcerrorcallback_t        error_cb;
+  /* End of the mandatory fields.*/
+  /**
+   * @brief Scan sequence, @p ADC_CHANNEL_INx or @p ADC_CHANNEL_DIFF()
+   *        entries. A channel may appear more than once.
+   */
+  uint8_t                   sequence[BCM2835_ADC_MAX_SEQUENCE];
+} ADCConversionGroup;
+
+/**
+ * @brief   Driver configuration structure.
+ */
+typedef struct {
+  /**
+   * @brief Converter type, @p ADC_DEVICE_MCP3008 or @p ADC_DEVICE_MCP3208.
+   */
+  uint8_t                   device;
+  /**
+   * @brief SPI0 chip select the converter is wired to, 0 or 1.
+   */
+  uint8_t                   chip_select;
+  /**
+   * @brief SPI0 clock divider, even, from the 250MHz core clock.
+   * @details Conversions run back to back at 32 SCLK periods each, so this
+   *          also sets the conversion rate: a divider of 256 gives about
+   *          30k conversions per second shared by the scan sequence. Keep
+   *          SCLK within the converter limits for its supply, at least
+   *          10kHz and typically at most 1.35MHz at 2.7V.
+   */
+  uint32_t                  clock_divider;
+} ADCConfig;
+
+/**
+ * @brief   Structure representing an ADC driver.
+ */
+struct ADCDriver {
+  /**
+   * @brief Driver state.
+   */
+  adcstate_t                state;
+  /**
+   * @brief Current configuration data.
+   */
+  const ADCConfig           *config;
+  /**
+   * @brief Current samples buffer pointer or @p NULL.
+   */
+  adcsample_t               *samples;
+  /**
+   * @brief Current samples buffer depth or @p 0.
+   */
+  size_t                    depth;
+  /**
+   * @brief Current conversion group pointer or @p NULL.
+   */
+  const ADCConversionGroup  *grpp;
+#if ADC_USE_WAIT || defined(__DOXYGEN__)
+  /**
+   * @brief Waiting thread.
+   */
+  Thread                    *thread;
+#endif
+#if ADC_USE_MUTUAL_EXCLUSION || defined(__DOXYGEN__)
+#if CH_USE_MUTEXES || defined(__DOXYGEN__)
+  /**
+   * @brief Mutex protecting the peripheral.
+   */
+  Mutex                     mutex;
+#elif CH_USE_SEMAPHORES
+  Semaphore                 semaphore;
+#endif
+#endif /* ADC_USE_MUTUAL_EXCLUSION */
+#if defined(ADC_DRIVER_EXT_FIELDS)
+  ADC_DRIVER_EXT_FIELDS
+#endif
+  /* End of the mandatory fields.*/
+  /**
+   * @brief DMA control blocks, two RX ring halves then the TX loop.
+   */
+  bcm2835_dma_cb_t          cb[3];
+  /**
+   * @brief Raw RX ring, one 32 bit word per conversion.
+   */
+  uint32_t                  raw[2][BCM2835_ADC_DMA_CHUNK];
+  /**
+   * @brief TX loop: header and command word for each sequence entry.
+   */
+  uint32_t                  cmd[BCM2835_ADC_MAX_SEQUENCE][2];
+  /**
+   * @brief Conversions queued in each RX ring half.
+   */
+  size_t                    chunk[2];
+  /**
+   * @brief RX ring half the next interrupt completes.
+   */
+  unsigned                  cur;
+  /**
+   * @brief Conversions unpacked into the samples buffer so far.
+   */
+  size_t                    pos;
+  /**
+   * @brief Samples buffer position the next queued chunk starts at.
+   */
+  size_t                    plan;
+  /**
+   * @brief Sample mask for the converter resolution.
+   */
+  adcsample_t               mask;
+};
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+extern ADCDriver ADCD1;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void adc_lld_init(void);
+  void adc_lld_start(ADCDriver *adcp);
+  void adc_lld_stop(ADCDriver *adcp);
+  void adc_lld_start_conversion(ADCDriver *adcp);
+  void adc_lld_stop_conversion(ADCDriver *adcp);
+  void adc_lld_serve_interrupt(ADCDriver *adcp);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_USE_ADC */
+
+#endif /* _ADC_LLD_H_ */
+
+/** @} */
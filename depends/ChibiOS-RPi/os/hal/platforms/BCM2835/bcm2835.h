@@ -34,6 +34,19 @@
 #define GPPUDCLK0       REG(0x20200098)
 #define GPPUDCLK1       REG(0x2020009C)
 
+// -------- GPIO Event Detect --------
+/// Synchronous edge detection, sampled by the system clock. A pin with an
+/// enabled edge sets its GPEDS bit, cleared by writing one.
+#define GPEDS0          REG(0x20200040)
+#define GPEDS1          REG(0x20200044)
+#define GPREN0          REG(0x2020004C)
+#define GPREN1          REG(0x20200050)
+#define GPFEN0          REG(0x20200058)
+#define GPFEN1          REG(0x2020005C)
+
+/* gpio_int[3] covers both banks, IRQ 52, i.e. bit 20 of the second bank.*/
+#define GPIO_IRQ        BIT(20)
+
 #define GPIO_PUD_OFF      0x00
 #define GPIO_PUD_TRISTATE 0x00
 #define GPIO_PUD_PULLDOWN 0x01
@@ -206,8 +219,16 @@
 //                         AUX Registers
 // *****************************************************************************
 
+#define AUX_IRQ         REG(0x20215000)
 #define AUX_ENABLES     REG(0x20215004)
 
+/* AUX_IRQ pending and AUX_ENABLES bits, the three share ARM IRQ 29.*/
+#define AUX_MU          BIT(0)
+#define AUX_SPI1        BIT(1)
+#define AUX_SPI2        BIT(2)
+
+#define AUX_IRQ_LINE    BIT(29)
+
 // --- Mini UART Registers -----
 #define AUX_MU_IO_REG   REG(0x20215040)
 #define AUX_MU_IER_REG  REG(0x20215044)
@@ -228,6 +249,60 @@
 
 #define AUX_MU_LSR_RX_RDY     (AUX_MU_LSR_REG & BIT(0))
 #define AUX_MU_LSR_TX_RDY     (AUX_MU_LSR_REG & BIT(5))
+#define AUX_MU_LSR_TX_IDLE    (AUX_MU_LSR_REG & BIT(6)) /* FIFO empty, last stop bit sent.*/
+
+// --- Universal SPI Masters (SPI1, SPI2) -----
+
+/// See 2.3 "Universal SPI Master (2x)". The IO and TXHOLD registers are at
+/// offsets 0x20 and 0x30, not where the datasheet register map puts them,
+/// and each is mirrored over four words. SPI1 is ALT4 on GPIO16..GPIO21,
+/// SPI2 is ALT4 on GPIO40..GPIO45.
+struct auxspi_t {
+  volatile unsigned int cntl0;
+  volatile unsigned int cntl1;
+  volatile unsigned int stat;
+  volatile unsigned int peek;
+  volatile unsigned int reserved[4];
+  volatile unsigned int io[4];      /* @brief TX/RX FIFO, deasserts CS when done.*/
+  volatile unsigned int txhold[4];  /* @brief TX/RX FIFO, keeps CS asserted.*/
+};
+
+typedef struct auxspi_t auxspi_t;
+
+#define AUX_SPI1_ADDR ((auxspi_t *)0x20215080)
+#define AUX_SPI2_ADDR ((auxspi_t *)0x202150C0)
+
+/* CNTL0 */
+#define AUX_SPI_CNTL0_SPEED_SHIFT   20          /* @brief SCLK = core / (2 * (SPEED + 1)).*/
+#define AUX_SPI_CNTL0_SPEED_MAX     0xFFF
+#define AUX_SPI_CNTL0_CS_SHIFT      17          /* @brief CE2..CE0 levels during a transfer.*/
+#define AUX_SPI_CNTL0_POSTINPUT     BIT(16)
+#define AUX_SPI_CNTL0_VAR_CS        BIT(15)
+#define AUX_SPI_CNTL0_VAR_WIDTH     BIT(14)     /* @brief Shift length in TX bits 28..24.*/
+#define AUX_SPI_CNTL0_ENABLE        BIT(11)
+#define AUX_SPI_CNTL0_IN_RISING     BIT(10)
+#define AUX_SPI_CNTL0_CLEARFIFO     BIT(9)
+#define AUX_SPI_CNTL0_OUT_RISING    BIT(8)
+#define AUX_SPI_CNTL0_CPOL          BIT(7)
+#define AUX_SPI_CNTL0_MSBF_OUT      BIT(6)
+
+/* CNTL1 */
+#define AUX_SPI_CNTL1_TXEMPTY       BIT(7)      /* @brief IRQ while the TX FIFO is empty.*/
+#define AUX_SPI_CNTL1_IDLE          BIT(6)      /* @brief IRQ while the shifter is idle.*/
+#define AUX_SPI_CNTL1_MSBF_IN       BIT(1)
+#define AUX_SPI_CNTL1_KEEP_IN       BIT(0)
+
+/* STAT */
+#define AUX_SPI_STAT_TX_FULL        BIT(10)
+#define AUX_SPI_STAT_TX_EMPTY       BIT(9)
+#define AUX_SPI_STAT_RX_FULL        BIT(8)
+#define AUX_SPI_STAT_RX_EMPTY       BIT(7)
+#define AUX_SPI_STAT_BUSY           BIT(6)
+
+/* Variable width FIFO entries: shift length in bits 28..24, data MSB first
+   from bit 23, so one entry carries up to three bytes.*/
+#define AUX_SPI_WIDTH_SHIFT         24
+#define AUX_SPI_FIFO_DEPTH          4
 
 // *****************************************************************************
 //                        Interrupts
@@ -303,6 +378,65 @@ typedef struct bscdevice_t bscdevice_t;
 #define START_READ    BSC_I2CEN|BSC_ST|BSC_CLEAR|BSC_READ
 #define START_WRITE   BSC_I2CEN|BSC_ST
 
+// *****************************************************************************
+//              BSC/SPI Slave (I2C target on GPIO18..GPIO21)
+// *****************************************************************************
+
+/// See 11.2 "BSC/SPI Slave" register map. Pins are ALT3 on GPIO18 (SDA/MOSI),
+/// GPIO19 (SCL/SCLK), GPIO20 (MISO) and GPIO21 (CE).
+#define BSCSL_DR       REG(0x20214000) /* @brief Data register (FIFO + flags).*/
+#define BSCSL_RSR      REG(0x20214004) /* @brief Operation status / error clear.*/
+#define BSCSL_SLV      REG(0x20214008) /* @brief Slave address.*/
+#define BSCSL_CR       REG(0x2021400C) /* @brief Control.*/
+#define BSCSL_FR       REG(0x20214010) /* @brief Flags.*/
+#define BSCSL_IFLS     REG(0x20214014) /* @brief Interrupt FIFO level select.*/
+#define BSCSL_IMSC     REG(0x20214018) /* @brief Interrupt mask set/clear.*/
+#define BSCSL_RIS      REG(0x2021401C) /* @brief Raw interrupt status.*/
+#define BSCSL_MIS      REG(0x20214020) /* @brief Masked interrupt status.*/
+#define BSCSL_ICR      REG(0x20214024) /* @brief Interrupt clear.*/
+
+/* Data register flags (upper bits of BSCSL_DR).*/
+#define BSCSL_DR_DATA       0x000000FF
+#define BSCSL_DR_OE         BIT(8)  /* @brief RX overrun.*/
+#define BSCSL_DR_UE         BIT(9)  /* @brief TX underrun.*/
+
+/* Operation status flags.*/
+#define BSCSL_RSR_OE        BIT(0)
+#define BSCSL_RSR_UE        BIT(1)
+
+/* Control flags.*/
+#define BSCSL_CR_EN         BIT(0)
+#define BSCSL_CR_SPI        BIT(1)
+#define BSCSL_CR_I2C        BIT(2)
+#define BSCSL_CR_BRK        BIT(7)  /* @brief Stop operation and clear FIFOs.*/
+#define BSCSL_CR_TXE        BIT(8)
+#define BSCSL_CR_RXE        BIT(9)
+
+/* Flag register.*/
+#define BSCSL_FR_TXBUSY     BIT(0)
+#define BSCSL_FR_RXFE       BIT(1)
+#define BSCSL_FR_TXFF       BIT(2)
+#define BSCSL_FR_RXFF       BIT(3)
+#define BSCSL_FR_TXFE       BIT(4)
+#define BSCSL_FR_RXBUSY     BIT(5)
+#define BSCSL_FR_TXFLEVEL(fr)  (((fr) >> 6) & 0x1F)
+#define BSCSL_FR_RXFLEVEL(fr)  (((fr) >> 11) & 0x1F)
+
+/* FIFO level select (1/8, 1/4, 1/2, 3/4, 7/8 of the 16 byte FIFOs).*/
+#define BSCSL_IFLS_TX(lvl)  ((lvl) & 0x07)
+#define BSCSL_IFLS_RX(lvl)  (((lvl) & 0x07) << 3)
+
+/* Interrupt mask, status and clear bits.*/
+#define BSCSL_INT_RX        BIT(0)
+#define BSCSL_INT_TX        BIT(1)
+#define BSCSL_INT_BE        BIT(2)
+#define BSCSL_INT_OE        BIT(3)
+
+#define BSCSL_FIFO_SIZE     16
+
+/* "i2c spi slv" is IRQ 43, i.e. bit 11 of the second pending bank.*/
+#define BSCSL_IRQ           BIT(11)
+
 // *****************************************************************************
 //                  Serial Peripheral Interface (SPI)
 // *****************************************************************************
@@ -343,6 +477,155 @@ typedef struct bscdevice_t bscdevice_t;
 #define SPI_CS_CPHA                 0x00000004 /* @brief Clock Phase.*/
 #define SPI_CS_CS                   0x00000003 /* @brief Chip Select.*/
 
+#define SPI_DREQ_TX                 6          /* @brief DMA peripheral number, TX.*/
+#define SPI_DREQ_RX                 7          /* @brief DMA peripheral number, RX.*/
+
+/* First word of every DMA driven SPI0 transfer: length and CS[7:0].*/
+#define SPI_DMA_HEADER(dlen, cs)    (((uint32_t)(dlen) << 16) | ((cs) & 0xFF))
+
+// *****************************************************************************
+//                    Direct Memory Access Controller (DMA)
+// *****************************************************************************
+
+/// See 4.2 DMA Controller Register Map. Channels 0..14 are 0x100 apart,
+/// channel 15 lives elsewhere and is not described here.
+struct dmachannel_t {
+  volatile unsigned int cs;
+  volatile unsigned int conblk_ad;
+  volatile unsigned int ti;
+  volatile unsigned int source_ad;
+  volatile unsigned int dest_ad;
+  volatile unsigned int txfr_len;
+  volatile unsigned int stride;
+  volatile unsigned int nextconbk;
+  volatile unsigned int debug;
+};
+
+typedef struct dmachannel_t dmachannel_t;
+
+#define DMA_CHANNEL(n)   ((dmachannel_t *)(0x20007000 + ((n) * 0x100)))
+#define DMA_INT_STATUS   REG(0x20007FE0)
+#define DMA_ENABLE       REG(0x20007FF0)
+
+/* Control blocks are read by the DMA engine from memory, 32 byte aligned.*/
+typedef struct {
+  uint32_t ti;
+  uint32_t source_ad;
+  uint32_t dest_ad;
+  uint32_t txfr_len;
+  uint32_t stride;
+  uint32_t nextconbk;
+  uint32_t reserved[2];
+} __attribute__((aligned(32))) bcm2835_dma_cb_t;
+
+/* Channel control and status.*/
+#define DMA_CS_ACTIVE     BIT(0)
+#define DMA_CS_END        BIT(1)
+#define DMA_CS_INT        BIT(2)
+#define DMA_CS_ERROR      BIT(8)
+#define DMA_CS_PRIORITY(n)        (((n) & 0x0F) << 16)
+#define DMA_CS_PANIC_PRIORITY(n)  (((n) & 0x0F) << 20)
+#define DMA_CS_WAIT_WRITES BIT(28)
+#define DMA_CS_ABORT      BIT(30)
+#define DMA_CS_RESET      BIT(31)
+
+/* Transfer information, both in the channel and the control blocks.*/
+#define DMA_TI_INTEN      BIT(0)
+#define DMA_TI_WAIT_RESP  BIT(3)
+#define DMA_TI_DEST_INC   BIT(4)
+#define DMA_TI_DEST_DREQ  BIT(6)
+#define DMA_TI_SRC_INC    BIT(8)
+#define DMA_TI_SRC_DREQ   BIT(10)
+#define DMA_TI_PERMAP(n)  (((n) & 0x1F) << 16)
+
+/* Debug register error flags, write one to clear.*/
+#define DMA_DEBUG_ERRORS  0x00000007
+
+/* DMA channel n raises IRQ 16+n, i.e. a bit of the first pending bank.*/
+#define DMA_IRQ(n)        BIT(16 + (n))
+
+/* The DMA engine addresses peripherals through the 0x7E bus window and
+   memory through the L2 coherent alias, matching what the ARM sees when
+   the firmware leaves the L2 cache enabled (the default).*/
+#define DMA_BUS_PERIPH(a) (((uint32_t)(a) & 0x00FFFFFF) | 0x7E000000)
+#if !defined(DMA_BUS_MEMORY_ALIAS)
+#define DMA_BUS_MEMORY_ALIAS 0x40000000
+#endif
+#define DMA_BUS_MEMORY(p) (((uint32_t)(p) & 0x3FFFFFFF) | DMA_BUS_MEMORY_ALIAS)
+
+// *****************************************************************************
+//                        PCM / I2S Audio (PCM)
+// *****************************************************************************
+
+/// See 8.8 PCM Register Map. Pins are ALT0 on GPIO18 (CLK), GPIO19 (FS),
+/// GPIO20 (DIN) and GPIO21 (DOUT).
+#define PCM_CS_A       REG(0x20203000) /* @brief Control and status.*/
+#define PCM_FIFO_A     REG(0x20203004) /* @brief FIFO data.*/
+#define PCM_MODE_A     REG(0x20203008) /* @brief Mode.*/
+#define PCM_RXC_A      REG(0x2020300C) /* @brief Receive configuration.*/
+#define PCM_TXC_A      REG(0x20203010) /* @brief Transmit configuration.*/
+#define PCM_DREQ_A     REG(0x20203014) /* @brief DMA request level.*/
+#define PCM_INTEN_A    REG(0x20203018) /* @brief Interrupt enables.*/
+#define PCM_INTSTC_A   REG(0x2020301C) /* @brief Interrupt status and clear.*/
+#define PCM_GRAY       REG(0x20203020) /* @brief Gray mode control.*/
+
+/* Control and status.*/
+#define PCM_CS_EN       BIT(0)
+#define PCM_CS_RXON     BIT(1)
+#define PCM_CS_TXON     BIT(2)
+#define PCM_CS_TXCLR    BIT(3)
+#define PCM_CS_RXCLR    BIT(4)
+#define PCM_CS_DMAEN    BIT(9)
+#define PCM_CS_RXERR    BIT(16) /* @brief RX FIFO overflowed, write 1 to clear.*/
+#define PCM_CS_RXSEX    BIT(23) /* @brief Sign extend received samples.*/
+#define PCM_CS_SYNC     BIT(24) /* @brief Reads back as written 2 PCM clocks later.*/
+#define PCM_CS_STBY     BIT(25) /* @brief Take the FIFO RAM out of standby.*/
+
+/* Mode.*/
+#define PCM_MODE_FSLEN(n)   ((n) & 0x3FF)
+#define PCM_MODE_FLEN(n)    (((n) & 0x3FF) << 10)
+#define PCM_MODE_FSI        BIT(20) /* @brief Frame starts on the FS falling edge.*/
+#define PCM_MODE_FSM        BIT(21) /* @brief FS is an input (slave).*/
+#define PCM_MODE_CLKI       BIT(22) /* @brief Sample inputs on the rising edge.*/
+#define PCM_MODE_CLKM       BIT(23) /* @brief CLK is an input (slave).*/
+#define PCM_MODE_FRXP       BIT(25) /* @brief Two 16 bit channels per RX word.*/
+
+/* Receive and transmit channel configuration, width is 8 + WID + 16 * WEX.*/
+#define PCM_XC_CH2WID(n)    ((n) & 0x0F)
+#define PCM_XC_CH2POS(n)    (((n) & 0x3FF) << 4)
+#define PCM_XC_CH2EN        BIT(14)
+#define PCM_XC_CH2WEX       BIT(15)
+#define PCM_XC_CH1WID(n)    (((n) & 0x0F) << 16)
+#define PCM_XC_CH1POS(n)    (((n) & 0x3FF) << 20)
+#define PCM_XC_CH1EN        BIT(30)
+#define PCM_XC_CH1WEX       BIT(31)
+
+/* DMA request levels, in FIFO words.*/
+#define PCM_DREQ_RX_LEVEL(n) ((n) & 0x7F)
+#define PCM_DREQ_RX_PANIC(n) (((n) & 0x7F) << 16)
+
+#define PCM_DREQ_TX         2          /* @brief DMA peripheral number, TX.*/
+#define PCM_DREQ_RX         3          /* @brief DMA peripheral number, RX.*/
+
+#define PCM_FIFO_SIZE       64
+
+// -------- PCM clock (clock manager) --------
+#define CM_PCMCTL      REG(0x20101098)
+#define CM_PCMDIV      REG(0x2010109C)
+
+#define CM_PASSWORD    0x5A000000
+#define CM_CTL_SRC(n)  ((n) & 0x0F)
+#define CM_CTL_ENAB    BIT(4)
+#define CM_CTL_KILL    BIT(5)
+#define CM_CTL_BUSY    BIT(7)
+#define CM_CTL_MASH(n) (((n) & 0x03) << 9)
+#define CM_DIV_DIVI(n) (((n) & 0xFFF) << 12)
+#define CM_DIV_DIVF(n) ((n) & 0xFFF)
+
+#define CM_SRC_OSC     1               /* @brief 19.2MHz crystal.*/
+#define CM_SRC_PLLD    6               /* @brief 500MHz PLLD.*/
+#define CM_PLLD_FREQ   500000000
+
 // *****************************************************************************
 //                  Pulse Width Modulation (PWM)
 // *****************************************************************************
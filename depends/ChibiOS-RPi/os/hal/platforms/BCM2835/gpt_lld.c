@@ -71,11 +71,11 @@ static void gpt_lld_serve_driver_interrupt(GPTDriver *gptp) {
       uint32_t period = gptp->period;
       if (gptp->state == GPT_CONTINUOUS && period > 0) {
 	*(gptp->compare) += period;
-	SYSTIMER_CS |= match_mask;
+	SYSTIMER_CS = match_mask;
 	gptp->config->callback(&GPTD1);
       }
       else {
-	SYSTIMER_CS |= match_mask;
+	SYSTIMER_CS = match_mask;
 	IRQ_DISABLE1 |= gptp->irq_mask;
 	gptp->config->callback(&GPTD1);
 	gptp->state = GPT_READY;
@@ -132,8 +132,14 @@ void gpt_lld_init(void) {
   gptObjectInit(&GPTD2);
 #endif
 
-  /* Clear all match bits.*/
-  SYSTIMER_CS |= 0x0F;
+  /* Clear the match bits of the channels owned here, the match bits are
+     write one to clear so the others are left alone.*/
+#if BCM2835_GPT_USE_TIMER1
+  SYSTIMER_CS = SYSTIMER_CS_MATCH1;
+#endif
+#if BCM2835_GPT_USE_TIMER2
+  SYSTIMER_CS = SYSTIMER_CS_MATCH3;
+#endif
 }
 
 /**
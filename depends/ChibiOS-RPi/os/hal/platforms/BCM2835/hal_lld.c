@@ -111,12 +111,34 @@ CH_IRQ_HANDLER(IrqHandler)
 
 #if HAL_USE_SPI
   spi_lld_serve_interrupt(&SPI0);
+#if BCM2835_SPI_USE_SPI1
+  spi_lld_serve_interrupt(&SPID1);
+#endif
+#if BCM2835_SPI_USE_SPI2
+  spi_lld_serve_interrupt(&SPID2);
+#endif
+#endif
+
+#if HAL_USE_ADC
+  adc_lld_serve_interrupt(&ADCD1);
+#endif
+
+#if HAL_USE_I2S
+  i2s_lld_serve_interrupt(&I2SD1);
+#endif
+
+#if BCM2835_I2C_USE_SLAVE
+  i2cs_lld_serve_interrupt(&I2CSD1);
 #endif
 
 #if HAL_USE_GPT
   gpt_lld_serve_interrupt();
 #endif
 
+#if HAL_USE_ICU
+  icu_lld_serve_interrupt();
+#endif
+
   CH_IRQ_EPILOGUE();
 }
 
@@ -141,6 +163,10 @@ void delayMicroseconds(uint32_t n)
  */
 void hal_lld_init(void) {
   systimer_init();
+
+#if BCM2835_I2C_USE_SLAVE
+  i2cs_lld_init();
+#endif
 }
 
 /**
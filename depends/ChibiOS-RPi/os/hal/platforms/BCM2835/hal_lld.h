@@ -90,6 +90,8 @@ extern "C" {
 }
 #endif
 
+#include "i2cs_lld.h"
+
 #endif /* _HAL_LLD_H_ */
 
 /** @} */
@@ -35,6 +35,14 @@
 /* Driver local definitions.                                                 */
 /*===========================================================================*/
 
+/**
+ * @brief   Commands of the burst being run, for its timeout handler.
+ */
+typedef struct {
+  I2CBurstCommand           *cmdp;
+  size_t                    n;
+} burst_t;
+
 /*===========================================================================*/
 /* Driver exported variables.                                                */
 /*===========================================================================*/
@@ -88,6 +96,7 @@ I2CDriver I2CD2;
 
 /**
  * @brief   Wakes up the waiting thread.
+ * @details Also completes the burst command in flight, if any.
  *
  * @param[in] i2cp      pointer to the @p I2CDriver object
  * @param[in] msg       wakeup message
@@ -96,6 +105,11 @@ I2CDriver I2CD2;
  */
 #define wakeup_isr(i2cp, msg) {                                             \
   chSysLockFromIsr();                                                       \
+  if ((i2cp)->burst != NULL) {                                              \
+    (i2cp)->burst->end = hal_lld_get_counter_value();                       \
+    (i2cp)->burst->status = (msg);                                          \
+    (i2cp)->burst = NULL;                                                   \
+  }                                                                         \
   if ((i2cp)->thread != NULL) {                                             \
     Thread *tp = (i2cp)->thread;                                            \
     (i2cp)->thread = NULL;                                                  \
@@ -135,6 +149,42 @@ static void i2c_lld_safety_timeout(void *p) {
   chSysUnlockFromIsr();
 }
 
+/**
+ * @brief   Handling of stalled bursts.
+ * @details Aborts every command of the burst still in flight.
+ *
+ * @param[in] p         pointer to the @p burst_t of the burst
+ *
+ * @notapi
+ */
+static void i2c_lld_burst_timeout(void *p) {
+  burst_t *bp = (burst_t *)p;
+  halrtcnt_t now = hal_lld_get_counter_value();
+  size_t i;
+
+  chSysLockFromIsr();
+  for (i = 0; i < bp->n; i++) {
+    I2CBurstCommand *cmdp = &bp->cmdp[i];
+    I2CDriver *i2cp = cmdp->driver;
+
+    if (i2cp->burst != cmdp)
+      continue;
+    i2cp->errors |= I2CD_TIMEOUT;
+    i2cp->device->control = 0;
+    i2cp->device->status = BSC_CLKT | BSC_ERR | BSC_DONE;
+    i2cp->burst = NULL;
+    cmdp->end = now;
+    cmdp->status = RDY_TIMEOUT;
+    if (i2cp->thread != NULL) {
+      Thread *tp = i2cp->thread;
+      i2cp->thread = NULL;
+      tp->p_u.rdymsg = RDY_TIMEOUT;
+      chSchReadyI(tp);
+    }
+  }
+  chSysUnlockFromIsr();
+}
+
 /*===========================================================================*/
 /* Driver interrupt handlers.                                                */
 /*===========================================================================*/
@@ -152,6 +202,10 @@ void i2c_lld_serve_interrupt(I2CDriver *i2cp) {
     if (status & BSC_ERR)
       i2cp->errors |= I2CD_ACK_FAILURE;
 
+    /* The interrupt line is shared by all the controllers, the condition
+       must be acknowledged or it would starve the other buses.*/
+    device->control = 0;
+    device->status = BSC_CLKT | BSC_ERR | BSC_DONE;
     wakeup_isr(i2cp, RDY_RESET);
   }
   else if (status & BSC_DONE) {
@@ -209,6 +263,11 @@ void i2c_lld_start(I2CDriver *i2cp) {
   /* Set up GPIO pins for I2C */
 #if BCM2835_I2C_BSC0_ENABLED_
   if ( i2cp->device == BSC0_ADDR ) {
+    /* SDA0/SCL0 are on header pins 27/28 (ID_SD/ID_SC). Unlike GPIO2/3
+       they have no pull-ups on the board, the internal ones are enabled
+       so the bus idles high even without external resistors.*/
+    palSetPadMode(GPIO0_PORT, GPIO0_PAD, PAL_MODE_INPUT_PULLUP);
+    palSetPadMode(GPIO1_PORT, GPIO1_PAD, PAL_MODE_INPUT_PULLUP);
     bcm2835_gpio_fnsel(GPIO0_PAD, GPFN_ALT0);
     bcm2835_gpio_fnsel(GPIO1_PAD, GPFN_ALT0);
   }
@@ -296,12 +355,10 @@ msg_t i2c_lld_master_transmit_timeout(I2CDriver *i2cp, i2caddr_t addr,
   device->dataLength = txbytes;
   device->status = CLEAR_STATUS;
 
-  /* Enable Interrupts and start transfer.*/
-  device->control |= (BSC_INTT | BSC_INTD | START_WRITE);
-
-  /* Is this really needed? there is an outer lock already */
+  /* Enable Interrupts and start transfer. Locked, so that a transfer
+     ending at once finds the thread to wake up.*/
   chSysLock();
-
+  device->control |= (BSC_INTT | BSC_INTD | START_WRITE);
   i2cp->thread = chThdSelf();
   chSchGoSleepS(THD_STATE_SUSPENDED);
   if ((timeout != TIME_INFINITE) && chVTIsArmedI(&vt))
@@ -360,11 +417,9 @@ msg_t i2c_lld_master_receive_timeout(I2CDriver *i2cp, i2caddr_t addr,
   device->dataLength = rxbytes;
   device->status = CLEAR_STATUS;
 
-  /* Enable Interrupts and start transfer.*/
-  device->control = (BSC_INTR | BSC_INTD | START_READ);
-
-  // needed? there is an outer lock already
+  /* Enable Interrupts and start transfer, locked as above.*/
   chSysLock();
+  device->control = (BSC_INTR | BSC_INTD | START_READ);
   i2cp->thread = chThdSelf();
   chSchGoSleepS(THD_STATE_SUSPENDED);
   if ((timeout != TIME_INFINITE) && chVTIsArmedI(&vt))
@@ -374,6 +429,85 @@ msg_t i2c_lld_master_receive_timeout(I2CDriver *i2cp, i2caddr_t addr,
   return chThdSelf()->p_u.rdymsg;
 }
 
+/**
+ * @brief   Writes one command byte on each of several buses at once.
+ * @details The transfers are fully set up first, then started back to back
+ *          with the interrupts masked, so they run in parallel and begin
+ *          within a few bus clock cycles of each other. Each command
+ *          records the counter value when the burst started and when its
+ *          transfer ended, taken in the completion interrupt: a sensor that
+ *          starts converting on the STOP condition started at @p end.
+ *          A bus appears at most once in a burst, commands for the same
+ *          bus need separate bursts.
+ * @note    BCM2835 specific. Bursts are not recorded by transaction
+ *          captures.
+ *
+ * @param[in,out] cmdp  commands, their @p status, @p start and @p end
+ *                      fields are written
+ * @param[in] n         number of commands
+ * @param[in] timeout   the number of ticks before the burst timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ *
+ * @api
+ */
+void i2cMasterCommandBurst(I2CBurstCommand *cmdp, size_t n,
+                           systime_t timeout) {
+  burst_t burst = {cmdp, n};
+  VirtualTimer vt;
+  halrtcnt_t start;
+  size_t i, j;
+
+  chDbgCheck((cmdp != NULL) && (n > 0) && (timeout != TIME_IMMEDIATE),
+             "i2cMasterCommandBurst");
+  for (i = 0; i < n; i++) {
+    chDbgAssert(cmdp[i].driver->state == I2C_READY,
+                "i2cMasterCommandBurst(), #1", "not ready");
+    for (j = 0; j < i; j++)
+      chDbgAssert(cmdp[j].driver != cmdp[i].driver,
+                  "i2cMasterCommandBurst(), #2", "bus used twice");
+  }
+
+  chSysLock();
+  for (i = 0; i < n; i++) {
+    I2CDriver *i2cp = cmdp[i].driver;
+    bscdevice_t *device = i2cp->device;
+
+    i2cp->state = I2C_ACTIVE_TX;
+    i2cp->errors = I2CD_NO_ERROR;
+    i2cp->burst = &cmdp[i];
+    cmdp[i].status = RDY_OK;
+    device->control = BSC_I2CEN | BSC_CLEAR;
+    device->status = CLEAR_STATUS;
+    device->slaveAddress = cmdp[i].addr;
+    device->dataLength = 1;
+    device->dataFifo = cmdp[i].command;
+  }
+  start = hal_lld_get_counter_value();
+  for (i = 0; i < n; i++)
+    cmdp[i].driver->device->control = BSC_I2CEN | BSC_INTD | BSC_ST;
+  for (i = 0; i < n; i++)
+    cmdp[i].start = start;
+  if (timeout != TIME_INFINITE)
+    chVTSetI(&vt, timeout, i2c_lld_burst_timeout, &burst);
+
+  /* The interrupts are masked between the check and the sleep, a transfer
+     ending in between is seen by the check.*/
+  for (i = 0; i < n; i++) {
+    I2CDriver *i2cp = cmdp[i].driver;
+
+    if (i2cp->burst != NULL) {
+      i2cp->thread = chThdSelf();
+      chSchGoSleepS(THD_STATE_SUSPENDED);
+    }
+    i2cp->state = cmdp[i].status == RDY_TIMEOUT ? I2C_LOCKED : I2C_READY;
+  }
+  if ((timeout != TIME_INFINITE) && chVTIsArmedI(&vt))
+    chVTResetI(&vt);
+  chSysUnlock();
+}
+
 #endif /* HAL_USE_I2C */
 
 /** @} */
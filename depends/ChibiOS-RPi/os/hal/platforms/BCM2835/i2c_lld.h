@@ -113,6 +113,24 @@ typedef struct {
   /* End of the mandatory fields.*/
 } I2CConfig;
 
+/**
+ * @brief   One command of a burst, see @p i2cMasterCommandBurst().
+ */
+typedef struct {
+  /** @brief Driver of the bus the command goes out on.*/
+  I2CDriver                 *driver;
+  /** @brief Slave address.*/
+  i2caddr_t                 addr;
+  /** @brief The single byte written.*/
+  uint8_t                   command;
+  /** @brief Outcome: @p RDY_OK, @p RDY_RESET or @p RDY_TIMEOUT.*/
+  msg_t                     status;
+  /** @brief Counter value when the burst was started.*/
+  halrtcnt_t                start;
+  /** @brief Counter value when the transfer ended, with its STOP.*/
+  halrtcnt_t                end;
+} I2CBurstCommand;
+
 /**
  * @brief   Structure representing an I2C driver.
  * @note    Implementations may extend this structure to contain more,
@@ -132,6 +150,10 @@ struct I2CDriver {
   Mutex                     mutex;
 #endif /* CH_USE_MUTEXES */
 #endif /* I2C_USE_MUTUAL_EXCLUSION */
+#if I2C_USE_CAPTURE
+  /** @brief Capture the transactions are recorded to, @p NULL if none.*/
+  I2CCapture                *capture;
+#endif /* I2C_USE_CAPTURE */
 #if defined(I2C_DRIVER_EXT_FIELDS)
   I2C_DRIVER_EXT_FIELDS
 #endif
@@ -168,6 +190,10 @@ struct I2CDriver {
    * @brief   Current index in buffer when receiving data.
    */
   size_t                    rxidx;
+  /**
+   * @brief   Burst command in flight on this bus, @p NULL if none.
+   */
+  I2CBurstCommand           *burst;
 };
 
 /*===========================================================================*/
@@ -338,6 +364,9 @@ extern "C" {
 
   void i2c_lld_serve_interrupt(I2CDriver *i2cp);
 
+  void i2cMasterCommandBurst(I2CBurstCommand *cmdp, size_t n,
+                             systime_t timeout);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,332 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    BCM2835/i2cs_lld.c
+ * @brief   BSC/SPI slave (I2C target) low level driver code.
+ * @details The slave serves a byte-addressed register map to an external
+ *          I2C host. The map is double buffered: the producer fills the
+ *          back buffer in place and commits it, the commit swaps the
+ *          buffers between host bursts so that a host burst read always
+ *          returns one coherent snapshot. Bytes are fed to the TX FIFO
+ *          straight from the front buffer, no staging copy is made.
+ *
+ *          Host protocol:
+ *          - A read without a preceding write returns the map from offset 0.
+ *          - A write sets the register pointer with its first byte. Further
+ *            bytes of the same write are handed to the write callback.
+ *          - A read following a pointer write starts at that pointer.
+ *          .
+ *
+ * @addtogroup I2CS
+ * @{
+ */
+
+#include "ch.h"
+#include "hal.h"
+
+#if BCM2835_I2C_USE_SLAVE || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/* TX interrupt when the FIFO drains to half, RX interrupt at 1/8.*/
+#define I2CS_IFLS   (BSCSL_IFLS_TX(2) | BSCSL_IFLS_RX(0))
+
+#define I2CS_CR     (BSCSL_CR_EN | BSCSL_CR_I2C | BSCSL_CR_TXE | BSCSL_CR_RXE)
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   I2C slave driver identifier.
+ */
+I2CSlaveDriver I2CSD1;
+
+/*===========================================================================*/
+/* Driver local variables.                                                   */
+/*===========================================================================*/
+
+/* Map offset the TX FIFO was last preloaded from.*/
+static size_t tx_base;
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Tops up the TX FIFO from the front buffer.
+ *
+ * @notapi
+ */
+static void fill_tx(I2CSlaveDriver *i2csp) {
+  const uint8_t *map = i2csp->config->buffers[i2csp->front];
+  size_t size = i2csp->config->size;
+
+  while ((i2csp->tx_reg < size) && !(BSCSL_FR & BSCSL_FR_TXFF)) {
+    BSCSL_DR = map[i2csp->tx_reg++];
+    i2csp->tx_bytes++;
+  }
+
+  /* Nothing left to queue, stop the level interrupt from refiring.*/
+  if (i2csp->tx_reg >= size)
+    BSCSL_IMSC &= ~BSCSL_INT_TX;
+}
+
+/**
+ * @brief   Discards the TX FIFO contents and preloads it from @p reg.
+ *
+ * @notapi
+ */
+static void rewind_tx(I2CSlaveDriver *i2csp, size_t reg) {
+  BSCSL_CR = I2CS_CR | BSCSL_CR_BRK;
+  BSCSL_CR = I2CS_CR;
+  if (reg > i2csp->config->size)
+    reg = i2csp->config->size;
+  tx_base = i2csp->tx_reg = reg;
+  BSCSL_IMSC |= BSCSL_INT_TX;
+  fill_tx(i2csp);
+}
+
+/**
+ * @brief   Common ISR and commit-time processing.
+ *
+ * @notapi
+ */
+static void serve_slaveI(I2CSlaveDriver *i2csp) {
+  uint32_t fr;
+
+  /* Host writes, the first byte after an idle bus is the pointer.*/
+  while (!((fr = BSCSL_FR) & BSCSL_FR_RXFE)) {
+    uint32_t dr = BSCSL_DR;
+    uint8_t value = dr & BSCSL_DR_DATA;
+
+    if (dr & (BSCSL_DR_OE | BSCSL_DR_UE))
+      i2csp->errors++;
+
+    if (i2csp->expect_pointer) {
+      i2csp->expect_pointer = FALSE;
+      i2csp->wr_reg = value;
+      rewind_tx(i2csp, value);
+    }
+    else {
+      if (i2csp->config->write_cb != NULL)
+        i2csp->config->write_cb(i2csp, i2csp->wr_reg, value);
+      i2csp->wr_reg++;
+    }
+  }
+
+  if (!(fr & (BSCSL_FR_RXBUSY | BSCSL_FR_TXBUSY))) {
+    size_t consumed = i2csp->tx_reg - BSCSL_FR_TXFLEVEL(fr) - tx_base;
+
+    i2csp->expect_pointer = TRUE;
+
+    /* A burst has ended, or the preloaded bytes are stale: restart from
+       the top of the most recent snapshot.*/
+    if ((consumed > 0) || i2csp->swap_pending) {
+      if (consumed > 0)
+        i2csp->bursts++;
+      if (i2csp->swap_pending) {
+        i2csp->swap_pending = FALSE;
+        i2csp->front ^= 1;
+        i2csp->generation++;
+      }
+      rewind_tx(i2csp, 0);
+      return;
+    }
+  }
+
+  fill_tx(i2csp);
+}
+
+/*===========================================================================*/
+/* Driver interrupt handlers.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   BSC slave IRQ handler.
+ *
+ * @param[in] i2csp     pointer to the @p I2CSlaveDriver object
+ *
+ * @notapi
+ */
+void i2cs_lld_serve_interrupt(I2CSlaveDriver *i2csp) {
+  uint32_t mis;
+
+  if (!(IRQ_PEND2 & BSCSL_IRQ) || (i2csp->state != I2CS_READY))
+    return;
+
+  mis = BSCSL_MIS;
+  if (mis & BSCSL_INT_OE) {
+    i2csp->errors++;
+    BSCSL_RSR = 0;
+  }
+
+  chSysLockFromIsr();
+  serve_slaveI(i2csp);
+  chSysUnlockFromIsr();
+
+  BSCSL_ICR = mis;
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Low level I2C slave driver initialization.
+ *
+ * @notapi
+ */
+void i2cs_lld_init(void) {
+  I2CSD1.state = I2CS_STOP;
+  I2CSD1.config = NULL;
+}
+
+/**
+ * @brief   Configures and starts serving the register map.
+ * @note    Both buffers should hold a valid snapshot before starting, the
+ *          host can read the front one immediately.
+ *
+ * @param[in] i2csp     pointer to the @p I2CSlaveDriver object
+ * @param[in] config    pointer to the @p I2CSlaveConfig object
+ *
+ * @api
+ */
+void i2csStart(I2CSlaveDriver *i2csp, const I2CSlaveConfig *config) {
+
+  chDbgCheck((i2csp != NULL) && (config != NULL) &&
+             (config->size <= BCM2835_I2CS_MAX_MAP_SIZE) &&
+             (config->buffers[0] != NULL) && (config->buffers[1] != NULL),
+             "i2csStart");
+
+  IRQ_DISABLE2 = BSCSL_IRQ;
+
+  i2csp->config = config;
+  i2csp->front = 0;
+  i2csp->swap_pending = FALSE;
+  i2csp->expect_pointer = TRUE;
+  i2csp->wr_reg = 0;
+  i2csp->generation = 0;
+  i2csp->bursts = 0;
+  i2csp->tx_bytes = 0;
+  i2csp->errors = 0;
+
+  bcm2835_gpio_fnsel(GPIO18_PAD, GPFN_ALT3);  /* BSC_SL SDA.*/
+  bcm2835_gpio_fnsel(GPIO19_PAD, GPFN_ALT3);  /* BSC_SL SCL.*/
+
+  BSCSL_CR = 0;
+  BSCSL_RSR = 0;
+  BSCSL_SLV = config->address & 0x7F;
+  BSCSL_IFLS = I2CS_IFLS;
+  BSCSL_ICR = BSCSL_INT_RX | BSCSL_INT_TX | BSCSL_INT_BE | BSCSL_INT_OE;
+  BSCSL_IMSC = BSCSL_INT_RX | BSCSL_INT_OE;
+
+  chSysLock();
+  rewind_tx(i2csp, 0);
+  i2csp->state = I2CS_READY;
+  chSysUnlock();
+
+  IRQ_ENABLE2 = BSCSL_IRQ;
+}
+
+/**
+ * @brief   Stops serving the register map and releases the pins.
+ *
+ * @param[in] i2csp     pointer to the @p I2CSlaveDriver object
+ *
+ * @api
+ */
+void i2csStop(I2CSlaveDriver *i2csp) {
+
+  chDbgCheck(i2csp != NULL, "i2csStop");
+
+  IRQ_DISABLE2 = BSCSL_IRQ;
+  BSCSL_IMSC = 0;
+  BSCSL_CR = BSCSL_CR_BRK;
+  BSCSL_CR = 0;
+
+  bcm2835_gpio_fnsel(GPIO18_PAD, GPFN_IN);
+  bcm2835_gpio_fnsel(GPIO19_PAD, GPFN_IN);
+
+  i2csp->state = I2CS_STOP;
+}
+
+/**
+ * @brief   Returns the buffer the next snapshot must be written into.
+ * @details The buffer is not visible to the host until
+ *          @p i2csCommitUpdate() is called. A previously committed but not
+ *          yet published snapshot is taken back by this call, so the
+ *          producer can refresh it in place.
+ * @note    Only one producer thread is supported.
+ *
+ * @param[in] i2csp     pointer to the @p I2CSlaveDriver object
+ * @return              Pointer to the back buffer.
+ *
+ * @api
+ */
+uint8_t *i2csGetUpdateBuffer(I2CSlaveDriver *i2csp) {
+  uint8_t *buf;
+
+  chSysLock();
+  i2csp->swap_pending = FALSE;
+  buf = i2csp->config->buffers[i2csp->front ^ 1];
+  chSysUnlock();
+  return buf;
+}
+
+/**
+ * @brief   Publishes the back buffer.
+ * @details The buffers are swapped immediately if the bus is idle,
+ *          otherwise as soon as the running host burst completes.
+ *
+ * @param[in] i2csp     pointer to the @p I2CSlaveDriver object
+ *
+ * @iclass
+ */
+void i2csCommitUpdateI(I2CSlaveDriver *i2csp) {
+
+  chDbgCheckClassI();
+  chDbgAssert(i2csp->state == I2CS_READY,
+              "i2csCommitUpdateI(), #1", "not ready");
+
+  i2csp->swap_pending = TRUE;
+  serve_slaveI(i2csp);
+}
+
+/**
+ * @brief   Publishes the back buffer.
+ *
+ * @param[in] i2csp     pointer to the @p I2CSlaveDriver object
+ *
+ * @api
+ */
+void i2csCommitUpdate(I2CSlaveDriver *i2csp) {
+
+  chSysLock();
+  i2csCommitUpdateI(i2csp);
+  chSysUnlock();
+}
+
+#endif /* BCM2835_I2C_USE_SLAVE */
+
+/** @} */
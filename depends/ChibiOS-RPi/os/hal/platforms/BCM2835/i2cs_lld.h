@@ -0,0 +1,184 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    BCM2835/i2cs_lld.h
+ * @brief   BSC/SPI slave (I2C target) low level driver header.
+ *
+ * @addtogroup I2CS
+ * @{
+ */
+
+#ifndef _I2CS_LLD_H_
+#define _I2CS_LLD_H_
+
+#include "bcm2835.h"
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Enables the BSC/SPI slave peripheral as an I2C target.
+ * @note    The peripheral owns GPIO18 and GPIO19 while started.
+ */
+#if !defined(BCM2835_I2C_USE_SLAVE) || defined(__DOXYGEN__)
+#define BCM2835_I2C_USE_SLAVE               FALSE
+#endif
+
+/**
+ * @brief   Largest register map served by the slave.
+ * @details The register pointer written by the host is a single byte, so
+ *          maps larger than 256 bytes cannot be addressed.
+ */
+#if !defined(BCM2835_I2CS_MAX_MAP_SIZE) || defined(__DOXYGEN__)
+#define BCM2835_I2CS_MAX_MAP_SIZE           256
+#endif
+
+#if BCM2835_I2C_USE_SLAVE || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if BCM2835_I2CS_MAX_MAP_SIZE > 256
+#error "BCM2835_I2CS_MAX_MAP_SIZE cannot exceed 256 bytes"
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Driver state machine possible states.
+ */
+typedef enum {
+  I2CS_UNINIT = 0,                  /**< Not initialized.                   */
+  I2CS_STOP = 1,                    /**< Stopped.                           */
+  I2CS_READY = 2                    /**< Serving the register map.          */
+} i2csstate_t;
+
+/**
+ * @brief   Type of a structure representing an I2C slave driver.
+ */
+typedef struct I2CSlaveDriver I2CSlaveDriver;
+
+/**
+ * @brief   Host write notification callback type.
+ * @details Invoked from the ISR, in a locked state, for every byte the host
+ *          writes past the register pointer. @p reg is the register the byte
+ *          was addressed to.
+ *
+ * @param[in] i2csp     pointer to the @p I2CSlaveDriver object
+ * @param[in] reg       register offset
+ * @param[in] value     written value
+ */
+typedef void (*i2cswritecb_t)(I2CSlaveDriver *i2csp, uint8_t reg, uint8_t value);
+
+/**
+ * @brief   Driver configuration structure.
+ */
+typedef struct {
+  /**
+   * @brief 7 bit address the slave answers to.
+   */
+  uint8_t                   address;
+  /**
+   * @brief Register map size in bytes, at most @p BCM2835_I2CS_MAX_MAP_SIZE.
+   */
+  size_t                    size;
+  /**
+   * @brief The two register map buffers, each @p size bytes.
+   * @details One is served to the host while the other is being filled by
+   *          the producer; @p i2csCommitUpdate() swaps them.
+   */
+  uint8_t                   *buffers[2];
+  /**
+   * @brief Host write callback, can be @p NULL.
+   */
+  i2cswritecb_t             write_cb;
+} I2CSlaveConfig;
+
+/**
+ * @brief   Structure representing an I2C slave driver.
+ */
+struct I2CSlaveDriver {
+  /** @brief Driver state.*/
+  i2csstate_t               state;
+  /** @brief Current configuration data.*/
+  const I2CSlaveConfig      *config;
+  /** @brief Index of the buffer currently served to the host.*/
+  uint8_t                   front;
+  /** @brief A committed update is waiting for the current burst to end.*/
+  bool_t                    swap_pending;
+  /** @brief The next received byte is a register pointer.*/
+  bool_t                    expect_pointer;
+  /** @brief Register pointer of the current write.*/
+  uint8_t                   wr_reg;
+  /** @brief Next map offset to be queued into the TX FIFO.*/
+  size_t                    tx_reg;
+  /** @brief Snapshot generation, incremented on every swap.*/
+  uint32_t                  generation;
+  /** @brief Statistics: bursts started by the host.*/
+  uint32_t                  bursts;
+  /** @brief Statistics: bytes queued to the host.*/
+  uint32_t                  tx_bytes;
+  /** @brief Statistics: RX overruns and TX underruns.*/
+  uint32_t                  errors;
+};
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Returns the generation of the snapshot being served.
+ *
+ * @param[in] i2csp     pointer to the @p I2CSlaveDriver object
+ *
+ * @api
+ */
+#define i2csGetGeneration(i2csp) ((i2csp)->generation)
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+extern I2CSlaveDriver I2CSD1;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void i2cs_lld_init(void);
+  void i2cs_lld_serve_interrupt(I2CSlaveDriver *i2csp);
+  void i2csStart(I2CSlaveDriver *i2csp, const I2CSlaveConfig *config);
+  void i2csStop(I2CSlaveDriver *i2csp);
+  uint8_t *i2csGetUpdateBuffer(I2CSlaveDriver *i2csp);
+  void i2csCommitUpdateI(I2CSlaveDriver *i2csp);
+  void i2csCommitUpdate(I2CSlaveDriver *i2csp);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BCM2835_I2C_USE_SLAVE */
+
+#endif /* _I2CS_LLD_H_ */
+
+/** @} */
@@ -0,0 +1,435 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    BCM2835/i2s_lld.c
+ * @brief   PCM/I2S receive low level driver code.
+ * @details The PCM RX FIFO is drained by a DMA channel into the two halves
+ *          of the configured buffer, the callback runs once per half so
+ *          the CPU only sees one interrupt every @p size/2 words. Sample
+ *          words are sign extended by the PCM block, or packed two 16 bit
+ *          channels per word.
+ *          In master mode the bit clock is derived from PLLD by the PCM
+ *          clock manager with MASH filtering, the fractional divider keeps
+ *          the long term rate exact at the cost of some bit clock jitter.
+ *
+ * @addtogroup I2S
+ * @{
+ */
+
+#include "ch.h"
+#include "hal.h"
+
+#if HAL_USE_I2S || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+#define I2S_DMA_RX      DMA_CHANNEL(BCM2835_I2S_DMA_RX_CHANNEL)
+
+/* DREQ when 16 words are waiting, the panic level leaves 16 words of
+   margin before the FIFO overflows.*/
+#define I2S_DREQ        (PCM_DREQ_RX_LEVEL(16) | PCM_DREQ_RX_PANIC(48))
+
+/* Bounded waits, in microseconds.*/
+#define I2S_SYNC_TIMEOUT    100
+#define I2S_CLOCK_TIMEOUT   100
+
+#define I2S_CM_SRC      (CM_PASSWORD | CM_CTL_SRC(CM_SRC_PLLD))
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   I2S driver identifier.
+ */
+I2SDriver I2SD1;
+
+/*===========================================================================*/
+/* Driver local variables.                                                   */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Stops the DMA channel and clears its status.
+ *
+ * @notapi
+ */
+static void dma_reset(dmachannel_t *dmap) {
+
+  dmap->cs = DMA_CS_RESET;
+  dmap->cs = DMA_CS_INT | DMA_CS_END;
+  dmap->debug = DMA_DEBUG_ERRORS;
+}
+
+/**
+ * @brief   Empties the RX FIFO.
+ * @details The PCM block runs on the bit clock, the clear only takes
+ *          effect two clocks later. The SYNC bit echoes back with the same
+ *          delay and tells when that happened.
+ *
+ * @notapi
+ */
+static void pcm_clear_rx(void) {
+  uint32_t sync = ~PCM_CS_A & PCM_CS_SYNC;
+  uint32_t t0;
+
+  PCM_CS_A = (PCM_CS_A & ~PCM_CS_SYNC) | PCM_CS_RXCLR | sync;
+  t0 = SYSTIMER_CLO;
+  while (((PCM_CS_A & PCM_CS_SYNC) != sync) &&
+         (SYSTIMER_CLO - t0 < I2S_SYNC_TIMEOUT))
+    ;
+}
+
+/**
+ * @brief   Stops the PCM clock.
+ *
+ * @notapi
+ */
+static void pcm_clock_stop(void) {
+  uint32_t t0;
+
+  CM_PCMCTL = I2S_CM_SRC;
+  t0 = SYSTIMER_CLO;
+  while ((CM_PCMCTL & CM_CTL_BUSY) &&
+         (SYSTIMER_CLO - t0 < I2S_CLOCK_TIMEOUT))
+    ;
+}
+
+/**
+ * @brief   Starts the PCM clock at @p bclk Hz.
+ * @note    The clock manager must not be reprogrammed while busy.
+ *
+ * @notapi
+ */
+static void pcm_clock_start(uint32_t bclk) {
+  uint32_t divi = CM_PLLD_FREQ / bclk;
+  uint32_t divf = (uint32_t)(((uint64_t)(CM_PLLD_FREQ % bclk) << 12) / bclk);
+
+  pcm_clock_stop();
+  CM_PCMDIV = CM_PASSWORD | CM_DIV_DIVI(divi) | CM_DIV_DIVF(divf);
+  CM_PCMCTL = I2S_CM_SRC | CM_CTL_MASH(1);
+  CM_PCMCTL = I2S_CM_SRC | CM_CTL_MASH(1) | CM_CTL_ENAB;
+}
+
+/**
+ * @brief   Channel 1 configuration field for a slot.
+ * @note    The channel 2 fields are laid out the same 16 bits lower.
+ *
+ * @notapi
+ */
+static uint32_t channel_config(uint32_t pos, uint32_t width) {
+  uint32_t wid = width - 8;
+
+  return PCM_XC_CH1EN | PCM_XC_CH1POS(pos) | PCM_XC_CH1WID(wid & 15) |
+         (wid & 16 ? PCM_XC_CH1WEX : 0);
+}
+
+/**
+ * @brief   Stops the transfer, the PCM block stays configured.
+ *
+ * @notapi
+ */
+static void stop_rx(void) {
+
+  PCM_CS_A &= ~(PCM_CS_RXON | PCM_CS_DMAEN);
+  dma_reset(I2S_DMA_RX);
+}
+
+/**
+ * @brief   Programs and starts the DMA chain over the buffer halves.
+ *
+ * @notapi
+ */
+static void start_rx(I2SDriver *i2sp, bool_t continuous) {
+  const I2SConfig *config = i2sp->config;
+  size_t half = config->size / 2;
+  unsigned i;
+
+  chDbgAssert((config->rx_buffer != NULL) && (config->size > 0) &&
+              (config->size % 16 == 0) &&
+              (((uint32_t)config->rx_buffer & 31) == 0),
+              "start_rx(), #1", "invalid buffer");
+
+  for (i = 0; i < 2; i++) {
+    i2sp->cb[i].ti = DMA_TI_INTEN | DMA_TI_WAIT_RESP | DMA_TI_DEST_INC |
+                     DMA_TI_SRC_DREQ | DMA_TI_PERMAP(PCM_DREQ_RX);
+    i2sp->cb[i].source_ad = DMA_BUS_PERIPH(&PCM_FIFO_A);
+    i2sp->cb[i].dest_ad = DMA_BUS_MEMORY((uint32_t *)config->rx_buffer +
+                                         i * half);
+    i2sp->cb[i].txfr_len = half * sizeof (uint32_t);
+    i2sp->cb[i].stride = 0;
+  }
+  i2sp->cb[0].nextconbk = DMA_BUS_MEMORY(&i2sp->cb[1]);
+  i2sp->cb[1].nextconbk = continuous ? DMA_BUS_MEMORY(&i2sp->cb[0]) : 0;
+  i2sp->cur = 0;
+  i2sp->continuous = continuous;
+
+  /* Stale samples out, DMA requests on, then the receiver.*/
+  pcm_clear_rx();
+  PCM_CS_A |= PCM_CS_RXERR | PCM_CS_DMAEN;
+  I2S_DMA_RX->conblk_ad = DMA_BUS_MEMORY(&i2sp->cb[0]);
+  I2S_DMA_RX->cs = DMA_CS_WAIT_WRITES | DMA_CS_ACTIVE;
+  PCM_CS_A |= PCM_CS_RXON;
+}
+
+/*===========================================================================*/
+/* Driver interrupt handlers.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   RX DMA channel IRQ handler.
+ *
+ * @param[in] i2sp      pointer to the @p I2SDriver object
+ *
+ * @notapi
+ */
+void i2s_lld_serve_interrupt(I2SDriver *i2sp) {
+  dmachannel_t *dmap = I2S_DMA_RX;
+  size_t half;
+  unsigned cur;
+  uint32_t cs;
+
+  if (!(IRQ_PEND1 & DMA_IRQ(BCM2835_I2S_DMA_RX_CHANNEL)))
+    return;
+
+  /* Acknowledging without stopping a running chain.*/
+  cs = dmap->cs;
+  dmap->cs = DMA_CS_WAIT_WRITES | DMA_CS_INT | (cs & DMA_CS_ACTIVE);
+
+  chSysLockFromIsr();
+
+  /* The exchange may have been stopped while the IRQ was pending.*/
+  if (i2sp->state != I2S_ACTIVE) {
+    chSysUnlockFromIsr();
+    return;
+  }
+
+  if (cs & DMA_CS_ERROR) {
+    stop_rx();
+    i2sp->overruns++;
+    i2sp->state = I2S_READY;
+    chSysUnlockFromIsr();
+    return;
+  }
+
+  /* A sample was dropped by the FIFO, the W1C flag is cleared by writing
+     it back.*/
+  if (PCM_CS_A & PCM_CS_RXERR) {
+    PCM_CS_A |= PCM_CS_RXERR;
+    i2sp->overruns++;
+  }
+
+  /* The engine must be on the other half by now, back on this one means
+     it is being overwritten already. Capture goes on, the stream has a
+     discontinuity.*/
+  cur = i2sp->cur;
+  if (i2sp->continuous &&
+      (dmap->conblk_ad == DMA_BUS_MEMORY(&i2sp->cb[cur])))
+    i2sp->overruns++;
+  i2sp->cur = cur ^ 1;
+
+  half = i2sp->config->size / 2;
+  if (cur == 0) {
+    if (i2sp->config->end_cb != NULL)
+      i2sp->config->end_cb(i2sp, 0, half);
+  }
+  else if (i2sp->continuous) {
+    if (i2sp->config->end_cb != NULL)
+      i2sp->config->end_cb(i2sp, half, half);
+  }
+  else {
+    stop_rx();
+    i2sp->state = I2S_COMPLETE;
+    if (i2sp->config->end_cb != NULL)
+      i2sp->config->end_cb(i2sp, half, half);
+    if (i2sp->state == I2S_COMPLETE)
+      i2sp->state = I2S_READY;
+  }
+
+  chSysUnlockFromIsr();
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Low level I2S driver initialization.
+ *
+ * @notapi
+ */
+void i2s_lld_init(void) {
+
+  i2sObjectInit(&I2SD1);
+}
+
+/**
+ * @brief   Configures and activates the I2S peripheral.
+ *
+ * @param[in] i2sp      pointer to the @p I2SDriver object
+ *
+ * @notapi
+ */
+void i2s_lld_start(I2SDriver *i2sp) {
+  const I2SConfig *config = i2sp->config;
+  uint32_t flen = config->frame_length;
+  uint32_t fslen, pos1, pos2, mode, rxc;
+
+  chDbgAssert((config->tx_buffer == NULL) &&
+              (config->mode & I2S_MODE_RX) && !(config->mode & I2S_MODE_TX),
+              "i2s_lld_start(), #1", "receive only");
+  chDbgAssert((config->width >= 8) && (config->width <= 32) &&
+              (config->channels >= 1) && (config->channels <= 2) &&
+              (!config->packed ||
+               ((config->width <= 16) && (config->channels == 2))),
+              "i2s_lld_start(), #2", "invalid sample format");
+
+  switch (config->format) {
+  case BCM2835_I2S_FORMAT_PHILIPS:
+    fslen = flen / 2;
+    pos1 = 1;
+    pos2 = flen / 2 + 1;
+    mode = PCM_MODE_FSI;
+    break;
+  case BCM2835_I2S_FORMAT_LEFT_JUSTIFIED:
+    fslen = flen / 2;
+    pos1 = 0;
+    pos2 = flen / 2;
+    mode = 0;
+    break;
+  default:
+    fslen = 1;
+    pos1 = 1;
+    pos2 = 1 + config->width;
+    mode = 0;
+  }
+
+  chDbgAssert((flen >= 2) && (flen <= 1024) &&
+              (((config->channels == 2) ? pos2 : pos1) + config->width <= flen),
+              "i2s_lld_start(), #3", "samples do not fit the frame");
+
+  /* Inputs sampled on the rising bit clock edge in every format.*/
+  mode |= PCM_MODE_FSLEN(fslen) | PCM_MODE_FLEN(flen - 1) | PCM_MODE_CLKI;
+  if (!(config->mode & I2S_MODE_MASTER))
+    mode |= PCM_MODE_CLKM | PCM_MODE_FSM;
+  if (config->packed)
+    mode |= PCM_MODE_FRXP;
+
+  rxc = channel_config(pos1, config->width);
+  if (config->channels == 2)
+    rxc |= channel_config(pos2, config->width) >> 16;
+
+  if (i2sp->state == I2S_STOP) {
+    bcm2835_gpio_fnsel(GPIO18_PAD, GPFN_ALT0);  /* PCM_CLK.*/
+    bcm2835_gpio_fnsel(GPIO19_PAD, GPFN_ALT0);  /* PCM_FS.*/
+    bcm2835_gpio_fnsel(GPIO20_PAD, GPFN_ALT0);  /* PCM_DIN.*/
+
+    DMA_ENABLE |= BIT(BCM2835_I2S_DMA_RX_CHANNEL);
+    dma_reset(I2S_DMA_RX);
+    IRQ_ENABLE1 = DMA_IRQ(BCM2835_I2S_DMA_RX_CHANNEL);
+  }
+  else
+    pcm_clock_stop();
+
+  /* The block must be enabled before its registers can be written.*/
+  PCM_CS_A = PCM_CS_EN | PCM_CS_STBY;
+  PCM_MODE_A = mode;
+  PCM_RXC_A = rxc;
+  PCM_TXC_A = 0;
+  PCM_INTEN_A = 0;
+  PCM_DREQ_A = I2S_DREQ;
+  PCM_CS_A = PCM_CS_EN | PCM_CS_STBY | PCM_CS_RXSEX;
+
+  if (config->mode & I2S_MODE_MASTER) {
+    chDbgAssert(config->sample_rate > 0,
+                "i2s_lld_start(), #4", "no sample rate");
+    pcm_clock_start(config->sample_rate * flen);
+  }
+  i2sp->overruns = 0;
+}
+
+/**
+ * @brief   Deactivates the I2S peripheral.
+ *
+ * @param[in] i2sp      pointer to the @p I2SDriver object
+ *
+ * @notapi
+ */
+void i2s_lld_stop(I2SDriver *i2sp) {
+
+  if (i2sp->state == I2S_READY) {
+    IRQ_DISABLE1 = DMA_IRQ(BCM2835_I2S_DMA_RX_CHANNEL);
+    stop_rx();
+    pcm_clock_stop();
+    PCM_CS_A = 0;
+
+    bcm2835_gpio_fnsel(GPIO18_PAD, GPFN_IN);
+    bcm2835_gpio_fnsel(GPIO19_PAD, GPFN_IN);
+    bcm2835_gpio_fnsel(GPIO20_PAD, GPFN_IN);
+  }
+}
+
+/**
+ * @brief   Starts a one-shot capture filling the buffer once.
+ *
+ * @param[in] i2sp      pointer to the @p I2SDriver object
+ *
+ * @notapi
+ */
+void i2s_lld_start_exchange(I2SDriver *i2sp) {
+
+  start_rx(i2sp, FALSE);
+}
+
+/**
+ * @brief   Starts a capture cycling over the buffer until stopped.
+ *
+ * @param[in] i2sp      pointer to the @p I2SDriver object
+ *
+ * @notapi
+ */
+void i2s_lld_start_exchange_continuous(I2SDriver *i2sp) {
+
+  start_rx(i2sp, TRUE);
+}
+
+/**
+ * @brief   Stops the ongoing capture.
+ *
+ * @param[in] i2sp      pointer to the @p I2SDriver object
+ *
+ * @notapi
+ */
+void i2s_lld_stop_exchange(I2SDriver *i2sp) {
+
+  (void)i2sp;
+
+  stop_rx();
+}
+
+#endif /* HAL_USE_I2S */
+
+/** @} */
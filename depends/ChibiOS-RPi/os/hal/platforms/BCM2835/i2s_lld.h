@@ -0,0 +1,224 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    BCM2835/i2s_lld.h
+ * @brief   PCM/I2S receive low level driver header.
+ *
+ * @addtogroup I2S
+ * @{
+ */
+
+#ifndef _I2S_LLD_H_
+#define _I2S_LLD_H_
+
+#include "bcm2835.h"
+
+#if HAL_USE_I2S || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @name    Frame formats
+ * @{
+ */
+/** @brief Philips I2S, data one clock after the FS edge, left on FS low.*/
+#define BCM2835_I2S_FORMAT_PHILIPS          0
+/** @brief Left justified, data on the FS edge, left on FS high.*/
+#define BCM2835_I2S_FORMAT_LEFT_JUSTIFIED   1
+/** @brief DSP/PCM, one clock FS pulse, channels back to back.*/
+#define BCM2835_I2S_FORMAT_DSP              2
+/** @} */
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   DMA channel draining the PCM RX FIFO.
+ */
+#if !defined(BCM2835_I2S_DMA_RX_CHANNEL) || defined(__DOXYGEN__)
+#define BCM2835_I2S_DMA_RX_CHANNEL          8
+#endif
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if BCM2835_I2S_DMA_RX_CHANNEL > 12
+#error "invalid BCM2835 I2S DMA channel"
+#endif
+
+#if HAL_USE_ADC && ((BCM2835_I2S_DMA_RX_CHANNEL == BCM2835_ADC_DMA_RX_CHANNEL) || \
+                    (BCM2835_I2S_DMA_RX_CHANNEL == BCM2835_ADC_DMA_TX_CHANNEL))
+#error "I2S and ADC drivers assigned to the same DMA channel"
+#endif
+
+#if BCM2835_I2C_USE_SLAVE
+#error "the PCM block and the BSC slave share GPIO18 and GPIO19"
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   I2S mode type.
+ */
+typedef uint32_t i2smode_t;
+
+/**
+ * @brief   I2S notification callback type.
+ * @details Invoked from the ISR each time a half of the buffer is filled.
+ *
+ * @param[in] i2sp      pointer to the @p I2SDriver object
+ * @param[in] offset    offset of the filled half, in buffer words
+ * @param[in] n         number of buffer words filled
+ */
+typedef void (*i2scallback_t)(I2SDriver *i2sp, size_t offset, size_t n);
+
+/**
+ * @brief   Driver configuration structure.
+ */
+typedef struct {
+  /**
+   * @brief   Transmission buffer pointer.
+   * @note    Transmission is not supported, must be @p NULL.
+   */
+  const void                *tx_buffer;
+  /**
+   * @brief   Receive buffer pointer.
+   * @details 32 byte aligned, see @p BCM2835_I2S_BUFFER_DECL().
+   */
+  void                      *rx_buffer;
+  /**
+   * @brief   Buffer size in 32 bit words, a multiple of 16 so that each
+   *          half starts on a cache line.
+   * @details Each channel sample takes one word, sign extended, or with
+   *          @p packed two 16 bit channels share a word.
+   */
+  size_t                    size;
+  /**
+   * @brief   Half buffer callback or @p NULL.
+   */
+  i2scallback_t             end_cb;
+  /* End of the mandatory fields.*/
+  /**
+   * @brief   @p I2S_MODE_MASTER, generating CLK and FS, or
+   *          @p I2S_MODE_SLAVE, plus @p I2S_MODE_RX.
+   */
+  i2smode_t                 mode;
+  /**
+   * @brief   Frame format, @p BCM2835_I2S_FORMAT_*.
+   */
+  uint8_t                   format;
+  /**
+   * @brief   Sample width in bits, 8..32.
+   */
+  uint8_t                   width;
+  /**
+   * @brief   Channels per frame, 1 or 2.
+   */
+  uint8_t                   channels;
+  /**
+   * @brief   Packs two channels of at most 16 bits into each word.
+   */
+  bool_t                    packed;
+  /**
+   * @brief   Bit clocks per frame, e.g. 64 for two 32 bit slots.
+   */
+  uint16_t                  frame_length;
+  /**
+   * @brief   Frames per second, master mode only.
+   */
+  uint32_t                  sample_rate;
+} I2SConfig;
+
+/**
+ * @brief   Structure representing an I2S driver.
+ */
+struct I2SDriver {
+  /**
+   * @brief   Driver state.
+   */
+  i2sstate_t                state;
+  /**
+   * @brief   Current configuration data.
+   */
+  const I2SConfig           *config;
+  /* End of the mandatory fields.*/
+  /**
+   * @brief   DMA control blocks, one per buffer half.
+   */
+  bcm2835_dma_cb_t          cb[2];
+  /**
+   * @brief   Buffer half the next interrupt completes.
+   */
+  unsigned                  cur;
+  /**
+   * @brief   The exchange restarts from the buffer top when full.
+   */
+  bool_t                    continuous;
+  /**
+   * @brief   Statistics: RX FIFO overflows and half buffers overwritten
+   *          before their callback ran.
+   */
+  uint32_t                  overruns;
+};
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Declares a receive buffer of @p n words.
+ * @details Cache line alignment keeps both halves independently
+ *          maintainable should the data cache be enabled.
+ */
+#define BCM2835_I2S_BUFFER_DECL(name, n)                                    \
+  uint32_t name[n] __attribute__((aligned(32)))
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+extern I2SDriver I2SD1;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void i2s_lld_init(void);
+  void i2s_lld_start(I2SDriver *i2sp);
+  void i2s_lld_stop(I2SDriver *i2sp);
+  void i2s_lld_start_exchange(I2SDriver *i2sp);
+  void i2s_lld_start_exchange_continuous(I2SDriver *i2sp);
+  void i2s_lld_stop_exchange(I2SDriver *i2sp);
+  void i2s_lld_serve_interrupt(I2SDriver *i2sp);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_USE_I2S */
+
+#endif /* _I2S_LLD_H_ */
+
+/** @} */
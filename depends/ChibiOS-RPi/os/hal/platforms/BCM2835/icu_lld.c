@@ -0,0 +1,350 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    BCM2835/icu_lld.c
+ * @brief   GPIO edge timestamping ICU low level driver code.
+ * @details Each driver watches one GPIO with both synchronous edge
+ *          detectors enabled. The shared GPIO interrupt reads the 1MHz
+ *          system timer on entry and hands the timestamp to every driver
+ *          whose event bit is set; the current pin level tells the start
+ *          edge from the stop edge. Resolution is one microsecond, the
+ *          accuracy is bounded by the IRQ latency jitter, i.e. the longest
+ *          kernel critical section.
+ *
+ * @addtogroup ICU
+ * @{
+ */
+
+#include "ch.h"
+#include "hal.h"
+
+#if HAL_USE_ICU || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+#define GPEDS(bank)     (*((bank) ? &GPEDS1 : &GPEDS0))
+#define GPREN(bank)     (*((bank) ? &GPREN1 : &GPREN0))
+#define GPFEN(bank)     (*((bank) ? &GPFEN1 : &GPFEN0))
+#define GPLEV(bank)     (*((bank) ? &GPLEV1 : &GPLEV0))
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   ICUD1 driver identifier.
+ */
+#if BCM2835_ICU_USE_ICU1 || defined(__DOXYGEN__)
+ICUDriver ICUD1;
+#endif
+
+/**
+ * @brief   ICUD2 driver identifier.
+ */
+#if BCM2835_ICU_USE_ICU2 || defined(__DOXYGEN__)
+ICUDriver ICUD2;
+#endif
+
+/**
+ * @brief   ICUD3 driver identifier.
+ */
+#if BCM2835_ICU_USE_ICU3 || defined(__DOXYGEN__)
+ICUDriver ICUD3;
+#endif
+
+/**
+ * @brief   ICUD4 driver identifier.
+ */
+#if BCM2835_ICU_USE_ICU4 || defined(__DOXYGEN__)
+ICUDriver ICUD4;
+#endif
+
+/*===========================================================================*/
+/* Driver local variables.                                                   */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Forgets the running and the latched frequency gates.
+ *
+ * @notapi
+ */
+static void reset_average(ICUDriver *icup) {
+
+  icup->avg_count = 0;
+  icup->avg_sum = 0;
+  icup->freq_count = 0;
+  icup->freq_sum = 0;
+}
+
+/**
+ * @brief   No start edge for the overflow interval.
+ *
+ * @notapi
+ */
+static void overflow_handler(void *p) {
+  ICUDriver *icup = (ICUDriver *)p;
+
+  chSysLockFromIsr();
+  icup->state = ICU_WAITING;
+  reset_average(icup);
+  if (icup->config->overflow_cb != NULL)
+    _icu_isr_invoke_overflow_cb(icup);
+  chSysUnlockFromIsr();
+}
+
+/**
+ * @brief   Start edge processing.
+ *
+ * @notapi
+ */
+static void start_edge(ICUDriver *icup, icucnt_t now) {
+
+  if (icup->state != ICU_WAITING) {
+    icup->period = now - icup->start;
+    if (icup->config->gate > 0) {
+      icup->avg_count++;
+      icup->avg_sum += icup->period;
+      if (icup->avg_sum >= icup->config->gate) {
+        icup->freq_count = icup->avg_count;
+        icup->freq_sum = icup->avg_sum;
+        icup->avg_count = 0;
+        icup->avg_sum = 0;
+      }
+    }
+  }
+  icup->start = now;
+
+  if (icup->ovticks > 0) {
+    if (chVTIsArmedI(&icup->vt))
+      chVTResetI(&icup->vt);
+    chVTSetI(&icup->vt, icup->ovticks, overflow_handler, icup);
+  }
+
+  if (icup->config->period_cb != NULL)
+    _icu_isr_invoke_period_cb(icup)
+  else
+    icup->state = ICU_ACTIVE;
+}
+
+/**
+ * @brief   Stop edge processing.
+ *
+ * @notapi
+ */
+static void stop_edge(ICUDriver *icup, icucnt_t now) {
+
+  icup->width = now - icup->start;
+  if (icup->config->width_cb != NULL)
+    _icu_isr_invoke_width_cb(icup)
+  else
+    icup->state = ICU_IDLE;
+}
+
+/**
+ * @brief   Edge processing for one driver.
+ *
+ * @notapi
+ */
+static void serve_edge(ICUDriver *icup, icucnt_t now) {
+  bool_t active;
+
+  if ((icup->state < ICU_WAITING) || !(GPEDS(icup->bank) & icup->mask))
+    return;
+  GPEDS(icup->bank) = icup->mask;
+
+  active = ((GPLEV(icup->bank) & icup->mask) != 0) ==
+           (icup->config->mode == ICU_INPUT_ACTIVE_HIGH);
+  if (active)
+    start_edge(icup, now);
+  else if (icup->state == ICU_ACTIVE)
+    stop_edge(icup, now);
+  else if (icup->state == ICU_IDLE) {
+    /* The start edge came and went within the IRQ latency, the pulse is
+       counted anyway.*/
+    icup->missed++;
+    start_edge(icup, now);
+    stop_edge(icup, now);
+  }
+  /* Else the tail of a pulse already running when enabled.*/
+}
+
+/*===========================================================================*/
+/* Driver interrupt handlers.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Shared GPIO IRQ handler.
+ *
+ * @notapi
+ */
+void icu_lld_serve_interrupt(void) {
+  icucnt_t now;
+
+  if (!(IRQ_PEND2 & GPIO_IRQ))
+    return;
+
+  /* Timestamp first, everything after it is latency.*/
+  now = SYSTIMER_CLO;
+
+  chSysLockFromIsr();
+#if BCM2835_ICU_USE_ICU1
+  serve_edge(&ICUD1, now);
+#endif
+#if BCM2835_ICU_USE_ICU2
+  serve_edge(&ICUD2, now);
+#endif
+#if BCM2835_ICU_USE_ICU3
+  serve_edge(&ICUD3, now);
+#endif
+#if BCM2835_ICU_USE_ICU4
+  serve_edge(&ICUD4, now);
+#endif
+  chSysUnlockFromIsr();
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Low level ICU driver initialization.
+ *
+ * @notapi
+ */
+void icu_lld_init(void) {
+
+#if BCM2835_ICU_USE_ICU1
+  icuObjectInit(&ICUD1);
+#endif
+#if BCM2835_ICU_USE_ICU2
+  icuObjectInit(&ICUD2);
+#endif
+#if BCM2835_ICU_USE_ICU3
+  icuObjectInit(&ICUD3);
+#endif
+#if BCM2835_ICU_USE_ICU4
+  icuObjectInit(&ICUD4);
+#endif
+
+  /* Only pins with an enabled detector can raise it.*/
+  IRQ_ENABLE2 = GPIO_IRQ;
+}
+
+/**
+ * @brief   Configures and activates the ICU peripheral.
+ *
+ * @param[in] icup      pointer to the @p ICUDriver object
+ *
+ * @notapi
+ */
+void icu_lld_start(ICUDriver *icup) {
+  const ICUConfig *config = icup->config;
+
+  chDbgAssert((config->frequency == SYSTIMER_CLOCK_FREQ) &&
+              (config->gpio <= 53),
+              "icu_lld_start(), #1", "invalid configuration");
+
+  icup->bank = config->gpio >> 5;
+  icup->mask = BIT(config->gpio & 31);
+  icup->ovticks = 0;
+  if (config->overflow > 0)
+    icup->ovticks = (systime_t)(((uint64_t)config->overflow * CH_FREQUENCY +
+                                 SYSTIMER_CLOCK_FREQ - 1) /
+                                SYSTIMER_CLOCK_FREQ);
+  bcm2835_gpio_fnsel(config->gpio, GPFN_IN);
+}
+
+/**
+ * @brief   Deactivates the ICU peripheral.
+ *
+ * @param[in] icup      pointer to the @p ICUDriver object
+ *
+ * @notapi
+ */
+void icu_lld_stop(ICUDriver *icup) {
+
+  (void)icup;
+}
+
+/**
+ * @brief   Enables the input capture.
+ *
+ * @param[in] icup      pointer to the @p ICUDriver object
+ *
+ * @notapi
+ */
+void icu_lld_enable(ICUDriver *icup) {
+
+  reset_average(icup);
+  icup->missed = 0;
+  GPEDS(icup->bank) = icup->mask;
+  GPREN(icup->bank) |= icup->mask;
+  GPFEN(icup->bank) |= icup->mask;
+}
+
+/**
+ * @brief   Disables the input capture.
+ *
+ * @param[in] icup      pointer to the @p ICUDriver object
+ *
+ * @notapi
+ */
+void icu_lld_disable(ICUDriver *icup) {
+
+  GPREN(icup->bank) &= ~icup->mask;
+  GPFEN(icup->bank) &= ~icup->mask;
+  GPEDS(icup->bank) = icup->mask;
+  if (chVTIsArmedI(&icup->vt))
+    chVTResetI(&icup->vt);
+}
+
+/**
+ * @brief   Returns the averaged input frequency.
+ * @details The frequency of the latest completed averaging gate, zero
+ *          before the first gate completes or after an overflow.
+ *
+ * @param[in] icup      pointer to the @p ICUDriver object
+ * @return              The frequency in millihertz.
+ *
+ * @api
+ */
+uint32_t icuBCM2835GetFrequency(ICUDriver *icup) {
+  uint32_t n, sum;
+
+  chSysLock();
+  n = icup->freq_count;
+  sum = icup->freq_sum;
+  chSysUnlock();
+
+  if (sum == 0)
+    return 0;
+  return (uint32_t)(((uint64_t)n * SYSTIMER_CLOCK_FREQ * 1000 + sum / 2) / sum);
+}
+
+#endif /* HAL_USE_ICU */
+
+/** @} */
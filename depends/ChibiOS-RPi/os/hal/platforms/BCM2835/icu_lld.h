@@ -0,0 +1,282 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    BCM2835/icu_lld.h
+ * @brief   GPIO edge timestamping ICU low level driver header.
+ *
+ * @addtogroup ICU
+ * @{
+ */
+
+#ifndef _ICU_LLD_H_
+#define _ICU_LLD_H_
+
+#include "bcm2835.h"
+
+#if HAL_USE_ICU || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   ICUD1 driver enable switch.
+ */
+#if !defined(BCM2835_ICU_USE_ICU1) || defined(__DOXYGEN__)
+#define BCM2835_ICU_USE_ICU1                TRUE
+#endif
+
+/**
+ * @brief   ICUD2 driver enable switch.
+ */
+#if !defined(BCM2835_ICU_USE_ICU2) || defined(__DOXYGEN__)
+#define BCM2835_ICU_USE_ICU2                FALSE
+#endif
+
+/**
+ * @brief   ICUD3 driver enable switch.
+ */
+#if !defined(BCM2835_ICU_USE_ICU3) || defined(__DOXYGEN__)
+#define BCM2835_ICU_USE_ICU3                FALSE
+#endif
+
+/**
+ * @brief   ICUD4 driver enable switch.
+ */
+#if !defined(BCM2835_ICU_USE_ICU4) || defined(__DOXYGEN__)
+#define BCM2835_ICU_USE_ICU4                FALSE
+#endif
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if !BCM2835_ICU_USE_ICU1 && !BCM2835_ICU_USE_ICU2 &&                       \
+    !BCM2835_ICU_USE_ICU3 && !BCM2835_ICU_USE_ICU4
+#error "ICU driver activated but no ICU peripheral assigned"
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief ICU driver mode.
+ */
+typedef enum {
+  ICU_INPUT_ACTIVE_HIGH = 0,        /**< Trigger on rising edge.            */
+  ICU_INPUT_ACTIVE_LOW = 1,         /**< Trigger on falling edge.           */
+} icumode_t;
+
+/**
+ * @brief   ICU frequency type.
+ */
+typedef uint32_t icufreq_t;
+
+/**
+ * @brief   ICU counter type.
+ * @details Edges are timestamped against the free running 1MHz system
+ *          timer, widths and periods up to about 71 minutes are exact.
+ */
+typedef uint32_t icucnt_t;
+
+/**
+ * @brief   Driver configuration structure.
+ */
+typedef struct {
+  /**
+   * @brief   Driver mode.
+   */
+  icumode_t                 mode;
+  /**
+   * @brief   Timer clock in Hz.
+   * @note    Must be @p SYSTIMER_CLOCK_FREQ, the system timer is not
+   *          prescalable.
+   */
+  icufreq_t                 frequency;
+  /**
+   * @brief   Callback for pulse width measurement.
+   */
+  icucallback_t             width_cb;
+  /**
+   * @brief   Callback for cycle period measurement.
+   */
+  icucallback_t             period_cb;
+  /**
+   * @brief   Callback for timer overflow.
+   * @details Invoked when no start edge arrived for @p overflow ticks. The
+   *          driver then waits for a fresh first edge, so a stopped sensor
+   *          never yields a bogus long period.
+   */
+  icucallback_t             overflow_cb;
+  /* End of the mandatory fields.*/
+  /**
+   * @brief   GPIO number of the input, 0..53.
+   */
+  uint8_t                   gpio;
+  /**
+   * @brief   Overflow interval in ticks, zero disables it.
+   */
+  icucnt_t                  overflow;
+  /**
+   * @brief   Frequency averaging gate in ticks, zero disables it.
+   * @details Whole periods are accumulated in the ISR until they span at
+   *          least this long, then the count and span are latched for
+   *          @p icuBCM2835GetFrequency().
+   */
+  icucnt_t                  gate;
+} ICUConfig;
+
+/**
+ * @brief   Structure representing an ICU driver.
+ */
+struct ICUDriver {
+  /**
+   * @brief Driver state.
+   */
+  icustate_t                state;
+  /**
+   * @brief Current configuration data.
+   */
+  const ICUConfig           *config;
+#if defined(ICU_DRIVER_EXT_FIELDS)
+  ICU_DRIVER_EXT_FIELDS
+#endif
+  /* End of the mandatory fields.*/
+  /**
+   * @brief Edge detect bit of the input in its bank.
+   */
+  uint32_t                  mask;
+  /**
+   * @brief Bank of the input, 0 or 1.
+   */
+  uint8_t                   bank;
+  /**
+   * @brief Timestamp of the latest start edge.
+   */
+  icucnt_t                  start;
+  /**
+   * @brief Latest pulse width.
+   */
+  icucnt_t                  width;
+  /**
+   * @brief Latest cycle period.
+   */
+  icucnt_t                  period;
+  /**
+   * @brief Periods accumulated in the running gate.
+   */
+  uint32_t                  avg_count;
+  /**
+   * @brief Ticks accumulated in the running gate.
+   */
+  uint32_t                  avg_sum;
+  /**
+   * @brief Periods of the latest completed gate.
+   */
+  uint32_t                  freq_count;
+  /**
+   * @brief Ticks of the latest completed gate.
+   */
+  uint32_t                  freq_sum;
+  /**
+   * @brief Stop edges seen without their start edge.
+   * @details Pulses shorter than the IRQ latency are still counted, with
+   *          a zero width.
+   */
+  uint32_t                  missed;
+  /**
+   * @brief Overflow interval in system ticks.
+   */
+  systime_t                 ovticks;
+  /**
+   * @brief Overflow timer.
+   */
+  VirtualTimer              vt;
+};
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Returns the width of the latest pulse.
+ *
+ * @param[in] icup      pointer to the @p ICUDriver object
+ * @return              The number of ticks.
+ *
+ * @notapi
+ */
+#define icu_lld_get_width(icup) ((icup)->width)
+
+/**
+ * @brief   Returns the width of the latest cycle.
+ *
+ * @param[in] icup      pointer to the @p ICUDriver object
+ * @return              The number of ticks.
+ *
+ * @notapi
+ */
+#define icu_lld_get_period(icup) ((icup)->period)
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#if BCM2835_ICU_USE_ICU1 && !defined(__DOXYGEN__)
+extern ICUDriver ICUD1;
+#endif
+
+#if BCM2835_ICU_USE_ICU2 && !defined(__DOXYGEN__)
+extern ICUDriver ICUD2;
+#endif
+
+#if BCM2835_ICU_USE_ICU3 && !defined(__DOXYGEN__)
+extern ICUDriver ICUD3;
+#endif
+
+#if BCM2835_ICU_USE_ICU4 && !defined(__DOXYGEN__)
+extern ICUDriver ICUD4;
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void icu_lld_init(void);
+  void icu_lld_start(ICUDriver *icup);
+  void icu_lld_stop(ICUDriver *icup);
+  void icu_lld_enable(ICUDriver *icup);
+  void icu_lld_disable(ICUDriver *icup);
+  uint32_t icuBCM2835GetFrequency(ICUDriver *icup);
+  void icu_lld_serve_interrupt(void);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_USE_ICU */
+
+#endif /* _ICU_LLD_H_ */
+
+/** @} */
@@ -3,9 +3,14 @@ PLATFORMSRC = ${CHIBIOS}/os/hal/platforms/BCM2835/hal_lld.c \
               ${CHIBIOS}/os/hal/platforms/BCM2835/pal_lld.c \
               ${CHIBIOS}/os/hal/platforms/BCM2835/serial_lld.c \
               ${CHIBIOS}/os/hal/platforms/BCM2835/i2c_lld.c \
+              ${CHIBIOS}/os/hal/platforms/BCM2835/i2cs_lld.c \
+              ${CHIBIOS}/os/hal/platforms/BCM2835/i2s_lld.c \
               ${CHIBIOS}/os/hal/platforms/BCM2835/spi_lld.c \
+              ${CHIBIOS}/os/hal/platforms/BCM2835/adc_lld.c \
               ${CHIBIOS}/os/hal/platforms/BCM2835/gpt_lld.c \
+              ${CHIBIOS}/os/hal/platforms/BCM2835/icu_lld.c \
               ${CHIBIOS}/os/hal/platforms/BCM2835/pwm_lld.c \
+              ${CHIBIOS}/os/hal/platforms/BCM2835/rtc_lld.c \
               ${CHIBIOS}/os/hal/platforms/BCM2835/bcm2835.c
 
 # Required include directories
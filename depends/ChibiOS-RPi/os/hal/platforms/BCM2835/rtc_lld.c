@@ -17,14 +17,13 @@
     You should have received a copy of the GNU General Public License
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
-/*
-   Concepts and parts of this file have been contributed by Uladzimir Pylinsky
-   aka barthess.
- */
 
 /**
- * @file    rtc_lld.c
- * @brief   RTC low level driver for DS1307
+ * @file    BCM2835/rtc_lld.c
+ * @brief   System timer backed RTC low level driver.
+ * @details The BCM2835 has no battery backed clock. The wall clock time
+ *          is derived from the free running 64 bit, 1MHz system timer and
+ *          starts at the UNIX epoch on reset, until set from the host.
  *
  * @addtogroup RTC
  * @{
@@ -35,6 +34,8 @@
 
 #if HAL_USE_RTC || defined(__DOXYGEN__)
 
+#include "calendar.h"
+
 /*===========================================================================*/
 /* Driver exported variables.                                                */
 /*===========================================================================*/
@@ -52,6 +53,22 @@ RTCDriver RTCD1;
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
+/**
+ * @brief   Reads the 64 bit system timer.
+ * @details The high word is read again to catch a carry between the reads.
+ *
+ * @notapi
+ */
+static uint64_t systimer_read(void) {
+  uint32_t hi, lo;
+
+  do {
+    hi = SYSTIMER_CHI;
+    lo = SYSTIMER_CLO;
+  } while (hi != SYSTIMER_CHI);
+  return ((uint64_t)hi << 32) | lo;
+}
+
 /*===========================================================================*/
 /* Driver interrupt handlers.                                                */
 /*===========================================================================*/
@@ -61,86 +78,58 @@ RTCDriver RTCD1;
 /*===========================================================================*/
 
 /**
- * @brief   Initialize DS1307.
+ * @brief   Low level RTC driver initialization.
+ * @details The clock starts at the UNIX epoch.
  *
- * @api
+ * @notapi
  */
 void rtc_lld_init(void) {
-  I2CConfig i2cConfig;
-  i2cStart(&I2C0, &i2cConfig);
-  RTCD1.i2c_bus = &I2C0;
+
+  RTCD1.anchor = systimer_read();
+  RTCD1.sec = 0;
 }
 
 /**
  * @brief   Set current time.
- * @note    Fractional part will be silently ignored. There is no possibility
- *          to set it on STM32 platform.
  *
  * @param[in] rtcp      pointer to RTC driver structure
  * @param[in] timespec  pointer to a @p RTCTime structure
  *
- * @api
+ * @notapi
  */
 void rtc_lld_set_time(RTCDriver *rtcp, const RTCTime *timespec) {
-  I2CDriver *i2cp = rtcp->i2c_bus;
-  i2cAcquireBus(i2cp);
-  i2cMasterTransmitTimeout(&I2C0, 0x68, timespec->registers, 7, NULL, 0, MS2ST(1000));
-  i2cReleaseBus(i2cp);
+
+  rtcp->anchor = systimer_read() -
+                 (uint64_t)timespec->tv_msec * (SYSTIMER_CLOCK_FREQ / 1000);
+  rtcp->sec = timespec->tv_sec;
 }
 
 /**
  * @brief   Get current time.
+ * @details Divides only when the last read was in an earlier second, with
+ *          32 bit arithmetic unless that read is more than an hour old.
  *
  * @param[in] rtcp      pointer to RTC driver structure
  * @param[out] timespec pointer to a @p RTCTime structure
  *
- * @api
+ * @notapi
  */
 void rtc_lld_get_time(RTCDriver *rtcp, RTCTime *timespec) {
-  I2CDriver *i2cp = rtcp->i2c_bus;
-  i2cAcquireBus(i2cp);
-  uint8_t command = 0;
-  i2cMasterTransmitTimeout(i2cp, 0x68, &command, 1, timespec->registers, 7, MS2ST(1000));
-  i2cReleaseBus(i2cp);
-}
-
-/**
- * @brief     Set alarm time.
- *
- * @note      Default value after BKP domain reset for both comparators is 0.
- * @note      Function does not performs any checks of alarm time validity.
- *
- * @param[in] rtcp      Pointer to RTC driver structure.
- * @param[in] alarm     Alarm identifier. Can be 1 or 2.
- * @param[in] alarmspec Pointer to a @p RTCAlarm structure.
- *
- * @api
- */
-void rtc_lld_set_alarm(RTCDriver *rtcp,
-                       rtcalarm_t alarm,
-                       const RTCAlarm *alarmspec) {
-  UNUSED(rtcp);
-  UNUSED(alarm);
-  UNUSED(alarmspec);
-  /* Not supported. No return status.*/
-}
-
-/**
- * @brief   Get alarm time.
- *
- * @param[in] rtcp       pointer to RTC driver structure
- * @param[in] alarm      alarm identifier
- * @param[out] alarmspec pointer to a @p RTCAlarm structure
- *
- * @api
- */
-void rtc_lld_get_alarm(RTCDriver *rtcp,
-                       rtcalarm_t alarm,
-                       RTCAlarm *alarmspec) {
-  UNUSED(rtcp);
-  UNUSED(alarm);
-  UNUSED(alarmspec);
-  /* Not supported. */
+  uint64_t elapsed = systimer_read() - rtcp->anchor;
+
+  if (elapsed >= SYSTIMER_CLOCK_FREQ) {
+    uint32_t secs;
+
+    if (elapsed <= 0xFFFFFFFFU)
+      secs = (uint32_t)elapsed / SYSTIMER_CLOCK_FREQ;
+    else
+      secs = (uint32_t)(elapsed / SYSTIMER_CLOCK_FREQ);
+    rtcp->anchor += (uint64_t)secs * SYSTIMER_CLOCK_FREQ;
+    rtcp->sec += secs;
+    elapsed -= (uint64_t)secs * SYSTIMER_CLOCK_FREQ;
+  }
+  timespec->tv_sec = rtcp->sec;
+  timespec->tv_msec = (uint32_t)elapsed / (SYSTIMER_CLOCK_FREQ / 1000);
 }
 
 /**
@@ -152,21 +141,13 @@ void rtc_lld_get_alarm(RTCDriver *rtcp,
  * @api
  */
 uint32_t rtc_lld_get_time_fat(RTCDriver *rtcp) {
-  uint32_t fattime;
   RTCTime timespec;
 
   chSysLock();
   rtcGetTimeI(rtcp, &timespec);
   chSysUnlock();
 
-  fattime  = bcd2int(timespec.registers[0] & 0x7F);
-  fattime |= bcd2int(timespec.registers[1]) << 5;
-  fattime |= bcd2int(timespec.registers[2]) << 11;
-  fattime |= bcd2int(timespec.registers[4]) << 16;
-  fattime |= bcd2int(timespec.registers[5]) << 21;
-  fattime |= (2000 + bcd2int(timespec.registers[6])) << 25;
-
-  return fattime;
+  return calEpochToFat(timespec.tv_sec);
 }
 
 #endif /* HAL_USE_RTC */
@@ -17,14 +17,10 @@
     You should have received a copy of the GNU General Public License
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
-/*
-   Concepts and parts of this file have been contributed by Uladzimir Pylinsky
-   aka barthess.
- */
 
 /**
- * @file    rtc_lld.h
- * @brief   DS1307 RTC low level driver header.
+ * @file    BCM2835/rtc_lld.h
+ * @brief   System timer backed RTC low level driver header.
  *
  * @addtogroup RTC
  * @{
@@ -40,28 +36,19 @@
 /*===========================================================================*/
 
 /**
- * @brief   Two alarm comparators available on STM32F4x.
+ * @brief   This RTC implementation does not support callbacks.
+ */
+#define RTC_SUPPORTS_CALLBACKS      FALSE
+
+/**
+ * @brief   No alarm comparators.
  */
-#define RTC_ALARMS                  2
+#define RTC_ALARMS                  0
 
 /**
- * @brief   Data offsets in RTC date and time registers.
+ * @brief   The RTC counts seconds since the UNIX epoch on the system timer.
  */
-#define RTC_TR_PM_OFFSET    22
-#define RTC_TR_HT_OFFSET    20
-#define RTC_TR_HU_OFFSET    16
-#define RTC_TR_MNT_OFFSET   12
-#define RTC_TR_MNU_OFFSET   8
-#define RTC_TR_ST_OFFSET    4
-#define RTC_TR_SU_OFFSET    0
-
-#define RTC_DR_YT_OFFSET    20
-#define RTC_DR_YU_OFFSET    16
-#define RTC_DR_WDU_OFFSET   13
-#define RTC_DR_MT_OFFSET    12
-#define RTC_DR_MU_OFFSET    8
-#define RTC_DR_DT_OFFSET    4
-#define RTC_DR_DU_OFFSET    0
+#define BCM2835_RTC_IS_SYSTIMER     TRUE
 
 /*===========================================================================*/
 /* Driver pre-compile time settings.                                         */
@@ -75,78 +62,41 @@
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
 
-/**
- * @brief   Type of a structure representing an RTC alarm time stamp.
- */
-typedef struct RTCAlarm RTCAlarm;
-
-/**
- * @brief   Type of a structure representing an RTC wakeup period.
- */
-typedef struct RTCWakeup RTCWakeup;
-
-/**
- * @brief   Type of a structure representing an RTC callbacks config.
- */
-typedef struct RTCCallbackConfig RTCCallbackConfig;
-
-/**
- * @brief   Type of an RTC alarm.
- * @details Meaningful on platforms with more than 1 alarm comparator.
- */
-typedef uint32_t rtcalarm_t;
-
 /**
  * @brief   Structure representing an RTC time stamp.
  */
 struct RTCTime {
-  /* @brief DS1307 registers */
-  uint8_t registers[7];
-};
-
-/**
- * @brief   Structure representing an RTC alarm time stamp.
- */
-struct RTCAlarm {
-};
-
-/**
- * @brief   Structure representing an RTC periodic wakeup period.
- */
-struct RTCWakeup {
-#if 0
   /**
-   * @brief   RTC WUTR register.
-   * @details Bits [15:0] contain value of WUTR register
-   *          Bits [18:16] contain value of WUCKSEL bits in CR register
-   *
-   * @notes   ((WUTR == 0) || (WUCKSEL == 3)) is forbidden combination.
+   * @brief Seconds since UNIX epoch.
    */
-  uint32_t wakeup;
-#endif
+  uint32_t tv_sec;
+  /**
+   * @brief Fractional part.
+   */
+  uint32_t tv_msec;
 };
 
 /**
  * @brief   Structure representing an RTC driver.
+ * @details The time is kept as the system timer value at which the current
+ *          second started, moved forward when a read finds it more than a
+ *          second old. Reads within the same second need no division.
  */
-struct RTCDriver{
-  I2CDriver                   *i2c_bus;
+struct RTCDriver {
+  /**
+   * @brief System timer value at the start of second @p sec.
+   */
+  uint64_t          anchor;
+  /**
+   * @brief Seconds since UNIX epoch at @p anchor.
+   */
+  uint32_t          sec;
 };
 
 /*===========================================================================*/
 /* Driver macros.                                                            */
 /*===========================================================================*/
 
-#define bcd2int(x) ((((x) >> 4) * 10) + ((x) & 0x0F))
-
-#define rtc_second(t)   bcd2int((t).registers[0])
-#define rtc_minute(t)   bcd2int((t).registers[1])
-#define rtc_hour(t)     bcd2int((t).registers[2])
-#define rtc_dayofweek(t) ((t).registers[3])
-#define rtc_day(t)       bcd2int((t).registers[4])
-#define rtc_month(t)     bcd2int((t).registers[5])
-#define rtc_year(t)      (2000 + bcd2int((t).registers[6]))
-
 /*===========================================================================*/
 /* External declarations.                                                    */
 /*===========================================================================*/
@@ -161,14 +111,6 @@ extern "C" {
   void rtc_lld_init(void);
   void rtc_lld_set_time(RTCDriver *rtcp, const RTCTime *timespec);
   void rtc_lld_get_time(RTCDriver *rtcp, RTCTime *timespec);
-  void rtc_lld_set_alarm(RTCDriver *rtcp,
-                         rtcalarm_t alarm,
-                         const RTCAlarm *alarmspec);
-  void rtc_lld_get_alarm(RTCDriver *rtcp,
-                         rtcalarm_t alarm,
-                         RTCAlarm *alarmspec);
-  void rtcSetPeriodicWakeup_v2(RTCDriver *rtcp, RTCWakeup *wakeupspec);
-  void rtcGetPeriodicWakeup_v2(RTCDriver *rtcp, RTCWakeup *wakeupspec);
   uint32_t rtc_lld_get_time_fat(RTCDriver *rtcp);
 #ifdef __cplusplus
 }
@@ -35,6 +35,16 @@
 /* Driver local definitions.                                                 */
 /*===========================================================================*/
 
+#if BCM2835_SERIAL_DE_TIMER == 1
+#define DE_TIMER_CMP        SYSTIMER_CMP1
+#define DE_TIMER_MATCH      SYSTIMER_CS_MATCH1
+#define DE_TIMER_IRQ        SYSTIMER_IRQEN1
+#else
+#define DE_TIMER_CMP        SYSTIMER_CMP3
+#define DE_TIMER_MATCH      SYSTIMER_CS_MATCH3
+#define DE_TIMER_IRQ        SYSTIMER_IRQEN3
+#endif
+
 /*===========================================================================*/
 /* Driver exported variables.                                                */
 /*===========================================================================*/
@@ -49,15 +59,61 @@ SerialDriver SD1;
  * @brief   Driver default configuration.
  */
 static const SerialConfig default_config = {
-  115200 /* default baud rate */
+  115200, /* default baud rate */
+  FALSE,
+  0
 };
 
+/**
+ * @brief   RS-485 driver enable pin mask, zero if unused.
+ */
+static uint32_t de_mask;
+
+/**
+ * @brief   One character time in microseconds, start and stop bit included.
+ */
+static uint32_t de_char_us;
+
+/**
+ * @brief   The DE release timer is armed.
+ */
+static bool_t de_timing;
+
 /*===========================================================================*/
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
+/**
+ * @brief   Drops DE now or once the transmitter should have drained.
+ * @details The compare is sized to the characters still in the TX FIFO,
+ *          STAT bits 27:24, plus the one in the shift register, and is
+ *          re-armed if the transmitter is still not idle when it fires.
+ */
+static void de_release(void) {
+  if (AUX_MU_LSR_TX_IDLE) {
+    de_timing = FALSE;
+    IRQ_DISABLE1 = DE_TIMER_IRQ;
+    GPCLR0 = de_mask;
+    return;
+  }
+  de_timing = TRUE;
+  SYSTIMER_CS = DE_TIMER_MATCH;
+  DE_TIMER_CMP = SYSTIMER_CLO +
+                 (((AUX_MU_STAT_REG >> 24) & 0x0F) + 1) * de_char_us;
+  IRQ_ENABLE1 = DE_TIMER_IRQ;
+}
+
 static void output_notify(GenericQueue *qp) {
   UNUSED(qp);  
+  /* Take the bus before the first start bit, a pending release from the
+     previous frame no longer applies.*/
+  if (de_mask) {
+    if (de_timing) {
+      de_timing = FALSE;
+      IRQ_DISABLE1 = DE_TIMER_IRQ;
+    }
+    GPSET0 = de_mask;
+  }
   /* Enable tx interrupts.*/
   AUX_MU_IER_REG |= AUX_MU_IER_TX_IRQEN; 
 }
@@ -67,25 +123,33 @@ static void output_notify(GenericQueue *qp) {
 /*===========================================================================*/
 
 void sd_lld_serve_interrupt( SerialDriver *sdp ) {
+  /* The IIR says data is there, drain the RX FIFO without spinning.*/
   if (AUX_MU_IIR_RX_IRQ) {
     chSysLockFromIsr();
-    while(!AUX_MU_LSR_RX_RDY);
-    do {	
+    while (AUX_MU_LSR_RX_RDY)
       sdIncomingDataI(sdp, AUX_MU_IO_REG & 0xFF);
-    } while (AUX_MU_LSR_RX_RDY);
     chSysUnlockFromIsr();
   }
 
+  /* RS-485 release timer, the line is shared so check the match bit.*/
+  if (de_timing && (SYSTIMER_CS & DE_TIMER_MATCH))
+    de_release();
+
+  /* Fill the TX FIFO as far as it goes, one interrupt per burst rather than
+     per character.*/
   if (AUX_MU_IIR_TX_IRQ) {
     chSysLockFromIsr();
-    while(!AUX_MU_LSR_TX_RDY);
-    msg_t data = sdRequestDataI(sdp);
-    if (data < Q_OK) {
-      /* Disable tx interrupts.*/
-      AUX_MU_IER_REG &= ~AUX_MU_IER_TX_IRQEN; 
-    }
-    else {
-      mini_uart_send((uint32_t)data);
+    while (AUX_MU_LSR_TX_RDY) {
+      msg_t data = sdRequestDataI(sdp);
+      if (data < Q_OK) {
+        /* Disable tx interrupts, in RS-485 mode the bus is held until the
+           last stop bit is out.*/
+        AUX_MU_IER_REG &= ~AUX_MU_IER_TX_IRQEN; 
+        if (de_mask)
+          de_release();
+        break;
+      }
+      AUX_MU_IO_REG = (uint32_t)data;
     }
     chSysUnlockFromIsr();
   }
@@ -122,7 +186,8 @@ void sd_lld_start(SerialDriver *sdp, const SerialConfig *config) {
 
   IRQ_DISABLE1 = BIT(29);
 	
-  AUX_ENABLES = 1;
+  /* The SPI1/SPI2 masters share the AUX block, leave their enables alone.*/
+  AUX_ENABLES |= AUX_MU;
   
   AUX_MU_IER_REG  = 0x00;
   AUX_MU_CNTL_REG = 0x00;
@@ -140,6 +205,18 @@ void sd_lld_start(SerialDriver *sdp, const SerialConfig *config) {
   GPPUDCLK0 = (1<<14)|(1<<15);
   bcm2835_delay(150);
   GPPUDCLK0 = 0;
+
+  /* RS-485 transceiver starts out listening.*/
+  de_mask = 0;
+  de_timing = FALSE;
+  IRQ_DISABLE1 = DE_TIMER_IRQ;
+  if (config->rs485) {
+    GPCLR0 = BIT(config->de_pad);
+    bcm2835_gpio_fnsel(config->de_pad, GPFN_OUT);
+    de_mask = BIT(config->de_pad);
+    de_char_us = (10 * SYSTIMER_CLOCK_FREQ + config->baud_rate - 1) /
+                 config->baud_rate;
+  }
   
   AUX_MU_CNTL_REG = 0x03;
 
@@ -158,9 +235,17 @@ void sd_lld_start(SerialDriver *sdp, const SerialConfig *config) {
 void sd_lld_stop(SerialDriver *sdp) {
   UNUSED(sdp);
 
-  IRQ_DISABLE1 |= BIT(29);
+  AUX_MU_IER_REG = 0x00;
+  if ((AUX_ENABLES & (AUX_SPI1 | AUX_SPI2)) == 0)
+    IRQ_DISABLE1 = AUX_IRQ_LINE;
   bcm2835_gpio_fnsel(14, GPFN_IN);
   bcm2835_gpio_fnsel(15, GPFN_IN);
+  if (de_mask) {
+    de_timing = FALSE;
+    IRQ_DISABLE1 = DE_TIMER_IRQ;
+    GPCLR0 = de_mask;
+    de_mask = 0;
+  }
 }
 
 uint32_t mini_uart_recv ( void )
@@ -48,10 +48,30 @@
 /* Driver pre-compile time settings.                                         */
 /*===========================================================================*/
 
+/**
+ * @brief   System timer compare channel releasing the RS-485 driver enable.
+ * @details The mini UART has no transmitter idle interrupt, the channel
+ *          drops DE once the characters left in the FIFO are out. Channels
+ *          0 and 2 belong to the GPU, 1 and 3 are shared with GPTD1/GPTD2.
+ */
+#if !defined(BCM2835_SERIAL_DE_TIMER) || defined(__DOXYGEN__)
+#define BCM2835_SERIAL_DE_TIMER     3
+#endif
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
 
+#if (BCM2835_SERIAL_DE_TIMER != 1) && (BCM2835_SERIAL_DE_TIMER != 3)
+#error "BCM2835_SERIAL_DE_TIMER must be system timer channel 1 or 3"
+#endif
+
+#if HAL_USE_GPT &&                                                          \
+    (((BCM2835_SERIAL_DE_TIMER == 1) && BCM2835_GPT_USE_TIMER1) ||          \
+     ((BCM2835_SERIAL_DE_TIMER == 3) && BCM2835_GPT_USE_TIMER2))
+#error "BCM2835_SERIAL_DE_TIMER is already allocated to the GPT driver"
+#endif
+
 /*===========================================================================*/
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
@@ -66,6 +86,16 @@
 typedef struct {
   /** @brief Baud rate for the Mini UART */
   uint32_t                 baud_rate;
+  /**
+   * @brief RS-485 half duplex operation.
+   * @details The transceiver driver enable is raised when output is queued
+   *          and dropped by @p BCM2835_SERIAL_DE_TIMER once the last stop
+   *          bit is out, so several nodes can share one pair. DE and /RE are expected to be tied, the
+   *          node does not hear its own transmissions.
+   */
+  bool_t                   rs485;
+  /** @brief GPIO0..31 driving DE, active high, when @p rs485 is set.*/
+  uint8_t                  de_pad;
 } SerialConfig;
 
 /**
@@ -37,31 +37,248 @@
 /* Driver local definitions.                                                 */
 /*===========================================================================*/
 
+/**
+ * @brief   Bytes carried by one variable width FIFO entry.
+ */
+#define AUX_ENTRY_BYTES         3
+
+/**
+ * @brief   Bytes that fit in the universal SPI master FIFOs.
+ */
+#define AUX_FIFO_BYTES          (AUX_SPI_FIFO_DEPTH * AUX_ENTRY_BYTES)
+
 /*===========================================================================*/
 /* Driver exported variables.                                                */
 /*===========================================================================*/
 
 SPIDriver SPI0;
 
+#if BCM2835_SPI_USE_SPI1 || defined(__DOXYGEN__)
+/** @brief SPI1 (universal SPI master) driver identifier.*/
+SPIDriver SPID1;
+#endif
+
+#if BCM2835_SPI_USE_SPI2 || defined(__DOXYGEN__)
+/** @brief SPI2 (universal SPI master) driver identifier.*/
+SPIDriver SPID2;
+#endif
+
 /*===========================================================================*/
 /* Driver local variables.                                                   */
 /*===========================================================================*/
 
+#if BCM2835_SPI_USE_AUX_ || defined(__DOXYGEN__)
+/**
+ * @brief   Universal SPI master pins, all ALT4.
+ */
+typedef struct {
+  uint8_t               miso;
+  uint8_t               mosi;
+  uint8_t               sclk;
+  uint8_t               ce[3];
+} aux_pins_t;
+
+static const aux_pins_t spi1_pins = {19, 20, 21, {18, 17, 16}};
+static const aux_pins_t spi2_pins = {40, 41, 42, {43, 44, 45}};
+#endif
+
 /*===========================================================================*/
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
+#if BCM2835_SPI_USE_AUX_ || defined(__DOXYGEN__)
+static const aux_pins_t *aux_pins(SPIDriver *spip) {
+  return spip->aux == AUX_SPI1_ADDR ? &spi1_pins : &spi2_pins;
+}
+
+static uint32_t aux_bit(SPIDriver *spip) {
+  return spip->aux == AUX_SPI1_ADDR ? AUX_SPI1 : AUX_SPI2;
+}
+
+/**
+ * @brief   Queues up to three bytes as one variable width FIFO entry.
+ * @details All entries but the last go through TXHOLD so that the chip
+ *          select stays asserted across the whole transfer.
+ */
+static void aux_write_fifo(SPIDriver *spip) {
+  const uint8_t *txbuf = (const uint8_t *)spip->txbuf;
+  size_t count = spip->txcnt < AUX_ENTRY_BYTES ? spip->txcnt : AUX_ENTRY_BYTES;
+  uint32_t data = (uint32_t)(count * 8) << AUX_SPI_WIDTH_SHIFT;
+  size_t i;
+
+  if (txbuf != NULL) {
+    for (i = 0; i < count; i++)
+      data |= (uint32_t)*txbuf++ << (16 - 8 * i);
+    spip->txbuf = txbuf;
+  }
+  spip->txcnt -= count;
+  if (spip->txcnt > 0)
+    spip->aux->txhold[0] = data;
+  else
+    spip->aux->io[0] = data;
+}
+
+/**
+ * @brief   Unpacks one received FIFO entry.
+ * @details Entries come back right aligned and in the order they were
+ *          queued, so each holds the smaller of three and the bytes left.
+ */
+static void aux_read_fifo(SPIDriver *spip) {
+  uint8_t *rxbuf = (uint8_t *)spip->rxbuf;
+  size_t count = spip->rxcnt < AUX_ENTRY_BYTES ? spip->rxcnt : AUX_ENTRY_BYTES;
+  uint32_t data = spip->aux->io[0];
+  size_t i;
+
+  if (rxbuf != NULL) {
+    for (i = count; i > 0; i--)
+      *rxbuf++ = (uint8_t)(data >> (8 * (i - 1)));
+    spip->rxbuf = rxbuf;
+  }
+  spip->rxcnt -= count;
+}
+
+/**
+ * @brief   Moves data between the buffers and the FIFOs.
+ * @details Never queues more than both FIFOs can hold, so the RX FIFO
+ *          cannot overflow however late the interrupt is served. The work
+ *          per call is bounded by the FIFO depth.
+ *
+ * @return              TRUE when the whole transfer has been received.
+ */
+static bool_t aux_pump(SPIDriver *spip) {
+  auxspi_t *aux = spip->aux;
+  uint32_t stat = aux->stat;
+
+  while ((spip->rxcnt > spip->txcnt) && !(stat & AUX_SPI_STAT_RX_EMPTY)) {
+    aux_read_fifo(spip);
+    stat = aux->stat;
+  }
+  while ((spip->txcnt > 0) &&
+         (spip->rxcnt - spip->txcnt < AUX_FIFO_BYTES) &&
+         !(stat & AUX_SPI_STAT_TX_FULL)) {
+    aux_write_fifo(spip);
+    stat = aux->stat;
+  }
+  return spip->rxcnt == 0;
+}
+
+/**
+ * @brief   Universal SPI master IRQ handler.
+ * @details TXEMPTY keeps the FIFO topped up while there is data to queue,
+ *          IDLE then collects the tail of the transfer.
+ */
+static void aux_serve_interrupt(SPIDriver *spip) {
+  if (aux_pump(spip)) {
+    spip->aux->cntl1 = AUX_SPI_CNTL1_MSBF_IN;
+    _spi_isr_code(spip);
+  }
+  else if (spip->txcnt == 0)
+    spip->aux->cntl1 = AUX_SPI_CNTL1_MSBF_IN | AUX_SPI_CNTL1_IDLE;
+}
+
+static void aux_start(SPIDriver *spip) {
+  const SPIConfig *cfg = spip->config;
+  const aux_pins_t *pins = aux_pins(spip);
+  auxspi_t *aux = spip->aux;
+  uint32_t speed, cntl0;
+
+  chDbgAssert(!cfg->lossiEnabled && !cfg->chip_select_polarity &&
+              (cfg->chip_select < 3),
+              "aux_start(), #1", "unsupported configuration");
+
+  AUX_ENABLES |= aux_bit(spip);
+  aux->cntl1 = 0;
+  aux->cntl0 = AUX_SPI_CNTL0_CLEARFIFO;
+
+  bcm2835_gpio_fnsel(pins->miso, GPFN_ALT4);
+  bcm2835_gpio_fnsel(pins->mosi, GPFN_ALT4);
+  bcm2835_gpio_fnsel(pins->sclk, GPFN_ALT4);
+  bcm2835_gpio_fnsel(pins->ce[cfg->chip_select], GPFN_ALT4);
+
+  /* SPI0 divides the core clock by CDIV, the AUX masters by 2 * (SPEED + 1).
+     A zero CDIV stands for 65536.*/
+  speed = cfg->clock_divider == 0 ? 65536 : cfg->clock_divider;
+  speed = speed < 2 ? 0 : speed / 2 - 1;
+  if (speed > AUX_SPI_CNTL0_SPEED_MAX)
+    speed = AUX_SPI_CNTL0_SPEED_MAX;
+
+  /* Only the selected chip select goes low during transfers. Data is
+     sampled on the rising edge when CPOL equals CPHA, and always changes
+     on the opposite edge.*/
+  cntl0 = (speed << AUX_SPI_CNTL0_SPEED_SHIFT) |
+          ((7 & ~(1 << cfg->chip_select)) << AUX_SPI_CNTL0_CS_SHIFT) |
+          AUX_SPI_CNTL0_VAR_WIDTH | AUX_SPI_CNTL0_ENABLE |
+          AUX_SPI_CNTL0_MSBF_OUT;
+  if (cfg->clock_polarity)
+    cntl0 |= AUX_SPI_CNTL0_CPOL;
+  if (!cfg->clock_polarity == !cfg->clock_phase)
+    cntl0 |= AUX_SPI_CNTL0_IN_RISING;
+  else
+    cntl0 |= AUX_SPI_CNTL0_OUT_RISING;
+
+  aux->cntl0 = cntl0;
+  aux->cntl1 = AUX_SPI_CNTL1_MSBF_IN;
+
+  IRQ_ENABLE1 = AUX_IRQ_LINE;
+}
+
+static void aux_stop(SPIDriver *spip) {
+  const aux_pins_t *pins = aux_pins(spip);
+
+  spip->aux->cntl1 = 0;
+  spip->aux->cntl0 = 0;
+  AUX_ENABLES &= ~aux_bit(spip);
+
+  /* The mini UART shares the interrupt line.*/
+  if ((AUX_ENABLES & (AUX_MU | AUX_SPI1 | AUX_SPI2)) == 0)
+    IRQ_DISABLE1 = AUX_IRQ_LINE;
+
+  bcm2835_gpio_fnsel(pins->miso, GPFN_IN);
+  bcm2835_gpio_fnsel(pins->mosi, GPFN_IN);
+  bcm2835_gpio_fnsel(pins->sclk, GPFN_IN);
+  bcm2835_gpio_fnsel(pins->ce[spip->config->chip_select], GPFN_IN);
+}
+
+static void aux_exchange(SPIDriver *spip, size_t n,
+                         const void *txbuf, void *rxbuf) {
+  auxspi_t *aux = spip->aux;
+
+  spip->txbuf = txbuf;
+  spip->txcnt = n;
+  spip->rxbuf = rxbuf;
+  spip->rxcnt = n;
+
+  aux->cntl0 |= AUX_SPI_CNTL0_CLEARFIFO;
+  aux->cntl0 &= ~AUX_SPI_CNTL0_CLEARFIFO;
+
+  /* Prime the FIFO, the interrupt takes over from there.*/
+  aux_pump(spip);
+  aux->cntl1 = AUX_SPI_CNTL1_MSBF_IN |
+               (spip->txcnt > 0 ? AUX_SPI_CNTL1_TXEMPTY : AUX_SPI_CNTL1_IDLE);
+}
+
+static uint16_t aux_polled_exchange(SPIDriver *spip, uint16_t frame) {
+  auxspi_t *aux = spip->aux;
+
+  aux->io[0] = (8UL << AUX_SPI_WIDTH_SHIFT) | ((uint32_t)(frame & 0xFF) << 16);
+  while (aux->stat & AUX_SPI_STAT_RX_EMPTY)
+    ;
+  return (uint16_t)(aux->io[0] & 0xFF);
+}
+#endif /* BCM2835_SPI_USE_AUX_ */
+
 /*===========================================================================*/
 /* Driver interrupt handlers.                                                */
 /*===========================================================================*/
 
 #define read_fifo(spip) {                       \
+  uint8_t *rxbuf = (uint8_t *)(spip)->rxbuf;    \
   while (SPI0_CS & SPI_CS_RXD) {                \
     uint32_t rx = SPI0_FIFO;                    \
-    uint8_t *rxbuf = (uint8_t *)(spip)->rxbuf;	\
     if (rxbuf)                                  \
       *rxbuf++ = rx;                            \
   }                                             \
+  (spip)->rxbuf = rxbuf;                        \
 }
 
 
@@ -73,6 +290,13 @@ SPIDriver SPI0;
  * @notapi
  */
 void spi_lld_serve_interrupt(SPIDriver *spip) {
+#if BCM2835_SPI_USE_AUX_
+  if (spip->aux != NULL) {
+    if (AUX_IRQ & aux_bit(spip))
+      aux_serve_interrupt(spip);
+    return;
+  }
+#endif
   if (IRQ_PEND2 & SPI_IRQ) {
     if (SPI0_CS & SPI_CS_DONE) {
       size_t *count = &(spip->txcnt);
@@ -85,6 +309,8 @@ void spi_lld_serve_interrupt(SPIDriver *spip) {
 	    SPI0_FIFO = spip->txbuf != NULL ? *(txbuf)++ : 0;
 	    *count -= 2;
 	  }
+	  if (spip->txbuf != NULL)
+	    spip->txbuf = txbuf;
 	}
 	else {
 	  uint8_t *txbuf = (uint8_t *)(spip)->txbuf;
@@ -92,6 +318,8 @@ void spi_lld_serve_interrupt(SPIDriver *spip) {
 	    SPI0_FIFO = spip->txbuf != NULL ? *(txbuf)++ : 0;
 	    --*count;
 	  }
+	  if (spip->txbuf != NULL)
+	    spip->txbuf = txbuf;
 	}
       }
       else {
@@ -120,6 +348,15 @@ void spi_lld_serve_interrupt(SPIDriver *spip) {
  */
 void spi_lld_init(void) {
   spiObjectInit(&SPI0);
+  SPI0.aux = NULL;
+#if BCM2835_SPI_USE_SPI1
+  spiObjectInit(&SPID1);
+  SPID1.aux = AUX_SPI1_ADDR;
+#endif
+#if BCM2835_SPI_USE_SPI2
+  spiObjectInit(&SPID2);
+  SPID2.aux = AUX_SPI2_ADDR;
+#endif
 }
 
 /**
@@ -130,7 +367,12 @@ void spi_lld_init(void) {
  * @notapi
  */
 void spi_lld_start(SPIDriver *spip) {
-  UNUSED(spip);
+#if BCM2835_SPI_USE_AUX_
+  if (spip->aux != NULL) {
+    aux_start(spip);
+    return;
+  }
+#endif
 
   IRQ_DISABLE2 |= BIT(22);
 
@@ -180,6 +422,12 @@ void spi_lld_start(SPIDriver *spip) {
  * @notapi
  */
 void spi_lld_stop(SPIDriver *spip) {
+#if BCM2835_SPI_USE_AUX_
+  if (spip->aux != NULL) {
+    aux_stop(spip);
+    return;
+  }
+#endif
   UNUSED(spip);
 
   IRQ_DISABLE2 |= BIT(22);
@@ -200,6 +448,11 @@ void spi_lld_stop(SPIDriver *spip) {
  * @notapi
  */
 void spi_lld_select(SPIDriver *spip) {
+#if BCM2835_SPI_USE_AUX_
+  /* The universal masters drive the chip select set at start on their own.*/
+  if (spip->aux != NULL)
+    return;
+#endif
   uint32_t cs = SPI0_CS;
   cs &= ~SPI_CS_CS;
   cs |= (spip->config->chip_select & SPI_CS_CS);
@@ -215,6 +468,10 @@ void spi_lld_select(SPIDriver *spip) {
  * @notapi
  */
 void spi_lld_unselect(SPIDriver *spip) {
+#if BCM2835_SPI_USE_AUX_
+  if (spip->aux != NULL)
+    return;
+#endif
   UNUSED(spip);
   /* This sets the CS back to CS0.
    * There's no way to turn off all chip selects.
@@ -255,6 +512,13 @@ void spi_lld_ignore(SPIDriver *spip, size_t n) {
  */
 void spi_lld_exchange(SPIDriver *spip, size_t n,
                       const void *txbuf, void *rxbuf) {
+#if BCM2835_SPI_USE_AUX_
+  if (spip->aux != NULL) {
+    aux_exchange(spip, n, txbuf, rxbuf);
+    return;
+  }
+#endif
+
   /* Clear TX and RX fifos.*/
   SPI0_CS |= SPI_CS_CLEAR_TX | SPI_CS_CLEAR_RX;
 
@@ -314,6 +578,10 @@ void spi_lld_receive(SPIDriver *spip, size_t n, void *rxbuf) {
  * @return              The received data frame from the SPI bus.
  */
 uint16_t spi_lld_polled_exchange(SPIDriver *spip, uint16_t frame) {
+#if BCM2835_SPI_USE_AUX_
+  if (spip->aux != NULL)
+    return aux_polled_exchange(spip, frame);
+#endif
   UNUSED(spip);
 
   /* Clear TX and RX fifos. Start transfer.*/
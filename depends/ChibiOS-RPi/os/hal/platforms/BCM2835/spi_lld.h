@@ -31,6 +31,8 @@
 
 #if HAL_USE_SPI || defined(__DOXYGEN__)
 
+#include "bcm2835.h"
+
 /*===========================================================================*/
 /* Driver constants.                                                         */
 /*===========================================================================*/
@@ -39,10 +41,33 @@
 /* Driver pre-compile time settings.                                         */
 /*===========================================================================*/
 
+/**
+ * @brief   SPID1 driver enable switch.
+ * @details If set to @p TRUE the support for the SPI1 universal SPI master
+ *          (AUX block, ALT4 on GPIO16..GPIO21) is included.
+ * @note    GPIO18 doubles as SPI1_CE0_N, it cannot be shared with the PWM,
+ *          PCM or BSC slave functions while CE0 is used.
+ */
+#if !defined(BCM2835_SPI_USE_SPI1) || defined(__DOXYGEN__)
+#define BCM2835_SPI_USE_SPI1                FALSE
+#endif
+
+/**
+ * @brief   SPID2 driver enable switch.
+ * @details If set to @p TRUE the support for the SPI2 universal SPI master
+ *          (AUX block, ALT4 on GPIO40..GPIO45) is included.
+ * @note    GPIO40..GPIO45 are not brought out on the Raspberry Pi headers.
+ */
+#if !defined(BCM2835_SPI_USE_SPI2) || defined(__DOXYGEN__)
+#define BCM2835_SPI_USE_SPI2                FALSE
+#endif
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
 
+#define BCM2835_SPI_USE_AUX_    (BCM2835_SPI_USE_SPI1 || BCM2835_SPI_USE_SPI2)
+
 /*===========================================================================*/
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
@@ -64,6 +89,11 @@ typedef void (*spicallback_t)(SPIDriver *spip);
  * @brief   Driver configuration structure.
  * @note    Implementations may extend this structure to contain more,
  *          architecture dependent, fields.
+ * @note    SPID1 and SPID2 accept the same configuration as SPI0, with
+ *          @p chip_select 0..2 and the same SCLK for a given
+ *          @p clock_divider, rounded down to an even divider. They have no
+ *          LoSSI mode and their chip selects are active low only, so
+ *          @p lossiEnabled and the polarity fields must be zero.
  */
 typedef struct {
   /**
@@ -145,6 +175,7 @@ struct SPIDriver {
 #elif CH_USE_SEMAPHORES
   Semaphore             semaphore;
 #endif
+#endif /* SPI_USE_MUTUAL_EXCLUSION */
 
   /**
    * @brief Receive buffer
@@ -161,7 +192,15 @@ struct SPIDriver {
    */
   size_t              txcnt;
 
-#endif /* SPI_USE_MUTUAL_EXCLUSION */
+  /**
+   * @brief Universal SPI master registers, @p NULL for SPI0.
+   */
+  auxspi_t              *aux;
+
+  /**
+   * @brief Bytes still to be received, universal SPI masters only.
+   */
+  size_t                rxcnt;
 #if defined(SPI_DRIVER_EXT_FIELDS)
   SPI_DRIVER_EXT_FIELDS
 #endif
@@ -180,6 +219,12 @@ struct SPIDriver {
 extern "C" {
 #endif
   extern SPIDriver SPI0;
+#if BCM2835_SPI_USE_SPI1
+  extern SPIDriver SPID1;
+#endif
+#if BCM2835_SPI_USE_SPI2
+  extern SPIDriver SPID2;
+#endif
 
   void spi_lld_init(void);
   void spi_lld_start(SPIDriver *spip);
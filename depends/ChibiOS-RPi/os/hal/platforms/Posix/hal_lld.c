@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include "ch.h"
 #include "hal.h"
@@ -48,6 +49,45 @@ static struct timeval tick = {0, 1000000 / CH_FREQUENCY};
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
+#if SIM_VIRTUAL_TIME || defined(__DOXYGEN__)
+/**
+ * @brief   Counter value returned last, the counter never goes back.
+ */
+static halrtcnt_t lastcnt;
+
+/**
+ * @brief   Serves the system ticks of an idle period back to back.
+ * @details Called from the idle thread, no thread can run before a timer
+ *          wakes one: the ticks are served through the kernel tick handler
+ *          until a thread is ready or a simulated second has passed, so the
+ *          other interrupt sources are still polled. The ticks are charged
+ *          to the idle thread, which is the one running.
+ *
+ * @return              @p FALSE if no virtual timer is armed.
+ */
+static bool_t run_idle_ticks(void) {
+  unsigned n = 0;
+
+  CH_IRQ_PROLOGUE();
+
+  chSysLockFromIsr();
+  while ((&vtlist != (VTList *)vtlist.vt_next) &&
+         !chSchIsPreemptionRequired() && (n < CH_FREQUENCY)) {
+    chSysTimerHandlerI();
+    n++;
+  }
+  chSysUnlockFromIsr();
+
+  CH_IRQ_EPILOGUE();
+
+  dbg_check_lock();
+  if (chSchIsPreemptionRequired())
+    chSchDoReschedule();
+  dbg_check_unlock();
+  return n > 0;
+}
+#endif /* SIM_VIRTUAL_TIME */
+
 /*===========================================================================*/
 /* Driver interrupt handlers.                                                */
 /*===========================================================================*/
@@ -70,6 +110,41 @@ void hal_lld_init(void) {
   timeradd(&nextcnt, &tick, &nextcnt);
 }
 
+/**
+ * @brief   Reads the realtime counter.
+ * @details With @p SIM_VIRTUAL_TIME the counter is the system time plus
+ *          the host time since the last tick, so it jumps with the system
+ *          time and still advances in busy loops between ticks.
+ *
+ * @return              The counter in nanoseconds, modulo 2^32.
+ *
+ * @notapi
+ */
+halrtcnt_t hal_lld_counter(void) {
+#if SIM_VIRTUAL_TIME
+  struct timeval tv, last;
+  halrtcnt_t cnt;
+
+  gettimeofday(&tv, NULL);
+  timersub(&nextcnt, &tick, &last);
+  cnt = (halrtcnt_t)chTimeNow() * (1000000000UL / CH_FREQUENCY);
+  if (timercmp(&tv, &last, >)) {
+    timersub(&tv, &last, &tv);
+    cnt += (halrtcnt_t)tv.tv_sec * 1000000000UL +
+           (halrtcnt_t)tv.tv_usec * 1000UL;
+  }
+  /* A late tick served after a jump could otherwise step back.*/
+  if ((int32_t)(cnt - lastcnt) > 0)
+    lastcnt = cnt;
+  return lastcnt;
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (halrtcnt_t)ts.tv_sec * 1000000000UL + (halrtcnt_t)ts.tv_nsec;
+#endif
+}
+
 /**
  * @brief Interrupt simulation.
  */
@@ -87,6 +162,15 @@ void ChkIntSources(void) {
 #endif
 
   gettimeofday(&tv, NULL);
+
+#if SIM_VIRTUAL_TIME
+  /* Called from the idle thread, nothing can happen before a timer wakes a
+     thread: ticks at once, the host schedule restarts from now.*/
+  if ((currp->p_prio == IDLEPRIO) && run_idle_ticks()) {
+    timeradd(&tv, &tick, &nextcnt);
+    return;
+  }
+#endif
   if (timercmp(&tv, &nextcnt, >=)) {
     timeradd(&nextcnt, &tick, &nextcnt);
 
@@ -40,7 +40,7 @@
 /**
  * @brief   Defines the support for realtime counters in the HAL.
  */
-#define HAL_IMPLEMENTS_COUNTERS FALSE
+#define HAL_IMPLEMENTS_COUNTERS TRUE
 
 /**
  * @brief   Platform name.
@@ -54,6 +54,24 @@
 /* Driver pre-compile time settings.                                         */
 /*===========================================================================*/
 
+/**
+ * @brief   Virtual time fast-forward switch.
+ * @details If set to @p TRUE the system time stops following the host
+ *          clock whenever all threads are idle: the simulator jumps straight
+ *          to the next virtual timer deadline. While threads are running
+ *          the time still advances at the host pace, so busy loops polling
+ *          the time terminate.
+ * @note    Simulated peripherals must be paced by virtual timers, or by
+ *          threads sleeping on them, never by the host clock, in order to
+ *          keep up with the jumps. The I2C replay backend is, the socket
+ *          serial ports are served in host time and appear infinitely
+ *          fast.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(SIM_VIRTUAL_TIME) || defined(__DOXYGEN__)
+#define SIM_VIRTUAL_TIME            FALSE
+#endif
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
@@ -62,10 +80,37 @@
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
 
+/**
+ * @brief   Type of the realtime free counter value.
+ */
+typedef uint32_t halrtcnt_t;
+
 /*===========================================================================*/
 /* Driver macros.                                                            */
 /*===========================================================================*/
 
+/**
+ * @brief   Returns the current value of the system free running counter.
+ * @note    The counter follows the host monotonic clock, with
+ *          @p SIM_VIRTUAL_TIME it follows the system time instead.
+ *
+ * @return              The value of the system free running counter of
+ *                      type halrtcnt_t.
+ *
+ * @notapi
+ */
+#define hal_lld_get_counter_value()         hal_lld_counter()
+
+/**
+ * @brief   Realtime counter frequency.
+ * @note    The counter counts nanoseconds.
+ *
+ * @return              The realtime counter frequency.
+ *
+ * @notapi
+ */
+#define hal_lld_get_counter_frequency()     1000000000UL
+
 /*===========================================================================*/
 /* External declarations.                                                    */
 /*===========================================================================*/
@@ -74,6 +119,7 @@
 extern "C" {
 #endif
   void hal_lld_init(void);
+  halrtcnt_t hal_lld_counter(void);
   void ChkIntSources(void);
 #ifdef __cplusplus
 }
@@ -0,0 +1,356 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    Posix/i2c_lld.c
+ * @brief   Posix I2C trace replay low level driver code.
+ *
+ * @addtogroup POSIX_I2C
+ * @{
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ch.h"
+#include "hal.h"
+
+#if HAL_USE_I2C || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/**
+ * @brief   Microseconds per system tick.
+ */
+#define US_PER_TICK         (1000000 / CH_FREQUENCY)
+
+/**
+ * @brief   A decoded trace record.
+ */
+typedef struct {
+  uint8_t                   tag;
+  uint8_t                   addr;
+  uint32_t                  start;
+  uint32_t                  duration;
+  uint8_t                   errors;
+  const uint8_t             *tx;
+  size_t                    txlen;
+  const uint8_t             *rx;
+  size_t                    rxlen;
+} replay_record_t;
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/** @brief I2C1 driver identifier.*/
+#if USE_SIM_I2C1 || defined(__DOXYGEN__)
+I2CDriver I2CD1;
+#endif
+
+/*===========================================================================*/
+/* Driver local variables.                                                   */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+static bool_t get_byte(I2CDriver *i2cp, uint8_t *bp) {
+
+  if (i2cp->pos >= i2cp->size)
+    return FALSE;
+  *bp = i2cp->trace[i2cp->pos++];
+  return TRUE;
+}
+
+static bool_t get_varint(I2CDriver *i2cp, uint32_t *vp) {
+  unsigned shift = 0;
+  uint8_t b;
+
+  *vp = 0;
+  do {
+    if ((shift > 28) || !get_byte(i2cp, &b))
+      return FALSE;
+    *vp |= (uint32_t)(b & 0x7F) << shift;
+    shift += 7;
+  } while (b & 0x80);
+  return TRUE;
+}
+
+static bool_t get_bytes(I2CDriver *i2cp, const uint8_t **pp, size_t *np) {
+  uint32_t n;
+
+  if (!get_varint(i2cp, &n) || (n > i2cp->size - i2cp->pos))
+    return FALSE;
+  *pp = &i2cp->trace[i2cp->pos];
+  *np = n;
+  i2cp->pos += n;
+  return TRUE;
+}
+
+/**
+ * @brief   Decodes the next record, restarting a looped trace.
+ *
+ * @return              @p FALSE at the end of the trace, or at a truncated
+ *                      or malformed record.
+ */
+static bool_t next_record(I2CDriver *i2cp, replay_record_t *rp) {
+
+  if ((i2cp->pos >= i2cp->size) || (i2cp->trace[i2cp->pos] == I2C_TRACE_END)) {
+    if (!(i2cp->config->flags & I2C_REPLAY_LOOP) ||
+        (i2cp->replayed == 0))
+      return FALSE;
+    i2cp->pos = I2C_TRACE_HEADER_SIZE;
+  }
+
+  rp->errors = I2CD_NO_ERROR;
+  rp->tx = NULL;
+  rp->txlen = 0;
+  if (!get_byte(i2cp, &rp->tag) || !get_byte(i2cp, &rp->addr) ||
+      !get_varint(i2cp, &rp->start) || !get_varint(i2cp, &rp->duration))
+    return FALSE;
+  if ((rp->tag & I2C_TRACE_ERRORS) && !get_byte(i2cp, &rp->errors))
+    return FALSE;
+  if (((rp->tag & I2C_TRACE_KIND_MASK) == I2C_TRACE_TX) &&
+      !get_bytes(i2cp, &rp->tx, &rp->txlen))
+    return FALSE;
+  return get_bytes(i2cp, &rp->rx, &rp->rxlen);
+}
+
+/**
+ * @brief   System time in microseconds, without the 32 bits wrap.
+ */
+static uint64_t timeline_now(I2CDriver *i2cp) {
+  systime_t now = chTimeNow();
+
+  i2cp->timeline += (uint64_t)(systime_t)(now - i2cp->seen) * US_PER_TICK;
+  i2cp->seen = now;
+  return i2cp->timeline;
+}
+
+/**
+ * @brief   Sleeps on a virtual timer until the first tick at or after
+ *          @p due, in microseconds.
+ *
+ * @sclass
+ */
+static void timeline_wait(I2CDriver *i2cp, uint64_t due) {
+  uint64_t now = timeline_now(i2cp);
+
+  if (due > now)
+    chThdSleepS((systime_t)((due - now + US_PER_TICK - 1) / US_PER_TICK));
+}
+
+/**
+ * @brief   Answers a transaction from the trace.
+ *
+ * @return              The recorded status.
+ *
+ * @sclass
+ */
+static msg_t replay(I2CDriver *i2cp, uint8_t kind, i2caddr_t addr,
+                    const uint8_t *txbuf, size_t txbytes,
+                    uint8_t *rxbuf, size_t rxbytes) {
+  replay_record_t rec;
+  size_t n;
+
+  if (i2cp->ended || !next_record(i2cp, &rec)) {
+    /* Nobody left on the bus.*/
+    i2cp->ended = TRUE;
+    i2cp->errors = I2CD_ACK_FAILURE;
+    return RDY_RESET;
+  }
+  i2cp->replayed++;
+  if (rec.tag & I2C_TRACE_GAP)
+    i2cp->gaps++;
+  if (((rec.tag & I2C_TRACE_KIND_MASK) != kind) || (rec.addr != addr) ||
+      (rec.txlen != txbytes) || (rec.rxlen != rxbytes) ||
+      ((txbytes > 0) && (memcmp(rec.tx, txbuf, txbytes) != 0)))
+    i2cp->mismatches++;
+
+  if (rxbytes > 0) {
+    n = rec.rxlen < rxbytes ? rec.rxlen : rxbytes;
+    memcpy(rxbuf, rec.rx, n);
+    memset(rxbuf + n, 0, rxbytes - n);
+  }
+
+  if (i2cp->config->flags & I2C_REPLAY_TIMING) {
+    uint64_t now = timeline_now(i2cp);
+    uint64_t due = now;
+
+    /* A transaction does not start earlier after the previous one than it
+       did on the target, a driver slower than the recorded one keeps its
+       own pace. The recorded start is kept to the microsecond, so gaps and
+       durations shorter than a tick do not drift against the system
+       time.*/
+    if ((i2cp->replayed > 1) && (i2cp->started + rec.start > now))
+      due = i2cp->started + rec.start;
+    timeline_wait(i2cp, due);
+    i2cp->started = due;
+    timeline_wait(i2cp, due + rec.duration);
+  }
+
+  i2cp->errors = rec.errors;
+  switch (rec.tag & I2C_TRACE_STATUS_MASK) {
+  case I2C_TRACE_OK:
+    return RDY_OK;
+  case I2C_TRACE_TIMEOUT:
+    return RDY_TIMEOUT;
+  default:
+    return RDY_RESET;
+  }
+}
+
+/*===========================================================================*/
+/* Driver interrupt handlers.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Low level I2C driver initialization.
+ *
+ * @notapi
+ */
+void i2c_lld_init(void) {
+
+#if USE_SIM_I2C1
+  i2cObjectInit(&I2CD1);
+  I2CD1.trace = NULL;
+#endif
+}
+
+/**
+ * @brief   Loads the trace.
+ * @details Restarting an already started driver, as done to recover from a
+ *          timeout, keeps the replay position.
+ * @note    A missing or invalid trace file terminates the simulator.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ *
+ * @notapi
+ */
+void i2c_lld_start(I2CDriver *i2cp) {
+  FILE *f;
+  long size;
+
+  if (i2cp->trace != NULL)
+    return;
+
+  if ((f = fopen(i2cp->config->path, "rb")) == NULL) {
+    printf("I2C: Error opening trace %s\n", i2cp->config->path);
+    goto abort;
+  }
+  if ((fseek(f, 0, SEEK_END) != 0) || ((size = ftell(f)) < 0) ||
+      (fseek(f, 0, SEEK_SET) != 0) ||
+      ((i2cp->trace = malloc((size_t)size + 1)) == NULL) ||
+      (fread(i2cp->trace, 1, (size_t)size, f) != (size_t)size)) {
+    printf("I2C: Error reading trace %s\n", i2cp->config->path);
+    fclose(f);
+    goto abort;
+  }
+  fclose(f);
+  if ((size < I2C_TRACE_HEADER_SIZE) ||
+      (memcmp(i2cp->trace, I2C_TRACE_MAGIC, 4) != 0) ||
+      (i2cp->trace[4] != I2C_TRACE_VERSION)) {
+    printf("I2C: %s is not a version %d trace\n",
+           i2cp->config->path, I2C_TRACE_VERSION);
+    goto abort;
+  }
+  i2cp->size = (size_t)size;
+  i2cp->pos = I2C_TRACE_HEADER_SIZE;
+  i2cp->timeline = 0;
+  i2cp->seen = chTimeNow();
+  i2cp->started = 0;
+  i2cp->replayed = 0;
+  i2cp->mismatches = 0;
+  i2cp->gaps = 0;
+  i2cp->ended = FALSE;
+  return;
+
+abort:
+  exit(1);
+}
+
+/**
+ * @brief   Releases the trace.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ *
+ * @notapi
+ */
+void i2c_lld_stop(I2CDriver *i2cp) {
+
+  free(i2cp->trace);
+  i2cp->trace = NULL;
+}
+
+/**
+ * @brief   Transmits data via the I2C bus as master.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ * @param[in] addr      slave device address
+ * @param[in] txbuf     pointer to the transmit buffer
+ * @param[in] txbytes   number of bytes to be transmitted
+ * @param[out] rxbuf    pointer to the receive buffer
+ * @param[in] rxbytes   number of bytes to be received
+ * @param[in] timeout   ignored, a recorded timeout is replayed instead
+ * @return              The recorded status.
+ *
+ * @notapi
+ */
+msg_t i2c_lld_master_transmit_timeout(I2CDriver *i2cp, i2caddr_t addr,
+                                      const uint8_t *txbuf, size_t txbytes,
+                                      uint8_t *rxbuf, size_t rxbytes,
+                                      systime_t timeout) {
+
+  (void)timeout;
+  return replay(i2cp, I2C_TRACE_TX, addr, txbuf, txbytes, rxbuf, rxbytes);
+}
+
+/**
+ * @brief   Receives data via the I2C bus as master.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ * @param[in] addr      slave device address
+ * @param[out] rxbuf    pointer to the receive buffer
+ * @param[in] rxbytes   number of bytes to be received
+ * @param[in] timeout   ignored, a recorded timeout is replayed instead
+ * @return              The recorded status.
+ *
+ * @notapi
+ */
+msg_t i2c_lld_master_receive_timeout(I2CDriver *i2cp, i2caddr_t addr,
+                                     uint8_t *rxbuf, size_t rxbytes,
+                                     systime_t timeout) {
+
+  (void)timeout;
+  return replay(i2cp, I2C_TRACE_RX, addr, NULL, 0, rxbuf, rxbytes);
+}
+
+#endif /* HAL_USE_I2C */
+
+/** @} */
@@ -0,0 +1,189 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    Posix/i2c_lld.h
+ * @brief   Posix I2C trace replay low level driver header.
+ * @details The simulated bus answers every transaction with the next record
+ *          of a trace captured on the target, see @p I2C_USE_CAPTURE. The
+ *          received bytes, the status and the error flags are the recorded
+ *          ones and the transaction takes the recorded time, so a device
+ *          driver sees the field traffic again, NACKs and clock stretching
+ *          included. A transaction also waits out the rest of the recorded
+ *          gap since the previous one started. The waits are virtual timer
+ *          sleeps on a microsecond timeline, so the replay keeps the
+ *          recorded pace under @p SIM_VIRTUAL_TIME. Requests that differ
+ *          from the recorded ones are counted, the recorded answer is given
+ *          anyway.
+ *
+ * @addtogroup POSIX_I2C
+ * @{
+ */
+
+#ifndef _I2C_LLD_H_
+#define _I2C_LLD_H_
+
+#if HAL_USE_I2C || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @name    Replay flags
+ * @{
+ */
+/** @brief Transactions take the recorded time and gaps.*/
+#define I2C_REPLAY_TIMING           0x01
+/** @brief The trace restarts when it ends.*/
+#define I2C_REPLAY_LOOP             0x02
+/** @} */
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   I2CD1 driver enable switch.
+ * @details If set to @p TRUE the support for I2CD1 is included.
+ * @note    The default is @p TRUE.
+ */
+#if !defined(USE_SIM_I2C1) || defined(__DOXYGEN__)
+#define USE_SIM_I2C1                TRUE
+#endif
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Type of a structure representing an I2C driver.
+ */
+typedef struct I2CDriver I2CDriver;
+
+/**
+ * @brief   I2C status type
+ */
+typedef uint32_t i2cstatus_t;
+
+/**
+ * @brief   I2C flags type
+ */
+typedef uint32_t i2cflags_t;
+
+/**
+ * @brief   I2C address type
+ */
+typedef uint16_t i2caddr_t;
+
+/**
+ * @brief   Driver configuration structure.
+ */
+typedef struct {
+  /** @brief Path of the trace file replayed on the bus.*/
+  const char                *path;
+  /** @brief Replay flags, @p I2C_REPLAY_*.*/
+  uint8_t                   flags;
+} I2CConfig;
+
+/**
+ * @brief   Structure representing an I2C driver.
+ */
+struct I2CDriver {
+  /** @brief Driver state.*/
+  i2cstate_t                state;
+  /** @brief Current configuration data.*/
+  const I2CConfig           *config;
+  /** @brief Error flags.*/
+  i2cflags_t                errors;
+#if I2C_USE_MUTUAL_EXCLUSION
+#if CH_USE_MUTEXES
+  Mutex                     mutex;
+#elif CH_USE_SEMAPHORES
+  Semaphore                 semaphore;
+#endif
+#endif /* I2C_USE_MUTUAL_EXCLUSION */
+#if I2C_USE_CAPTURE
+  /** @brief Capture the transactions are recorded to, @p NULL if none.*/
+  I2CCapture                *capture;
+#endif /* I2C_USE_CAPTURE */
+  /* End of the mandatory fields.*/
+  /** @brief Trace file contents.*/
+  uint8_t                   *trace;
+  /** @brief Trace size in bytes.*/
+  size_t                    size;
+  /** @brief Offset of the next record.*/
+  size_t                    pos;
+  /** @brief System time in microseconds when last read.*/
+  uint64_t                  timeline;
+  /** @brief System time @p timeline was last updated at.*/
+  systime_t                 seen;
+  /** @brief Start of the previous transaction on @p timeline.*/
+  uint64_t                  started;
+  /** @brief Statistics: transactions answered from the trace.*/
+  uint32_t                  replayed;
+  /** @brief Statistics: requests differing from the recorded ones.*/
+  uint32_t                  mismatches;
+  /** @brief Statistics: records marked as following dropped ones.*/
+  uint32_t                  gaps;
+  /** @brief The trace ended, the bus no longer acknowledges.*/
+  bool_t                    ended;
+};
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+#define i2c_lld_get_errors(i2cp) ((i2cp)->errors)
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#if USE_SIM_I2C1 && !defined(__DOXYGEN__)
+extern I2CDriver I2CD1;
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void i2c_lld_init(void);
+  void i2c_lld_start(I2CDriver *i2cp);
+  void i2c_lld_stop(I2CDriver *i2cp);
+  msg_t i2c_lld_master_transmit_timeout(I2CDriver *i2cp, i2caddr_t addr,
+                                        const uint8_t *txbuf, size_t txbytes,
+                                        uint8_t *rxbuf, size_t rxbytes,
+                                        systime_t timeout);
+  msg_t i2c_lld_master_receive_timeout(I2CDriver *i2cp, i2caddr_t addr,
+                                       uint8_t *rxbuf, size_t rxbytes,
+                                       systime_t timeout);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_USE_I2C */
+
+#endif /* _I2C_LLD_H_ */
+
+/** @} */
@@ -50,6 +50,114 @@
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
+#if I2C_USE_CAPTURE || defined(__DOXYGEN__)
+/*
+ * Capture clock, the HAL realtime counter where available because a
+ * transaction usually takes less than a system tick.
+ */
+#if HAL_IMPLEMENTS_COUNTERS
+#define capture_now()       ((uint32_t)halGetCounterValue())
+#define capture_us(dt)      ((uint32_t)RTT2US(dt))
+#else
+#define capture_now()       ((uint32_t)chTimeNow())
+#define capture_us(dt)      ((uint32_t)(dt) * (1000000 / CH_FREQUENCY))
+#endif
+
+static size_t varint_size(uint32_t v) {
+  size_t n = 1;
+
+  while (v >= 0x80) {
+    v >>= 7;
+    n++;
+  }
+  return n;
+}
+
+static void put_varint(InputQueue *iqp, uint32_t v) {
+
+  while (v >= 0x80) {
+    chIQPutI(iqp, (uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  chIQPutI(iqp, (uint8_t)v);
+}
+
+static void put_bytes(InputQueue *iqp, const uint8_t *bp, size_t n) {
+
+  put_varint(iqp, n);
+  while (n-- > 0)
+    chIQPutI(iqp, *bp++);
+}
+
+/**
+ * @brief   Appends the record of a completed transaction.
+ * @details The record is dropped whole if it does not fit.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ * @param[in] capp      capture attached when the transaction started
+ * @param[in] t0        capture clock at the transaction start
+ * @param[in] kind      @p I2C_TRACE_TX or @p I2C_TRACE_RX
+ * @param[in] addr      slave device address
+ * @param[in] txbuf     transmitted data
+ * @param[in] txbytes   number of bytes transmitted
+ * @param[in] rxbuf     received data
+ * @param[in] rxbytes   number of bytes received
+ * @param[in] rdymsg    the transaction status
+ *
+ * @iclass
+ */
+static void capture_record(I2CDriver *i2cp, I2CCapture *capp, uint32_t t0,
+                           uint8_t kind, i2caddr_t addr,
+                           const uint8_t *txbuf, size_t txbytes,
+                           const uint8_t *rxbuf, size_t rxbytes,
+                           msg_t rdymsg) {
+  uint32_t start, duration;
+  uint8_t tag;
+  size_t n;
+
+  /* Started or stopped while the transaction was in progress.*/
+  if ((capp == NULL) || (i2cp->capture != capp))
+    return;
+
+  start = capture_us(t0 - capp->last);
+  duration = capture_us(capture_now() - t0);
+  tag = kind;
+  if (rdymsg == RDY_TIMEOUT)
+    tag |= I2C_TRACE_TIMEOUT;
+  else if (rdymsg != RDY_OK)
+    tag |= I2C_TRACE_RESET;
+  if (i2cp->errors != I2CD_NO_ERROR)
+    tag |= I2C_TRACE_ERRORS;
+  if (capp->gap)
+    tag |= I2C_TRACE_GAP;
+
+  n = 2 + varint_size(start) + varint_size(duration) +
+      varint_size(rxbytes) + rxbytes;
+  if (tag & I2C_TRACE_ERRORS)
+    n++;
+  if (kind == I2C_TRACE_TX)
+    n += varint_size(txbytes) + txbytes;
+  if (n > chIQGetEmptyI(&capp->queue)) {
+    capp->dropped++;
+    capp->gap = TRUE;
+    return;
+  }
+
+  chIQPutI(&capp->queue, tag);
+  chIQPutI(&capp->queue, (uint8_t)addr);
+  put_varint(&capp->queue, start);
+  put_varint(&capp->queue, duration);
+  if (tag & I2C_TRACE_ERRORS)
+    chIQPutI(&capp->queue, (uint8_t)i2cp->errors);
+  if (kind == I2C_TRACE_TX)
+    put_bytes(&capp->queue, txbuf, txbytes);
+  put_bytes(&capp->queue, rxbuf, rxbytes);
+  capp->records++;
+  capp->last = t0;
+  capp->gap = FALSE;
+}
+#endif /* I2C_USE_CAPTURE */
+
 /*===========================================================================*/
 /* Driver exported functions.                                                */
 /*===========================================================================*/
@@ -76,6 +184,9 @@ void i2cObjectInit(I2CDriver *i2cp) {
 
   i2cp->state  = I2C_STOP;
   i2cp->config = NULL;
+#if I2C_USE_CAPTURE
+  i2cp->capture = NULL;
+#endif
 
 #if I2C_USE_MUTUAL_EXCLUSION
 #if CH_USE_MUTEXES
@@ -183,6 +294,10 @@ msg_t i2cMasterTransmitTimeout(I2CDriver *i2cp,
                                size_t rxbytes,
                                systime_t timeout) {
   msg_t rdymsg;
+#if I2C_USE_CAPTURE
+  I2CCapture *capp;
+  uint32_t t0;
+#endif
 
   chDbgCheck((i2cp != NULL) && (addr != 0) &&
              (txbytes > 0) && (txbuf != NULL) &&
@@ -196,12 +311,21 @@ msg_t i2cMasterTransmitTimeout(I2CDriver *i2cp,
   chSysLock();
   i2cp->errors = I2CD_NO_ERROR;
   i2cp->state = I2C_ACTIVE_TX;
+#if I2C_USE_CAPTURE
+  capp = i2cp->capture;
+  t0 = capture_now();
+#endif
   rdymsg = i2c_lld_master_transmit_timeout(i2cp, addr, txbuf, txbytes,
                                            rxbuf, rxbytes, timeout);
   if (rdymsg == RDY_TIMEOUT)
     i2cp->state = I2C_LOCKED;
   else
     i2cp->state = I2C_READY;
+#if I2C_USE_CAPTURE
+  capture_record(i2cp, capp, t0, I2C_TRACE_TX, addr, txbuf, txbytes,
+                 rxbuf, rxbytes, rdymsg);
+  chSchRescheduleS();
+#endif
   chSysUnlock();
   return rdymsg;
 }
@@ -233,6 +357,10 @@ msg_t i2cMasterReceiveTimeout(I2CDriver *i2cp,
                               systime_t timeout){
 
   msg_t rdymsg;
+#if I2C_USE_CAPTURE
+  I2CCapture *capp;
+  uint32_t t0;
+#endif
 
   chDbgCheck((i2cp != NULL) && (addr != 0) &&
              (rxbytes > 0) && (rxbuf != NULL) &&
@@ -245,11 +373,20 @@ msg_t i2cMasterReceiveTimeout(I2CDriver *i2cp,
   chSysLock();
   i2cp->errors = I2CD_NO_ERROR;
   i2cp->state = I2C_ACTIVE_RX;
+#if I2C_USE_CAPTURE
+  capp = i2cp->capture;
+  t0 = capture_now();
+#endif
   rdymsg = i2c_lld_master_receive_timeout(i2cp, addr, rxbuf, rxbytes, timeout);
   if (rdymsg == RDY_TIMEOUT)
     i2cp->state = I2C_LOCKED;
   else
     i2cp->state = I2C_READY;
+#if I2C_USE_CAPTURE
+  capture_record(i2cp, capp, t0, I2C_TRACE_RX, addr, NULL, 0,
+                 rxbuf, rxbytes, rdymsg);
+  chSchRescheduleS();
+#endif
   chSysUnlock();
   return rdymsg;
 }
@@ -298,6 +435,86 @@ void i2cReleaseBus(I2CDriver *i2cp) {
 }
 #endif /* I2C_USE_MUTUAL_EXCLUSION */
 
+#if I2C_USE_CAPTURE || defined(__DOXYGEN__)
+/**
+ * @brief   Initializes a @p I2CCapture object.
+ *
+ * @param[out] capp     pointer to the @p I2CCapture object
+ * @param[in] bp        pointer to the trace buffer
+ * @param[in] size      size of the trace buffer, records larger than this
+ *                      are never captured
+ *
+ * @init
+ */
+void i2cCaptureObjectInit(I2CCapture *capp, uint8_t *bp, size_t size) {
+
+  chIQInit(&capp->queue, bp, size, NULL, NULL);
+  capp->records = 0;
+  capp->dropped = 0;
+  capp->last = 0;
+  capp->gap = FALSE;
+}
+
+/**
+ * @brief   Starts capturing the transactions of a driver.
+ * @details The trace header is queued and every following transaction is
+ *          recorded until @p i2cCaptureStop(). A transaction already in
+ *          progress is not.
+ * @pre     The capture queue must be empty.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ * @param[in] capp      pointer to the @p I2CCapture object
+ *
+ * @api
+ */
+void i2cCaptureStart(I2CDriver *i2cp, I2CCapture *capp) {
+  const char *magic = I2C_TRACE_MAGIC;
+
+  chDbgCheck((i2cp != NULL) && (capp != NULL), "i2cCaptureStart");
+
+  chSysLock();
+  chDbgAssert(i2cp->capture == NULL, "i2cCaptureStart(), #1",
+              "already capturing");
+  chDbgAssert(chIQGetEmptyI(&capp->queue) >= I2C_TRACE_HEADER_SIZE + 1,
+              "i2cCaptureStart(), #2", "queue too small or not empty");
+  while (*magic != '\0')
+    chIQPutI(&capp->queue, (uint8_t)*magic++);
+  chIQPutI(&capp->queue, I2C_TRACE_VERSION);
+  capp->records = 0;
+  capp->dropped = 0;
+  capp->last = capture_now();
+  capp->gap = FALSE;
+  i2cp->capture = capp;
+  chSchRescheduleS();
+  chSysUnlock();
+}
+
+/**
+ * @brief   Stops capturing and terminates the trace.
+ * @details If the queue is full the end tag is dropped and counted, the
+ *          reader then has to rely on its own timeout.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ *
+ * @api
+ */
+void i2cCaptureStop(I2CDriver *i2cp) {
+  I2CCapture *capp;
+
+  chDbgCheck(i2cp != NULL, "i2cCaptureStop");
+
+  chSysLock();
+  capp = i2cp->capture;
+  if (capp != NULL) {
+    i2cp->capture = NULL;
+    if (chIQPutI(&capp->queue, I2C_TRACE_END) != Q_OK)
+      capp->dropped++;
+    chSchRescheduleS();
+  }
+  chSysUnlock();
+}
+#endif /* I2C_USE_CAPTURE */
+
 #endif /* HAL_USE_I2C */
 
 /** @} */
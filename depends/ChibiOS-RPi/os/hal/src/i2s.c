@@ -125,7 +125,7 @@ void i2sStop(I2SDriver *i2sp) {
  */
 void i2sStartExchange(I2SDriver *i2sp) {
 
-  chDbgCheck(i2sp != NULL "i2sStartExchange");
+  chDbgCheck(i2sp != NULL, "i2sStartExchange");
 
   chSysLock();
   chDbgAssert(i2sp->state == I2S_READY,
@@ -143,7 +143,7 @@ void i2sStartExchange(I2SDriver *i2sp) {
  */
 void i2sStartExchangeContinuous(I2SDriver *i2sp) {
 
-  chDbgCheck(i2sp != NULL "i2sStartExchangeContinuous");
+  chDbgCheck(i2sp != NULL, "i2sStartExchangeContinuous");
 
   chSysLock();
   chDbgAssert(i2sp->state == I2S_READY,
@@ -83,6 +83,13 @@
 #define HAL_USE_I2C                 FALSE
 #endif
 
+/**
+ * @brief   Enables the I2S subsystem.
+ */
+#if !defined(HAL_USE_I2S) || defined(__DOXYGEN__)
+#define HAL_USE_I2S                 FALSE
+#endif
+
 /**
  * @brief   Enables the ICU subsystem.
  */
@@ -114,6 +114,7 @@
 #include "chevents.h"
 #include "chmsg.h"
 #include "chmboxes.h"
+#include "chwq.h"
 #include "chmemcore.h"
 #include "chheap.h"
 #include "chmempools.h"
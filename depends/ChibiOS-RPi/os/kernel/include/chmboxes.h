@@ -68,6 +68,14 @@ extern "C" {
   msg_t chMBFetch(Mailbox *mbp, msg_t *msgp, systime_t timeout);
   msg_t chMBFetchS(Mailbox *mbp, msg_t *msgp, systime_t timeout);
   msg_t chMBFetchI(Mailbox *mbp, msg_t *msgp);
+  cnt_t chMBPostN(Mailbox *mbp, const msg_t *msgs, cnt_t n,
+                  systime_t timeout);
+  cnt_t chMBPostNS(Mailbox *mbp, const msg_t *msgs, cnt_t n,
+                   systime_t timeout);
+  cnt_t chMBPostNI(Mailbox *mbp, const msg_t *msgs, cnt_t n);
+  cnt_t chMBFetchN(Mailbox *mbp, msg_t *msgs, cnt_t n, systime_t timeout);
+  cnt_t chMBFetchNS(Mailbox *mbp, msg_t *msgs, cnt_t n, systime_t timeout);
+  cnt_t chMBFetchNI(Mailbox *mbp, msg_t *msgs, cnt_t n);
 #ifdef __cplusplus
 }
 #endif
@@ -179,6 +179,23 @@ extern "C" {
 #define chSchIsRescRequiredI() (firstprio(&rlist.r_queue) > currp->p_prio)
 #endif /* !defined(PORT_OPTIMIZED_ISRESCHREQUIREDI) */
 
+/**
+ * @brief   Removes a ready thread from the ready list.
+ * @details Used when a thread waiting in the ready list must be moved,
+ *          for example because its priority has been raised.
+ * @note    @p prio is the priority the thread was inserted with, ports
+ *          indexing the ready list by priority need it.
+ *
+ * @param[in] tp        the thread to be removed
+ * @param[in] prio      the priority @p tp was inserted with
+ * @return              The thread pointer.
+ *
+ * @iclass
+ */
+#if !defined(PORT_OPTIMIZED_READYREMOVEI) || defined(__DOXYGEN__)
+#define chSchReadyRemoveI(tp, prio) ((void)(prio), dequeue(tp))
+#endif /* !defined(PORT_OPTIMIZED_READYREMOVEI) */
+
 /**
  * @brief   Determines if yielding is possible.
  * @details This function returns @p TRUE if there is a ready thread with
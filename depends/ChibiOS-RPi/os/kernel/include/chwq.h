@@ -0,0 +1,180 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    chwq.h
+ * @brief   Work queues macros and structures.
+ *
+ * @addtogroup work_queues
+ * @{
+ */
+
+#ifndef _CHWQ_H_
+#define _CHWQ_H_
+
+/**
+ * @brief   Work queues APIs.
+ * @details If enabled then the work queue APIs are included in the kernel.
+ * @note    The default is @p FALSE.
+ * @note    Requires @p CH_USE_SEMAPHORES.
+ */
+#if !defined(CH_USE_WORKQUEUES) || defined(__DOXYGEN__)
+#define CH_USE_WORKQUEUES               FALSE
+#endif
+
+#if CH_USE_WORKQUEUES || defined(__DOXYGEN__)
+
+/*
+ * Module dependencies check.
+ */
+#if !CH_USE_SEMAPHORES
+#error "CH_USE_WORKQUEUES requires CH_USE_SEMAPHORES"
+#endif
+
+/**
+ * @brief   Time stamp used by the service latency statistics.
+ * @details Defaults to the system time, a port can map it to a finer free
+ *          running counter in its parameters header.
+ */
+#if !defined(CH_WQ_TIMESTAMP) || defined(__DOXYGEN__)
+#define CH_WQ_TIMESTAMP()               ((uint32_t)chTimeNow())
+#endif
+
+/**
+ * @brief   Work function type.
+ */
+typedef void (*wqfunc_t)(void *arg);
+
+/**
+ * @brief   Type of a work item.
+ */
+typedef struct WorkItem WorkItem;
+
+/**
+ * @brief   Structure representing a work item.
+ * @details Work items are allocated by their owner, usually statically next
+ *          to the driver they serve, so enqueuing never allocates or fails.
+ */
+struct WorkItem {
+  WorkItem              *wi_next;       /**< @brief Next queued item.       */
+  wqfunc_t              wi_func;        /**< @brief Work function.          */
+  void                  *wi_arg;        /**< @brief Work function argument. */
+  uint32_t              wi_stamp;       /**< @brief Enqueue time stamp.     */
+  bool_t                wi_pending;     /**< @brief Queued, not yet run.    */
+};
+
+/**
+ * @brief   Structure representing a work queue object.
+ */
+typedef struct {
+  WorkItem              *wq_head;       /**< @brief First queued item.      */
+  WorkItem              *wq_tail;       /**< @brief Last queued item.       */
+  Semaphore             wq_sem;         /**< @brief Queued items counter.   */
+  cnt_t                 wq_depth;       /**< @brief Items queued now.       */
+  cnt_t                 wq_maxdepth;    /**< @brief Highest queue depth.    */
+  uint32_t              wq_served;      /**< @brief Items run.              */
+  uint32_t              wq_coalesced;   /**< @brief Enqueues of an already
+                                                    pending item.           */
+  uint32_t              wq_maxlatency;  /**< @brief Longest enqueue to run
+                                                    time.                   */
+  uint64_t              wq_latency;     /**< @brief Sum of the enqueue to
+                                                    run times.              */
+} WorkQueue;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void chWQInit(WorkQueue *wqp);
+  void chWQItemInit(WorkItem *wip, wqfunc_t func, void *arg);
+  bool_t chWQEnqueueI(WorkQueue *wqp, WorkItem *wip);
+  bool_t chWQEnqueue(WorkQueue *wqp, WorkItem *wip);
+  msg_t chWQDispatch(WorkQueue *wqp, systime_t time);
+  msg_t chWQWorker(void *arg);
+  void chWQResetStatsI(WorkQueue *wqp);
+  void chWQResetStats(WorkQueue *wqp);
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @name    Macro Functions
+ * @{
+ */
+/**
+ * @brief   Returns the number of queued work items.
+ *
+ * @param[in] wqp       the pointer to an initialized WorkQueue object
+ *
+ * @iclass
+ */
+#define chWQGetDepthI(wqp) ((wqp)->wq_depth)
+
+/**
+ * @brief   Returns @p TRUE if the work item is queued and not yet run.
+ *
+ * @param[in] wip       the pointer to an initialized WorkItem object
+ *
+ * @iclass
+ */
+#define chWQIsPendingI(wip) ((wip)->wi_pending)
+/** @} */
+
+/**
+ * @brief   Data part of a static work item initializer.
+ *
+ * @param[in] func      the work function
+ * @param[in] arg       the work function argument
+ */
+#define _WORKITEM_DATA(func, arg) {NULL, (func), (arg), 0, FALSE}
+
+/**
+ * @brief   Static work item initializer.
+ *
+ * @param[in] name      the name of the work item variable
+ * @param[in] func      the work function
+ * @param[in] arg       the work function argument
+ */
+#define WORKITEM_DECL(name, func, arg)                                      \
+  WorkItem name = _WORKITEM_DATA(func, arg)
+
+/**
+ * @brief   Data part of a static work queue initializer.
+ *
+ * @param[in] name      the name of the work queue variable
+ */
+#define _WORKQUEUE_DATA(name) {                                             \
+  NULL,                                                                     \
+  NULL,                                                                     \
+  _SEMAPHORE_DATA(name.wq_sem, 0),                                          \
+  0, 0, 0, 0, 0, 0                                                          \
+}
+
+/**
+ * @brief   Static work queue initializer.
+ *
+ * @param[in] name      the name of the work queue variable
+ */
+#define WORKQUEUE_DECL(name) WorkQueue name = _WORKQUEUE_DATA(name)
+
+#endif /* CH_USE_WORKQUEUES */
+
+#endif /* _CHWQ_H_ */
+
+/** @} */
@@ -32,6 +32,9 @@
  *            priority.
  *          - <b>Fetch</b>: A message is fetched from the mailbox and removed
  *            from the queue.
+ *          - <b>Post N</b>, <b>Fetch N</b>: Batches of messages are moved
+ *            in a single critical section, waiting at most once and waking
+ *            up the other side once.
  *          - <b>Reset</b>: The mailbox is emptied and all the stored messages
  *            are lost.
  *          .
@@ -371,6 +374,235 @@ msg_t chMBFetchI(Mailbox *mbp, msg_t *msgp) {
   chSemSignalI(&mbp->mb_emptysem);
   return RDY_OK;
 }
+
+/*
+ * Copies messages into the buffer, the slots must be already reserved.
+ */
+static void mb_write(Mailbox *mbp, const msg_t *msgs, cnt_t n) {
+
+  while (n-- > 0) {
+    *mbp->mb_wrptr++ = *msgs++;
+    if (mbp->mb_wrptr >= mbp->mb_top)
+      mbp->mb_wrptr = mbp->mb_buffer;
+  }
+}
+
+/*
+ * Copies messages out of the buffer, the messages must be already reserved.
+ */
+static void mb_read(Mailbox *mbp, msg_t *msgs, cnt_t n) {
+
+  while (n-- > 0) {
+    *msgs++ = *mbp->mb_rdptr++;
+    if (mbp->mb_rdptr >= mbp->mb_top)
+      mbp->mb_rdptr = mbp->mb_buffer;
+  }
+}
+
+/*
+ * Reserves up to n units of a semaphore counter without waiting, returns
+ * the number of reserved units.
+ */
+static cnt_t mb_take(Semaphore *sp, cnt_t n) {
+  cnt_t k = chSemGetCounterI(sp);
+
+  if (k <= 0)
+    return 0;
+  if (k > n)
+    k = n;
+  sp->s_cnt -= k;
+  return k;
+}
+
+/**
+ * @brief   Posts a batch of messages into a mailbox.
+ * @details The invoking thread waits until at least one empty slot in the
+ *          mailbox becomes available or the specified time runs out, then
+ *          posts as many messages as there are empty slots, up to @p n, in
+ *          a single critical section and with a single reschedule.
+ *
+ * @param[in] mbp       the pointer to an initialized Mailbox object
+ * @param[in] msgs      the messages to be posted, in FIFO order
+ * @param[in] n         number of messages in @p msgs, greater than zero
+ * @param[in] time      the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of posted messages, zero if the mailbox
+ *                      has been reset while waiting or if the operation has
+ *                      timed out.
+ *
+ * @api
+ */
+cnt_t chMBPostN(Mailbox *mbp, const msg_t *msgs, cnt_t n, systime_t time) {
+  cnt_t k;
+
+  chSysLock();
+  k = chMBPostNS(mbp, msgs, n, time);
+  chSysUnlock();
+  return k;
+}
+
+/**
+ * @brief   Posts a batch of messages into a mailbox.
+ * @details The invoking thread waits until at least one empty slot in the
+ *          mailbox becomes available or the specified time runs out, then
+ *          posts as many messages as there are empty slots, up to @p n, in
+ *          a single critical section and with a single reschedule.
+ *
+ * @param[in] mbp       the pointer to an initialized Mailbox object
+ * @param[in] msgs      the messages to be posted, in FIFO order
+ * @param[in] n         number of messages in @p msgs, greater than zero
+ * @param[in] time      the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of posted messages, zero if the mailbox
+ *                      has been reset while waiting or if the operation has
+ *                      timed out.
+ *
+ * @sclass
+ */
+cnt_t chMBPostNS(Mailbox *mbp, const msg_t *msgs, cnt_t n, systime_t time) {
+  cnt_t k;
+
+  chDbgCheckClassS();
+  chDbgCheck((mbp != NULL) && (msgs != NULL) && (n > 0), "chMBPostNS");
+
+  if (chSemWaitTimeoutS(&mbp->mb_emptysem, time) != RDY_OK)
+    return 0;
+  /* One slot is owned, the others are taken only if already free.*/
+  k = mb_take(&mbp->mb_emptysem, n - 1) + 1;
+  mb_write(mbp, msgs, k);
+  chSemAddCounterI(&mbp->mb_fullsem, k);
+  chSchRescheduleS();
+  return k;
+}
+
+/**
+ * @brief   Posts a batch of messages into a mailbox.
+ * @details This variant is non-blocking, it posts as many messages as there
+ *          are empty slots, up to @p n.
+ *
+ * @param[in] mbp       the pointer to an initialized Mailbox object
+ * @param[in] msgs      the messages to be posted, in FIFO order
+ * @param[in] n         number of messages in @p msgs, greater than zero
+ * @return              The number of posted messages, zero if the mailbox
+ *                      is full.
+ *
+ * @iclass
+ */
+cnt_t chMBPostNI(Mailbox *mbp, const msg_t *msgs, cnt_t n) {
+  cnt_t k;
+
+  chDbgCheckClassI();
+  chDbgCheck((mbp != NULL) && (msgs != NULL) && (n > 0), "chMBPostNI");
+
+  k = mb_take(&mbp->mb_emptysem, n);
+  if (k > 0) {
+    mb_write(mbp, msgs, k);
+    chSemAddCounterI(&mbp->mb_fullsem, k);
+  }
+  return k;
+}
+
+/**
+ * @brief   Retrieves a batch of messages from a mailbox.
+ * @details The invoking thread waits until at least one message is posted in
+ *          the mailbox or the specified time runs out, then fetches all the
+ *          queued messages, up to @p n, in a single critical section and
+ *          with a single reschedule. A buffer of @p chMBSizeI() messages
+ *          always receives everything queued.
+ *
+ * @param[in] mbp       the pointer to an initialized Mailbox object
+ * @param[out] msgs     buffer for the received messages, in FIFO order
+ * @param[in] n         size of @p msgs in messages, greater than zero
+ * @param[in] time      the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of fetched messages, zero if the mailbox
+ *                      has been reset while waiting or if the operation has
+ *                      timed out.
+ *
+ * @api
+ */
+cnt_t chMBFetchN(Mailbox *mbp, msg_t *msgs, cnt_t n, systime_t time) {
+  cnt_t k;
+
+  chSysLock();
+  k = chMBFetchNS(mbp, msgs, n, time);
+  chSysUnlock();
+  return k;
+}
+
+/**
+ * @brief   Retrieves a batch of messages from a mailbox.
+ * @details The invoking thread waits until at least one message is posted in
+ *          the mailbox or the specified time runs out, then fetches all the
+ *          queued messages, up to @p n, in a single critical section and
+ *          with a single reschedule. A buffer of @p chMBSizeI() messages
+ *          always receives everything queued.
+ *
+ * @param[in] mbp       the pointer to an initialized Mailbox object
+ * @param[out] msgs     buffer for the received messages, in FIFO order
+ * @param[in] n         size of @p msgs in messages, greater than zero
+ * @param[in] time      the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of fetched messages, zero if the mailbox
+ *                      has been reset while waiting or if the operation has
+ *                      timed out.
+ *
+ * @sclass
+ */
+cnt_t chMBFetchNS(Mailbox *mbp, msg_t *msgs, cnt_t n, systime_t time) {
+  cnt_t k;
+
+  chDbgCheckClassS();
+  chDbgCheck((mbp != NULL) && (msgs != NULL) && (n > 0), "chMBFetchNS");
+
+  if (chSemWaitTimeoutS(&mbp->mb_fullsem, time) != RDY_OK)
+    return 0;
+  /* One message is owned, the others are taken only if already queued.*/
+  k = mb_take(&mbp->mb_fullsem, n - 1) + 1;
+  mb_read(mbp, msgs, k);
+  chSemAddCounterI(&mbp->mb_emptysem, k);
+  chSchRescheduleS();
+  return k;
+}
+
+/**
+ * @brief   Retrieves a batch of messages from a mailbox.
+ * @details This variant is non-blocking, it fetches all the queued messages,
+ *          up to @p n.
+ *
+ * @param[in] mbp       the pointer to an initialized Mailbox object
+ * @param[out] msgs     buffer for the received messages, in FIFO order
+ * @param[in] n         size of @p msgs in messages, greater than zero
+ * @return              The number of fetched messages, zero if the mailbox
+ *                      is empty.
+ *
+ * @iclass
+ */
+cnt_t chMBFetchNI(Mailbox *mbp, msg_t *msgs, cnt_t n) {
+  cnt_t k;
+
+  chDbgCheckClassI();
+  chDbgCheck((mbp != NULL) && (msgs != NULL) && (n > 0), "chMBFetchNI");
+
+  k = mb_take(&mbp->mb_fullsem, n);
+  if (k > 0) {
+    mb_read(mbp, msgs, k);
+    chSemAddCounterI(&mbp->mb_emptysem, k);
+  }
+  return k;
+}
 #endif /* CH_USE_MAILBOXES */
 
 /** @} */
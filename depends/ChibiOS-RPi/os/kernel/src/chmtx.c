@@ -126,6 +126,8 @@ void chMtxLockS(Mutex *mp) {
     /* Does the running thread have higher priority than the mutex
        owning thread? */
     while (tp->p_prio < ctp->p_prio) {
+      tprio_t prio = tp->p_prio;
+
       /* Make priority of thread tp match the running thread's priority.*/
       tp->p_prio = ctp->p_prio;
       /* The following states need priority queues reordering.*/
@@ -157,7 +159,7 @@ void chMtxLockS(Mutex *mp) {
         tp->p_state = THD_STATE_CURRENT;
 #endif
         /* Re-enqueues tp with its new priority on the ready list.*/
-        chSchReadyI(dequeue(tp));
+        chSchReadyI(chSchReadyRemoveI(tp, prio));
         break;
       }
       break;
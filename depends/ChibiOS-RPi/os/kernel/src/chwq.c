@@ -0,0 +1,262 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    chwq.c
+ * @brief   Work queues code.
+ *
+ * @addtogroup work_queues
+ * @details Deferred work, interrupt bottom halves.
+ *          <h2>Operation mode</h2>
+ *          An interrupt handler (top half) does the minimum the hardware
+ *          requires and enqueues a work item, a function and its argument.
+ *          One or more worker threads, at the priority chosen for the
+ *          queue, run the queued items in FIFO order.
+ *          - Work items are preallocated by their owners, enqueuing is an
+ *            I-class O(1) operation that cannot fail.
+ *          - Enqueuing an item that is still pending does not queue it
+ *            twice, the request is merged into the pending one and counted
+ *            in @p wq_coalesced. An item can be enqueued again as soon as
+ *            its function starts running.
+ *          - Different urgency classes use separate queues, each with its
+ *            own workers.
+ *          .
+ *          The queue keeps its current and highest depth and the latency
+ *          between enqueue and the start of each item, measured with
+ *          @p CH_WQ_TIMESTAMP().
+ * @pre     In order to use the work queue APIs the @p CH_USE_WORKQUEUES
+ *          option must be enabled in @p chconf.h.
+ * @{
+ */
+
+#include "ch.h"
+
+#if CH_USE_WORKQUEUES || defined(__DOXYGEN__)
+/**
+ * @brief   Initializes a WorkQueue object.
+ *
+ * @param[out] wqp      the pointer to the WorkQueue structure to be
+ *                      initialized
+ *
+ * @init
+ */
+void chWQInit(WorkQueue *wqp) {
+
+  chDbgCheck(wqp != NULL, "chWQInit");
+
+  wqp->wq_head = wqp->wq_tail = NULL;
+  chSemInit(&wqp->wq_sem, 0);
+  wqp->wq_depth = wqp->wq_maxdepth = 0;
+  wqp->wq_served = wqp->wq_coalesced = wqp->wq_maxlatency = 0;
+  wqp->wq_latency = 0;
+}
+
+/**
+ * @brief   Initializes a WorkItem object.
+ *
+ * @param[out] wip      the pointer to the WorkItem structure to be
+ *                      initialized
+ * @param[in] func      the work function
+ * @param[in] arg       the work function argument
+ *
+ * @init
+ */
+void chWQItemInit(WorkItem *wip, wqfunc_t func, void *arg) {
+
+  chDbgCheck((wip != NULL) && (func != NULL), "chWQItemInit");
+
+  wip->wi_next = NULL;
+  wip->wi_func = func;
+  wip->wi_arg = arg;
+  wip->wi_stamp = 0;
+  wip->wi_pending = FALSE;
+}
+
+/**
+ * @brief   Enqueues a work item.
+ * @details The item is appended to the queue and a worker is made ready,
+ *          no reschedule is performed.
+ *
+ * @param[in] wqp       the pointer to an initialized WorkQueue object
+ * @param[in] wip       the pointer to an initialized WorkItem object
+ * @return              The operation status.
+ * @retval TRUE         if the item has been queued.
+ * @retval FALSE        if the item was already pending, the request has been
+ *                      merged into it.
+ *
+ * @iclass
+ */
+bool_t chWQEnqueueI(WorkQueue *wqp, WorkItem *wip) {
+
+  chDbgCheckClassI();
+  chDbgCheck((wqp != NULL) && (wip != NULL), "chWQEnqueueI");
+
+  if (wip->wi_pending) {
+    wqp->wq_coalesced++;
+    return FALSE;
+  }
+  wip->wi_pending = TRUE;
+  wip->wi_next = NULL;
+  wip->wi_stamp = CH_WQ_TIMESTAMP();
+  if (wqp->wq_tail != NULL)
+    wqp->wq_tail->wi_next = wip;
+  else
+    wqp->wq_head = wip;
+  wqp->wq_tail = wip;
+  if (++wqp->wq_depth > wqp->wq_maxdepth)
+    wqp->wq_maxdepth = wqp->wq_depth;
+  chSemSignalI(&wqp->wq_sem);
+  return TRUE;
+}
+
+/**
+ * @brief   Enqueues a work item.
+ *
+ * @param[in] wqp       the pointer to an initialized WorkQueue object
+ * @param[in] wip       the pointer to an initialized WorkItem object
+ * @return              The operation status.
+ * @retval TRUE         if the item has been queued.
+ * @retval FALSE        if the item was already pending.
+ *
+ * @api
+ */
+bool_t chWQEnqueue(WorkQueue *wqp, WorkItem *wip) {
+  bool_t queued;
+
+  chSysLock();
+  queued = chWQEnqueueI(wqp, wip);
+  chSchRescheduleS();
+  chSysUnlock();
+  return queued;
+}
+
+/**
+ * @brief   Waits for a work item and runs it.
+ * @details This is the body of a worker thread, it can also be called by an
+ *          application thread that serves a queue among other duties.
+ *
+ * @param[in] wqp       the pointer to an initialized WorkQueue object
+ * @param[in] time      the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The operation status.
+ * @retval RDY_OK       if a work item has been run.
+ * @retval RDY_RESET    if the queue semaphore has been reset.
+ * @retval RDY_TIMEOUT  if the operation has timed out.
+ *
+ * @api
+ */
+msg_t chWQDispatch(WorkQueue *wqp, systime_t time) {
+  WorkItem *wip;
+  wqfunc_t func;
+  void *arg;
+  uint32_t latency;
+  msg_t rdymsg;
+
+  chDbgCheck(wqp != NULL, "chWQDispatch");
+
+  chSysLock();
+  rdymsg = chSemWaitTimeoutS(&wqp->wq_sem, time);
+  if (rdymsg != RDY_OK) {
+    chSysUnlock();
+    return rdymsg;
+  }
+  wip = wqp->wq_head;
+  chDbgAssert(wip != NULL, "chWQDispatch(), #1", "queue empty");
+  if ((wqp->wq_head = wip->wi_next) == NULL)
+    wqp->wq_tail = NULL;
+  wqp->wq_depth--;
+  wip->wi_pending = FALSE;
+  latency = CH_WQ_TIMESTAMP() - wip->wi_stamp;
+  if (latency > wqp->wq_maxlatency)
+    wqp->wq_maxlatency = latency;
+  wqp->wq_latency += latency;
+  wqp->wq_served++;
+  func = wip->wi_func;
+  arg = wip->wi_arg;
+  chSysUnlock();
+
+  func(arg);
+  return RDY_OK;
+}
+
+/**
+ * @brief   Worker thread function.
+ * @details Serves the queue passed as argument forever. Create one or more
+ *          workers per queue, the queue urgency is the workers priority:
+ *          @code
+ *            chThdCreateStatic(waWorker, sizeof(waWorker), HIGHPRIO - 2,
+ *                              chWQWorker, &wq);
+ *          @endcode
+ *
+ * @param[in] arg       the pointer to an initialized WorkQueue object
+ * @return              Never returns.
+ */
+msg_t chWQWorker(void *arg) {
+  WorkQueue *wqp = arg;
+
+  chRegSetThreadName("worker");
+  while (TRUE)
+    chWQDispatch(wqp, TIME_INFINITE);
+  return 0;
+}
+
+/**
+ * @brief   Clears the queue statistics.
+ * @details The current depth is kept, the highest depth restarts from it.
+ *          Called in the critical zone that copies the statistics, no
+ *          count is lost in between.
+ *
+ * @param[in] wqp       the pointer to an initialized WorkQueue object
+ *
+ * @iclass
+ */
+void chWQResetStatsI(WorkQueue *wqp) {
+
+  chDbgCheckClassI();
+  chDbgCheck(wqp != NULL, "chWQResetStatsI");
+
+  wqp->wq_maxdepth = wqp->wq_depth;
+  wqp->wq_served = 0;
+  wqp->wq_coalesced = 0;
+  wqp->wq_maxlatency = 0;
+  wqp->wq_latency = 0;
+}
+
+/**
+ * @brief   Clears the queue statistics.
+ * @details The current depth is kept, the highest depth restarts from it.
+ *
+ * @param[in] wqp       the pointer to an initialized WorkQueue object
+ *
+ * @api
+ */
+void chWQResetStats(WorkQueue *wqp) {
+
+  chSysLock();
+  chWQResetStatsI(wqp);
+  chSysUnlock();
+}
+
+#endif /* CH_USE_WORKQUEUES */
+
+/** @} */
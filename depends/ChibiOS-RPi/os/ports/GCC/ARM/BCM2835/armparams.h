@@ -32,6 +32,8 @@
 #ifndef _ARMPARAMS_H_
 #define _ARMPARAMS_H_
 
+#include "bcm2835.h"
+
 /**
  * @brief   ARM core model.
  */
@@ -43,6 +45,15 @@
 #define port_wait_for_interrupt() {                               \
   asm volatile ("MCR p15,0,r0,c7,c0,4" : : : "memory");           \
 }
+
+/**
+ * @brief   Work queue latency time stamp.
+ * @details The free running 1MHz system timer, the work queue latency
+ *          statistics are in microseconds.
+ */
+#if !defined(CH_WQ_TIMESTAMP) || defined(__DOXYGEN__)
+#define CH_WQ_TIMESTAMP()       SYSTIMER_CLO
+#endif
   
 #endif /* _ARMPARAMS_H_ */
 
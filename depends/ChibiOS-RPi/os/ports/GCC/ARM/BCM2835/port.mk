@@ -1,11 +1,14 @@
 # List of the ChibiOS/RT ARM7 BCM2835 port files.
-PORTSRC = ${CHIBIOS}/os/ports/GCC/ARM/chcore.c
+PORTSRC = ${CHIBIOS}/os/ports/GCC/ARM/chcore.c \
+          ${CHIBIOS}/os/ports/common/chrlbitmap.c
 
 PORTASM = ${CHIBIOS}/os/ports/GCC/ARM/crt0.s \
           ${CHIBIOS}/os/ports/GCC/ARM/chcoreasm.s \
+          ${CHIBIOS}/os/ports/GCC/ARM/armmem.s \
           ${CHIBIOS}/os/ports/GCC/ARM/BCM2835/vectors.s
 
 PORTINC = ${CHIBIOS}/os/ports/GCC/ARM \
-          ${CHIBIOS}/os/ports/GCC/ARM/BCM2835
+          ${CHIBIOS}/os/ports/GCC/ARM/BCM2835 \
+          ${CHIBIOS}/os/ports/common
 
 PORTLD  = ${CHIBIOS}/os/ports/GCC/ARM/BCM2835/ld
@@ -0,0 +1,321 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    ARM/armmem.s
+ * @brief   ARMv6 memory and string routines.
+ * @details Replacements for the C library @p memcpy(), @p memmove(),
+ *          @p memset() and @p strlen(), linked ahead of it. Bytes are
+ *          moved up to an aligned destination, then aligned words in
+ *          32 byte LDM/STM bursts with @p PLD two bursts ahead. A source
+ *          not aligned like the destination is read by aligned words and
+ *          merged by shifts, 16 bytes at a time, as unaligned loads rotate
+ *          on this core unless CP15 enables them. The remaining bytes
+ *          close the copy. os/various/memops.c is the same code in C,
+ *          tested by demos/Posix-MEMOPS.
+ * @note    @p PLD requires ARMv5TE, the port lists this file for the
+ *          BCM2835 only.
+ *
+ * @addtogroup ARM_CORE
+ * @{
+ */
+
+#if !defined(__DOXYGEN__)
+
+.text
+.code 32
+
+/*
+ * void *memcpy(void *dst, const void *src, size_t n)
+ * r0 is kept for the return value, r12 is the destination pointer.
+ */
+.balign 16
+.global memcpy
+.type memcpy, %function
+memcpy:
+.Lcpy:
+        mov     r12, r0
+        cmp     r2, #8
+        blo     .Lcpy_short
+        stmfd   sp!, {r4-r10, lr}
+        ands    r3, r12, #3                     // Bytes up to an aligned
+        beq     .Lcpy_dst_aligned               // destination.
+        rsb     r3, r3, #4
+        sub     r2, r2, r3
+.Lcpy_head:
+        ldrb    r4, [r1], #1
+        subs    r3, r3, #1
+        strb    r4, [r12], #1
+        bne     .Lcpy_head
+.Lcpy_dst_aligned:
+        ands    r3, r1, #3
+        bne     .Lcpy_shifted
+        subs    r2, r2, #32
+        blo     .Lcpy_words
+.Lcpy_burst:
+        pld     [r1, #64]
+        ldmia   r1!, {r3-r10}
+        subs    r2, r2, #32
+        stmia   r12!, {r3-r10}
+        bhs     .Lcpy_burst
+.Lcpy_words:
+        adds    r2, r2, #32 - 4
+        blo     .Lcpy_tail
+.Lcpy_word:
+        ldr     r3, [r1], #4
+        subs    r2, r2, #4
+        str     r3, [r12], #4
+        bhs     .Lcpy_word
+.Lcpy_tail:
+        adds    r2, r2, #4
+        beq     .Lcpy_done
+.Lcpy_tail_byte:
+        ldrb    r3, [r1], #1
+        subs    r2, r2, #1
+        strb    r3, [r12], #1
+        bne     .Lcpy_tail_byte
+.Lcpy_done:
+        ldmfd   sp!, {r4-r10, pc}
+
+        /* Source off by r3 bytes: r4 holds the last aligned word read,
+           r8 and r9 are the shifts merging it with the next one.*/
+.Lcpy_shifted:
+        bic     r1, r1, #3
+        mov     r8, r3, lsl #3
+        rsb     r9, r8, #32
+        ldr     r4, [r1], #4
+        subs    r2, r2, #16
+        blo     .Lcpy_shifted_words
+.Lcpy_shifted_burst:
+        pld     [r1, #64]
+        ldmia   r1!, {r5-r7, r10}
+        mov     r4, r4, lsr r8
+        orr     r4, r4, r5, lsl r9
+        mov     r5, r5, lsr r8
+        orr     r5, r5, r6, lsl r9
+        mov     r6, r6, lsr r8
+        orr     r6, r6, r7, lsl r9
+        mov     r7, r7, lsr r8
+        orr     r7, r7, r10, lsl r9
+        stmia   r12!, {r4-r7}
+        mov     r4, r10
+        subs    r2, r2, #16
+        bhs     .Lcpy_shifted_burst
+.Lcpy_shifted_words:
+        adds    r2, r2, #16 - 4
+        blo     .Lcpy_shifted_end
+.Lcpy_shifted_word:
+        ldr     r5, [r1], #4
+        mov     r4, r4, lsr r8
+        orr     r4, r4, r5, lsl r9
+        str     r4, [r12], #4
+        mov     r4, r5
+        subs    r2, r2, #4
+        bhs     .Lcpy_shifted_word
+.Lcpy_shifted_end:
+        sub     r1, r1, #4                      // Back to the first byte
+        add     r1, r1, r3                      // not copied yet.
+        b       .Lcpy_tail
+
+.Lcpy_short:
+        cmp     r2, #0
+        bxeq    lr
+.Lcpy_short_byte:
+        ldrb    r3, [r1], #1
+        subs    r2, r2, #1
+        strb    r3, [r12], #1
+        bne     .Lcpy_short_byte
+        bx      lr
+.size memcpy, . - memcpy
+
+/*
+ * void *memmove(void *dst, const void *src, size_t n)
+ * A destination below the source or past its end is a forward copy,
+ * otherwise the copy runs backwards from the ends, r1 and r12. Sources
+ * not aligned like the destination are moved by bytes.
+ */
+.balign 16
+.global memmove
+.type memmove, %function
+memmove:
+        sub     r3, r0, r1
+        cmp     r3, r2
+        bhs     .Lcpy
+        add     r1, r1, r2
+        add     r12, r0, r2
+        cmp     r2, #8
+        blo     .Lmove_short
+        stmfd   sp!, {r4-r10, lr}
+        ands    r3, r12, #3
+        beq     .Lmove_dst_aligned
+        sub     r2, r2, r3
+.Lmove_head:
+        ldrb    r4, [r1, #-1]!
+        subs    r3, r3, #1
+        strb    r4, [r12, #-1]!
+        bne     .Lmove_head
+.Lmove_dst_aligned:
+        tst     r1, #3
+        bne     .Lmove_tail_bytes
+        subs    r2, r2, #32
+        blo     .Lmove_words
+.Lmove_burst:
+        pld     [r1, #-64]
+        ldmdb   r1!, {r3-r10}
+        subs    r2, r2, #32
+        stmdb   r12!, {r3-r10}
+        bhs     .Lmove_burst
+.Lmove_words:
+        adds    r2, r2, #32 - 4
+        blo     .Lmove_tail
+.Lmove_word:
+        ldr     r3, [r1, #-4]!
+        subs    r2, r2, #4
+        str     r3, [r12, #-4]!
+        bhs     .Lmove_word
+.Lmove_tail:
+        add     r2, r2, #4
+.Lmove_tail_bytes:
+        cmp     r2, #0
+        beq     .Lmove_done
+.Lmove_tail_byte:
+        ldrb    r3, [r1, #-1]!
+        subs    r2, r2, #1
+        strb    r3, [r12, #-1]!
+        bne     .Lmove_tail_byte
+.Lmove_done:
+        ldmfd   sp!, {r4-r10, pc}
+
+.Lmove_short:
+        cmp     r2, #0
+        bxeq    lr
+.Lmove_short_byte:
+        ldrb    r3, [r1, #-1]!
+        subs    r2, r2, #1
+        strb    r3, [r12, #-1]!
+        bne     .Lmove_short_byte
+        bx      lr
+.size memmove, . - memmove
+
+/*
+ * void *memset(void *dst, int c, size_t n)
+ * r1 becomes the byte replicated in a word.
+ */
+.balign 16
+.global memset
+.type memset, %function
+memset:
+        mov     r12, r0
+        cmp     r2, #8
+        blo     .Lset_tail
+        and     r1, r1, #0xFF
+        orr     r1, r1, r1, lsl #8
+        orr     r1, r1, r1, lsl #16
+        ands    r3, r12, #3
+        beq     .Lset_dst_aligned
+        rsb     r3, r3, #4
+        sub     r2, r2, r3
+.Lset_head:
+        strb    r1, [r12], #1
+        subs    r3, r3, #1
+        bne     .Lset_head
+.Lset_dst_aligned:
+        subs    r2, r2, #32
+        blo     .Lset_words
+        stmfd   sp!, {r4-r8, lr}
+        mov     r3, r1
+        mov     r4, r1
+        mov     r5, r1
+        mov     r6, r1
+        mov     r7, r1
+        mov     r8, r1
+        mov     lr, r1
+.Lset_burst:
+        stmia   r12!, {r1, r3-r8, lr}
+        subs    r2, r2, #32
+        bhs     .Lset_burst
+        ldmfd   sp!, {r4-r8, lr}
+.Lset_words:
+        adds    r2, r2, #32 - 4
+        blo     .Lset_words_end
+.Lset_word:
+        str     r1, [r12], #4
+        subs    r2, r2, #4
+        bhs     .Lset_word
+.Lset_words_end:
+        add     r2, r2, #4
+.Lset_tail:
+        cmp     r2, #0
+        bxeq    lr
+.Lset_tail_byte:
+        strb    r1, [r12], #1
+        subs    r2, r2, #1
+        bne     .Lset_tail_byte
+        bx      lr
+.size memset, . - memset
+
+/*
+ * size_t strlen(const char *s)
+ * Aligned words are scanned for a zero byte: (w - 0x01010101) & ~w has the
+ * top bit of a byte set only if w holds one. The reads never cross the
+ * word holding the terminator.
+ */
+.balign 16
+.global strlen
+.type strlen, %function
+strlen:
+        mov     r1, r0
+.Lstrlen_head:
+        tst     r1, #3
+        beq     .Lstrlen_aligned
+        ldrb    r2, [r1], #1
+        cmp     r2, #0
+        bne     .Lstrlen_head
+        sub     r0, r1, r0
+        sub     r0, r0, #1
+        bx      lr
+.Lstrlen_aligned:
+        mov     r12, #0x01
+        orr     r12, r12, r12, lsl #8
+        orr     r12, r12, r12, lsl #16
+.Lstrlen_word:
+        ldr     r2, [r1], #4
+        sub     r3, r2, r12
+        bic     r3, r3, r2
+        tst     r3, r12, lsl #7
+        beq     .Lstrlen_word
+        sub     r1, r1, #4                      // First zero byte of the
+        tst     r2, #0xFF                       // word, little endian.
+        beq     .Lstrlen_end
+        add     r1, r1, #1
+        tst     r2, #0xFF00
+        beq     .Lstrlen_end
+        add     r1, r1, #1
+        tst     r2, #0xFF0000
+        beq     .Lstrlen_end
+        add     r1, r1, #1
+.Lstrlen_end:
+        sub     r0, r1, r0
+        bx      lr
+.size strlen, . - strlen
+
+#endif /* !defined(__DOXYGEN__) */
+
+/** @} */
@@ -243,6 +243,19 @@ struct context {
 #define PORT_INT_REQUIRED_STACK         0x10
 #endif
 
+/**
+ * @brief   Enables the priority bitmap ready list.
+ * @details Thread wakeups become O(1) instead of linear in the number of
+ *          ready threads, at the cost of about 1KB for the ready list
+ *          header.
+ * @note    The bitmap is searched with CLZ, an ARM state instruction on
+ *          ARMv5 and later. In pure THUMB mode the compiler falls back to
+ *          a library call.
+ */
+#if !defined(ARM_USE_READYLIST_BITMAP) || defined(__DOXYGEN__)
+#define ARM_USE_READYLIST_BITMAP        FALSE
+#endif
+
 /**
  * @brief   Enforces a correct alignment for a stack area size value.
  */
@@ -478,6 +491,15 @@ extern "C" {
 }
 #endif
 
+#if ARM_USE_READYLIST_BITMAP || defined(__DOXYGEN__)
+/**
+ * @brief   Counts the leading zeros of a non-zero word.
+ */
+#define port_clz(w) __builtin_clz(w)
+
+#include "chrlbitmap.h"
+#endif /* ARM_USE_READYLIST_BITMAP */
+
 #endif /* _CHCORE_H_ */
 
 /** @} */
@@ -143,6 +143,15 @@ struct context {
 #define PORT_INT_REQUIRED_STACK         16384
 #endif
 
+/**
+ * @brief   Enables the priority bitmap ready list.
+ * @details Thread wakeups become O(1) instead of linear in the number of
+ *          ready threads.
+ */
+#if !defined(SIMIA32_USE_READYLIST_BITMAP) || defined(__DOXYGEN__)
+#define SIMIA32_USE_READYLIST_BITMAP    FALSE
+#endif
+
 /**
  * Enforces a correct alignment for a stack area size value.
  */
@@ -238,6 +247,15 @@ extern "C" {
 }
 #endif
 
+#if SIMIA32_USE_READYLIST_BITMAP || defined(__DOXYGEN__)
+/**
+ * @brief   Counts the leading zeros of a non-zero word.
+ */
+#define port_clz(w) __builtin_clz(w)
+
+#include "chrlbitmap.h"
+#endif /* SIMIA32_USE_READYLIST_BITMAP */
+
 #endif /* _CHCORE_H_ */
 
 /** @} */
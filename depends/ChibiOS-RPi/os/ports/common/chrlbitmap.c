@@ -0,0 +1,235 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    common/chrlbitmap.c
+ * @brief   Priority bitmap ready list code.
+ * @note    The bitmaps rely on the ready list header being zeroed at
+ *          startup, as any other variable in the .bss section.
+ *
+ * @addtogroup scheduler
+ * @{
+ */
+
+#include "ch.h"
+
+#if defined(PORT_OPTIMIZED_READYREMOVEI) || defined(__DOXYGEN__)
+
+#if HIGHPRIO >= RLBM_LEVELS
+#error "HIGHPRIO exceeds the priority levels covered by the bitmap"
+#endif
+
+/*
+ * Index of the lowest set bit of a non-zero word.
+ */
+#define lowbit(w) (31 - port_clz((w) & -(w)))
+
+/*
+ * Returns the last thread of the lowest non-empty level at or above
+ * prio, the queue header if all those levels are empty. A thread
+ * inserted after it is behind all threads with higher or equal priority.
+ */
+static Thread *level_tail(tprio_t prio) {
+  uint32_t i, w;
+
+  if (prio >= RLBM_LEVELS)
+    return (Thread *)&rlist.r_queue;
+  i = prio >> 5;
+  w = rlist.r_bitmap[i] & (0xFFFFFFFFU << (prio & 31));
+  if (w == 0) {
+    w = rlist.r_summary & (0xFFFFFFFEU << i);
+    if (w == 0)
+      return (Thread *)&rlist.r_queue;
+    i = lowbit(w);
+    w = rlist.r_bitmap[i];
+  }
+  return rlist.r_tail[(i << 5) + lowbit(w)];
+}
+
+#define level_is_set(prio)                                                  \
+  (rlist.r_bitmap[(prio) >> 5] & (1U << ((prio) & 31)))
+
+static void level_set(tprio_t prio) {
+
+  rlist.r_bitmap[prio >> 5] |= 1U << (prio & 31);
+  rlist.r_summary |= 1U << (prio >> 5);
+}
+
+static void level_clear(tprio_t prio) {
+
+  if ((rlist.r_bitmap[prio >> 5] &= ~(1U << (prio & 31))) == 0)
+    rlist.r_summary &= ~(1U << (prio >> 5));
+}
+
+/*
+ * Links tp into the ready list after cp.
+ */
+static void insert_after(Thread *tp, Thread *cp) {
+
+  tp->p_prev = cp;
+  tp->p_next = cp->p_next;
+  tp->p_next->p_prev = cp->p_next = tp;
+}
+
+/*
+ * Removes the first thread of the ready list.
+ */
+static Thread *fetch(void) {
+  Thread *tp = fifo_remove(&rlist.r_queue);
+
+  if (rlist.r_tail[tp->p_prio] == tp)
+    level_clear(tp->p_prio);
+  return tp;
+}
+
+/**
+ * @brief   Inserts a thread in the Ready List.
+ * @details The thread is positioned behind all threads with higher or equal
+ *          priority.
+ * @pre     The thread must not be already inserted in any list through its
+ *          @p p_next and @p p_prev or list corruption would occur.
+ * @post    This function does not reschedule so a call to a rescheduling
+ *          function must be performed before unlocking the kernel. Note that
+ *          interrupt handlers always reschedule on exit so an explicit
+ *          reschedule must not be performed in ISRs.
+ *
+ * @param[in] tp        the thread to be made ready
+ * @return              The thread pointer.
+ *
+ * @iclass
+ */
+Thread *chSchReadyI(Thread *tp) {
+  tprio_t prio = tp->p_prio;
+
+  chDbgCheckClassI();
+
+  /* Integrity checks.*/
+  chDbgAssert((tp->p_state != THD_STATE_READY) &&
+              (tp->p_state != THD_STATE_FINAL),
+              "chSchReadyI(), #1",
+              "invalid state");
+
+  tp->p_state = THD_STATE_READY;
+  insert_after(tp, level_tail(prio));
+  level_set(prio);
+  rlist.r_tail[prio] = tp;
+  return tp;
+}
+
+/**
+ * @brief   Removes a ready thread from the Ready List.
+ *
+ * @param[in] tp        the thread to be removed
+ * @param[in] prio      the priority @p tp was inserted with
+ * @return              The thread pointer.
+ *
+ * @iclass
+ */
+Thread *chSchReadyRemoveI(Thread *tp, tprio_t prio) {
+
+  chDbgCheckClassI();
+
+  if (rlist.r_tail[prio] == tp) {
+    /* The queue header has priority zero so it never matches.*/
+    if (tp->p_prev->p_prio == prio)
+      rlist.r_tail[prio] = tp->p_prev;
+    else
+      level_clear(prio);
+  }
+  return dequeue(tp);
+}
+
+/**
+ * @brief   Puts the current thread to sleep into the specified state.
+ * @details The thread goes into a sleeping state. The possible
+ *          @ref thread_states are defined into @p threads.h.
+ *
+ * @param[in] newstate  the new thread state
+ *
+ * @sclass
+ */
+void chSchGoSleepS(tstate_t newstate) {
+  Thread *otp;
+
+  chDbgCheckClassS();
+
+  (otp = currp)->p_state = newstate;
+#if CH_TIME_QUANTUM > 0
+  /* The thread is renouncing its remaining time slices so it will have a new
+     time quantum when it will wakeup.*/
+  otp->p_preempt = CH_TIME_QUANTUM;
+#endif
+  setcurrp(fetch());
+  currp->p_state = THD_STATE_CURRENT;
+  chSysSwitch(currp, otp);
+}
+
+/**
+ * @brief   Switches to the first thread on the runnable queue.
+ * @details The current thread is positioned in the ready list behind all
+ *          threads having the same priority. The thread regains its time
+ *          quantum.
+ *
+ * @special
+ */
+void chSchDoRescheduleBehind(void) {
+  Thread *otp;
+
+  otp = currp;
+  /* Picks the first thread from the ready queue and makes it current.*/
+  setcurrp(fetch());
+  currp->p_state = THD_STATE_CURRENT;
+#if CH_TIME_QUANTUM > 0
+  otp->p_preempt = CH_TIME_QUANTUM;
+#endif
+  chSchReadyI(otp);
+  chSysSwitch(currp, otp);
+}
+
+/**
+ * @brief   Switches to the first thread on the runnable queue.
+ * @details The current thread is positioned in the ready list ahead of all
+ *          threads having the same priority.
+ *
+ * @special
+ */
+void chSchDoRescheduleAhead(void) {
+  Thread *otp;
+  tprio_t prio;
+
+  otp = currp;
+  /* Picks the first thread from the ready queue and makes it current.*/
+  setcurrp(fetch());
+  currp->p_state = THD_STATE_CURRENT;
+
+  otp->p_state = THD_STATE_READY;
+  prio = otp->p_prio;
+  insert_after(otp, level_tail(prio + 1));
+  if (!level_is_set(prio)) {
+    level_set(prio);
+    rlist.r_tail[prio] = otp;
+  }
+
+  chSysSwitch(currp, otp);
+}
+
+#endif /* defined(PORT_OPTIMIZED_READYREMOVEI) */
+
+/** @} */
@@ -0,0 +1,95 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    common/chrlbitmap.h
+ * @brief   Priority bitmap ready list.
+ * @details Optional replacement of the ready list management, included at
+ *          the end of the port @p chcore.h. The ready list keeps its single
+ *          queue ordered by priority, so everything reading it stays valid,
+ *          but each priority level is a FIFO segment of the queue whose last
+ *          thread is recorded in @p r_tail. A two level bitmap marks the
+ *          non-empty levels, the insertion point of a thread is found with
+ *          two count leading zeros operations instead of walking the queue,
+ *          making wakeups O(1) whatever the number of ready threads.
+ * @pre     The port must define @p port_clz() before including this file.
+ *
+ * @addtogroup scheduler
+ * @{
+ */
+
+#ifndef _CHRLBITMAP_H_
+#define _CHRLBITMAP_H_
+
+/**
+ * @brief   Priority levels covered by the bitmap.
+ */
+#define RLBM_LEVELS                     256
+
+#define PORT_OPTIMIZED_READYLIST_STRUCT
+#define PORT_OPTIMIZED_READYI
+#define PORT_OPTIMIZED_GOSLEEPS
+#define PORT_OPTIMIZED_DORESCHEDULEBEHIND
+#define PORT_OPTIMIZED_DORESCHEDULEAHEAD
+#define PORT_OPTIMIZED_READYREMOVEI
+
+/**
+ * @extends ThreadsQueue
+ *
+ * @brief   Ready list header.
+ */
+typedef struct {
+  ThreadsQueue          r_queue;    /**< @brief Threads queue.              */
+  tprio_t               r_prio;     /**< @brief This field must be
+                                                initialized to zero.        */
+  struct context        r_ctx;      /**< @brief Not used, present because
+                                                offsets.                    */
+#if CH_USE_REGISTRY || defined(__DOXYGEN__)
+  Thread                *r_newer;   /**< @brief Newer registry element.     */
+  Thread                *r_older;   /**< @brief Older registry element.     */
+#endif
+  /* End of the fields shared with the Thread structure.*/
+  Thread                *r_current; /**< @brief The currently running
+                                                thread.                     */
+  uint32_t              r_summary;  /**< @brief Non-zero words of
+                                                @p r_bitmap.                */
+  uint32_t              r_bitmap[RLBM_LEVELS / 32];
+                                    /**< @brief Non-empty priority levels.  */
+  Thread                *r_tail[RLBM_LEVELS];
+                                    /**< @brief Last thread of each level,
+                                                valid while its bit is
+                                                set.                        */
+} ReadyList;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  Thread *chSchReadyI(Thread *tp);
+  void chSchGoSleepS(tstate_t newstate);
+  void chSchDoRescheduleBehind(void);
+  void chSchDoRescheduleAhead(void);
+  Thread *chSchReadyRemoveI(Thread *tp, tprio_t prio);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CHRLBITMAP_H_ */
+
+/** @} */
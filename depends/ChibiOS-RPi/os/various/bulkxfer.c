@@ -0,0 +1,519 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    bulkxfer.c
+ * @brief   Windowed, CRC-checked bulk transfer over a serial channel.
+ *
+ * @addtogroup bulkxfer
+ * @{
+ */
+
+#include <string.h>
+
+#include "ch.h"
+#include "hal.h"
+#include "bulkxfer.h"
+
+#define BX_SYNC0            'B'
+#define BX_SYNC1            'X'
+
+/* Host frames carry everything in the header, a little payload is
+   tolerated for future extensions.*/
+#define BX_HOST_MAX_PAYLOAD 8
+
+/* PackBits worst case, one control byte per 128 literals.*/
+#define BX_SCRATCH_SIZE     (BX_MAX_BLOCK_SIZE + BX_MAX_BLOCK_SIZE / 128 + 1)
+
+/**
+ * @brief   One frame in flight.
+ */
+typedef struct {
+  uint32_t              seq;
+  uint32_t              offset;
+  size_t                len;
+  uint32_t              stamp;              /**< @brief Transmission order.*/
+  systime_t             sent_at;
+  bool_t                acked;
+} bx_slot_t;
+
+/**
+ * @brief   Session state.
+ */
+typedef struct {
+  BaseChannel           *chp;
+  const BxSource        *srcp;
+  const BxConfig        *cfgp;
+  BxStats               *statsp;
+  bx_slot_t             slots[BX_MAX_WINDOW];
+  uint32_t              base;               /**< @brief Oldest unacked.     */
+  uint32_t              next;               /**< @brief Next new sequence.  */
+  uint32_t              stamp;
+  uint8_t               rx[BX_HEADER_SIZE + BX_HOST_MAX_PAYLOAD + BX_CRC_SIZE];
+  size_t                rxn;
+} bx_session_t;
+
+static const uint32_t crc32_table[256] = {
+  0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA,
+  0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
+  0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988,
+  0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
+  0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE,
+  0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
+  0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC,
+  0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
+  0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
+  0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
+  0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940,
+  0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+  0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116,
+  0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
+  0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924,
+  0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
+  0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A,
+  0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+  0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818,
+  0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
+  0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E,
+  0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
+  0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C,
+  0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+  0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2,
+  0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
+  0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
+  0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
+  0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086,
+  0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
+  0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4,
+  0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
+  0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A,
+  0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
+  0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8,
+  0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+  0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE,
+  0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
+  0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC,
+  0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
+  0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252,
+  0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
+  0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60,
+  0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
+  0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
+  0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
+  0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04,
+  0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+  0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A,
+  0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
+  0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38,
+  0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
+  0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E,
+  0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+  0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C,
+  0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
+  0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2,
+  0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
+  0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0,
+  0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+  0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6,
+  0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
+  0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
+  0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
+};
+
+/* Compression scratch, sessions are not reentrant.*/
+static uint8_t scratch[BX_SCRATCH_SIZE];
+
+static void put_le16(uint8_t *p, uint16_t v) {
+
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+
+  put_le16(p, (uint16_t)v);
+  put_le16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_le16(const uint8_t *p) {
+
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+
+  return get_le16(p) | ((uint32_t)get_le16(p + 2) << 16);
+}
+
+/**
+ * @brief   PackBits encoding.
+ * @return              The encoded size, or @p n if encoding does not pay.
+ */
+static size_t rle_encode(const uint8_t *src, size_t n, uint8_t *dst) {
+  size_t i = 0, o = 0;
+
+  while (i < n) {
+    size_t run = 1;
+
+    if (o >= n)
+      return n;
+
+    while ((i + run < n) && (run < 128) && (src[i + run] == src[i]))
+      run++;
+    if (run >= 3) {
+      dst[o++] = (uint8_t)(257 - run);
+      dst[o++] = src[i];
+      i += run;
+    }
+    else {
+      size_t lit = run;
+
+      /* Literals up to the next run of three.*/
+      while ((i + lit < n) && (lit < 128)) {
+        if ((i + lit + 2 < n) && (src[i + lit] == src[i + lit + 1]) &&
+            (src[i + lit] == src[i + lit + 2]))
+          break;
+        lit++;
+      }
+      dst[o++] = (uint8_t)(lit - 1);
+      memcpy(&dst[o], &src[i], lit);
+      o += lit;
+      i += lit;
+    }
+  }
+  return o < n ? o : n;
+}
+
+static void send_frame(bx_session_t *sp, uint8_t type, uint8_t flags,
+                       uint32_t seq, uint32_t offset,
+                       const uint8_t *payload, size_t len) {
+  uint8_t hdr[BX_HEADER_SIZE];
+  uint8_t tail[BX_CRC_SIZE];
+  uint32_t crc;
+
+  hdr[0] = BX_SYNC0;
+  hdr[1] = BX_SYNC1;
+  hdr[2] = type;
+  hdr[3] = flags;
+  put_le16(&hdr[4], (uint16_t)seq);
+  put_le16(&hdr[6], (uint16_t)len);
+  put_le32(&hdr[8], offset);
+  crc = bxCrc32(0, &hdr[2], BX_HEADER_SIZE - 2);
+  crc = bxCrc32(crc, payload, len);
+  put_le32(tail, crc);
+
+  chnWrite(sp->chp, hdr, BX_HEADER_SIZE);
+  if (len > 0)
+    chnWrite(sp->chp, payload, len);
+  chnWrite(sp->chp, tail, BX_CRC_SIZE);
+
+  sp->statsp->frames++;
+  sp->statsp->wire_bytes += BX_HEADER_SIZE + len + BX_CRC_SIZE;
+}
+
+/**
+ * @brief   (Re)sends a data frame, straight from the source storage.
+ * @return              @p FALSE if the source no longer holds the data.
+ */
+static bool_t send_slot(bx_session_t *sp, bx_slot_t *slotp) {
+  const uint8_t *data;
+  size_t n, len;
+  uint8_t flags = 0;
+
+  n = sp->srcp->read(sp->srcp->ctx, slotp->offset, &data, slotp->len);
+  if (n != slotp->len)
+    return FALSE;
+
+  len = n;
+  if (sp->cfgp->compress) {
+    size_t packed = rle_encode(data, n, scratch);
+    if (packed < n) {
+      data = scratch;
+      len = packed;
+      flags |= BX_FLAG_RLE;
+    }
+  }
+
+  send_frame(sp, BX_TYPE_DATA, flags, slotp->seq, slotp->offset, data, len);
+  slotp->stamp = ++sp->stamp;
+  slotp->sent_at = chTimeNow();
+  return TRUE;
+}
+
+static bx_slot_t *slot_of(bx_session_t *sp, uint32_t seq) {
+
+  return &sp->slots[seq % sp->cfgp->window];
+}
+
+/**
+ * @brief   Feeds one byte to the host frame parser.
+ * @return              @p TRUE when @p rx holds a complete, valid frame.
+ */
+static bool_t parse_byte(bx_session_t *sp, uint8_t b) {
+  size_t len;
+
+  if ((sp->rxn == 0) && (b != BX_SYNC0))
+    return FALSE;
+  if ((sp->rxn == 1) && (b != BX_SYNC1)) {
+    sp->rxn = (b == BX_SYNC0) ? 1 : 0;
+    return FALSE;
+  }
+  sp->rx[sp->rxn++] = b;
+  if (sp->rxn < BX_HEADER_SIZE)
+    return FALSE;
+
+  len = get_le16(&sp->rx[6]);
+  if (len > BX_HOST_MAX_PAYLOAD) {
+    sp->statsp->bad_frames++;
+    sp->rxn = 0;
+    return FALSE;
+  }
+  if (sp->rxn < BX_HEADER_SIZE + len + BX_CRC_SIZE)
+    return FALSE;
+
+  sp->rxn = 0;
+  if (bxCrc32(0, &sp->rx[2], BX_HEADER_SIZE - 2 + len) !=
+      get_le32(&sp->rx[BX_HEADER_SIZE + len])) {
+    sp->statsp->bad_frames++;
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+ * @brief   Widens a 16 bit sequence number received from the host.
+ */
+static uint32_t widen_seq(bx_session_t *sp, uint16_t seq) {
+
+  return sp->base + (int16_t)(seq - (uint16_t)sp->base);
+}
+
+/**
+ * @brief   Applies an acknowledgement.
+ * @return              @p TRUE if it acknowledged anything new.
+ */
+static bool_t handle_ack(bx_session_t *sp, uint32_t ack, uint32_t bitmap) {
+  uint32_t seq, newest = 0;
+  bool_t progress = FALSE;
+
+  for (seq = sp->base; seq != sp->next; seq++) {
+    bx_slot_t *slotp = slot_of(sp, seq);
+    int32_t d = (int32_t)(seq - ack);
+
+    if (slotp->acked)
+      continue;
+    if ((d < 0) || ((d >= 1) && (d <= 32) && (bitmap & (1UL << (d - 1))))) {
+      slotp->acked = TRUE;
+      sp->statsp->payload_bytes += slotp->len;
+      if (slotp->stamp > newest)
+        newest = slotp->stamp;
+      progress = TRUE;
+    }
+  }
+
+  while ((sp->base != sp->next) && slot_of(sp, sp->base)->acked)
+    sp->base++;
+
+  /* Selective retransmit of the frames a later frame overtook.*/
+  for (seq = sp->base; seq != sp->next; seq++) {
+    bx_slot_t *slotp = slot_of(sp, seq);
+    if (!slotp->acked && (slotp->stamp < newest)) {
+      if (!send_slot(sp, slotp))
+        return FALSE;
+      sp->statsp->retransmits++;
+    }
+  }
+  return progress;
+}
+
+/**
+ * @brief   CRC-32 (IEEE 802.3), table driven.
+ * @details Pass 0 as @p crc to start, the previous result to continue.
+ *
+ * @param[in] crc       running CRC
+ * @param[in] bp        data
+ * @param[in] n         data length
+ * @return              The updated CRC.
+ */
+uint32_t bxCrc32(uint32_t crc, const uint8_t *bp, size_t n) {
+
+  crc = ~crc;
+  while (n--)
+    crc = crc32_table[(crc ^ *bp++) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+/**
+ * @brief   @p BxSource read function for a @p BxMemory region.
+ *
+ * @param[in] ctx       pointer to a @p BxMemory
+ * @param[in] offset    source offset
+ * @param[out] datap    pointer to the data at @p offset
+ * @param[in] max       maximum length
+ * @return              Bytes available at @p datap.
+ */
+size_t bxMemoryRead(void *ctx, uint32_t offset,
+                    const uint8_t **datap, size_t max) {
+  const BxMemory *mp = ctx;
+
+  if (offset >= mp->size)
+    return 0;
+  *datap = mp->base + offset;
+  return (mp->size - offset < max) ? mp->size - offset : max;
+}
+
+/**
+ * @brief   Serves one download session.
+ * @details Waits for the host to open the session, streams the source from
+ *          the requested offset and completes the end handshake.
+ *
+ * @param[in] chp       channel to the host
+ * @param[in] srcp      data source
+ * @param[in] cfgp      session parameters
+ * @param[out] statsp   session statistics
+ * @return              The session outcome.
+ * @retval RDY_OK       if everything was acknowledged.
+ * @retval RDY_TIMEOUT  if the host never opened the session or stopped
+ *                      answering.
+ * @retval RDY_RESET    if the host aborted, the channel was reset or the
+ *                      source lost unacknowledged data.
+ */
+msg_t bxSend(BaseChannel *chp, const BxSource *srcp,
+             const BxConfig *cfgp, BxStats *statsp) {
+  bx_session_t s;
+  uint32_t offset = 0;
+  unsigned retries = 0;
+  bool_t started = FALSE, eof = FALSE;
+  systime_t start;
+
+  chDbgCheck((chp != NULL) && (srcp != NULL) && (cfgp != NULL) &&
+             (statsp != NULL) && (cfgp->window > 0) &&
+             (cfgp->window <= BX_MAX_WINDOW) && (cfgp->block_size > 0) &&
+             (cfgp->block_size <= BX_MAX_BLOCK_SIZE), "bxSend");
+
+  memset(&s, 0, sizeof(s));
+  memset(statsp, 0, sizeof(*statsp));
+  s.chp = chp;
+  s.srcp = srcp;
+  s.cfgp = cfgp;
+  s.statsp = statsp;
+
+  /* Session opening, the START frame carries the resume offset.*/
+  start = chTimeNow();
+  while (!started) {
+    systime_t elapsed = chTimeNow() - start;
+    msg_t c;
+
+    if (elapsed >= cfgp->start_timeout)
+      return RDY_TIMEOUT;
+    c = chnGetTimeout(chp, cfgp->start_timeout - elapsed);
+    if (c == Q_TIMEOUT)
+      return RDY_TIMEOUT;
+    if (c < Q_OK)
+      return RDY_RESET;
+    if (parse_byte(&s, (uint8_t)c) && (s.rx[2] == BX_TYPE_START)) {
+      offset = get_le32(&s.rx[8]);
+      started = TRUE;
+    }
+  }
+
+  while (TRUE) {
+    bx_slot_t *oldest;
+    systime_t elapsed;
+    msg_t c;
+
+    /* Keeps the window full.*/
+    while (!eof && (s.next - s.base < cfgp->window)) {
+      bx_slot_t *slotp = slot_of(&s, s.next);
+      const uint8_t *data;
+      size_t n = srcp->read(srcp->ctx, offset, &data, cfgp->block_size);
+
+      if (n == 0) {
+        eof = TRUE;
+        break;
+      }
+      slotp->seq = s.next++;
+      slotp->offset = offset;
+      slotp->len = n;
+      slotp->acked = FALSE;
+      offset += n;
+      if (!send_slot(&s, slotp))
+        return RDY_RESET;
+    }
+    if (s.base == s.next)
+      break;
+
+    /* Waits for the host up to the oldest frame retransmission time.*/
+    oldest = slot_of(&s, s.base);
+    elapsed = chTimeNow() - oldest->sent_at;
+    c = Q_TIMEOUT;
+    if (elapsed < cfgp->rto)
+      c = chnGetTimeout(chp, cfgp->rto - elapsed);
+    if (c == Q_TIMEOUT) {
+      statsp->timeouts++;
+      if (++retries > BX_MAX_RETRIES)
+        return RDY_TIMEOUT;
+      if (!send_slot(&s, oldest))
+        return RDY_RESET;
+      statsp->retransmits++;
+      continue;
+    }
+    if (c < Q_OK)
+      return RDY_RESET;
+    if (!parse_byte(&s, (uint8_t)c))
+      continue;
+    if (s.rx[2] == BX_TYPE_ABORT)
+      return RDY_RESET;
+    if ((s.rx[2] == BX_TYPE_ACK) &&
+        handle_ack(&s, widen_seq(&s, get_le16(&s.rx[4])), get_le32(&s.rx[8])))
+      retries = 0;
+  }
+
+  /* End handshake, repeated until acknowledged.*/
+  for (retries = 0; retries <= BX_MAX_RETRIES; retries++) {
+    systime_t sent_at;
+
+    send_frame(&s, BX_TYPE_END, 0, s.next, offset, NULL, 0);
+    sent_at = chTimeNow();
+    while (TRUE) {
+      systime_t elapsed = chTimeNow() - sent_at;
+      msg_t c;
+
+      if (elapsed >= cfgp->rto)
+        break;
+      c = chnGetTimeout(chp, cfgp->rto - elapsed);
+      if (c == Q_TIMEOUT)
+        break;
+      if (c < Q_OK)
+        return RDY_RESET;
+      if (!parse_byte(&s, (uint8_t)c))
+        continue;
+      if (s.rx[2] == BX_TYPE_ABORT)
+        return RDY_RESET;
+      if ((s.rx[2] == BX_TYPE_ACK) &&
+          (widen_seq(&s, get_le16(&s.rx[4])) > s.next))
+        return RDY_OK;
+    }
+    statsp->timeouts++;
+  }
+  return RDY_TIMEOUT;
+}
+
+/** @} */
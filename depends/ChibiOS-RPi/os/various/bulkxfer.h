@@ -0,0 +1,189 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    bulkxfer.h
+ * @brief   Windowed, CRC-checked bulk transfer over a serial channel.
+ * @details Frame layout, all fields little-endian:
+ *          <pre>
+ *          0   'B' 'X'           sync
+ *          2   type              BX_TYPE_*
+ *          3   flags             BX_FLAG_*
+ *          4   seq     (16 bit)  frame sequence number
+ *          6   len     (16 bit)  payload length
+ *          8   offset  (32 bit)  source offset of the payload
+ *          12  payload[len]
+ *          12+len crc  (32 bit)  CRC-32 (IEEE) of bytes 2..11+len
+ *          </pre>
+ *          A session runs as follows:
+ *          - The host sends @p BX_TYPE_START, @p offset being where the
+ *            transfer resumes, e.g. the size of a partial file. It may
+ *            repeat it until the first frame arrives; later ones are
+ *            ignored.
+ *          - The target sends @p BX_TYPE_DATA frames numbered from 0,
+ *            @p offset being the source offset of the first byte. With
+ *            @p BX_FLAG_RLE the payload is PackBits encoded and expands to
+ *            at most the block size.
+ *          - The host answers the data frames with @p BX_TYPE_ACK: @p seq
+ *            is the next frame it expects in order and @p offset is a
+ *            bitmap, bit @p n set if it holds frame @p seq+1+n. Frames a
+ *            later acknowledged frame overtook are resent at once, the
+ *            rest after the retransmission timeout. Duplicates are
+ *            acknowledged again.
+ *          - Once every data frame is acknowledged the target sends
+ *            @p BX_TYPE_END, @p seq being the next frame number and
+ *            @p offset the total length. It is repeated every
+ *            retransmission timeout, up to @p BX_MAX_RETRIES more times,
+ *            until the host acknowledges it with @p seq one past it. The
+ *            host should keep answering repeated END frames for a while,
+ *            its acknowledgement may be lost.
+ *          - The target gives up after @p BX_MAX_RETRIES timeouts in a
+ *            row; the host may send @p BX_TYPE_ABORT at any time.
+ *          .
+ *          Sequence numbers are the low 16 bits of a count widened by the
+ *          receiver. Frames with a bad CRC are dropped, the receiver
+ *          resynchronizes on the next sync bytes; host frames carry at
+ *          most eight payload bytes. Text the target prints before the
+ *          session, such as a shell prompt, is skipped the same way.
+ *          tools/bxrecv is a host implementation.
+ *
+ * @addtogroup bulkxfer
+ * @{
+ */
+
+#ifndef _BULKXFER_H_
+#define _BULKXFER_H_
+
+/**
+ * @brief   Largest payload per frame.
+ */
+#if !defined(BX_MAX_BLOCK_SIZE) || defined(__DOXYGEN__)
+#define BX_MAX_BLOCK_SIZE           1024
+#endif
+
+/**
+ * @brief   Largest number of frames in flight, at most 33.
+ */
+#if !defined(BX_MAX_WINDOW) || defined(__DOXYGEN__)
+#define BX_MAX_WINDOW               16
+#endif
+
+/**
+ * @brief   Timeouts in a row after which a session is abandoned.
+ */
+#if !defined(BX_MAX_RETRIES) || defined(__DOXYGEN__)
+#define BX_MAX_RETRIES              10
+#endif
+
+#if BX_MAX_WINDOW > 33
+#error "BX_MAX_WINDOW cannot exceed the 32 bit selective ACK bitmap + 1"
+#endif
+
+/**
+ * @name    Frame types
+ * @{
+ */
+#define BX_TYPE_DATA                0x01
+#define BX_TYPE_END                 0x02
+#define BX_TYPE_START               0x10
+#define BX_TYPE_ACK                 0x11
+#define BX_TYPE_ABORT               0x12
+/** @} */
+
+/**
+ * @name    Frame flags
+ * @{
+ */
+/** @brief Payload is PackBits run-length encoded.*/
+#define BX_FLAG_RLE                 0x01
+/** @} */
+
+#define BX_HEADER_SIZE              12
+#define BX_CRC_SIZE                 4
+
+/**
+ * @brief   Source of the transferred data.
+ * @details @p read returns a pointer into the source storage, so frames
+ *          are sent without staging copies. It may return fewer than
+ *          @p max bytes (a ring wrapping, the end of a log sector) and
+ *          returns zero at the end of the data. The bytes of any frame not
+ *          yet acknowledged must stay valid, they are read again for
+ *          retransmission.
+ */
+typedef struct {
+  size_t                (*read)(void *ctx, uint32_t offset,
+                                const uint8_t **datap, size_t max);
+  void                  *ctx;
+} BxSource;
+
+/**
+ * @brief   Flat memory region usable as a source through @p bxMemoryRead().
+ */
+typedef struct {
+  const uint8_t         *base;
+  size_t                size;
+} BxMemory;
+
+/**
+ * @brief   Session parameters.
+ */
+typedef struct {
+  /** @brief Payload bytes per frame, at most @p BX_MAX_BLOCK_SIZE.*/
+  size_t                block_size;
+  /** @brief Frames in flight, at most @p BX_MAX_WINDOW.*/
+  unsigned              window;
+  /** @brief Retransmission timeout.*/
+  systime_t             rto;
+  /** @brief How long to wait for the host to open the session.*/
+  systime_t             start_timeout;
+  /** @brief Run-length encode payloads when that makes them smaller.*/
+  bool_t                compress;
+} BxConfig;
+
+/**
+ * @brief   Session statistics.
+ */
+typedef struct {
+  uint32_t              frames;             /**< @brief Frames sent.        */
+  uint32_t              retransmits;        /**< @brief Frames resent.      */
+  uint32_t              timeouts;           /**< @brief RTO expirations.    */
+  uint32_t              bad_frames;         /**< @brief Host frames with a
+                                                 bad CRC.                   */
+  uint32_t              payload_bytes;      /**< @brief Source bytes
+                                                 acknowledged.              */
+  uint32_t              wire_bytes;         /**< @brief Bytes put on the
+                                                 wire, headers included.    */
+} BxStats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  uint32_t bxCrc32(uint32_t crc, const uint8_t *bp, size_t n);
+  msg_t bxSend(BaseChannel *chp, const BxSource *srcp,
+               const BxConfig *cfgp, BxStats *statsp);
+  size_t bxMemoryRead(void *ctx, uint32_t offset,
+                      const uint8_t **datap, size_t max);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BULKXFER_H_ */
+
+/** @} */
@@ -0,0 +1,187 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    calendar.c
+ * @brief   Calendar and FAT time stamp conversions code.
+ * @details Dates are counted in years starting on the 1st of March, which
+ *          puts the leap day at the end of the year, in 400 year eras of
+ *          146097 days.
+ *
+ * @addtogroup calendar
+ * @{
+ */
+
+#include <time.h>
+
+#include "ch.h"
+#include "calendar.h"
+
+/**
+ * @brief   Days from 0000-03-01 to 1970-01-01.
+ */
+#define DAYS_TO_EPOCH               719468U
+
+/**
+ * @brief   Days in a 400 year era.
+ */
+#define DAYS_PER_ERA                146097U
+
+#define SECS_PER_DAY                86400U
+
+/**
+ * @brief   Days before each month of a year starting in March.
+ */
+static const uint16_t days_before[12] = {
+  0, 31, 61, 92, 122, 153, 184, 214, 245, 275, 306, 337
+};
+
+static bool_t is_leap(uint32_t year) {
+
+  return (year % 4 == 0) && ((year % 100 != 0) || (year % 400 == 0));
+}
+
+/**
+ * @brief   Days since the epoch of a date.
+ *
+ * @param[in] year      year
+ * @param[in] mon       month, 0 to 11
+ * @param[in] mday      day of the month, 1 to 31
+ * @return              Days since 1970-01-01.
+ */
+static uint32_t date_to_days(uint32_t year, uint32_t mon, uint32_t mday) {
+  uint32_t y = mon < 2 ? year - 1 : year;
+  uint32_t mp = mon < 2 ? mon + 10 : mon - 2;
+  uint32_t era = y / 400;
+  uint32_t yoe = y - era * 400;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + days_before[mp] + mday - 1;
+
+  return era * DAYS_PER_ERA + doe - DAYS_TO_EPOCH;
+}
+
+/**
+ * @brief   Date of a day since the epoch.
+ * @details Fills the date fields of @p timp: year, month, day of the month,
+ *          day of the week and day of the year.
+ *
+ * @param[in] days      days since 1970-01-01
+ * @param[out] timp     broken down time
+ */
+static void days_to_date(uint32_t days, struct tm *timp) {
+  uint32_t z = days + DAYS_TO_EPOCH;
+  uint32_t era = z / DAYS_PER_ERA;
+  uint32_t doe = z - era * DAYS_PER_ERA;
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (yoe * 365 + yoe / 4 - yoe / 100);
+  uint32_t mp = doy / 32;
+  uint32_t year;
+
+  /* No month is longer than 32 days, the estimate is at most one short.*/
+  if ((mp < 11) && (doy >= days_before[mp + 1]))
+    mp++;
+  year = era * 400 + yoe + (mp >= 10 ? 1 : 0);
+  timp->tm_year = year - 1900;
+  timp->tm_mon = mp < 10 ? mp + 2 : mp - 10;
+  timp->tm_mday = doy - days_before[mp] + 1;
+  timp->tm_yday = mp >= 10 ? doy - 306 : doy + 59 + (is_leap(year) ? 1 : 0);
+  timp->tm_wday = (days + 4) % 7;
+}
+
+/**
+ * @brief   Converts seconds since the epoch to broken down UTC time.
+ * @details Same result as @p gmtime_r(), @p tm_isdst is cleared.
+ *
+ * @param[in] sec       seconds since 1970-01-01 00:00:00 UTC
+ * @param[out] timp     broken down time
+ */
+void calEpochToTm(uint32_t sec, struct tm *timp) {
+  uint32_t days = sec / SECS_PER_DAY;
+  uint32_t rem = sec - days * SECS_PER_DAY;
+
+  chDbgCheck(timp != NULL, "calEpochToTm");
+
+  days_to_date(days, timp);
+  timp->tm_hour = rem / 3600;
+  rem -= timp->tm_hour * 3600;
+  timp->tm_min = rem / 60;
+  timp->tm_sec = rem - timp->tm_min * 60;
+  timp->tm_isdst = 0;
+}
+
+/**
+ * @brief   Converts broken down UTC time to seconds since the epoch.
+ * @details Unlike @p mktime() the fields are not normalized, they must be
+ *          in range, and @p tm_wday and @p tm_yday are ignored.
+ *
+ * @param[in] timp      broken down time, 1970 to 2105
+ * @return              Seconds since 1970-01-01 00:00:00 UTC.
+ */
+uint32_t calTmToEpoch(const struct tm *timp) {
+
+  chDbgCheck((timp != NULL) && (timp->tm_year >= 70) &&
+             (timp->tm_mon >= 0) && (timp->tm_mon < 12) &&
+             (timp->tm_mday >= 1), "calTmToEpoch");
+
+  return date_to_days(timp->tm_year + 1900, timp->tm_mon, timp->tm_mday) *
+         SECS_PER_DAY + timp->tm_hour * 3600 + timp->tm_min * 60 +
+         timp->tm_sec;
+}
+
+/**
+ * @brief   Converts seconds since the epoch to a FAT time stamp.
+ * @details Times before 1980 give @p CAL_FAT_EPOCH. The seconds are
+ *          rounded down to an even number, as FAT stores them halved.
+ *
+ * @param[in] sec       seconds since 1970-01-01 00:00:00 UTC
+ * @return              FAT time stamp.
+ */
+uint32_t calEpochToFat(uint32_t sec) {
+  struct tm tm;
+
+  calEpochToTm(sec, &tm);
+  if (tm.tm_year < 80)
+    return CAL_FAT_EPOCH;
+  return ((uint32_t)(tm.tm_year - 80) << 25) |
+         ((uint32_t)(tm.tm_mon + 1) << 21) |
+         ((uint32_t)tm.tm_mday << 16) |
+         ((uint32_t)tm.tm_hour << 11) |
+         ((uint32_t)tm.tm_min << 5) |
+         ((uint32_t)tm.tm_sec >> 1);
+}
+
+/**
+ * @brief   Converts a FAT time stamp to seconds since the epoch.
+ *
+ * @param[in] fat       FAT time stamp, 1980 to 2105
+ * @return              Seconds since 1970-01-01 00:00:00 UTC.
+ */
+uint32_t calFatToEpoch(uint32_t fat) {
+  struct tm tm;
+
+  tm.tm_year = (fat >> 25) + 80;
+  tm.tm_mon = ((fat >> 21) & 0x0F) - 1;
+  tm.tm_mday = (fat >> 16) & 0x1F;
+  tm.tm_hour = (fat >> 11) & 0x1F;
+  tm.tm_min = (fat >> 5) & 0x3F;
+  tm.tm_sec = (fat & 0x1F) * 2;
+  return calTmToEpoch(&tm);
+}
+
+/** @} */
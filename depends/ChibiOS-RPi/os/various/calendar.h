@@ -0,0 +1,57 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    calendar.h
+ * @brief   Calendar and FAT time stamp conversions.
+ * @details Constant time conversions between seconds since the UNIX epoch,
+ *          broken down UTC time and FAT time stamps, for 1970 to 2105. They
+ *          use a month table and divisions by constants only, which the
+ *          compiler turns into multiplications, unlike @p mktime() and
+ *          @p gmtime() that loop over the years and months.
+ *
+ * @addtogroup calendar
+ * @{
+ */
+
+#ifndef _CALENDAR_H_
+#define _CALENDAR_H_
+
+#include <time.h>
+
+/**
+ * @brief   FAT time stamp of 1980-01-01 00:00:00, the earliest one.
+ */
+#define CAL_FAT_EPOCH               0x00210000
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void calEpochToTm(uint32_t sec, struct tm *timp);
+  uint32_t calTmToEpoch(const struct tm *timp);
+  uint32_t calEpochToFat(uint32_t sec);
+  uint32_t calFatToEpoch(uint32_t fat);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CALENDAR_H_ */
+
+/** @} */
@@ -353,6 +353,89 @@ uint32_t rtcGetTimeFatFromCounter(RTCDriver *rtcp) {
   return fattime;
 }
 #endif /* STM32_RTC_IS_CALENDAR */
+
+#elif BCM2835_RTC_IS_SYSTIMER
+#include "calendar.h"
+
+/*
+ * The BCM2835 RTC counts seconds since the epoch, conversions go through
+ * the constant time calendar routines instead of mktime() and gmtime().
+ */
+
+/**
+ * @brief   Gets raw time from RTC and converts it to canonicalized format.
+ *
+ * @param[in] rtcp      pointer to RTC driver structure
+ * @param[out] timp     pointer to a @p tm structure as defined in time.h
+ *
+ * @api
+ */
+void rtcGetTimeTm(RTCDriver *rtcp, struct tm *timp) {
+  RTCTime timespec = {0,0};
+
+  rtcGetTime(rtcp, &timespec);
+  calEpochToTm(timespec.tv_sec, timp);
+}
+
+/**
+ * @brief   Sets RTC time.
+ *
+ * @param[in] rtcp      pointer to RTC driver structure
+ * @param[out] timp     pointer to a @p tm structure as defined in time.h
+ *
+ * @api
+ */
+void rtcSetTimeTm(RTCDriver *rtcp, struct tm *timp) {
+  RTCTime timespec = {0,0};
+
+  timespec.tv_sec = calTmToEpoch(timp);
+  rtcSetTime(rtcp, &timespec);
+}
+
+/**
+ * @brief   Gets raw time from RTC and converts it to unix format.
+ *
+ * @param[in] rtcp      pointer to RTC driver structure
+ * @return              Unix time value in seconds.
+ *
+ * @api
+ */
+time_t rtcGetTimeUnixSec(RTCDriver *rtcp) {
+  RTCTime timespec = {0,0};
+
+  rtcGetTime(rtcp, &timespec);
+  return timespec.tv_sec;
+}
+
+/**
+ * @brief   Sets RTC time.
+ *
+ * @param[in] rtcp      pointer to RTC driver structure
+ * @param[in] tv_sec    time specification
+ *
+ * @api
+ */
+void rtcSetTimeUnixSec(RTCDriver *rtcp, time_t tv_sec) {
+  RTCTime timespec = {0,0};
+
+  timespec.tv_sec = tv_sec;
+  rtcSetTime(rtcp, &timespec);
+}
+
+/**
+ * @brief   Gets raw time from RTC and converts it to unix format.
+ *
+ * @param[in] rtcp      pointer to RTC driver structure
+ * @return              Unix time value in microseconds.
+ *
+ * @api
+ */
+uint64_t rtcGetTimeUnixUsec(RTCDriver *rtcp) {
+  RTCTime timespec = {0,0};
+
+  rtcGetTime(rtcp, &timespec);
+  return (uint64_t)timespec.tv_sec * 1000000 + timespec.tv_msec * 1000;
+}
 #endif /* (defined(STM32F4XX) || defined(STM32F2XX) || defined(STM32L1XX) || defined(STM32F1XX)) */
 
 /** @} */
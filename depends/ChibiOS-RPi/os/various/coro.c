@@ -0,0 +1,227 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    coro.c
+ * @brief   Stackless coroutines sharing one thread.
+ *
+ * @addtogroup coroutines
+ * @{
+ */
+
+#include "ch.h"
+#include "coro.h"
+
+/**
+ * @brief   Returns @p TRUE if the coroutine has to be run.
+ */
+static bool_t coro_ready(Coro *cp) {
+
+  if ((cp->c_wait == 0) || (cp->c_wait & (CORO_W_YIELD | CORO_W_POLL)))
+    return TRUE;
+  if ((cp->c_wait & CORO_W_EVENTS) && (cp->c_events & cp->c_evwait))
+    return TRUE;
+  return (cp->c_wait & CORO_W_TIME) && coroTimedOut(cp);
+}
+
+/**
+ * @brief   Time the coroutine can be left alone for.
+ */
+static systime_t coro_idle_time(Coro *cp, systime_t now) {
+  systime_t elapsed;
+
+  if (cp->c_wait & CORO_W_YIELD)
+    return TIME_IMMEDIATE;
+  if (cp->c_wait & CORO_W_POLL)
+    return 1;
+  if (!(cp->c_wait & CORO_W_TIME))
+    return TIME_INFINITE;
+  elapsed = now - cp->c_time;
+  return elapsed >= cp->c_interval ? TIME_IMMEDIATE : cp->c_interval - elapsed;
+}
+
+/**
+ * @brief   Initializes a coroutine scheduler.
+ *
+ * @param[out] csp      pointer to the @p CoroScheduler object
+ *
+ * @init
+ */
+void coroSchedInit(CoroScheduler *csp) {
+
+  chDbgCheck(csp != NULL, "coroSchedInit");
+
+  csp->cs_head = NULL;
+  csp->cs_thread = NULL;
+}
+
+/**
+ * @brief   Adds a coroutine to a scheduler.
+ * @note    Must be called before @p coroSchedRun() or from a coroutine of
+ *          the same scheduler.
+ *
+ * @param[in] csp       pointer to the @p CoroScheduler object
+ * @param[out] cp       pointer to the @p Coro object, usually embedded at the
+ *                      top of the coroutine state
+ * @param[in] func      the coroutine body
+ * @param[in] arg       argument available through @p coroGetArg()
+ * @param[in] listen    events latched by this coroutine
+ *
+ * @api
+ */
+void coroStart(CoroScheduler *csp, Coro *cp, corofunc_t func, void *arg,
+               eventmask_t listen) {
+
+  chDbgCheck((csp != NULL) && (cp != NULL) && (func != NULL), "coroStart");
+
+  cp->c_func = func;
+  cp->c_arg = arg;
+  cp->c_lc = 0;
+  cp->c_wait = 0;
+  cp->c_time = chTimeNow();
+  cp->c_interval = 0;
+  cp->c_listen = listen;
+  cp->c_events = 0;
+  cp->c_evwait = 0;
+  cp->c_next = csp->cs_head;
+  csp->cs_head = cp;
+}
+
+/**
+ * @brief   Runs every coroutine that can proceed, once.
+ * @details Building block of @p coroSchedRun(), for threads that serve
+ *          coroutines among other duties.
+ *
+ * @param[in] csp       pointer to the @p CoroScheduler object
+ * @return              The time until a coroutine next needs to run,
+ *                      @p TIME_INFINITE if only events can wake them.
+ *
+ * @api
+ */
+systime_t coroSchedStep(CoroScheduler *csp) {
+  systime_t next = TIME_INFINITE;
+  Coro **cpp = &csp->cs_head;
+  Coro *cp;
+
+  while ((cp = *cpp) != NULL) {
+    systime_t idle;
+
+    if (coro_ready(cp) && (cp->c_func(cp) == CORO_ENDED)) {
+      *cpp = cp->c_next;
+      continue;
+    }
+    idle = coro_idle_time(cp, chTimeNow());
+    if (idle < next)
+      next = idle;
+    cpp = &cp->c_next;
+  }
+  return next;
+}
+
+/**
+ * @brief   Latches events into the coroutines listening to them.
+ *
+ * @param[in] csp       pointer to the @p CoroScheduler object
+ * @param[in] events    events received by the scheduler thread
+ *
+ * @api
+ */
+void coroSchedDeliver(CoroScheduler *csp, eventmask_t events) {
+  Coro *cp;
+
+  for (cp = csp->cs_head; cp != NULL; cp = cp->c_next)
+    cp->c_events |= events & cp->c_listen;
+}
+
+/**
+ * @brief   Runs the coroutines in the calling thread, forever.
+ *
+ * @param[in] csp       pointer to the @p CoroScheduler object
+ *
+ * @api
+ */
+void coroSchedRun(CoroScheduler *csp) {
+
+  chDbgCheck(csp != NULL, "coroSchedRun");
+
+  csp->cs_thread = chThdSelf();
+  while (TRUE) {
+    systime_t idle = coroSchedStep(csp);
+    coroSchedDeliver(csp, chEvtWaitAnyTimeout(ALL_EVENTS, idle));
+  }
+}
+
+/**
+ * @brief   Sends events to the coroutines of a running scheduler.
+ *
+ * @param[in] csp       pointer to the @p CoroScheduler object
+ * @param[in] mask      events to be sent
+ *
+ * @iclass
+ */
+void coroSignalI(CoroScheduler *csp, eventmask_t mask) {
+
+  chDbgCheckClassI();
+  chDbgCheck((csp != NULL) && (csp->cs_thread != NULL), "coroSignalI");
+
+  chEvtSignalI(csp->cs_thread, mask);
+}
+
+/**
+ * @brief   Sends events to the coroutines of a running scheduler.
+ *
+ * @param[in] csp       pointer to the @p CoroScheduler object
+ * @param[in] mask      events to be sent
+ *
+ * @api
+ */
+void coroSignal(CoroScheduler *csp, eventmask_t mask) {
+
+  chDbgCheck((csp != NULL) && (csp->cs_thread != NULL), "coroSignal");
+
+  chEvtSignal(csp->cs_thread, mask);
+}
+
+/**
+ * @brief   Arms the coroutine timeout.
+ * @note    Used by the wait macros.
+ *
+ * @param[in] cp        pointer to the @p Coro object
+ * @param[in] start     timeout start
+ * @param[in] interval  timeout length
+ */
+void coroSetTimeout(Coro *cp, systime_t start, systime_t interval) {
+
+  cp->c_time = start;
+  cp->c_interval = interval;
+}
+
+/**
+ * @brief   Returns @p TRUE if the coroutine timeout has expired.
+ * @note    Used by the wait macros.
+ *
+ * @param[in] cp        pointer to the @p Coro object
+ */
+bool_t coroTimedOut(Coro *cp) {
+
+  return (systime_t)(chTimeNow() - cp->c_time) >= cp->c_interval;
+}
+
+/** @} */
@@ -0,0 +1,267 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    coro.h
+ * @brief   Stackless coroutines sharing one thread.
+ * @details A coroutine is a function that returns whenever it has to wait
+ *          and, when called again, resumes right after the wait, so driver
+ *          code reads sequentially:
+ *          @code
+ *          typedef struct {
+ *            Coro      coro;               // Must be the first member.
+ *            uint32_t  raw;
+ *          } Sensor;
+ *
+ *          static msg_t sensor_task(Coro *cp) {
+ *            Sensor *sp = (Sensor *)cp;
+ *
+ *            CORO_BEGIN(cp);
+ *            while (TRUE) {
+ *              start_conversion(sp);
+ *              CORO_SLEEP(cp, MS2ST(9));        // From now.
+ *              sp->raw = read_adc(sp);
+ *              CORO_SLEEP_NEXT(cp, MS2ST(991)); // From the end of the
+ *            }                                  // 9 ms, every 1000 ms.
+ *            CORO_END(cp);
+ *          }
+ *          @endcode
+ *          Coroutines keep no stack between waits: local variables are lost
+ *          across a wait, state that must survive lives in the structure
+ *          embedding the @p Coro. Waits cannot be placed inside a
+ *          @p switch of the coroutine body and two waits cannot share a
+ *          source line.
+ *
+ *          A @p CoroScheduler runs any number of coroutines in one thread,
+ *          sleeping until the nearest deadline or an event. Events are
+ *          the scheduler thread event flags, sent with @p coroSignalI() or
+ *          broadcast by any @p EventSource the scheduler thread listens to.
+ *          Each coroutine latches the events in its @p listen mask.
+ *
+ * @addtogroup coroutines
+ * @{
+ */
+
+#ifndef _CORO_H_
+#define _CORO_H_
+
+/*
+ * Module dependencies check.
+ */
+#if !CH_USE_EVENTS
+#error "Coroutines require CH_USE_EVENTS"
+#endif
+
+/**
+ * @name    Coroutine return values
+ * @{
+ */
+#define CORO_WAITING        0
+#define CORO_ENDED          1
+/** @} */
+
+/**
+ * @name    Wait conditions
+ * @{
+ */
+#define CORO_W_TIME         0x01
+#define CORO_W_EVENTS       0x02
+#define CORO_W_POLL         0x04
+#define CORO_W_YIELD        0x08
+/** @} */
+
+/**
+ * @brief   Type of a coroutine.
+ */
+typedef struct Coro Coro;
+
+/**
+ * @brief   Coroutine body type.
+ * @return              @p CORO_WAITING or @p CORO_ENDED, returned by the
+ *                      coroutine macros.
+ */
+typedef msg_t (*corofunc_t)(Coro *cp);
+
+/**
+ * @brief   Structure representing a coroutine.
+ */
+struct Coro {
+  Coro                  *c_next;        /**< @brief Next in scheduler.      */
+  corofunc_t            c_func;         /**< @brief Coroutine body.         */
+  void                  *c_arg;         /**< @brief Coroutine argument.     */
+  unsigned              c_lc;           /**< @brief Resume point.           */
+  uint8_t               c_wait;         /**< @brief @p CORO_W_* flags.      */
+  systime_t             c_time;         /**< @brief Timeout start.          */
+  systime_t             c_interval;     /**< @brief Timeout length.         */
+  eventmask_t           c_listen;       /**< @brief Events latched.         */
+  eventmask_t           c_events;       /**< @brief Latched events.         */
+  eventmask_t           c_evwait;       /**< @brief Awaited events, then
+                                                    the ones received.      */
+};
+
+/**
+ * @brief   Structure representing a coroutine scheduler.
+ */
+typedef struct {
+  Coro                  *cs_head;       /**< @brief Coroutines list.        */
+  Thread                *cs_thread;     /**< @brief Thread running them.    */
+} CoroScheduler;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void coroSchedInit(CoroScheduler *csp);
+  void coroStart(CoroScheduler *csp, Coro *cp, corofunc_t func, void *arg,
+                 eventmask_t listen);
+  systime_t coroSchedStep(CoroScheduler *csp);
+  void coroSchedDeliver(CoroScheduler *csp, eventmask_t events);
+  void coroSchedRun(CoroScheduler *csp);
+  void coroSignalI(CoroScheduler *csp, eventmask_t mask);
+  void coroSignal(CoroScheduler *csp, eventmask_t mask);
+  void coroSetTimeout(Coro *cp, systime_t start, systime_t interval);
+  bool_t coroTimedOut(Coro *cp);
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @name    Coroutine body macros
+ * @{
+ */
+/* Suspends until @p cond holds, @p wait tells the scheduler when to look.
+   The resume label sits in a dead block so that entering the wait is not
+   seen as a switch fall through.*/
+#define _CORO_BLOCK(cp, wait, cond)                                         \
+  do {                                                                      \
+    (cp)->c_wait = (wait);                                                  \
+    (cp)->c_lc = __LINE__;                                                  \
+    if (0) {                                                                \
+      case __LINE__:                                                        \
+        ;                                                                   \
+    }                                                                       \
+    if (!(cond))                                                            \
+      return CORO_WAITING;                                                  \
+    (cp)->c_wait = 0;                                                       \
+  } while (0)
+
+/* Moves the awaited events that arrived to @p c_evwait.*/
+#define _CORO_TAKE_EVENTS(cp)                                               \
+  ((cp)->c_evwait &= (cp)->c_events, (cp)->c_events &= ~(cp)->c_evwait)
+
+/**
+ * @brief   Starts the coroutine body.
+ */
+#define CORO_BEGIN(cp)  switch ((cp)->c_lc) { case 0:
+
+/**
+ * @brief   Ends the coroutine body, the coroutine leaves its scheduler.
+ */
+#define CORO_END(cp)    } (cp)->c_lc = 0; return CORO_ENDED
+
+/**
+ * @brief   Ends the coroutine from anywhere in the body.
+ */
+#define CORO_EXIT(cp)                                                       \
+  do {                                                                      \
+    (cp)->c_lc = 0;                                                         \
+    return CORO_ENDED;                                                      \
+  } while (0)
+
+/**
+ * @brief   Lets the other coroutines run, then continues.
+ */
+#define CORO_YIELD(cp)                                                      \
+  do {                                                                      \
+    (cp)->c_wait = CORO_W_YIELD;                                            \
+    (cp)->c_lc = __LINE__;                                                  \
+    return CORO_WAITING;                                                    \
+    case __LINE__:                                                          \
+    (cp)->c_wait = 0;                                                       \
+  } while (0)
+
+/**
+ * @brief   Waits @p ticks from now.
+ */
+#define CORO_SLEEP(cp, ticks)                                               \
+  do {                                                                      \
+    coroSetTimeout(cp, chTimeNow(), ticks);                                 \
+    _CORO_BLOCK(cp, CORO_W_TIME, coroTimedOut(cp));                         \
+  } while (0)
+
+/**
+ * @brief   Waits @p ticks from the end of the previous timed wait.
+ * @details The deadline is the previous one plus @p ticks, whatever the
+ *          time spent in between, so periodic loops built on this do not
+ *          drift. In a loop mixing waits the intervals add up, in the
+ *          example above the 9 ms conversion and the 991 ms wait make a
+ *          1000 ms period, plus the wake up latency the @p CORO_SLEEP()
+ *          counts from. The first time it is relative to @p coroStart().
+ */
+#define CORO_SLEEP_NEXT(cp, ticks)                                          \
+  do {                                                                      \
+    coroSetTimeout(cp, (cp)->c_time + (cp)->c_interval, ticks);             \
+    _CORO_BLOCK(cp, CORO_W_TIME, coroTimedOut(cp));                         \
+  } while (0)
+
+/**
+ * @brief   Waits for any of the events in @p mask.
+ * @details The received events are left in @p c_evwait.
+ */
+#define CORO_WAIT_EVENTS(cp, mask)                                          \
+  do {                                                                      \
+    (cp)->c_evwait = (mask);                                                \
+    _CORO_BLOCK(cp, CORO_W_EVENTS, (cp)->c_events & (cp)->c_evwait);        \
+    _CORO_TAKE_EVENTS(cp);                                                  \
+  } while (0)
+
+/**
+ * @brief   Waits for any of the events in @p mask, at most @p ticks.
+ * @details The received events are left in @p c_evwait, zero on timeout.
+ */
+#define CORO_WAIT_EVENTS_TIMEOUT(cp, mask, ticks)                           \
+  do {                                                                      \
+    (cp)->c_evwait = (mask);                                                \
+    coroSetTimeout(cp, chTimeNow(), ticks);                                 \
+    _CORO_BLOCK(cp, CORO_W_EVENTS | CORO_W_TIME,                            \
+                ((cp)->c_events & (cp)->c_evwait) || coroTimedOut(cp));     \
+    _CORO_TAKE_EVENTS(cp);                                                  \
+  } while (0)
+
+/**
+ * @brief   Waits until @p cond holds.
+ * @details The condition is polled once per system tick, prefer events
+ *          or deadlines where possible.
+ */
+#define CORO_WAIT_UNTIL(cp, cond) _CORO_BLOCK(cp, CORO_W_POLL, cond)
+/** @} */
+
+/**
+ * @brief   Returns the events that ended the last event wait.
+ */
+#define coroGetEvents(cp) ((cp)->c_evwait)
+
+/**
+ * @brief   Returns the argument given to @p coroStart().
+ */
+#define coroGetArg(cp) ((cp)->c_arg)
+
+#endif /* _CORO_H_ */
+
+/** @} */
@@ -0,0 +1,158 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    ms8607sensor.c
+ * @brief   MS8607 as a @p BaseSensor code.
+ *
+ * @addtogroup ms8607sensor
+ * @{
+ */
+
+#include "ch.h"
+#include "hal.h"
+#include "ms8607sensor.h"
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/* Commands and reads of one measurement, address bytes included: start
+   humidity, start temperature (2 + 2), read temperature (2 + 4), start
+   pressure (2), read pressure (2 + 4), read humidity (4).*/
+#define MS8607S_BUS_BYTES               22
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+static const SensorInfo *get_info(void *ip) {
+  MS8607Sensor *msp = ip;
+  uint32_t p_us = ms8607_get_conversion_time(msp->dev, ms8607_conversion_pressure);
+  uint32_t h_us = ms8607_get_conversion_time(msp->dev, ms8607_conversion_humidity);
+
+  msp->info.name = "MS8607";
+  msp->info.quantities = SNS_MASK(SNS_TEMPERATURE) | SNS_MASK(SNS_PRESSURE) |
+                         SNS_MASK(SNS_HUMIDITY);
+  msp->info.conversions = 3;
+  msp->info.first_us = p_us;
+  msp->info.measurement_us = 2 * p_us > h_us ? 2 * p_us : h_us;
+  msp->info.bus_bytes = MS8607S_BUS_BYTES;
+  return &msp->info;
+}
+
+static msg_t start(void *ip, uint32_t *wait_us) {
+  MS8607Sensor *msp = ip;
+
+  if (ms8607_start_conversion(msp->dev, ms8607_conversion_humidity,
+                              msp->context) != ms8607_status_ok)
+    return SNS_ERROR;
+  if (ms8607_start_conversion(msp->dev, ms8607_conversion_temperature,
+                              msp->context) != ms8607_status_ok)
+    return SNS_ERROR;
+  msp->phase = ms8607_conversion_temperature;
+  msp->retries = 0;
+  *wait_us = ms8607_get_conversion_time(msp->dev, ms8607_conversion_temperature);
+  return SNS_PENDING;
+}
+
+static msg_t collect(void *ip, uint32_t *wait_us) {
+  MS8607Sensor *msp = ip;
+  enum ms8607_conversion conv = (enum ms8607_conversion)msp->phase;
+  enum ms8607_status st;
+  uint32_t p_us, h_us;
+
+  st = ms8607_read_conversion(msp->dev, conv, &msp->adc[conv], msp->context);
+  if (st == ms8607_status_waiting) {
+    if (++msp->retries > MS8607S_MAX_RETRIES)
+      return SNS_ERROR;
+    *wait_us = MS8607S_RETRY_US;
+    return SNS_PENDING;
+  }
+  if (st != ms8607_status_ok)
+    return SNS_ERROR;
+
+  p_us = ms8607_get_conversion_time(msp->dev, ms8607_conversion_pressure);
+  switch (conv) {
+  case ms8607_conversion_temperature:
+    if (ms8607_start_conversion(msp->dev, ms8607_conversion_pressure,
+                                msp->context) != ms8607_status_ok)
+      return SNS_ERROR;
+    msp->phase = ms8607_conversion_pressure;
+    *wait_us = p_us;
+    return SNS_PENDING;
+  case ms8607_conversion_pressure:
+    /* The humidity conversion started with the temperature one.*/
+    h_us = ms8607_get_conversion_time(msp->dev, ms8607_conversion_humidity);
+    msp->phase = ms8607_conversion_humidity;
+    *wait_us = h_us > 2 * p_us ? h_us - 2 * p_us : 0;
+    return SNS_PENDING;
+  default:
+    return SNS_DONE;
+  }
+}
+
+static msg_t convert(void *ip, SensorReading *rp) {
+  MS8607Sensor *msp = ip;
+
+  if (ms8607_compensate_int32(msp->dev,
+                              msp->adc[ms8607_conversion_temperature],
+                              msp->adc[ms8607_conversion_pressure],
+                              msp->adc[ms8607_conversion_humidity],
+                              &rp->value[SNS_TEMPERATURE],
+                              &rp->value[SNS_PRESSURE],
+                              &rp->value[SNS_HUMIDITY]) != ms8607_status_ok)
+    return SNS_ERROR;
+  rp->quantities = SNS_MASK(SNS_TEMPERATURE) | SNS_MASK(SNS_PRESSURE) |
+                   SNS_MASK(SNS_HUMIDITY);
+  return SNS_DONE;
+}
+
+static const struct BaseSensorVMT vmt = {
+  get_info, start, collect, convert
+};
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Initializes an @p MS8607Sensor object.
+ * @details The MS8607 driver object must have been initialized, reset and
+ *          configured with the blocking driver API, the resolutions set
+ *          there determine the conversion times.
+ *
+ * @param[out] msp      pointer to the @p MS8607Sensor object
+ * @param[in] dev       pointer to the MS8607 driver object
+ * @param[in] context   context passed to the driver host functions
+ *
+ * @init
+ */
+void ms8607ObjectInit(MS8607Sensor *msp, ms8607_sensor *dev, void *context) {
+
+  msp->vmt = &vmt;
+  msp->dev = dev;
+  msp->context = context;
+  msp->phase = ms8607_conversion_temperature;
+  msp->retries = 0;
+  (void)get_info(msp);
+}
+
+/** @} */
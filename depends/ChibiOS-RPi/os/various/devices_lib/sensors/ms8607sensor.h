@@ -0,0 +1,99 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    ms8607sensor.h
+ * @brief   MS8607 as a @p BaseSensor header.
+ *
+ * @addtogroup ms8607sensor
+ * @{
+ */
+
+#ifndef _MS8607SENSOR_H_
+#define _MS8607SENSOR_H_
+
+#include "ms8607.h"
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Humidity collects answered with a NACK before giving up.
+ */
+#if !defined(MS8607S_MAX_RETRIES) || defined(__DOXYGEN__)
+#define MS8607S_MAX_RETRIES             20
+#endif
+
+/**
+ * @brief   Wait between two humidity collects answered with a NACK.
+ */
+#if !defined(MS8607S_RETRY_US) || defined(__DOXYGEN__)
+#define MS8607S_RETRY_US                1000
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   @p MS8607Sensor specific data.
+ */
+#define _ms8607_sensor_data                                                 \
+  _base_sensor_data                                                         \
+  /* Driver object, already reset and configured.*/                         \
+  ms8607_sensor             *dev;                                           \
+  /* Passed to the driver host functions, the I2C driver on ChibiOS.*/      \
+  void                      *context;                                       \
+  /* Descriptor, refreshed by get_info().*/                                 \
+  SensorInfo                info;                                           \
+  /* Next conversion to collect.*/                                          \
+  uint8_t                   phase;                                          \
+  /* NACKed humidity collects so far.*/                                     \
+  uint8_t                   retries;                                        \
+  /* Raw results, indexed by enum ms8607_conversion.*/                      \
+  uint32_t                  adc[3];
+
+/**
+ * @brief   MS8607 temperature, pressure and humidity sensor.
+ * @details A measurement runs the humidity conversion alongside the
+ *          temperature and pressure conversions, which share one ADC.
+ */
+typedef struct {
+  /** @brief Virtual Methods Table.*/
+  const struct BaseSensorVMT *vmt;
+  _ms8607_sensor_data
+} MS8607Sensor;
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void ms8607ObjectInit(MS8607Sensor *msp, ms8607_sensor *dev, void *context);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MS8607SENSOR_H_ */
+
+/** @} */
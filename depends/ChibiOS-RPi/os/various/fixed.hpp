@@ -0,0 +1,500 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    fixed.hpp
+ * @brief   Fixed point arithmetic with compile-time range tracking.
+ * @details @p Fixed<I, F> holds a signed value with @p I integer bits, sign
+ *          included, and @p F fractional bits: it covers
+ *          [-2^(I-1), 2^(I-1)) in steps of 2^-F. Values of up to 32 bits are
+ *          stored in an int32_t, wider ones in an int64_t. Either count may
+ *          be negative as long as the total is 1 to 64 bits, so that
+ *          scaling by powers of two only moves the binary point.
+ *
+ *          The operators return the type that holds every possible result
+ *          exactly. A sum gains one integer bit, a product adds up the
+ *          integer and the fractional bits of its operands. The arithmetic
+ *          is done at the width of the result type: 32 bits while it fits,
+ *          a 32x32->64 multiply or a 64 bit add only beyond that. A quotient
+ *          keeps the fractional bits of the dividend unless @p Div() asks
+ *          for more, and its numerator is only 64 bits wide when the
+ *          requested precision needs it. Narrowing, by @p As() (floor) or
+ *          @p Round(), is always explicit: that is where the caller states
+ *          the range the value is known to stay in.
+ *
+ *          Constants convert from floating point literals in constant
+ *          expressions. A literal out of range is a compile error and no
+ *          floating point code is left in the image.
+ *
+ *          The header does not depend on the kernel, tools/fixedref checks
+ *          it on the host against the MS8607 formulas.
+ *
+ * @addtogroup fixed_point
+ * @{
+ */
+
+#ifndef _FIXED_HPP_
+#define _FIXED_HPP_
+
+#include <stdint.h>
+
+namespace chibios_rt {
+
+  /** @cond */
+  namespace fixed_detail {
+    template <bool C, typename T = void> struct enable_if {};
+    template <typename T> struct enable_if<true, T> { typedef T type; };
+
+    template <bool Wide> struct storage { typedef int32_t type; };
+    template <> struct storage<true> { typedef int64_t type; };
+
+    constexpr int max(int a, int b) {
+      return a > b ? a : b;
+    }
+
+    /* Multiplies by 2^s, or divides by 2^-s rounding towards minus
+       infinity.*/
+    template <typename T>
+    constexpr T scale(T v, int s) {
+      return s >= 0 ? v * (T)((uint64_t)1 << s) : v >> -s;
+    }
+
+    /* Half of 2^s, zero when s is not positive.*/
+    template <typename T>
+    constexpr T half(int s) {
+      return s > 0 ? (T)((uint64_t)1 << (s - 1)) : 0;
+    }
+
+    constexpr double pow2(int n) {
+      return n == 0 ? 1.0 : n > 0 ? 2.0 * pow2(n - 1) : 0.5 * pow2(n + 1);
+    }
+
+    constexpr int64_t nearest(double v) {
+      return v < 0 ? (int64_t)(v - 0.5) : (int64_t)(v + 0.5);
+    }
+
+    /* Not constexpr: reaching it while evaluating a constant expression
+       makes the out of range constant a compile error.*/
+    inline int64_t out_of_range(int64_t v) {
+      return v;
+    }
+  }
+  /** @endcond */
+
+  /**
+   * @brief   Signed fixed point number.
+   *
+   * @tparam I          integer bits, sign included
+   * @tparam F          fractional bits
+   */
+  template <int I, int F>
+  class Fixed {
+    static_assert(I + F >= 1 && I + F <= 64,
+                  "Fixed<I, F> must be 1 to 64 bits wide");
+
+  public:
+    /**
+     * @brief   Storage type, the narrowest of int32_t and int64_t.
+     */
+    typedef typename fixed_detail::storage<(I + F > 32)>::type raw_t;
+
+    static const int int_bits = I;
+    static const int frac_bits = F;
+
+  private:
+    struct raw_tag {};
+
+    raw_t r;
+
+    constexpr Fixed(raw_t raw, raw_tag) : r(raw) {}
+
+    static constexpr int64_t MinRaw(void) {
+      return INT64_MIN >> (64 - (I + F));
+    }
+
+    static constexpr int64_t MaxRaw(void) {
+      return INT64_MAX >> (64 - (I + F));
+    }
+
+    static constexpr raw_t Checked(double scaled) {
+      return (scaled > (double)MinRaw() - 0.5) &&
+             (scaled < (double)MaxRaw() + 0.5) ?
+             (raw_t)fixed_detail::nearest(scaled) :
+             (raw_t)fixed_detail::out_of_range((int64_t)scaled);
+    }
+
+  public:
+    /**
+     * @brief   Zero.
+     */
+    constexpr Fixed(void) : r(0) {}
+
+    /**
+     * @brief   Conversion from a floating point constant.
+     * @details Rounds to the nearest step. Meant for literals in constant
+     *          expressions, where a value out of range does not compile;
+     *          used at run time it pulls in the floating point library.
+     *
+     * @param[in] v       value to be converted
+     */
+    explicit constexpr Fixed(double v)
+      : r(Checked(v * fixed_detail::pow2(F))) {}
+
+    /**
+     * @brief   Lossless conversion from a narrower type.
+     * @details Only participates when both the integer and the fractional
+     *          bits grow, anything else goes through @p As() or
+     *          @p Round().
+     *
+     * @param[in] o       value to be converted
+     */
+    template <int I2, int F2>
+    constexpr Fixed(const Fixed<I2, F2> &o,
+                    typename fixed_detail::enable_if<(I2 <= I) &&
+                                                     (F2 <= F)>::type * = 0)
+      : r(fixed_detail::scale<raw_t>((raw_t)o.Raw(), F - F2)) {}
+
+    /**
+     * @brief   Builds a value from its raw representation.
+     *
+     * @param[in] raw     value multiplied by 2^F
+     * @return            The value.
+     */
+    static constexpr Fixed FromRaw(raw_t raw) {
+      return Fixed(raw, raw_tag());
+    }
+
+    /**
+     * @brief   Builds a value from an integer.
+     * @note    The integer must be in range, this is not checked.
+     *
+     * @param[in] v       integer value
+     * @return            The value.
+     */
+    static constexpr Fixed FromInt(int64_t v) {
+      return Fixed(fixed_detail::scale<raw_t>((raw_t)v, F), raw_tag());
+    }
+
+    /**
+     * @brief   Smallest representable value.
+     */
+    static constexpr Fixed MinValue(void) {
+      return Fixed((raw_t)MinRaw(), raw_tag());
+    }
+
+    /**
+     * @brief   Largest representable value.
+     */
+    static constexpr Fixed MaxValue(void) {
+      return Fixed((raw_t)MaxRaw(), raw_tag());
+    }
+
+    /**
+     * @brief   Raw representation, the value multiplied by 2^F.
+     */
+    constexpr raw_t Raw(void) const {
+      return r;
+    }
+
+    /**
+     * @brief   Conversion to another format, rounding towards minus
+     *          infinity.
+     * @note    The value must be within the range of the target type,
+     *          this is not checked.
+     *
+     * @return            The converted value.
+     */
+    template <int I2, int F2>
+    constexpr Fixed<I2, F2> As(void) const {
+      typedef typename fixed_detail::storage<(I + F > 32) ||
+                                             (I2 + F2 > 32)>::type wide_t;
+      return Fixed<I2, F2>::FromRaw((typename Fixed<I2, F2>::raw_t)
+                 fixed_detail::scale<wide_t>((wide_t)r, F2 - F));
+    }
+
+    /**
+     * @brief   Conversion to another format, rounding to the nearest step.
+     * @note    The value must be within the range of the target type,
+     *          this is not checked.
+     *
+     * @return            The converted value.
+     */
+    template <int I2, int F2>
+    constexpr Fixed<I2, F2> Round(void) const {
+      typedef typename fixed_detail::storage<(I + F >= 32) ||
+                                             (I2 + F2 > 32)>::type wide_t;
+      return Fixed<I2, F2>::FromRaw((typename Fixed<I2, F2>::raw_t)
+                 fixed_detail::scale<wide_t>((wide_t)r +
+                     fixed_detail::half<wide_t>(F - F2), F2 - F));
+    }
+
+    /**
+     * @brief   Division by 2^N, only the binary point moves.
+     */
+    template <int N>
+    constexpr Fixed<I - N, F + N> Shr(void) const {
+      return Fixed<I - N, F + N>::FromRaw(r);
+    }
+
+    /**
+     * @brief   Multiplication by 2^N, only the binary point moves.
+     */
+    template <int N>
+    constexpr Fixed<I + N, F - N> Shl(void) const {
+      return Fixed<I + N, F - N>::FromRaw(r);
+    }
+
+    /**
+     * @brief   Integer part, rounded towards minus infinity.
+     */
+    constexpr raw_t ToInt(void) const {
+      return fixed_detail::scale<raw_t>(r, -F);
+    }
+
+    /**
+     * @brief   The value multiplied by @p K and rounded to an integer.
+     * @details Suited to the milli-unit integers of the sensor drivers. The
+     *          multiplication is 32 bits wide when the product fits.
+     * @note    The result must fit an int32_t, this is not checked.
+     */
+    template <int32_t K>
+    constexpr int32_t Scaled(void) const {
+      typedef typename fixed_detail::storage<(I + F + 32 - __builtin_clz(
+          (uint32_t)(K < 0 ? -K : K) | 1) > 32)>::type wide_t;
+      return (int32_t)fixed_detail::scale<wide_t>((wide_t)r * K +
+                 fixed_detail::half<wide_t>(F), -F);
+    }
+
+    /**
+     * @brief   Conversion to double, for tests and reports.
+     */
+    constexpr double ToDouble(void) const {
+      return (double)r / fixed_detail::pow2(F);
+    }
+
+    /**
+     * @brief   Negation, one integer bit wider so that -MinValue() fits.
+     */
+    constexpr Fixed<I + 1, F> operator-(void) const {
+      return Fixed<I + 1, F>::FromRaw(-(typename Fixed<I + 1, F>::raw_t)r);
+    }
+  };
+
+  /**
+   * @brief   Exact sum.
+   */
+  template <int Ia, int Fa, int Ib, int Fb>
+  constexpr Fixed<fixed_detail::max(Ia, Ib) + 1, fixed_detail::max(Fa, Fb)>
+  operator+(const Fixed<Ia, Fa> &a, const Fixed<Ib, Fb> &b) {
+    typedef Fixed<fixed_detail::max(Ia, Ib) + 1,
+                  fixed_detail::max(Fa, Fb)> R;
+    typedef typename R::raw_t raw_t;
+    return R::FromRaw(fixed_detail::scale<raw_t>((raw_t)a.Raw(),
+                                                 R::frac_bits - Fa) +
+                      fixed_detail::scale<raw_t>((raw_t)b.Raw(),
+                                                 R::frac_bits - Fb));
+  }
+
+  /**
+   * @brief   Exact difference.
+   */
+  template <int Ia, int Fa, int Ib, int Fb>
+  constexpr Fixed<fixed_detail::max(Ia, Ib) + 1, fixed_detail::max(Fa, Fb)>
+  operator-(const Fixed<Ia, Fa> &a, const Fixed<Ib, Fb> &b) {
+    typedef Fixed<fixed_detail::max(Ia, Ib) + 1,
+                  fixed_detail::max(Fa, Fb)> R;
+    typedef typename R::raw_t raw_t;
+    return R::FromRaw(fixed_detail::scale<raw_t>((raw_t)a.Raw(),
+                                                 R::frac_bits - Fa) -
+                      fixed_detail::scale<raw_t>((raw_t)b.Raw(),
+                                                 R::frac_bits - Fb));
+  }
+
+  /**
+   * @brief   Exact product.
+   * @details Two operands of up to 32 bits with a wider product compile to
+   *          a single 32x32->64 multiply.
+   */
+  template <int Ia, int Fa, int Ib, int Fb>
+  constexpr Fixed<Ia + Ib, Fa + Fb>
+  operator*(const Fixed<Ia, Fa> &a, const Fixed<Ib, Fb> &b) {
+    typedef typename Fixed<Ia + Ib, Fa + Fb>::raw_t raw_t;
+    return Fixed<Ia + Ib, Fa + Fb>::FromRaw((raw_t)a.Raw() * (raw_t)b.Raw());
+  }
+
+  /**
+   * @brief   Quotient with @p F fractional bits, truncated towards zero.
+   * @details The numerator is 64 bits wide only if the dividend shifted to
+   *          the requested precision does not fit 32 bits.
+   * @note    The divisor must not be zero and the quotient must be within
+   *          the range of the result, this is not checked.
+   */
+  template <int I, int F, int Ia, int Fa, int Ib, int Fb>
+  constexpr Fixed<I, F> Div(const Fixed<Ia, Fa> &a, const Fixed<Ib, Fb> &b) {
+    static_assert(F - Fa + Fb >= 0, "Div() cannot drop dividend bits");
+    static_assert(Ia + F + Fb <= 64, "Div() numerator exceeds 64 bits");
+    typedef typename fixed_detail::storage<(Ia + F + Fb > 32)>::type wide_t;
+    return Fixed<I, F>::FromRaw((typename Fixed<I, F>::raw_t)
+               (fixed_detail::scale<wide_t>((wide_t)a.Raw(), F - Fa + Fb) /
+                (wide_t)b.Raw()));
+  }
+
+  /**
+   * @brief   Quotient keeping the fractional bits of the dividend.
+   * @details The result type holds the largest quotient, a dividend at
+   *          the bottom of its range divided by minus one step.
+   */
+  template <int Ia, int Fa, int Ib, int Fb>
+  constexpr Fixed<Ia + Fb + 1, Fa>
+  operator/(const Fixed<Ia, Fa> &a, const Fixed<Ib, Fb> &b) {
+    return Div<Ia + Fb + 1, Fa>(a, b);
+  }
+
+  /** @cond */
+  namespace fixed_detail {
+    /* Both operands aligned to the finer one, compared in a type wide
+       enough for both.*/
+    template <int Ia, int Fa, int Ib, int Fb>
+    constexpr int compare(const Fixed<Ia, Fa> &a, const Fixed<Ib, Fb> &b) {
+      typedef typename storage<(max(Ia, Ib) + max(Fa, Fb) > 32)>::type wide_t;
+      return scale<wide_t>((wide_t)a.Raw(), max(Fa, Fb) - Fa) <
+             scale<wide_t>((wide_t)b.Raw(), max(Fa, Fb) - Fb) ? -1 :
+             scale<wide_t>((wide_t)a.Raw(), max(Fa, Fb) - Fa) >
+             scale<wide_t>((wide_t)b.Raw(), max(Fa, Fb) - Fb) ? 1 : 0;
+    }
+  }
+  /** @endcond */
+
+  template <int Ia, int Fa, int Ib, int Fb>
+  constexpr bool operator==(const Fixed<Ia, Fa> &a, const Fixed<Ib, Fb> &b) {
+    return fixed_detail::compare(a, b) == 0;
+  }
+
+  template <int Ia, int Fa, int Ib, int Fb>
+  constexpr bool operator!=(const Fixed<Ia, Fa> &a, const Fixed<Ib, Fb> &b) {
+    return fixed_detail::compare(a, b) != 0;
+  }
+
+  template <int Ia, int Fa, int Ib, int Fb>
+  constexpr bool operator<(const Fixed<Ia, Fa> &a, const Fixed<Ib, Fb> &b) {
+    return fixed_detail::compare(a, b) < 0;
+  }
+
+  template <int Ia, int Fa, int Ib, int Fb>
+  constexpr bool operator<=(const Fixed<Ia, Fa> &a, const Fixed<Ib, Fb> &b) {
+    return fixed_detail::compare(a, b) <= 0;
+  }
+
+  template <int Ia, int Fa, int Ib, int Fb>
+  constexpr bool operator>(const Fixed<Ia, Fa> &a, const Fixed<Ib, Fb> &b) {
+    return fixed_detail::compare(a, b) > 0;
+  }
+
+  template <int Ia, int Fa, int Ib, int Fb>
+  constexpr bool operator>=(const Fixed<Ia, Fa> &a, const Fixed<Ib, Fb> &b) {
+    return fixed_detail::compare(a, b) >= 0;
+  }
+
+  /**
+   * @brief   Type of the logarithms.
+   */
+  typedef Fixed<8, 24> FixedLog;
+
+  /** @cond */
+  namespace fixed_detail {
+    /* 1 / (1 + k / 16) in Q1.31, and minus the base 2 logarithm of the
+       rounded entry in Q8.24.*/
+    const uint32_t log2_recip[16] = {
+      2147483648u, 2021161080u, 1908874354u, 1808407283u,
+      1717986918u, 1636178018u, 1561806289u, 1493901668u,
+      1431655765u, 1374389535u, 1321528399u, 1272582903u,
+      1227133513u, 1184818564u, 1145324612u, 1108378657u
+    };
+    const int32_t log2_recip_log[16] = {
+      0,        1467383,  2850868,  4159533,
+      5401057,  6581994,  7707984,  8783912,
+      9814042,  10802114, 11751428, 12664911,
+      13545168, 14394532, 15215099, 16008758
+    };
+
+    /* Q2.30 product.*/
+    inline int32_t mul30(int32_t a, int32_t b) {
+      return (int32_t)(((int64_t)a * b) >> 30);
+    }
+  }
+  /** @endcond */
+
+  /**
+   * @brief   Base 2 logarithm.
+   * @details Normalizes the argument into [1, 2), brings it into
+   *          [1, 1 + 1/16) with the table reciprocal picked by its top four
+   *          fractional bits, and takes the logarithm of the rest from a
+   *          fifth order series: seven 32x32->64 multiplies, no division.
+   *          The error is within a few steps of 2^-24.
+   *
+   * @param[in] x       argument, must be positive
+   * @return            The logarithm, @p FixedLog::MinValue() if @p x is
+   *                    not positive.
+   */
+  template <int I, int F>
+  inline FixedLog Log2(const Fixed<I, F> &x) {
+    if (x.Raw() <= 0)
+      return FixedLog::MinValue();
+
+    uint64_t v = (uint64_t)x.Raw();
+    int msb = 63 - __builtin_clzll(v);
+    /* Mantissa in Q1.31.*/
+    uint32_t y = msb >= 31 ? (uint32_t)(v >> (msb - 31)) :
+                             (uint32_t)(v << (31 - msb));
+    unsigned k = (y >> 27) & 15;
+    /* y / (1 + k / 16) - 1 in Q2.30, within [-2^-30, 1/16).*/
+    int32_t e = (int32_t)((int64_t)((uint64_t)y * fixed_detail::log2_recip[k] -
+                                    ((uint64_t)1 << 62)) >> 32);
+    /* ln(1 + e) = e (1 - e (1/2 - e (1/3 - e (1/4 - e / 5)))).*/
+    int32_t p = (1 << 28) - fixed_detail::mul30(e, 214748365);
+    p = 357913941 - fixed_detail::mul30(e, p);
+    p = (1 << 29) - fixed_detail::mul30(e, p);
+    p = (1 << 30) - fixed_detail::mul30(e, p);
+    /* Times 1 / ln(2), rounded to Q8.24.*/
+    int32_t l = fixed_detail::mul30(fixed_detail::mul30(e, p), 1549082005);
+
+    return FixedLog::FromRaw((int32_t)(msb - F) * (1 << 24) +
+                             fixed_detail::log2_recip_log[k] + ((l + 32) >> 6));
+  }
+
+  /**
+   * @brief   Base 10 logarithm.
+   *
+   * @param[in] x       argument, must be positive
+   * @return            The logarithm, @p FixedLog::MinValue() if @p x is
+   *                    not positive.
+   */
+  template <int I, int F>
+  inline FixedLog Log10(const Fixed<I, F> &x) {
+    if (x.Raw() <= 0)
+      return FixedLog::MinValue();
+    FixedLog l2 = Log2(x);
+    return (l2 * Fixed<1, 31>(0.30102999566398120)).Round<8, 24>();
+  }
+}
+
+#endif /* _FIXED_HPP_ */
+
+/** @} */
@@ -0,0 +1,527 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    fixfft.c
+ * @brief   Fixed point real FFT and band power analysis code.
+ *
+ * @addtogroup fixfft
+ * @{
+ */
+
+#include <string.h>
+
+#include "fixfft.h"
+
+/*
+ * Complex values are packed into 32 bit words, the real part in the low
+ * half, so the n/2 complex inputs of the real FFT are just the n real
+ * samples read two at a time.
+ */
+
+#if (defined(__ARM_FEATURE_SIMD32) && (!defined(__thumb__) || defined(__thumb2__))) || \
+    defined(__DOXYGEN__)
+/* ARMv6 SIMD, not available in Thumb-1 code.*/
+
+#define SIMD2(op)                                                           \
+static inline uint32_t op(uint32_t a, uint32_t b) {                         \
+  uint32_t r;                                                               \
+  __asm__ (#op " %0, %1, %2" : "=r" (r) : "r" (a), "r" (b));                \
+  return r;                                                                 \
+}
+
+SIMD2(shadd16)
+SIMD2(shsub16)
+SIMD2(shasx)
+SIMD2(shsax)
+SIMD2(qsub16)
+SIMD2(smusd)
+SIMD2(smuadx)
+SIMD2(smulbb)
+SIMD2(smultt)
+
+static inline int64_t smlald(int64_t acc, uint32_t a, uint32_t b) {
+
+  __asm__ ("smlald %Q0, %R0, %1, %2" : "+r" (acc) : "r" (a), "r" (b));
+  return acc;
+}
+
+/* Low half of a, low half of b in the high half.*/
+static inline uint32_t pkhbt(uint32_t a, uint32_t b) {
+  uint32_t r;
+
+  __asm__ ("pkhbt %0, %1, %2, lsl #16" : "=r" (r) : "r" (a), "r" (b));
+  return r;
+}
+
+/* High half of a, bits 30..15 of b in the low half.*/
+static inline uint32_t pkhtb15(uint32_t a, uint32_t b) {
+  uint32_t r;
+
+  __asm__ ("pkhtb %0, %1, %2, asr #15" : "=r" (r) : "r" (a), "r" (b));
+  return r;
+}
+
+#else /* !__ARM_FEATURE_SIMD32 */
+/* Exact C equivalents of the instructions above.*/
+
+#define LO(x)       ((int32_t)(int16_t)(x))
+#define HI(x)       ((int32_t)(int16_t)((x) >> 16))
+#define PACK(l, h)  ((uint32_t)(uint16_t)(l) | ((uint32_t)(uint16_t)(h) << 16))
+
+static int32_t sat16(int32_t x) {
+
+  return x > 32767 ? 32767 : x < -32768 ? -32768 : x;
+}
+
+static uint32_t shadd16(uint32_t a, uint32_t b) {
+
+  return PACK((LO(a) + LO(b)) >> 1, (HI(a) + HI(b)) >> 1);
+}
+
+static uint32_t shsub16(uint32_t a, uint32_t b) {
+
+  return PACK((LO(a) - LO(b)) >> 1, (HI(a) - HI(b)) >> 1);
+}
+
+static uint32_t shasx(uint32_t a, uint32_t b) {
+
+  return PACK((LO(a) - HI(b)) >> 1, (HI(a) + LO(b)) >> 1);
+}
+
+static uint32_t shsax(uint32_t a, uint32_t b) {
+
+  return PACK((LO(a) + HI(b)) >> 1, (HI(a) - LO(b)) >> 1);
+}
+
+static uint32_t qsub16(uint32_t a, uint32_t b) {
+
+  return PACK(sat16(LO(a) - LO(b)), sat16(HI(a) - HI(b)));
+}
+
+static uint32_t smusd(uint32_t a, uint32_t b) {
+
+  return (uint32_t)(LO(a) * LO(b)) - (uint32_t)(HI(a) * HI(b));
+}
+
+static uint32_t smuadx(uint32_t a, uint32_t b) {
+
+  return (uint32_t)(LO(a) * HI(b)) + (uint32_t)(HI(a) * LO(b));
+}
+
+static uint32_t smulbb(uint32_t a, uint32_t b) {
+
+  return (uint32_t)(LO(a) * LO(b));
+}
+
+static uint32_t smultt(uint32_t a, uint32_t b) {
+
+  return (uint32_t)(HI(a) * HI(b));
+}
+
+static int64_t smlald(int64_t acc, uint32_t a, uint32_t b) {
+
+  return acc + (int64_t)LO(a) * LO(b) + (int64_t)HI(a) * HI(b);
+}
+
+static uint32_t pkhbt(uint32_t a, uint32_t b) {
+
+  return (a & 0xFFFF) | (b << 16);
+}
+
+static uint32_t pkhtb15(uint32_t a, uint32_t b) {
+
+  return (a & 0xFFFF0000) | (((uint32_t)((int32_t)b >> 15)) & 0xFFFF);
+}
+
+#endif /* !__ARM_FEATURE_SIMD32 */
+
+/*
+ * Quarter wave of sin(2*pi*i/FFT_MAX_SIZE), Q15.
+ */
+static const int16_t sintab[FFT_MAX_SIZE / 4 + 1] = {
+      0,   201,   402,   603,   804,  1005,  1206,  1407,  1608,  1809,
+   2009,  2210,  2411,  2611,  2811,  3012,  3212,  3412,  3612,  3812,
+   4011,  4211,  4410,  4609,  4808,  5007,  5205,  5404,  5602,  5800,
+   5998,  6195,  6393,  6590,  6787,  6983,  7180,  7376,  7571,  7767,
+   7962,  8157,  8351,  8546,  8740,  8933,  9127,  9319,  9512,  9704,
+   9896, 10088, 10279, 10469, 10660, 10850, 11039, 11228, 11417, 11605,
+  11793, 11980, 12167, 12354, 12540, 12725, 12910, 13095, 13279, 13463,
+  13646, 13828, 14010, 14192, 14373, 14553, 14733, 14912, 15091, 15269,
+  15447, 15624, 15800, 15976, 16151, 16326, 16500, 16673, 16846, 17018,
+  17190, 17361, 17531, 17700, 17869, 18037, 18205, 18372, 18538, 18703,
+  18868, 19032, 19195, 19358, 19520, 19681, 19841, 20001, 20160, 20318,
+  20475, 20632, 20788, 20943, 21097, 21251, 21403, 21555, 21706, 21856,
+  22006, 22154, 22302, 22449, 22595, 22740, 22884, 23028, 23170, 23312,
+  23453, 23593, 23732, 23870, 24008, 24144, 24279, 24414, 24548, 24680,
+  24812, 24943, 25073, 25202, 25330, 25457, 25583, 25708, 25833, 25956,
+  26078, 26199, 26320, 26439, 26557, 26674, 26791, 26906, 27020, 27133,
+  27246, 27357, 27467, 27576, 27684, 27791, 27897, 28002, 28106, 28209,
+  28311, 28411, 28511, 28610, 28707, 28803, 28899, 28993, 29086, 29178,
+  29269, 29359, 29448, 29535, 29622, 29707, 29792, 29875, 29957, 30038,
+  30118, 30196, 30274, 30350, 30425, 30499, 30572, 30644, 30715, 30784,
+  30853, 30920, 30986, 31050, 31114, 31177, 31238, 31298, 31357, 31415,
+  31471, 31527, 31581, 31634, 31686, 31737, 31786, 31834, 31881, 31927,
+  31972, 32015, 32058, 32099, 32138, 32177, 32214, 32251, 32286, 32319,
+  32352, 32383, 32413, 32442, 32470, 32496, 32522, 32546, 32568, 32590,
+  32610, 32629, 32647, 32664, 32679, 32693, 32706, 32718, 32729, 32738,
+  32746, 32753, 32758, 32762, 32766, 32767, 32767
+};
+
+/**
+ * @brief   sin(2*pi*idx/FFT_MAX_SIZE), Q15.
+ */
+static int32_t sin_q15(unsigned idx) {
+  unsigned r = idx % (FFT_MAX_SIZE / 4);
+
+  switch ((idx / (FFT_MAX_SIZE / 4)) & 3) {
+  case 0:
+    return sintab[r];
+  case 1:
+    return sintab[FFT_MAX_SIZE / 4 - r];
+  case 2:
+    return -sintab[r];
+  default:
+    return -sintab[FFT_MAX_SIZE / 4 - r];
+  }
+}
+
+/**
+ * @brief   Twiddle factor exp(-j*2*pi*idx/FFT_MAX_SIZE), packed.
+ */
+static uint32_t twiddle(unsigned idx) {
+
+  return (uint32_t)(uint16_t)sin_q15(idx + FFT_MAX_SIZE / 4) |
+         ((uint32_t)(uint16_t)-sin_q15(idx) << 16);
+}
+
+/**
+ * @brief   Complex product of @p x and the Q15 twiddle @p w.
+ */
+static inline uint32_t cmul(uint32_t x, uint32_t w) {
+
+  return pkhtb15(smuadx(x, w) << 1, smusd(x, w));
+}
+
+/**
+ * @brief   Complex conjugate.
+ */
+static inline uint32_t cconj(uint32_t x) {
+
+  return pkhbt(x, qsub16(0, x) >> 16);
+}
+
+/**
+ * @brief   In place complex FFT of @p m points, scaled by 1/m.
+ * @details Each radix-4 butterfly stores its outputs 0, 2, 1, 3, which
+ *          makes it two radix-2 stages fused: the output is in plain bit
+ *          reversed order whether or not a last radix-2 stage is needed.
+ */
+static void cfft_q15(uint32_t *x, size_t m) {
+  size_t len, q, i, j;
+
+  for (len = m; len >= 4; len >>= 2) {
+    unsigned stride = FFT_MAX_SIZE / len;
+
+    q = len / 4;
+    for (i = 0; i < q; i++) {
+      uint32_t w1 = twiddle(i * stride);
+      uint32_t w2 = twiddle(2 * i * stride);
+      uint32_t w3 = twiddle(3 * i * stride);
+
+      for (j = i; j < m; j += len) {
+        uint32_t *p = x + j;
+        uint32_t a = shadd16(p[0], p[2 * q]);
+        uint32_t b = shsub16(p[0], p[2 * q]);
+        uint32_t c = shadd16(p[q], p[3 * q]);
+        uint32_t d = shsub16(p[q], p[3 * q]);
+
+        p[0] = shadd16(a, c);
+        if (i == 0) {
+          p[q] = shsub16(a, c);
+          p[2 * q] = shsax(b, d);
+          p[3 * q] = shasx(b, d);
+        }
+        else {
+          p[q] = cmul(shsub16(a, c), w2);
+          p[2 * q] = cmul(shsax(b, d), w1);
+          p[3 * q] = cmul(shasx(b, d), w3);
+        }
+      }
+    }
+  }
+
+  if (len == 2) {
+    for (j = 0; j < m; j += 2) {
+      uint32_t a = x[j];
+
+      x[j] = shadd16(a, x[j + 1]);
+      x[j + 1] = shsub16(a, x[j + 1]);
+    }
+  }
+
+  for (i = 0, j = 0; i < m; i++) {
+    size_t bit = m >> 1;
+
+    if (i < j) {
+      uint32_t t = x[i];
+      x[i] = x[j];
+      x[j] = t;
+    }
+    while (j & bit) {
+      j ^= bit;
+      bit >>= 1;
+    }
+    j |= bit;
+  }
+}
+
+/**
+ * @brief   Real spectrum bin from the complex bins @p k and @p m-k.
+ * @details X[k] = (Xe[k] + W^k * Xo[k]) / 2, where Xe and Xo are the even
+ *          and odd samples spectra, (Z[k] + Z*[m-k]) / 2 and
+ *          (Z[k] - Z*[m-k]) / 2j.
+ */
+static inline uint32_t split(uint32_t zk, uint32_t zmk, uint32_t w) {
+  uint32_t c = cconj(zmk);
+  uint32_t d = shsub16(zk, c);
+
+  return shadd16(shadd16(zk, c), cmul(pkhbt(d >> 16, qsub16(0, d)), w));
+}
+
+/**
+ * @brief   In place real FFT.
+ * @details The result is the DFT of the input divided by @p n, bins 0 to
+ *          @p n/2 stored as described in the module documentation.
+ *
+ * @param[in,out] buf   @p n Q15 samples within +/-16384, 4 bytes aligned
+ * @param[in] n         FFT size, a power of 2 from @p FFT_MIN_SIZE to
+ *                      @p FFT_MAX_SIZE
+ */
+void fftRealQ15(int16_t *buf, size_t n) {
+  uint32_t *z = (uint32_t *)buf;
+  size_t m = n / 2, k;
+  unsigned stride = FFT_MAX_SIZE / n;
+  int32_t re, im;
+
+  cfft_q15(z, m);
+
+  /* DC and Nyquist, both real.*/
+  re = (int16_t)z[0];
+  im = (int16_t)(z[0] >> 16);
+  z[0] = (uint32_t)(uint16_t)((re + im) >> 1) |
+         ((uint32_t)(uint16_t)((re - im) >> 1) << 16);
+
+  for (k = 1; k <= m / 2; k++) {
+    uint32_t zk = z[k], zmk = z[m - k];
+
+    z[k] = split(zk, zmk, twiddle(k * stride));
+    if (k != m - k)
+      z[m - k] = split(zmk, zk, twiddle((m - k) * stride));
+  }
+}
+
+/**
+ * @brief   Periodic Hann window coefficients, Q15.
+ *
+ * @param[out] window   @p n coefficients
+ * @param[in] n         window size, a power of 2 up to @p FFT_MAX_SIZE
+ */
+void fftWindowHann(int16_t *window, size_t n) {
+  unsigned stride = FFT_MAX_SIZE / n;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    window[i] = (int16_t)((32767 - sin_q15(i * stride + FFT_MAX_SIZE / 4)) >> 1);
+}
+
+/**
+ * @brief   Multiplies samples by Q15 window coefficients, in place.
+ *
+ * @param[in,out] buf   @p n samples, 4 bytes aligned
+ * @param[in] window    @p n coefficients, 4 bytes aligned
+ * @param[in] n         number of samples, even
+ */
+void fftApplyWindowQ15(int16_t *buf, const int16_t *window, size_t n) {
+  uint32_t *xp = (uint32_t *)buf;
+  const uint32_t *wp = (const uint32_t *)window;
+
+  for (n /= 2; n > 0; n--, xp++, wp++)
+    *xp = pkhbt((int32_t)smulbb(*xp, *wp) >> 15,
+                (int32_t)smultt(*xp, *wp) >> 15);
+}
+
+/**
+ * @brief   One-sided energy of a band of a real spectrum.
+ * @details Bins other than DC and Nyquist count twice, for their negative
+ *          frequency image, so a whole spectrum sums to the mean square of
+ *          the transformed samples.
+ *
+ * @param[in] spectrum  output of @p fftRealQ15()
+ * @param[in] n         FFT size
+ * @param[in] lo        first bin
+ * @param[in] hi        bin past the last one, at most @p n/2+1
+ * @return              Sum of the squared magnitudes, Q30.
+ */
+uint64_t fftBandEnergyQ15(const int16_t *spectrum, size_t n,
+                          unsigned lo, unsigned hi) {
+  const uint32_t *s = (const uint32_t *)spectrum;
+  unsigned m = n / 2, k;
+  uint64_t edges = 0;
+  int64_t sum = 0;
+
+  if (lo == 0) {
+    edges += (int32_t)smulbb(s[0], s[0]);
+    lo = 1;
+  }
+  if (hi > m) {
+    edges += (int32_t)smultt(s[0], s[0]);
+    hi = m;
+  }
+  for (k = lo; k < hi; k++)
+    sum = smlald(sum, s[k], s[k]);
+  return ((uint64_t)sum << 1) + edges;
+}
+
+/**
+ * @brief   Transforms the collected frame and accumulates the bands.
+ */
+static void analyze(FftAnalyzer *ap) {
+  const FftAnalyzerConfig *cfgp = ap->config;
+  size_t n = cfgp->n, i;
+  int64_t sum = 0;
+  int32_t mean;
+  uint32_t dmax = 0;
+  int s, sh;
+  unsigned b;
+
+  /* Mean removal and block floating point scaling into 14 bits.*/
+  for (i = 0; i < n; i++)
+    sum += cfgp->history[i];
+  mean = (int32_t)(sum / (int64_t)n);
+  for (i = 0; i < n; i++) {
+    int32_t d = cfgp->history[i] - mean;
+    uint32_t a = d < 0 ? -(uint32_t)d : (uint32_t)d;
+
+    if (a > dmax)
+      dmax = a;
+  }
+  s = 14 - (dmax != 0 ? 32 - __builtin_clz(dmax) : 0);
+  for (i = 0; i < n; i++) {
+    int32_t d = cfgp->history[i] - mean;
+
+    cfgp->work[i] = (int16_t)(s >= 0 ? d * (1 << s) : d >> -s);
+  }
+
+  fftApplyWindowQ15(cfgp->work, cfgp->window, n);
+  fftRealQ15(cfgp->work, n);
+
+  /* Back to the input units, saturating.*/
+  sh = FFT_POWER_FRAC - 2 * s;
+  for (b = 0; b < cfgp->nbands; b++) {
+    uint64_t e = fftBandEnergyQ15(cfgp->work, n,
+                                  cfgp->bands[b].lo, cfgp->bands[b].hi);
+
+    if (sh < 0)
+      e >>= -sh;
+    else if (e > (UINT64_MAX >> sh))
+      e = UINT64_MAX;
+    else
+      e <<= sh;
+    ap->power[b] = ap->power[b] > UINT64_MAX - e ? UINT64_MAX
+                                                   : ap->power[b] + e;
+  }
+  ap->frames++;
+}
+
+/**
+ * @brief   Initializes an analyzer.
+ *
+ * @param[out] ap       pointer to the @p FftAnalyzer object
+ * @param[in] cfgp      analyzer parameters, must stay valid while in use
+ */
+void fftAnalyzerInit(FftAnalyzer *ap, const FftAnalyzerConfig *cfgp) {
+  uint64_t sum = 0;
+  size_t i;
+
+  ap->config = cfgp;
+  ap->fill = 0;
+  ap->frames = 0;
+  memset(ap->power, 0, sizeof ap->power);
+
+  /* The window loss is the mean of the squared coefficients.*/
+  fftWindowHann(cfgp->window, cfgp->n);
+  for (i = 0; i < cfgp->n; i++)
+    sum += (uint32_t)(cfgp->window[i] * cfgp->window[i]);
+  ap->gain = (uint32_t)(((uint64_t)1 << 46) / (sum / cfgp->n));
+}
+
+/**
+ * @brief   Adds a sample to the analyzer.
+ * @details A frame is analyzed every @p hop samples once the first @p n
+ *          have been collected.
+ *
+ * @param[in] ap        pointer to the @p FftAnalyzer object
+ * @param[in] sample    the sample, the frame deviations from their mean
+ *                      must fit in 31 bits
+ * @return              Nonzero if a frame was analyzed.
+ */
+int fftAnalyzerPut(FftAnalyzer *ap, int32_t sample) {
+  const FftAnalyzerConfig *cfgp = ap->config;
+
+  cfgp->history[ap->fill++] = sample;
+  if (ap->fill < cfgp->n)
+    return 0;
+
+  analyze(ap);
+  memmove(cfgp->history, cfgp->history + cfgp->hop,
+          (cfgp->n - cfgp->hop) * sizeof (int32_t));
+  ap->fill = cfgp->n - cfgp->hop;
+  return 1;
+}
+
+/**
+ * @brief   Returns the band powers averaged since the last read.
+ * @details The accumulators are reset.
+ *
+ * @param[in] ap        pointer to the @p FftAnalyzer object
+ * @param[out] power    band mean square values in input units squared,
+ *                      with @p FFT_POWER_FRAC fractional bits, one per band
+ * @return              The number of frames averaged, zero if none and
+ *                      then the powers are zero.
+ */
+uint32_t fftAnalyzerRead(FftAnalyzer *ap, uint64_t *power) {
+  uint32_t frames = ap->frames;
+  unsigned b;
+
+  for (b = 0; b < ap->config->nbands; b++) {
+    uint64_t v = frames > 0 ? ap->power[b] / frames : 0;
+
+    if ((v >> 16) > UINT64_MAX / ap->gain)
+      power[b] = UINT64_MAX;
+    else
+      power[b] = (v >> 16) * ap->gain + (((v & 0xFFFF) * ap->gain) >> 16);
+    ap->power[b] = 0;
+  }
+  ap->frames = 0;
+  return frames;
+}
+
+/** @} */
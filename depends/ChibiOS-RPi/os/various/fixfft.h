@@ -0,0 +1,149 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    fixfft.h
+ * @brief   Fixed point real FFT and band power analysis.
+ * @details The FFT works in place on Q15 samples. The @p n real samples are
+ *          transformed as @p n/2 complex ones by a radix-4 decimation in
+ *          frequency FFT, followed by a radix-2 stage when @p n/2 is not a
+ *          power of 4, and then split into the @p n/2+1 bins of the real
+ *          spectrum. Each stage halves or quarters its outputs, so the
+ *          result is the DFT divided by @p n and nothing overflows as long
+ *          as the inputs stay within +/-16384.
+ *          The spectrum is stored as pairs of int16_t real and imaginary
+ *          parts. Bins 0 (DC) and @p n/2 (Nyquist) are both real, they
+ *          share the first pair.
+ *
+ *          On ARMv6 the butterflies run on the dual 16 bit SIMD
+ *          instructions. Elsewhere, as on the host reference, the same
+ *          arithmetic is done in plain C and the results are bit identical.
+ *
+ *          The analyzer turns a stream of integer samples, e.g. pressure
+ *          readings, into band powers. Each frame of @p n samples has its
+ *          mean removed, is scaled into 14 bits (block floating point),
+ *          Hann windowed and transformed. The power of each configured band
+ *          is accumulated in the input units squared, corrected for the
+ *          window loss, so that the bands of a whole spectrum add up to the
+ *          variance of the input.
+ *
+ * @addtogroup fixfft
+ * @{
+ */
+
+#ifndef _FIXFFT_H_
+#define _FIXFFT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief   Largest FFT size, the twiddle table is sized for it.
+ */
+#define FFT_MAX_SIZE                1024
+
+/**
+ * @brief   Smallest FFT size.
+ */
+#define FFT_MIN_SIZE                16
+
+/**
+ * @brief   Largest number of bands per analyzer.
+ */
+#if !defined(FFT_MAX_BANDS) || defined(__DOXYGEN__)
+#define FFT_MAX_BANDS               8
+#endif
+
+/**
+ * @brief   Fractional bits of the analyzer band powers.
+ */
+#define FFT_POWER_FRAC              8
+
+/**
+ * @brief   Bin holding frequency @p f for @p n samples at rate @p fs.
+ * @details @p f and @p fs in the same unit, e.g. mHz.
+ */
+#define FFT_BIN(f, fs, n)           ((unsigned)((uint64_t)(f) * (n) / (fs)))
+
+/**
+ * @brief   Band of bins, @p lo included, @p hi excluded.
+ * @note    Bin @p n/2 is included with @p hi equal to @p n/2+1.
+ */
+typedef struct {
+  uint16_t              lo;
+  uint16_t              hi;
+} FftBand;
+
+/**
+ * @brief   Analyzer parameters.
+ * @details The three buffers are @p n elements each, @p work must be 4
+ *          bytes aligned.
+ */
+typedef struct {
+  /** @brief FFT size, a power of 2 within the size limits.*/
+  size_t                n;
+  /** @brief Samples between frames, @p n/2 for the usual 50% overlap.*/
+  size_t                hop;
+  /** @brief Bands to be accumulated.*/
+  const FftBand         *bands;
+  /** @brief Number of bands, at most @p FFT_MAX_BANDS.*/
+  unsigned              nbands;
+  /** @brief Input samples of the frame being collected.*/
+  int32_t               *history;
+  /** @brief FFT work area.*/
+  int16_t               *work;
+  /** @brief Window coefficients, written by @p fftAnalyzerInit().*/
+  int16_t               *window;
+} FftAnalyzerConfig;
+
+/**
+ * @brief   Analyzer state.
+ */
+typedef struct {
+  /** @brief Analyzer parameters.*/
+  const FftAnalyzerConfig *config;
+  /** @brief Samples in @p history.*/
+  size_t                fill;
+  /** @brief Frames accumulated since the last read.*/
+  uint32_t              frames;
+  /** @brief Window power loss correction, Q16.*/
+  uint32_t              gain;
+  /** @brief Band power accumulators.*/
+  uint64_t              power[FFT_MAX_BANDS];
+} FftAnalyzer;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void fftRealQ15(int16_t *buf, size_t n);
+  void fftWindowHann(int16_t *window, size_t n);
+  void fftApplyWindowQ15(int16_t *buf, const int16_t *window, size_t n);
+  uint64_t fftBandEnergyQ15(const int16_t *spectrum, size_t n,
+                            unsigned lo, unsigned hi);
+  void fftAnalyzerInit(FftAnalyzer *ap, const FftAnalyzerConfig *cfgp);
+  int fftAnalyzerPut(FftAnalyzer *ap, int32_t sample);
+  uint32_t fftAnalyzerRead(FftAnalyzer *ap, uint64_t *power);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FIXFFT_H_ */
+
+/** @} */
@@ -0,0 +1,139 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    lvtable.c
+ * @brief   Latest value table.
+ *
+ * @addtogroup lvtable
+ * @{
+ */
+
+#include "ch.h"
+#include "lvtable.h"
+
+/* Keeps the compiler from moving record accesses across the sequence
+   counter accesses. The ARM11 is a single core, its own loads and stores
+   are seen in order and no hardware barrier is needed.*/
+#define LV_BARRIER()        __asm__ volatile ("" : : : "memory")
+
+/**
+ * @brief   Initializes a table, all its channels never written.
+ *
+ * @param[out] tp       pointer to the @p LvTable object
+ * @param[in] channels  array of @p n channels
+ * @param[in] n         number of channels
+ *
+ * @init
+ */
+void lvObjectInit(LvTable *tp, LvChannel *channels, unsigned n) {
+  unsigned i;
+
+  chDbgCheck((tp != NULL) && (channels != NULL), "lvObjectInit");
+
+  tp->channels = channels;
+  tp->n = n;
+  for (i = 0; i < n; i++) {
+    channels[i].seq = 0;
+    channels[i].rec.stamp = 0;
+    channels[i].rec.count = 0;
+  }
+}
+
+/**
+ * @brief   Publishes the newest values of a channel.
+ *
+ * @param[in] tp        pointer to the @p LvTable object
+ * @param[in] ch        channel index
+ * @param[in] values    @p LV_VALUES values
+ *
+ * @iclass
+ */
+void lvWriteI(LvTable *tp, unsigned ch, const int32_t *values) {
+  LvChannel *cp;
+  unsigned i;
+
+  chDbgCheckClassI();
+  chDbgCheck((tp != NULL) && (ch < tp->n) && (values != NULL), "lvWriteI");
+
+  cp = &tp->channels[ch];
+  cp->seq++;
+  LV_BARRIER();
+  cp->rec.stamp = chTimeNow();
+  cp->rec.count++;
+  for (i = 0; i < LV_VALUES; i++)
+    cp->rec.value[i] = values[i];
+  LV_BARRIER();
+  cp->seq++;
+}
+
+/**
+ * @brief   Publishes the newest values of a channel.
+ * @details The interrupts stay masked for the copy of one record only.
+ *
+ * @param[in] tp        pointer to the @p LvTable object
+ * @param[in] ch        channel index
+ * @param[in] values    @p LV_VALUES values
+ *
+ * @api
+ */
+void lvWrite(LvTable *tp, unsigned ch, const int32_t *values) {
+
+  chSysLock();
+  lvWriteI(tp, ch, values);
+  chSysUnlock();
+}
+
+/**
+ * @brief   Reads the newest record of a channel.
+ * @details Never blocks a writer. The copy is retried when a write
+ *          preempted it, a reader is only delayed by writes.
+ * @note    Can be called from any context, ISRs included.
+ *
+ * @param[in] tp        pointer to the @p LvTable object
+ * @param[in] ch        channel index
+ * @param[out] rp       pointer to the @p LvRecord to fill, its @p count is
+ *                      zero if the channel was never written
+ * @return              The number of copies retried.
+ *
+ * @api
+ */
+uint32_t lvRead(const LvTable *tp, unsigned ch, LvRecord *rp) {
+  const LvChannel *cp;
+  uint32_t seq, retries = 0;
+
+  chDbgCheck((tp != NULL) && (ch < tp->n) && (rp != NULL), "lvRead");
+
+  cp = &tp->channels[ch];
+  while (TRUE) {
+    seq = cp->seq;
+    LV_BARRIER();
+    if ((seq & 1) == 0) {
+      *rp = cp->rec;
+      LV_READ_HOOK(ch);
+      LV_BARRIER();
+      if (cp->seq == seq)
+        return retries;
+    }
+    retries++;
+  }
+}
+
+/** @} */
@@ -0,0 +1,96 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    lvtable.h
+ * @brief   Latest value table.
+ * @details Holds the newest record of each channel for any number of
+ *          readers. A write never waits: it updates the record with the
+ *          interrupts masked, between two increments of the channel
+ *          sequence counter. A reader copies the record without any lock
+ *          and copies it again if the counter changed meanwhile, which
+ *          only happens when a write preempted the copy.
+ *
+ * @addtogroup lvtable
+ * @{
+ */
+
+#ifndef _LVTABLE_H_
+#define _LVTABLE_H_
+
+/**
+ * @brief   Values per record.
+ */
+#if !defined(LV_VALUES) || defined(__DOXYGEN__)
+#define LV_VALUES                   3
+#endif
+
+/**
+ * @brief   Invoked by readers between copying a record and validating it.
+ * @details Empty by default, tests use it to force writes in the middle of
+ *          a copy, it can be defined in @p chconf.h.
+ */
+#if !defined(LV_READ_HOOK) || defined(__DOXYGEN__)
+#define LV_READ_HOOK(ch)
+#endif
+
+/**
+ * @brief   Newest record of a channel.
+ */
+typedef struct {
+  /** @brief System time of the write.*/
+  systime_t             stamp;
+  /** @brief Writes so far, zero if the channel was never written.*/
+  uint32_t              count;
+  /** @brief Values, meaning defined by the writer.*/
+  int32_t               value[LV_VALUES];
+} LvRecord;
+
+/**
+ * @brief   One channel.
+ */
+typedef struct {
+  /** @brief Odd while a write is in progress.*/
+  volatile uint32_t     seq;
+  LvRecord              rec;
+} LvChannel;
+
+/**
+ * @brief   Latest value table.
+ */
+typedef struct {
+  LvChannel             *channels;
+  unsigned              n;
+} LvTable;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void lvObjectInit(LvTable *tp, LvChannel *channels, unsigned n);
+  void lvWriteI(LvTable *tp, unsigned ch, const int32_t *values);
+  void lvWrite(LvTable *tp, unsigned ch, const int32_t *values);
+  uint32_t lvRead(const LvTable *tp, unsigned ch, LvRecord *rp);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LVTABLE_H_ */
+
+/** @} */
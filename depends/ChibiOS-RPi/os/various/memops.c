@@ -0,0 +1,211 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    memops.c
+ * @brief   Portable memory and string routines.
+ * @details C versions of the assembly routines of the ARM port,
+ *          os/ports/GCC/ARM/armmem.s, taking the same paths block for
+ *          block: bytes up to an aligned destination, 32 byte bursts of
+ *          aligned words, 16 byte bursts merged by shifts when the source
+ *          is not aligned with the destination, then bytes. They replace
+ *          the C library ones on ports without an assembly version and let
+ *          the Posix build test the block logic.
+ * @note    This file must be compiled with @p -fno-builtin and
+ *          @p -fno-tree-loop-distribute-patterns, or the compiler turns the
+ *          byte loops back into calls to these very functions.
+ *
+ * @addtogroup memops
+ * @{
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define WORD_SIZE                   4U
+
+/**
+ * @brief   Word access to byte buffers.
+ */
+typedef uint32_t __attribute__((may_alias)) word_t;
+
+static int is_aligned(const void *p) {
+
+  return ((uintptr_t)p & (WORD_SIZE - 1)) == 0;
+}
+
+/**
+ * @brief   Copies a memory area.
+ * @note    The shifted merge reads aligned words only, never past the word
+ *          holding the last source byte.
+ */
+void *memcpy(void *dst, const void *src, size_t n) {
+  uint8_t *d = dst;
+  const uint8_t *s = src;
+
+  if (n >= 2 * WORD_SIZE) {
+    while (!is_aligned(d)) {
+      *d++ = *s++;
+      n--;
+    }
+    if (is_aligned(s)) {
+      word_t *dw = (word_t *)d;
+      const word_t *sw = (const word_t *)s;
+
+      for (; n >= 8 * WORD_SIZE; n -= 8 * WORD_SIZE) {
+        dw[0] = sw[0]; dw[1] = sw[1]; dw[2] = sw[2]; dw[3] = sw[3];
+        dw[4] = sw[4]; dw[5] = sw[5]; dw[6] = sw[6]; dw[7] = sw[7];
+        dw += 8;
+        sw += 8;
+      }
+      for (; n >= WORD_SIZE; n -= WORD_SIZE)
+        *dw++ = *sw++;
+      d = (uint8_t *)dw;
+      s = (const uint8_t *)sw;
+    }
+    else {
+      unsigned off = (uintptr_t)s & (WORD_SIZE - 1);
+      unsigned rs = 8 * off, ls = 32 - rs;
+      const word_t *sw = (const word_t *)(s - off);
+      word_t *dw = (word_t *)d;
+      uint32_t w = *sw++;
+
+      for (; n >= 4 * WORD_SIZE; n -= 4 * WORD_SIZE) {
+        uint32_t w0 = sw[0], w1 = sw[1], w2 = sw[2], w3 = sw[3];
+
+        dw[0] = (w >> rs) | (w0 << ls);
+        dw[1] = (w0 >> rs) | (w1 << ls);
+        dw[2] = (w1 >> rs) | (w2 << ls);
+        dw[3] = (w2 >> rs) | (w3 << ls);
+        w = w3;
+        sw += 4;
+        dw += 4;
+      }
+      for (; n >= WORD_SIZE; n -= WORD_SIZE) {
+        uint32_t next = *sw++;
+
+        *dw++ = (w >> rs) | (next << ls);
+        w = next;
+      }
+      d = (uint8_t *)dw;
+      s = (const uint8_t *)(sw - 1) + off;
+    }
+  }
+  while (n-- > 0)
+    *d++ = *s++;
+  return dst;
+}
+
+/**
+ * @brief   Copies a memory area that can overlap the destination.
+ * @details A destination below the source or past its end is a forward
+ *          copy. Otherwise the copy runs backwards, in aligned bursts if
+ *          the source and the destination are aligned alike and by bytes
+ *          if not.
+ */
+void *memmove(void *dst, const void *src, size_t n) {
+  uint8_t *d;
+  const uint8_t *s;
+
+  if ((uintptr_t)dst - (uintptr_t)src >= n)
+    return memcpy(dst, src, n);
+
+  d = (uint8_t *)dst + n;
+  s = (const uint8_t *)src + n;
+  if (n >= 2 * WORD_SIZE) {
+    while (!is_aligned(d)) {
+      *--d = *--s;
+      n--;
+    }
+    if (is_aligned(s)) {
+      word_t *dw = (word_t *)d;
+      const word_t *sw = (const word_t *)s;
+
+      for (; n >= 8 * WORD_SIZE; n -= 8 * WORD_SIZE) {
+        dw -= 8;
+        sw -= 8;
+        dw[7] = sw[7]; dw[6] = sw[6]; dw[5] = sw[5]; dw[4] = sw[4];
+        dw[3] = sw[3]; dw[2] = sw[2]; dw[1] = sw[1]; dw[0] = sw[0];
+      }
+      for (; n >= WORD_SIZE; n -= WORD_SIZE)
+        *--dw = *--sw;
+      d = (uint8_t *)dw;
+      s = (const uint8_t *)sw;
+    }
+  }
+  while (n-- > 0)
+    *--d = *--s;
+  return dst;
+}
+
+/**
+ * @brief   Fills a memory area.
+ */
+void *memset(void *dst, int c, size_t n) {
+  uint8_t *d = dst;
+
+  if (n >= 2 * WORD_SIZE) {
+    uint32_t w = (uint8_t)c * 0x01010101U;
+    word_t *dw;
+
+    while (!is_aligned(d)) {
+      *d++ = (uint8_t)c;
+      n--;
+    }
+    dw = (word_t *)d;
+    for (; n >= 8 * WORD_SIZE; n -= 8 * WORD_SIZE) {
+      dw[0] = w; dw[1] = w; dw[2] = w; dw[3] = w;
+      dw[4] = w; dw[5] = w; dw[6] = w; dw[7] = w;
+      dw += 8;
+    }
+    for (; n >= WORD_SIZE; n -= WORD_SIZE)
+      *dw++ = w;
+    d = (uint8_t *)dw;
+  }
+  while (n-- > 0)
+    *d++ = (uint8_t)c;
+  return dst;
+}
+
+/**
+ * @brief   Length of a string.
+ * @details Scans aligned words for a zero byte, @p (w - 0x01010101) & ~w
+ *          has the top bit of a byte set only if the word holds a zero
+ *          byte. The reads never cross the word holding the terminator.
+ */
+size_t strlen(const char *str) {
+  const char *s = str;
+  const word_t *sw;
+  uint32_t w;
+
+  for (; !is_aligned(s); s++)
+    if (*s == '\0')
+      return s - str;
+  sw = (const word_t *)s;
+  do
+    w = *sw++;
+  while (((w - 0x01010101U) & ~w & 0x80808080U) == 0);
+  for (s = (const char *)(sw - 1); *s != '\0'; s++)
+    ;
+  return s - str;
+}
+
+/** @} */
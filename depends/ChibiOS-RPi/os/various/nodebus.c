@@ -0,0 +1,700 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    nodebus.c
+ * @brief   Multi-drop TDMA node bus over a half duplex serial channel.
+ * @note    The CRC comes from the bulk transfer module, @p bulkxfer.c must
+ *          be linked as well.
+ *
+ * @addtogroup nodebus
+ * @{
+ */
+
+#include <string.h>
+
+#include "ch.h"
+#include "hal.h"
+#include "chprintf.h"
+#include "bulkxfer.h"
+#include "nodebus.h"
+
+#define NB_SYNC0            'N'
+#define NB_SYNC1            'B'
+
+/* How often the receive loops look at the termination request.*/
+#define NB_POLL             MS2ST(100)
+
+#define NB_RX_MORE          0
+#define NB_RX_OK            1
+#define NB_RX_BAD           2
+
+static void put_le16(uint8_t *p, uint16_t v) {
+
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+
+  put_le16(p, (uint16_t)v);
+  put_le16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_le16(const uint8_t *p) {
+
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+
+  return get_le16(p) | ((uint32_t)get_le16(p + 2) << 16);
+}
+
+/**
+ * @brief   Time on the wire of @p n bytes, 8N1, rounded up.
+ */
+static systime_t airtime(uint32_t baud, size_t n) {
+
+  return (systime_t)((n * 10 * (uint64_t)CH_FREQUENCY + baud - 1) / baud);
+}
+
+/**
+ * @brief   Sleeps until @p t, returns at once if @p t has passed.
+ */
+static void sleep_until(systime_t t) {
+  systime_t now = chTimeNow();
+
+  if ((int32_t)(t - now) > 0)
+    chThdSleep(t - now);
+}
+
+/**
+ * @brief   Builds a frame around the payload already at @p buf[6].
+ * @return              The frame length.
+ */
+static size_t seal_frame(uint8_t *buf, uint8_t type, uint8_t addr,
+                         size_t len) {
+
+  buf[0] = NB_SYNC0;
+  buf[1] = NB_SYNC1;
+  buf[2] = type;
+  buf[3] = addr;
+  put_le16(&buf[4], (uint16_t)len);
+  put_le32(&buf[NB_HEADER_SIZE + len],
+           bxCrc32(0, &buf[2], NB_HEADER_SIZE - 2 + len));
+  return NB_HEADER_SIZE + len + NB_CRC_SIZE;
+}
+
+/**
+ * @brief   Feeds one byte to a frame parser.
+ * @return              @p NB_RX_OK when @p rx holds a complete, valid frame,
+ *                      @p NB_RX_BAD when a frame was dropped.
+ */
+static int parse_byte(uint8_t *rx, size_t *rxnp, uint8_t b) {
+  size_t len;
+
+  if ((*rxnp == 0) && (b != NB_SYNC0))
+    return NB_RX_MORE;
+  if ((*rxnp == 1) && (b != NB_SYNC1)) {
+    *rxnp = (b == NB_SYNC0) ? 1 : 0;
+    return NB_RX_MORE;
+  }
+  rx[(*rxnp)++] = b;
+  if (*rxnp < NB_HEADER_SIZE)
+    return NB_RX_MORE;
+
+  len = get_le16(&rx[4]);
+  if (len > NB_MAX_PAYLOAD) {
+    *rxnp = 0;
+    return NB_RX_BAD;
+  }
+  if (*rxnp < NB_HEADER_SIZE + len + NB_CRC_SIZE)
+    return NB_RX_MORE;
+
+  *rxnp = 0;
+  if (bxCrc32(0, &rx[2], NB_HEADER_SIZE - 2 + len) !=
+      get_le32(&rx[NB_HEADER_SIZE + len]))
+    return NB_RX_BAD;
+  return NB_RX_OK;
+}
+
+/**
+ * @brief   Payload bytes a node can send in its slot.
+ */
+static size_t slot_payload(uint32_t baud, uint16_t slot_ms, uint8_t guard_ms) {
+  size_t bytes;
+
+  if (slot_ms <= 2 * guard_ms)
+    return 0;
+  bytes = (size_t)(((uint64_t)(slot_ms - 2 * guard_ms) * baud) / 10000);
+  if (bytes <= NB_HEADER_SIZE + NB_CRC_SIZE)
+    return 0;
+  bytes -= NB_HEADER_SIZE + NB_CRC_SIZE;
+  return bytes < NB_MAX_PAYLOAD ? bytes : NB_MAX_PAYLOAD;
+}
+
+/*===========================================================================*/
+/* Collector.                                                                */
+/*===========================================================================*/
+
+static void collector_join(NbCollector *cp, uint32_t uid) {
+  unsigned i, addr = 0;
+  bool_t back = FALSE;
+
+  if (uid == 0)
+    return;
+
+  /* A node that missed its announcement gets its address again, an
+     evicted one its old address if still free, so that its last batch is
+     still recognized when resent. A new node gets the lowest free one.*/
+  for (i = 0; i < cp->config->nslots; i++) {
+    const NbEntry *ep = &cp->nodes[i];
+
+    if (ep->uid == uid) {
+      addr = i + 1;
+      break;
+    }
+    if ((ep->uid == 0) && !back &&
+        ((addr == 0) || (ep->last_uid == uid))) {
+      addr = i + 1;
+      back = ep->last_uid == uid;
+    }
+  }
+  if (addr == 0)
+    return;
+
+  if (cp->nodes[addr - 1].uid != uid) {
+    NbEntry *ep = &cp->nodes[addr - 1];
+
+    if (!back) {
+      memset(ep, 0, sizeof(*ep));
+      ep->last_uid = uid;
+    }
+    ep->uid = uid;
+    ep->heard = FALSE;
+    cp->stats.joins++;
+  }
+  if (!cp->nodes[addr - 1].pending) {
+    cp->nodes[addr - 1].pending = TRUE;
+    cp->nodes[addr - 1].silent = 0;
+    cp->pending[cp->npending++] = (uint8_t)addr;
+  }
+}
+
+static void collector_data(NbCollector *cp, uint8_t addr,
+                           const uint8_t *payload, size_t len) {
+  const NbCollectorConfig *cfgp = cp->config;
+  NbEntry *ep;
+  uint16_t seq;
+  unsigned count;
+
+  if ((addr == 0) || (addr > cfgp->nslots) || (len < NB_DATA_HEADER_SIZE))
+    return;
+  ep = &cp->nodes[addr - 1];
+  if ((ep->uid == 0) || ep->pending)
+    return;
+
+  count = payload[3];
+  if ((payload[4] != cfgp->record_size) ||
+      (len != NB_DATA_HEADER_SIZE + count * (size_t)cfgp->record_size))
+    return;
+
+  ep->heard = TRUE;
+  ep->stats.frames++;
+  ep->stats.bytes += NB_HEADER_SIZE + len + NB_CRC_SIZE;
+
+  /* A batch heard again means its acknowledge was lost.*/
+  seq = get_le16(&payload[0]);
+  if (ep->synced && (seq == ep->seq)) {
+    ep->stats.duplicates++;
+    return;
+  }
+  ep->synced = TRUE;
+  ep->seq = seq;
+  ep->stats.records += count;
+  if ((count > 0) && (cfgp->data_cb != NULL))
+    cfgp->data_cb(cp, addr, payload[2], &payload[NB_DATA_HEADER_SIZE], count);
+}
+
+/**
+ * @brief   Settles the silent addresses at the end of a cycle.
+ */
+static void collector_close_cycle(NbCollector *cp) {
+  unsigned i;
+
+  cp->ack = 0;
+  for (i = 0; i < cp->config->nslots; i++) {
+    NbEntry *ep = &cp->nodes[i];
+
+    if ((ep->uid == 0) || ep->pending)
+      continue;
+    ep->stats.cycles++;
+    if (ep->heard) {
+      cp->ack |= (uint64_t)1 << i;
+      ep->heard = FALSE;
+      ep->silent = 0;
+      continue;
+    }
+    ep->stats.missed++;
+    if (++ep->silent >= NB_EVICT_CYCLES) {
+      ep->last_uid = ep->uid;
+      ep->uid = 0;
+      cp->stats.evictions++;
+    }
+  }
+}
+
+/**
+ * @brief   Initializes a collector.
+ *
+ * @param[out] cp       pointer to the @p NbCollector object
+ * @param[in] config    pointer to the configuration
+ *
+ * @api
+ */
+void nbCollectorInit(NbCollector *cp, const NbCollectorConfig *config) {
+
+  chDbgCheck((cp != NULL) && (config != NULL) && (config->chp != NULL) &&
+             (config->baud > 0) && (config->nslots > 0) &&
+             (config->nslots <= NB_MAX_NODES) &&
+             (config->record_size > 0) &&
+             (nbSlotCapacity(config->baud, config->slot_ms, config->guard_ms,
+                             config->record_size) > 0) &&
+             (airtime(config->baud, NB_HEADER_SIZE + NB_BEACON_SIZE +
+                      NB_MAX_ASSIGN * NB_ASSIGN_SIZE + NB_CRC_SIZE) <
+              MS2ST(config->slot_ms)),
+             "nbCollectorInit");
+
+  memset(cp, 0, sizeof(*cp));
+  cp->config = config;
+}
+
+/**
+ * @brief   Runs the collector side of the bus.
+ * @details Sends a beacon every cycle and serves the slots until the thread
+ *          is asked to terminate. The cycle start times advance by a fixed
+ *          period, so the schedule does not drift with the processing time.
+ *
+ * @param[in] cp        pointer to the @p NbCollector object
+ *
+ * @api
+ */
+void nbCollectorRun(NbCollector *cp) {
+  const NbCollectorConfig *cfgp = cp->config;
+  systime_t slot = MS2ST(cfgp->slot_ms);
+  systime_t cycle = (cfgp->nslots + 2) * slot;
+  systime_t start = chTimeNow();
+
+  while (!chThdShouldTerminate()) {
+    uint8_t beacon[NB_HEADER_SIZE + NB_BEACON_SIZE +
+                   NB_MAX_ASSIGN * NB_ASSIGN_SIZE + NB_CRC_SIZE];
+    uint8_t *p = &beacon[NB_HEADER_SIZE];
+    systime_t now = chTimeNow();
+    unsigned n = 0;
+
+    /* A late start, a long callback for example, shifts the schedule.*/
+    if ((int32_t)(now - start) > 0)
+      start = now;
+    sleep_until(start);
+
+    put_le16(&p[0], cp->cycle);
+    p[2] = (uint8_t)cfgp->nslots;
+    put_le16(&p[3], cfgp->slot_ms);
+    p[5] = cfgp->guard_ms;
+    put_le32(&p[6], (uint32_t)cp->ack);
+    put_le32(&p[10], (uint32_t)(cp->ack >> 32));
+    cp->free = 0;
+    for (n = 0; n < cfgp->nslots; n++)
+      if (cp->nodes[n].uid == 0)
+        cp->free |= (uint64_t)1 << n;
+    put_le32(&p[14], (uint32_t)cp->free);
+    put_le32(&p[18], (uint32_t)(cp->free >> 32));
+    n = 0;
+    while ((n < NB_MAX_ASSIGN) && (n < cp->npending)) {
+      uint8_t addr = cp->pending[n];
+      uint8_t *q = &p[NB_BEACON_SIZE + n * NB_ASSIGN_SIZE];
+
+      put_le32(q, cp->nodes[addr - 1].uid);
+      q[4] = addr;
+      cp->nodes[addr - 1].pending = FALSE;
+      n++;
+    }
+    p[22] = (uint8_t)n;
+    cp->npending -= n;
+    memmove(&cp->pending[0], &cp->pending[n], cp->npending);
+    chnWrite(cfgp->chp, beacon,
+             seal_frame(beacon, NB_TYPE_BEACON, 0,
+                        NB_BEACON_SIZE + n * NB_ASSIGN_SIZE));
+    cp->stats.cycles++;
+    cp->cycle++;
+    cp->contention_bytes = 0;
+    cp->contention_joins = 0;
+
+    /* Slots, until the next cycle start.*/
+    while (TRUE) {
+      systime_t left = start + cycle - chTimeNow();
+      bool_t contention;
+      unsigned k;
+      msg_t c;
+      int r;
+
+      if (((int32_t)left <= 0) || chThdShouldTerminate())
+        break;
+      c = chnGetTimeout(cfgp->chp, left < NB_POLL ? left : NB_POLL);
+      if (c == Q_TIMEOUT)
+        continue;
+      if (c < Q_OK)
+        return;
+      k = (chTimeNow() - start) / slot;
+      contention = (k > cfgp->nslots) ||
+                   ((k > 0) && (cp->free & ((uint64_t)1 << (k - 1))));
+      if (contention)
+        cp->contention_bytes++;
+      r = parse_byte(cp->rx, &cp->rxn, (uint8_t)c);
+      if ((r == NB_RX_BAD) && !contention)
+        cp->stats.crc_errors++;
+      if (r != NB_RX_OK)
+        continue;
+      cp->stats.frames++;
+      if ((cp->rx[2] == NB_TYPE_JOIN) &&
+          (get_le16(&cp->rx[4]) == NB_JOIN_SIZE)) {
+        if (contention)
+          cp->contention_joins++;
+        collector_join(cp, get_le32(&cp->rx[NB_HEADER_SIZE]));
+      }
+      else if (cp->rx[2] == NB_TYPE_DATA)
+        collector_data(cp, cp->rx[3], &cp->rx[NB_HEADER_SIZE],
+                       get_le16(&cp->rx[4]));
+    }
+    /* Colliding join requests garble each other, whatever is not part of a
+       good frame is taken as a collision.*/
+    if (cp->contention_bytes > cp->contention_joins *
+                               (NB_HEADER_SIZE + NB_JOIN_SIZE + NB_CRC_SIZE))
+      cp->stats.collisions++;
+    collector_close_cycle(cp);
+    start += cycle;
+  }
+}
+
+/**
+ * @brief   Prints the link and per address statistics.
+ * @details Slot utilization is the share of the usable slot time, the slot
+ *          less its guard times, actually carrying frames.
+ *
+ * @param[in] chp       output stream
+ * @param[in] cp        pointer to the @p NbCollector object
+ *
+ * @api
+ */
+void nbCollectorPrintStats(BaseSequentialStream *chp, NbCollector *cp) {
+  const NbCollectorConfig *cfgp = cp->config;
+  uint32_t capacity = (uint32_t)(((uint64_t)(cfgp->slot_ms - 2 * cfgp->guard_ms) *
+                                  cfgp->baud) / 10000);
+  unsigned i;
+
+  chprintf(chp, "cycles %u frames %u crc %u collisions %u joins %u "
+                "evictions %u\r\n",
+           cp->stats.cycles, cp->stats.frames, cp->stats.crc_errors,
+           cp->stats.collisions, cp->stats.joins, cp->stats.evictions);
+  chprintf(chp, "addr uid      frames records dups missed util\r\n");
+  for (i = 0; i < cfgp->nslots; i++) {
+    const NbEntry *ep = &cp->nodes[i];
+    uint32_t util = 0;
+
+    if (ep->uid == 0)
+      continue;
+    if (ep->stats.cycles > 0)
+      util = (uint32_t)((ep->stats.bytes * (uint64_t)100) /
+                        ((uint64_t)ep->stats.cycles * capacity));
+    chprintf(chp, "%4u %08x %6u %7u %4u %6u %3u%%\r\n", i + 1, ep->uid,
+             ep->stats.frames, ep->stats.records, ep->stats.duplicates,
+             ep->stats.missed, util);
+  }
+}
+
+/**
+ * @brief   Records a node can send per slot.
+ *
+ * @param[in] baud      line speed
+ * @param[in] slot_ms   slot length in milliseconds
+ * @param[in] guard_ms  guard time in milliseconds
+ * @param[in] record_size bytes per record
+ * @return              The batch size, zero if not even one record fits.
+ *
+ * @api
+ */
+unsigned nbSlotCapacity(uint32_t baud, uint16_t slot_ms, uint8_t guard_ms,
+                        uint8_t record_size) {
+  size_t bytes = slot_payload(baud, slot_ms, guard_ms);
+  unsigned n;
+
+  if (bytes < NB_DATA_HEADER_SIZE)
+    return 0;
+  n = (unsigned)((bytes - NB_DATA_HEADER_SIZE) / record_size);
+  return n < 255 ? n : 255;
+}
+
+/*===========================================================================*/
+/* Node.                                                                     */
+/*===========================================================================*/
+
+static uint32_t node_random(NbNode *np) {
+
+  np->rng = np->rng * 1664525 + 1013904223;
+  return np->rng >> 16;
+}
+
+/**
+ * @brief   Sends the data frame of the cycle.
+ */
+static void node_send_data(NbNode *np) {
+  const NbNodeConfig *cfgp = np->config;
+  unsigned cap = nbSlotCapacity(cfgp->baud, np->slot_ms, np->guard_ms,
+                                cfgp->record_size);
+  uint8_t *p = &np->tx[NB_HEADER_SIZE];
+  unsigned i, head;
+  bool_t held;
+
+  /* A resent batch keeps its records and sequence number, it may have
+     been heard with its acknowledge lost.*/
+  chSysLock();
+  if (!np->retry)
+    np->inflight = np->count < cap ? np->count : cap;
+  head = np->head;
+  held = (np->count > np->inflight) || np->fresh;
+  chSysUnlock();
+  if (np->inflight > cap)
+    np->inflight = cap;
+
+  /* The producer only appends, the batch records are stable.*/
+  for (i = 0; i < np->inflight; i++)
+    memcpy(&p[NB_DATA_HEADER_SIZE + i * cfgp->record_size],
+           &cfgp->buffer[((head + i) % cfgp->depth) * cfgp->record_size],
+           cfgp->record_size);
+
+  put_le16(&p[0], np->seq);
+  p[2] = (np->retry ? NB_DATA_RETRY : 0) | (held ? NB_DATA_HELD : 0);
+  p[3] = (uint8_t)np->inflight;
+  p[4] = cfgp->record_size;
+  chnWrite(cfgp->chp, np->tx,
+           seal_frame(np->tx, NB_TYPE_DATA, np->addr,
+                      NB_DATA_HEADER_SIZE + np->inflight * cfgp->record_size));
+  np->frames++;
+  if (np->retry)
+    np->resent++;
+  np->sent = TRUE;
+  np->fresh = FALSE;
+}
+
+/**
+ * @brief   Sends a join request.
+ * @details Picks one of the contention opportunities of the cycle, the
+ *          contention slot and the free address slots, then a random
+ *          sub-slot in it. Binary exponential backoff spaces the attempts.
+ */
+static void node_join(NbNode *np, systime_t start) {
+  const NbNodeConfig *cfgp = np->config;
+  systime_t slot = MS2ST(np->slot_ms);
+  systime_t guard = MS2ST(np->guard_ms);
+  systime_t sub = airtime(cfgp->baud, NB_HEADER_SIZE + NB_JOIN_SIZE +
+                                      NB_CRC_SIZE) + 1;
+  unsigned i, k, pick, nsub = 1, nopp = 1;
+
+  for (i = 0; i < np->nslots; i++)
+    if (np->free & ((uint64_t)1 << i))
+      nopp++;
+  pick = node_random(np) % nopp;
+  k = np->nslots + 1;
+  for (i = 0; (i < np->nslots) && (pick > 0); i++) {
+    if ((np->free & ((uint64_t)1 << i)) && (--pick == 0))
+      k = i + 1;
+  }
+
+  if (slot > 2 * guard + sub)
+    nsub = (slot - 2 * guard) / sub;
+  sleep_until(start + k * slot + guard + (node_random(np) % nsub) * sub);
+  put_le32(&np->tx[NB_HEADER_SIZE], cfgp->uid);
+  chnWrite(cfgp->chp, np->tx,
+           seal_frame(np->tx, NB_TYPE_JOIN, 0, NB_JOIN_SIZE));
+  np->joins++;
+  np->wait = node_random(np) % (1U << np->backoff);
+  if (np->backoff < NB_JOIN_MAX_BACKOFF)
+    np->backoff++;
+}
+
+/**
+ * @brief   Handles a beacon heard at @p end.
+ */
+static void node_beacon(NbNode *np, systime_t end) {
+  const NbNodeConfig *cfgp = np->config;
+  const uint8_t *p = &np->rx[NB_HEADER_SIZE];
+  size_t len = get_le16(&np->rx[4]);
+  systime_t start, slot, guard;
+  uint64_t ack;
+  unsigned i;
+
+  np->beacons++;
+  np->nslots = p[2];
+  np->slot_ms = get_le16(&p[3]);
+  np->guard_ms = p[5];
+  ack = get_le32(&p[6]) | ((uint64_t)get_le32(&p[10]) << 32);
+  np->free = get_le32(&p[14]) | ((uint64_t)get_le32(&p[18]) << 32);
+
+  /* The collector starts the cycle with the beacon's first byte.*/
+  start = end - airtime(cfgp->baud, NB_HEADER_SIZE + len + NB_CRC_SIZE);
+  slot = MS2ST(np->slot_ms);
+  guard = MS2ST(np->guard_ms);
+
+  /* Outcome of the previous cycle's batch.*/
+  if ((np->addr != 0) && np->sent) {
+    np->sent = FALSE;
+    if (ack & ((uint64_t)1 << (np->addr - 1))) {
+      chSysLock();
+      np->head = (np->head + np->inflight) % cfgp->depth;
+      np->count -= np->inflight;
+      chSysUnlock();
+      np->records += np->inflight;
+      np->inflight = 0;
+      np->seq++;
+      np->retry = FALSE;
+      np->unacked = 0;
+    }
+    else {
+      np->retry = TRUE;
+      if (++np->unacked >= NB_EVICT_CYCLES)
+        np->addr = 0;
+    }
+  }
+
+  for (i = 0; i < p[22]; i++) {
+    const uint8_t *q = &p[NB_BEACON_SIZE + i * NB_ASSIGN_SIZE];
+
+    if ((q[4] != 0) && (get_le32(q) == cfgp->uid)) {
+      np->addr = q[4];
+      np->backoff = 1;
+      np->wait = 0;
+      np->unacked = 0;
+      np->sent = FALSE;
+      np->fresh = TRUE;
+    }
+  }
+  if (np->addr > np->nslots)
+    np->addr = 0;
+
+  if (np->addr != 0) {
+    if (nbSlotCapacity(cfgp->baud, np->slot_ms, np->guard_ms,
+                       cfgp->record_size) == 0)
+      return;
+    sleep_until(start + np->addr * slot + guard);
+    node_send_data(np);
+    return;
+  }
+
+  if (np->wait > 0) {
+    np->wait--;
+    return;
+  }
+  node_join(np, start);
+}
+
+/**
+ * @brief   Initializes a node.
+ *
+ * @param[out] np       pointer to the @p NbNode object
+ * @param[in] config    pointer to the configuration
+ *
+ * @api
+ */
+void nbNodeInit(NbNode *np, const NbNodeConfig *config) {
+
+  chDbgCheck((np != NULL) && (config != NULL) && (config->chp != NULL) &&
+             (config->baud > 0) && (config->uid != 0) &&
+             (config->record_size > 0) && (config->buffer != NULL) &&
+             (config->depth > 0), "nbNodeInit");
+
+  memset(np, 0, sizeof(*np));
+  np->config = config;
+  np->backoff = 1;
+  np->rng = config->uid;
+}
+
+/**
+ * @brief   Queues one record for the next slots.
+ * @note    Can be called from any thread.
+ *
+ * @param[in] np        pointer to the @p NbNode object
+ * @param[in] record    the record, @p NbNodeConfig::record_size bytes
+ * @return              @p FALSE if the queue was full and the record dropped.
+ *
+ * @api
+ */
+bool_t nbNodePost(NbNode *np, const void *record) {
+  const NbNodeConfig *cfgp = np->config;
+  unsigned tail;
+
+  /* Records are a few bytes, copying them in the critical zone keeps
+     concurrent producers apart.*/
+  chSysLock();
+  if (np->count >= cfgp->depth) {
+    np->overruns++;
+    chSysUnlock();
+    return FALSE;
+  }
+  tail = (np->head + np->count) % cfgp->depth;
+  memcpy(&cfgp->buffer[tail * cfgp->record_size], record, cfgp->record_size);
+  np->count++;
+  chSysUnlock();
+  return TRUE;
+}
+
+/**
+ * @brief   Runs the node side of the bus.
+ * @details Follows the beacons, sends the queued records in the assigned
+ *          slot and joins when unaddressed, until the thread is asked to
+ *          terminate.
+ *
+ * @param[in] np        pointer to the @p NbNode object
+ *
+ * @api
+ */
+void nbNodeRun(NbNode *np) {
+  BaseChannel *chp = np->config->chp;
+
+  while (!chThdShouldTerminate()) {
+    msg_t c = chnGetTimeout(chp, NB_POLL);
+    int r;
+
+    if (c == Q_TIMEOUT)
+      continue;
+    if (c < Q_OK)
+      return;
+    r = parse_byte(np->rx, &np->rxn, (uint8_t)c);
+    if (r == NB_RX_BAD)
+      np->crc_errors++;
+    if ((r == NB_RX_OK) && (np->rx[2] == NB_TYPE_BEACON) &&
+        (get_le16(&np->rx[4]) >= NB_BEACON_SIZE) &&
+        (get_le16(&np->rx[4]) ==
+         NB_BEACON_SIZE + np->rx[NB_HEADER_SIZE + 22] * NB_ASSIGN_SIZE))
+      node_beacon(np, chTimeNow());
+  }
+}
+
+/** @} */
@@ -0,0 +1,334 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    nodebus.h
+ * @brief   Multi-drop TDMA node bus over a half duplex serial channel.
+ * @details Frame layout, all fields little-endian:
+ *          <pre>
+ *          0   'N' 'B'           sync
+ *          2   type              NB_TYPE_*
+ *          3   addr              node address, 0 for the collector
+ *          4   len     (16 bit)  payload length
+ *          6   payload[len]
+ *          6+len crc   (32 bit)  CRC-32 (IEEE) of bytes 2..5+len
+ *          </pre>
+ *          The collector owns the timing. Every cycle starts with its
+ *          @p NB_TYPE_BEACON, the end of the beacon is the time reference
+ *          of the cycle. The beacon is followed by one slot per address,
+ *          address @p n transmitting in slot @p n, and by a contention slot.
+ *          Unaddressed nodes send @p NB_TYPE_JOIN with their unique
+ *          identifier in the contention slot or in the slot of any free
+ *          address, so a bus powering up with many nodes sorts itself out
+ *          in a few cycles. Every slot opens and closes with a guard time
+ *          that absorbs scheduling jitter and the transceiver turnaround.
+ *
+ *          Beacon payload:
+ *          <pre>
+ *          0   cycle   (16 bit)  cycle number
+ *          2   nslots            node slots in the cycle
+ *          3   slot    (16 bit)  slot length, milliseconds
+ *          5   guard             guard time, milliseconds
+ *          6   ack     (64 bit)  addresses heard in the previous cycle,
+ *                                bit n-1 for address n
+ *          14  free    (64 bit)  free addresses, bit n-1 for address n
+ *          22  nassign           address assignments that follow
+ *          23  uid     (32 bit)  identifier being assigned an address
+ *          27  addr              the address
+ *          ...                   further assignments
+ *          </pre>
+ *          Data payload:
+ *          <pre>
+ *          0   seq     (16 bit)  batch sequence number
+ *          2   flags             NB_DATA_*
+ *          3   count             records in the batch
+ *          4   size              bytes per record
+ *          5   records[count * size]
+ *          </pre>
+ *          A node sends one data frame per cycle, empty if it has nothing
+ *          queued, and resends the same batch until the beacon acknowledges
+ *          it. A node missing from @p NB_EVICT_CYCLES beacon acknowledges
+ *          in a row gives its address up and joins again, the collector
+ *          frees addresses after as many silent cycles.
+ *
+ * @addtogroup nodebus
+ * @{
+ */
+
+#ifndef _NODEBUS_H_
+#define _NODEBUS_H_
+
+/**
+ * @brief   Largest number of node slots, at most 64.
+ */
+#if !defined(NB_MAX_NODES) || defined(__DOXYGEN__)
+#define NB_MAX_NODES                64
+#endif
+
+/**
+ * @brief   Largest frame payload.
+ */
+#if !defined(NB_MAX_PAYLOAD) || defined(__DOXYGEN__)
+#define NB_MAX_PAYLOAD              256
+#endif
+
+/**
+ * @brief   Largest number of address assignments per beacon.
+ */
+#if !defined(NB_MAX_ASSIGN) || defined(__DOXYGEN__)
+#define NB_MAX_ASSIGN               4
+#endif
+
+/**
+ * @brief   Cycles without traffic after which an address is dropped.
+ */
+#if !defined(NB_EVICT_CYCLES) || defined(__DOXYGEN__)
+#define NB_EVICT_CYCLES             8
+#endif
+
+/**
+ * @brief   Largest join backoff exponent.
+ * @details A node that failed to get an address waits a random number of
+ *          cycles below 2^n before contending again, @p n growing with
+ *          every failure up to this value.
+ */
+#if !defined(NB_JOIN_MAX_BACKOFF) || defined(__DOXYGEN__)
+#define NB_JOIN_MAX_BACKOFF         4
+#endif
+
+#if NB_MAX_NODES > 64
+#error "NB_MAX_NODES cannot exceed the 64 bit beacon acknowledge bitmap"
+#endif
+
+#if (NB_MAX_ASSIGN < 1) || (NB_MAX_ASSIGN > 255)
+#error "NB_MAX_ASSIGN must be within 1..255"
+#endif
+
+/**
+ * @name    Frame types
+ * @{
+ */
+#define NB_TYPE_BEACON              0x01
+#define NB_TYPE_DATA                0x02
+#define NB_TYPE_JOIN                0x03
+/** @} */
+
+/**
+ * @name    Data frame flags
+ * @{
+ */
+/** @brief The batch is being resent, its records waited longer.*/
+#define NB_DATA_RETRY               0x01
+/** @brief Records waited more than a cycle, the queue held more than the
+    slot carries or the node has just been given its address.*/
+#define NB_DATA_HELD                0x02
+/** @} */
+
+#define NB_HEADER_SIZE              6
+#define NB_CRC_SIZE                 4
+#define NB_BEACON_SIZE              23
+#define NB_ASSIGN_SIZE              5
+#define NB_JOIN_SIZE                4
+#define NB_DATA_HEADER_SIZE         5
+
+/**
+ * @brief   Type of a collector.
+ */
+typedef struct NbCollector NbCollector;
+
+/**
+ * @brief   Collector record callback.
+ * @details Invoked from the collector thread for every new batch, never for
+ *          the duplicates of a batch whose acknowledge was lost.
+ *
+ * @param[in] cp        pointer to the @p NbCollector object
+ * @param[in] addr      sender address
+ * @param[in] flags     the batch @p NB_DATA_* flags
+ * @param[in] records   @p count records, @p NbCollectorConfig::record_size
+ *                      bytes each
+ * @param[in] count     number of records
+ */
+typedef void (*nbdatacb_t)(NbCollector *cp, uint8_t addr, uint8_t flags,
+                           const uint8_t *records, unsigned count);
+
+/**
+ * @brief   Collector configuration.
+ */
+typedef struct {
+  /** @brief Bus channel.*/
+  BaseChannel           *chp;
+  /** @brief Line speed, used to time the beacon end.*/
+  uint32_t              baud;
+  /** @brief Node slots per cycle, at most @p NB_MAX_NODES.*/
+  unsigned              nslots;
+  /** @brief Slot length in milliseconds.*/
+  uint16_t              slot_ms;
+  /** @brief Guard time in milliseconds, at each slot end.*/
+  uint8_t               guard_ms;
+  /** @brief Bytes per record.*/
+  uint8_t               record_size;
+  /** @brief Record callback, can be @p NULL.*/
+  nbdatacb_t            data_cb;
+} NbCollectorConfig;
+
+/**
+ * @brief   Link statistics.
+ */
+typedef struct {
+  uint32_t              cycles;             /**< @brief Beacons sent.       */
+  uint32_t              frames;             /**< @brief Good frames.        */
+  uint32_t              crc_errors;         /**< @brief Bad frames in node
+                                                 slots.                     */
+  uint32_t              collisions;         /**< @brief Contention slots
+                                                 with garbled traffic.      */
+  uint32_t              joins;              /**< @brief Addresses assigned. */
+  uint32_t              evictions;          /**< @brief Addresses dropped.  */
+} NbLinkStats;
+
+/**
+ * @brief   Per address statistics.
+ */
+typedef struct {
+  uint32_t              cycles;             /**< @brief Cycles assigned.    */
+  uint32_t              frames;             /**< @brief Data frames heard.  */
+  uint32_t              duplicates;         /**< @brief Batches heard again.*/
+  uint32_t              records;            /**< @brief New records.        */
+  uint32_t              bytes;              /**< @brief Frame bytes on the
+                                                 wire.                      */
+  uint32_t              missed;             /**< @brief Silent cycles.      */
+} NbNodeStats;
+
+/**
+ * @brief   Collector view of one address.
+ */
+typedef struct {
+  uint32_t              uid;                /**< @brief Owner, 0 if free.   */
+  uint32_t              last_uid;           /**< @brief Owner before the
+                                                 last eviction.             */
+  uint16_t              seq;                /**< @brief Last batch heard.   */
+  bool_t                synced;             /**< @brief @p seq is valid.    */
+  bool_t                heard;              /**< @brief Heard this cycle.   */
+  bool_t                pending;            /**< @brief Assigned, not yet
+                                                 announced.                 */
+  uint8_t               silent;             /**< @brief Silent cycles in a
+                                                 row.                       */
+  NbNodeStats           stats;
+} NbEntry;
+
+/**
+ * @brief   Collector state.
+ */
+struct NbCollector {
+  const NbCollectorConfig *config;
+  uint16_t              cycle;
+  uint64_t              ack;
+  /** @brief Addresses assigned but not yet announced, FIFO.*/
+  uint8_t               pending[NB_MAX_NODES];
+  unsigned              npending;
+  NbEntry               nodes[NB_MAX_NODES];
+  NbLinkStats           stats;
+  /** @brief Free addresses announced in the last beacon.*/
+  uint64_t              free;
+  /** @brief Bytes and good join frames seen in the contention slots.*/
+  unsigned              contention_bytes;
+  unsigned              contention_joins;
+  uint8_t               rx[NB_HEADER_SIZE + NB_MAX_PAYLOAD + NB_CRC_SIZE];
+  size_t                rxn;
+};
+
+/**
+ * @brief   Node configuration.
+ */
+typedef struct {
+  /** @brief Bus channel.*/
+  BaseChannel           *chp;
+  /** @brief Line speed, used to size the batches to the slot.*/
+  uint32_t              baud;
+  /** @brief Unique non zero identifier, the board serial for example.*/
+  uint32_t              uid;
+  /** @brief Bytes per record.*/
+  uint8_t               record_size;
+  /** @brief Record queue, @p depth records of @p record_size bytes.*/
+  uint8_t               *buffer;
+  /** @brief Record queue depth.*/
+  unsigned              depth;
+} NbNodeConfig;
+
+/**
+ * @brief   Node state.
+ */
+typedef struct {
+  const NbNodeConfig    *config;
+  uint8_t               addr;               /**< @brief 0 if unaddressed.   */
+  /** @brief Record queue, guarded by the system lock.*/
+  unsigned              head;
+  unsigned              count;
+  /** @brief Records of the unacknowledged batch, at the queue head.*/
+  unsigned              inflight;
+  uint16_t              seq;
+  bool_t                sent;
+  bool_t                retry;
+  bool_t                fresh;
+  uint8_t               unacked;
+  uint8_t               backoff;
+  unsigned              wait;
+  uint32_t              rng;
+  /** @brief Cycle layout from the last beacon.*/
+  unsigned              nslots;
+  uint64_t              free;
+  uint16_t              slot_ms;
+  uint8_t               guard_ms;
+  uint8_t               rx[NB_HEADER_SIZE + NB_MAX_PAYLOAD + NB_CRC_SIZE];
+  size_t                rxn;
+  uint8_t               tx[NB_HEADER_SIZE + NB_MAX_PAYLOAD + NB_CRC_SIZE];
+  /* Statistics.*/
+  uint32_t              beacons;            /**< @brief Beacons heard.      */
+  uint32_t              frames;             /**< @brief Data frames sent.   */
+  uint32_t              records;            /**< @brief Records acknowledged.*/
+  uint32_t              resent;             /**< @brief Batches resent.     */
+  uint32_t              joins;              /**< @brief Join requests sent. */
+  uint32_t              overruns;           /**< @brief Records dropped on a
+                                                 full queue.                */
+  uint32_t              crc_errors;         /**< @brief Bad frames heard.   */
+} NbNode;
+
+/**
+ * @brief   Cycle length in milliseconds, beacon slot included.
+ */
+#define NB_CYCLE_MS(nslots, slot_ms) (((nslots) + 2) * (slot_ms))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void nbCollectorInit(NbCollector *cp, const NbCollectorConfig *config);
+  void nbCollectorRun(NbCollector *cp);
+  void nbCollectorPrintStats(BaseSequentialStream *chp, NbCollector *cp);
+  unsigned nbSlotCapacity(uint32_t baud, uint16_t slot_ms, uint8_t guard_ms,
+                          uint8_t record_size);
+  void nbNodeInit(NbNode *np, const NbNodeConfig *config);
+  bool_t nbNodePost(NbNode *np, const void *record);
+  void nbNodeRun(NbNode *np);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NODEBUS_H_ */
+
+/** @} */
@@ -0,0 +1,144 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    sensoracq.c
+ * @brief   Batched acquisition over @p BaseSensor objects.
+ *
+ * @addtogroup sensoracq
+ * @{
+ */
+
+#include "ch.h"
+#include "hal.h"
+#include "sensoracq.h"
+
+/**
+ * @brief   System time @p us microseconds from now.
+ */
+static systime_t due_in(uint32_t us) {
+
+  return chTimeNow() + (us > 0 ? US2ST(us) : 0);
+}
+
+static void sleep_until(systime_t t) {
+
+  if ((int32_t)(t - chTimeNow()) > 0)
+    chThdSleepUntil(t);
+}
+
+static void job_start(SensorJob *jp) {
+  uint32_t wait_us = 0;
+
+  jp->reading.quantities = 0;
+  jp->collects = 0;
+  jp->status = snsStart(jp->sensor, &wait_us);
+  if (jp->status == SNS_PENDING)
+    jp->due = due_in(wait_us);
+  else
+    jp->status = SNS_ERROR;
+}
+
+static void job_collect(SensorJob *jp) {
+  uint32_t wait_us = 0;
+  msg_t msg;
+
+  jp->collects++;
+  msg = snsCollect(jp->sensor, &wait_us);
+  if (msg == SNS_PENDING) {
+    jp->due = due_in(wait_us);
+    return;
+  }
+  if (msg == SNS_DONE)
+    msg = snsConvert(jp->sensor, &jp->reading);
+  jp->status = msg == SNS_DONE ? SNS_DONE : SNS_ERROR;
+}
+
+static size_t jobs_done(const SensorJob *jobs, size_t n) {
+  size_t i, done = 0;
+
+  for (i = 0; i < n; i++)
+    if (jobs[i].status == SNS_DONE)
+      done++;
+  return done;
+}
+
+/**
+ * @brief   Reads a batch of sensors with overlapped conversions.
+ * @details All the measurements are started first, in order. Then the
+ *          sensor whose collect is due first is served, until every
+ *          measurement completed or failed. The bus transfers of the
+ *          sensors are serialized by the calling thread, the conversions
+ *          run concurrently.
+ *
+ * @param[in,out] jobs  sensors to read and their results
+ * @param[in] n         number of jobs
+ * @return              The number of valid readings.
+ *
+ * @api
+ */
+size_t sacqRead(SensorJob *jobs, size_t n) {
+  size_t i, next;
+
+  for (i = 0; i < n; i++)
+    job_start(&jobs[i]);
+
+  while (TRUE) {
+    next = n;
+    for (i = 0; i < n; i++) {
+      if (jobs[i].status != SNS_PENDING)
+        continue;
+      if (next == n || (int32_t)(jobs[i].due - jobs[next].due) < 0)
+        next = i;
+    }
+    if (next == n)
+      break;
+    sleep_until(jobs[next].due);
+    job_collect(&jobs[next]);
+  }
+  return jobs_done(jobs, n);
+}
+
+/**
+ * @brief   Reads a batch of sensors one after the other.
+ * @details Each measurement is completed before the next one is started,
+ *          as blocking drivers do. Same results as @p sacqRead(), slower;
+ *          kept as the reference the batch is measured against.
+ *
+ * @param[in,out] jobs  sensors to read and their results
+ * @param[in] n         number of jobs
+ * @return              The number of valid readings.
+ *
+ * @api
+ */
+size_t sacqReadSequential(SensorJob *jobs, size_t n) {
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    job_start(&jobs[i]);
+    while (jobs[i].status == SNS_PENDING) {
+      sleep_until(jobs[i].due);
+      job_collect(&jobs[i]);
+    }
+  }
+  return jobs_done(jobs, n);
+}
+
+/** @} */
@@ -0,0 +1,63 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    sensoracq.h
+ * @brief   Batched acquisition over @p BaseSensor objects.
+ * @details A batch starts a measurement on every sensor, then collects each
+ *          one as its conversions end, so the conversions of all the sensors
+ *          overlap and only the bus transfers are serialized. The sensors
+ *          may be of any type implementing @p BaseSensor.
+ *
+ * @addtogroup sensoracq
+ * @{
+ */
+
+#ifndef _SENSORACQ_H_
+#define _SENSORACQ_H_
+
+/**
+ * @brief   One sensor of a batch and its result.
+ */
+typedef struct {
+  /** @brief Sensor to read.*/
+  BaseSensor            *sensor;
+  /** @brief Reading, valid when @p status is @p SNS_DONE.*/
+  SensorReading         reading;
+  /** @brief @p SNS_DONE or @p SNS_ERROR once the batch returned.*/
+  msg_t                 status;
+  /** @brief Time of the next collect.*/
+  systime_t             due;
+  /** @brief Collect calls made, retries included.*/
+  uint32_t              collects;
+} SensorJob;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  size_t sacqRead(SensorJob *jobs, size_t n);
+  size_t sacqReadSequential(SensorJob *jobs, size_t n);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SENSORACQ_H_ */
+
+/** @} */
@@ -0,0 +1,219 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    trigger.c
+ * @brief   Event triggers with pre-trigger history code.
+ *
+ * @addtogroup trigger
+ * @{
+ */
+
+#include <string.h>
+
+#include "ch.h"
+#include "trigger.h"
+
+/**
+ * @brief   Ring frame @p back frames before the next one.
+ */
+static int32_t *frame(TrgEngine *tp, size_t back) {
+  const TrgConfig *cfgp = tp->config;
+  size_t idx = tp->head >= back ? tp->head - back
+                                : tp->head + cfgp->depth - back;
+
+  return cfgp->buffer + idx * (cfgp->channels + 1);
+}
+
+/**
+ * @brief   Value watched by a condition for the incoming frame.
+ */
+static int64_t metric(TrgEngine *tp, unsigned i, const int32_t *values) {
+  const TrgCondition *cp = &tp->config->conditions[i];
+  int32_t x = values[cp->channel];
+
+  switch (cp->kind) {
+  case TRG_RATE:
+    return (int64_t)x - frame(tp, cp->lag)[1 + cp->channel];
+  case TRG_BAND: {
+    TrgBandState *bp = &tp->band[i];
+    int64_t x8 = (int64_t)x << 8;
+    int64_t d;
+
+    if (tp->filled == 0) {
+      bp->fast = x8;
+      bp->slow = x8;
+      bp->power = 0;
+    }
+    bp->fast += (x8 - bp->fast) >> cp->fast;
+    bp->slow += (x8 - bp->slow) >> cp->slow;
+    d = bp->fast - bp->slow;
+    bp->power += (((d * d) >> 8) - bp->power) >> cp->avg;
+    return bp->power >> 8;
+  }
+  default:
+    return x;
+  }
+}
+
+/**
+ * @brief   Condition state after a new value, with hysteresis.
+ */
+static bool_t fired(const TrgCondition *cp, bool_t active, int64_t m) {
+
+  if (cp->on >= cp->off)
+    return m >= (active ? cp->off : cp->on);
+  return m <= (active ? cp->off : cp->on);
+}
+
+/**
+ * @brief   Initializes a trigger engine.
+ *
+ * @param[out] tp       pointer to the @p TrgEngine object
+ * @param[in] cfgp      engine parameters, must stay valid while in use
+ */
+void trgInit(TrgEngine *tp, const TrgConfig *cfgp) {
+  unsigned i;
+
+  chDbgCheck((tp != NULL) && (cfgp != NULL) && (cfgp->buffer != NULL) &&
+             (cfgp->nconditions <= TRG_MAX_CONDITIONS) &&
+             (cfgp->pre < cfgp->depth), "trgInit");
+  for (i = 0; i < cfgp->nconditions; i++)
+    chDbgAssert((cfgp->conditions[i].kind != TRG_RATE) ||
+                ((cfgp->conditions[i].lag > 0) &&
+                 (cfgp->conditions[i].lag < cfgp->depth)),
+                "trgInit(), #1", "rate lag out of the ring");
+
+  memset(tp, 0, sizeof *tp);
+  tp->config = cfgp;
+}
+
+/**
+ * @brief   Adds a frame.
+ * @details Evaluates the conditions, stores the frame and starts or ends a
+ *          capture, calling the mode callback if so. Only one thread may
+ *          put frames.
+ *
+ * @param[in] tp        pointer to the @p TrgEngine object
+ * @param[in] time      frame timestamp, in any unit
+ * @param[in] values    one value per channel
+ * @return              TRUE while capturing.
+ */
+bool_t trgPut(TrgEngine *tp, uint32_t time, const int32_t *values) {
+  const TrgConfig *cfgp = tp->config;
+  uint32_t active = 0;
+  bool_t start = FALSE, stop = FALSE;
+  int32_t *fp;
+  unsigned i;
+
+  for (i = 0; i < cfgp->nconditions; i++) {
+    const TrgCondition *cp = &cfgp->conditions[i];
+
+    /* A rate has no reference until the ring holds lag frames.*/
+    if ((cp->kind == TRG_RATE) && (tp->filled < cp->lag))
+      continue;
+    if (fired(cp, (tp->active >> i) & 1, metric(tp, i, values)))
+      active |= (uint32_t)1 << i;
+  }
+
+  chSysLock();
+  fp = frame(tp, 0);
+  fp[0] = (int32_t)time;
+  memcpy(fp + 1, values, cfgp->channels * sizeof (int32_t));
+  tp->head = tp->head + 1 == cfgp->depth ? 0 : tp->head + 1;
+  if (tp->filled < cfgp->depth)
+    tp->filled++;
+  tp->wr++;
+
+  if (!tp->capturing) {
+    if (active != 0) {
+      /* The history preceding this frame, not going back past what was
+         already delivered. A capture starting before the previous one was
+         read just extends it.*/
+      if (tp->rd == tp->end) {
+        size_t n = tp->filled - 1;
+
+        if (n > cfgp->pre)
+          n = cfgp->pre;
+        if (n > tp->wr - 1 - tp->end)
+          n = tp->wr - 1 - tp->end;
+        tp->rd = tp->wr - 1 - n;
+      }
+      tp->capturing = TRUE;
+      tp->cause = active;
+      tp->quiet = 0;
+      tp->captures++;
+      start = TRUE;
+    }
+  }
+  else if (active != 0)
+    tp->quiet = 0;
+  else if (++tp->quiet >= cfgp->post) {
+    tp->capturing = FALSE;
+    tp->end = tp->wr;
+    stop = TRUE;
+  }
+
+  /* Readable frames the ring no longer holds.*/
+  if ((tp->capturing || (tp->rd != tp->end)) && (tp->wr - tp->rd > cfgp->depth)) {
+    uint32_t lo = tp->wr - cfgp->depth;
+
+    if (!tp->capturing && (tp->end - tp->rd <= lo - tp->rd)) {
+      tp->overruns += tp->end - tp->rd;
+      tp->rd = tp->end;
+    }
+    else {
+      tp->overruns += lo - tp->rd;
+      tp->rd = lo;
+    }
+  }
+  tp->active = active;
+  chSysUnlock();
+
+  if ((start || stop) && (cfgp->mode_cb != NULL))
+    cfgp->mode_cb(tp, start);
+  return tp->capturing;
+}
+
+/**
+ * @brief   Reads the oldest captured frame not read yet.
+ *
+ * @param[in] tp        pointer to the @p TrgEngine object
+ * @param[out] timep    frame timestamp
+ * @param[out] values   one value per channel
+ * @return              FALSE if there is no frame to read.
+ */
+bool_t trgRead(TrgEngine *tp, uint32_t *timep, int32_t *values) {
+  const int32_t *fp;
+
+  chSysLock();
+  if (tp->rd == (tp->capturing ? tp->wr : tp->end)) {
+    chSysUnlock();
+    return FALSE;
+  }
+  fp = frame(tp, tp->wr - tp->rd);
+  *timep = (uint32_t)fp[0];
+  memcpy(values, fp + 1, tp->config->channels * sizeof (int32_t));
+  tp->rd++;
+  chSysUnlock();
+  return TRUE;
+}
+
+/** @} */
@@ -0,0 +1,201 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    trigger.h
+ * @brief   Event triggers with pre-trigger history.
+ * @details The sampling thread pushes every frame, one value per channel,
+ *          through @p trgPut(). The frames go into a ring buffer and are
+ *          checked against the trigger conditions, each costing a constant
+ *          amount of work per frame:
+ *          - @p TRG_LEVEL, the channel value.
+ *          - @p TRG_RATE, the change of the channel value over the last
+ *            @p lag frames, read back from the ring. The condition stays
+ *            released until the ring holds @p lag frames.
+ *          - @p TRG_BAND, the mean power of the channel band passed
+ *            between two exponential moving averages, a fast one with
+ *            time constant 2^@p fast frames and a slow one with 2^@p slow,
+ *            averaged again over 2^@p avg frames.
+ *          .
+ *          Conditions have hysteresis: with @p on above @p off a condition
+ *          fires when its value reaches @p on and releases when it drops
+ *          below @p off, with @p on below @p off it fires on falling values.
+ *
+ *          The first firing condition starts a capture: the @p pre frames
+ *          before it become readable through @p trgRead(), as does every
+ *          following frame until all conditions have been released for
+ *          @p post frames. The mode callback runs at both ends of a capture
+ *          so the sampling rate can be raised for its duration; frames carry
+ *          their own timestamp for this reason. Outside captures nothing is
+ *          readable and the ring only keeps the history.
+ *
+ * @addtogroup trigger
+ * @{
+ */
+
+#ifndef _TRIGGER_H_
+#define _TRIGGER_H_
+
+/**
+ * @brief   Largest number of conditions per engine.
+ */
+#if !defined(TRG_MAX_CONDITIONS) || defined(__DOXYGEN__)
+#define TRG_MAX_CONDITIONS          8
+#endif
+
+#if TRG_MAX_CONDITIONS > 32
+#error "TRG_MAX_CONDITIONS cannot exceed the 32 bit condition masks"
+#endif
+
+/**
+ * @name    Condition kinds
+ * @{
+ */
+#define TRG_LEVEL                   0
+#define TRG_RATE                    1
+#define TRG_BAND                    2
+/** @} */
+
+/**
+ * @brief   Type of a trigger engine.
+ */
+typedef struct TrgEngine TrgEngine;
+
+/**
+ * @brief   Capture start and end notification.
+ * @details Invoked from @p trgPut(), outside any critical section.
+ *
+ * @param[in] tp        pointer to the @p TrgEngine object
+ * @param[in] capturing TRUE when a capture starts, FALSE when it ends
+ */
+typedef void (*trgcallback_t)(TrgEngine *tp, bool_t capturing);
+
+/**
+ * @brief   Trigger condition.
+ */
+typedef struct {
+  /** @brief @p TRG_LEVEL, @p TRG_RATE or @p TRG_BAND.*/
+  uint8_t               kind;
+  /** @brief Channel the condition watches.*/
+  uint8_t               channel;
+  /** @brief @p TRG_RATE: frames the change is measured over, at least one
+             and less than the ring depth.*/
+  uint16_t              lag;
+  /** @brief @p TRG_BAND: high cutoff moving average, 2^fast frames.*/
+  uint8_t               fast;
+  /** @brief @p TRG_BAND: low cutoff moving average, 2^slow frames.*/
+  uint8_t               slow;
+  /** @brief @p TRG_BAND: power averaging, 2^avg frames.*/
+  uint8_t               avg;
+  /** @brief Firing threshold, power in channel units squared for bands.*/
+  int32_t               on;
+  /** @brief Release threshold.*/
+  int32_t               off;
+} TrgCondition;
+
+/**
+ * @brief   Trigger engine parameters.
+ */
+typedef struct {
+  /** @brief Values per frame.*/
+  unsigned              channels;
+  /** @brief The conditions, any of them starts a capture.*/
+  const TrgCondition    *conditions;
+  /** @brief Number of conditions, at most @p TRG_MAX_CONDITIONS.*/
+  unsigned              nconditions;
+  /** @brief Ring buffer, @p depth frames of @p channels+1 words.*/
+  int32_t               *buffer;
+  /** @brief Ring depth in frames, the slack over @p pre is what the reader
+             can fall behind during a capture.*/
+  size_t                depth;
+  /** @brief History frames preceding the trigger, less than @p depth.*/
+  size_t                pre;
+  /** @brief Frames captured after the last condition is released.*/
+  size_t                post;
+  /** @brief Capture start and end callback or @p NULL.*/
+  trgcallback_t         mode_cb;
+} TrgConfig;
+
+/**
+ * @brief   Moving averages of a @p TRG_BAND condition, Q8.
+ * @note    The channel must stay within +/-2^23 of its slow average for
+ *          the squares to fit.
+ */
+typedef struct {
+  int64_t               fast;
+  int64_t               slow;
+  int64_t               power;
+} TrgBandState;
+
+/**
+ * @brief   Structure representing a trigger engine.
+ */
+struct TrgEngine {
+  /** @brief Engine parameters.*/
+  const TrgConfig       *config;
+  /** @brief Ring index of the next frame.*/
+  size_t                head;
+  /** @brief Frames in the ring.*/
+  size_t                filled;
+  /** @brief Frames written since start.*/
+  uint32_t              wr;
+  /** @brief Next frame to be read.*/
+  uint32_t              rd;
+  /** @brief End of the readable frames, unless capturing.*/
+  uint32_t              end;
+  /** @brief A capture is running.*/
+  bool_t                capturing;
+  /** @brief Conditions currently fired.*/
+  uint32_t              active;
+  /** @brief Conditions that started the running or last capture.*/
+  uint32_t              cause;
+  /** @brief Frames since all conditions were released.*/
+  uint32_t              quiet;
+  /** @brief Statistics: captures started.*/
+  uint32_t              captures;
+  /** @brief Statistics: captured frames overwritten before being read.*/
+  uint32_t              overruns;
+  /** @brief Band filter states, per condition.*/
+  TrgBandState          band[TRG_MAX_CONDITIONS];
+};
+
+/**
+ * @brief   Returns TRUE while a capture is running.
+ */
+#define trgIsCapturing(tp) ((tp)->capturing)
+
+/**
+ * @brief   Returns the conditions that started the running or last capture.
+ */
+#define trgGetCause(tp) ((tp)->cause)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void trgInit(TrgEngine *tp, const TrgConfig *cfgp);
+  bool_t trgPut(TrgEngine *tp, uint32_t time, const int32_t *values);
+  bool_t trgRead(TrgEngine *tp, uint32_t *timep, int32_t *values);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TRIGGER_H_ */
+
+/** @} */
@@ -35,6 +35,7 @@
 #include "testmtx.h"
 #include "testmsg.h"
 #include "testmbox.h"
+#include "testwq.h"
 #include "testevt.h"
 #include "testheap.h"
 #include "testpools.h"
@@ -51,6 +52,7 @@ static ROMCONST struct testcase * ROMCONST *patterns[] = {
   patternmtx,
   patternmsg,
   patternmbox,
+  patternwq,
   patternevt,
   patternheap,
   patternpools,
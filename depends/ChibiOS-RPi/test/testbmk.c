@@ -19,6 +19,7 @@
 */
 
 #include "ch.h"
+#include "hal.h"
 #include "test.h"
 
 /**
@@ -53,6 +54,9 @@
  * - @subpage test_benchmarks_011
  * - @subpage test_benchmarks_012
  * - @subpage test_benchmarks_013
+ * - @subpage test_benchmarks_014
+ * - @subpage test_benchmarks_015
+ * - @subpage test_benchmarks_016
  * .
  * @file testbmk.c Kernel Benchmarks
  * @brief Kernel Benchmarks source file
@@ -689,6 +693,232 @@ ROMCONST struct testcase testbmk13 = {
   bmk13_execute
 };
 
+/**
+ * @page test_benchmarks_014 Ready list insertion
+ *
+ * <h2>Description</h2>
+ * A thread is inserted into and removed from the ready list, behind a
+ * growing number of ready threads of higher priority, the score is the
+ * number of insertions per second for each number of ready threads. The
+ * threads are never executed, their descriptors are taken from the test
+ * buffer so the largest number depends on the available RAM.
+ */
+
+#define BMK14_MAX_READY         64
+
+static void bmk14_execute(void) {
+  Thread *tdp = (Thread *)test.buffer;
+  Thread *probe;
+  tprio_t prio = chThdGetPriority();
+  uint32_t i, k, max;
+
+  max = sizeof(test.buffer) / sizeof(Thread) - 1;
+  if (max > BMK14_MAX_READY)
+    max = BMK14_MAX_READY;
+  probe = &tdp[max];
+  probe->p_prio = prio - 2;
+  for (k = 0; ; k = k ? k * 4 : 1) {
+    uint32_t n = 0;
+
+    if (k > max)
+      k = max;
+    /* The fillers have a lower priority than this thread so they are never
+       scheduled, but nothing must block while they are in the ready list.*/
+    test_wait_tick();
+    chSysLock();
+    for (i = 0; i < k; i++) {
+      tdp[i].p_prio = prio - 1;
+      tdp[i].p_state = THD_STATE_SUSPENDED;
+      chSchReadyI(&tdp[i]);
+    }
+    chSysUnlock();
+    test_start_timer(1000);
+    do {
+      chSysLock();
+      probe->p_state = THD_STATE_SUSPENDED;
+      chSchReadyI(probe);
+      chSchReadyRemoveI(probe, prio - 2);
+      chSysUnlock();
+      n++;
+#if defined(SIMULATOR)
+      ChkIntSources();
+#endif
+    } while (!test_timer_done);
+    chSysLock();
+    for (i = 0; i < k; i++)
+      chSchReadyRemoveI(&tdp[i], prio - 1);
+    chSysUnlock();
+    test_print("--- Score : ");
+    test_printn(n);
+    test_print(" wakeups/S, ");
+    test_printn(k);
+    test_println(" ready");
+    if (k == max)
+      break;
+  }
+}
+
+ROMCONST struct testcase testbmk14 = {
+  "Benchmark, ready list insertion",
+  NULL,
+  NULL,
+  bmk14_execute
+};
+
+#if CH_USE_MAILBOXES || defined(__DOXYGEN__)
+/**
+ * @page test_benchmarks_015 Mailboxes, single and batched messages
+ *
+ * <h2>Description</h2>
+ * Messages are posted into a mailbox and fetched back by the same thread,
+ * first one at a time and then in batches of @p BMK15_BATCH messages, the
+ * scores are the number of messages moved per second with each API.
+ */
+
+#define BMK15_BATCH             8
+
+static Mailbox mb1;
+static msg_t mb1_buf[BMK15_BATCH];
+
+static void bmk15_setup(void) {
+
+  chMBInit(&mb1, mb1_buf, BMK15_BATCH);
+}
+
+static void bmk15_execute(void) {
+  msg_t msgs[BMK15_BATCH];
+  uint32_t i, n;
+
+  for (i = 0; i < BMK15_BATCH; i++)
+    msgs[i] = (msg_t)i;
+
+  n = 0;
+  test_wait_tick();
+  test_start_timer(1000);
+  do {
+    for (i = 0; i < BMK15_BATCH; i++)
+      chMBPost(&mb1, msgs[i], TIME_INFINITE);
+    for (i = 0; i < BMK15_BATCH; i++)
+      chMBFetch(&mb1, &msgs[i], TIME_INFINITE);
+    n++;
+#if defined(SIMULATOR)
+    ChkIntSources();
+#endif
+  } while (!test_timer_done);
+  test_print("--- Single: ");
+  test_printn(n * BMK15_BATCH);
+  test_println(" msgs/S");
+
+  n = 0;
+  test_wait_tick();
+  test_start_timer(1000);
+  do {
+    chMBPostN(&mb1, msgs, BMK15_BATCH, TIME_INFINITE);
+    chMBFetchN(&mb1, msgs, BMK15_BATCH, TIME_INFINITE);
+    n++;
+#if defined(SIMULATOR)
+    ChkIntSources();
+#endif
+  } while (!test_timer_done);
+  test_print("--- Batch : ");
+  test_printn(n * BMK15_BATCH);
+  test_println(" msgs/S");
+}
+
+ROMCONST struct testcase testbmk15 = {
+  "Benchmark, mailboxes single/batched",
+  bmk15_setup,
+  NULL,
+  bmk15_execute
+};
+#endif /* CH_USE_MAILBOXES */
+
+#if HAL_IMPLEMENTS_COUNTERS || defined(__DOXYGEN__)
+/**
+ * @page test_benchmarks_016 Wakeup latency
+ *
+ * <h2>Description</h2>
+ * A thread waiting on a semaphore is signaled by a thread with a lower
+ * priority, with a growing number of threads of the same priority as the
+ * signaling one ready and yielding to each other. The signaling thread is
+ * put back in the ready list behind them before the switch. The score is
+ * the mean time from the signal to the woken thread running, measured with
+ * the realtime counter, for each number of ready threads.
+ */
+
+static halrtcnt_t bmk16_start;
+static uint32_t bmk16_total;
+
+static msg_t bmk16_waiter(void *p) {
+
+  (void)p;
+  while (TRUE) {
+    chSemWait(&sem1);
+    if (chThdShouldTerminate())
+      break;
+    bmk16_total += halGetCounterValue() - bmk16_start;
+  }
+  return 0;
+}
+
+static msg_t bmk16_yielder(void *p) {
+
+  (void)p;
+  while (!chThdShouldTerminate()) {
+    chThdYield();
+#if defined(SIMULATOR)
+    ChkIntSources();
+#endif
+  }
+  return 0;
+}
+
+static void bmk16_execute(void) {
+  tprio_t prio = chThdGetPriority();
+  uint32_t i, k, n, ns;
+
+  for (k = 0; k < MAX_THREADS; k = k ? k * 2 : 1) {
+    chSemInit(&sem1, 0);
+    bmk16_total = 0;
+    threads[0] = chThdCreateStatic(wa[0], WA_SIZE, prio + 1,
+                                   bmk16_waiter, NULL);
+    for (i = 1; i <= k; i++)
+      threads[i] = chThdCreateStatic(wa[i], WA_SIZE, prio,
+                                     bmk16_yielder, NULL);
+    n = 0;
+    test_wait_tick();
+    test_start_timer(1000);
+    do {
+      bmk16_start = halGetCounterValue();
+      chSemSignal(&sem1);
+      n++;
+#if defined(SIMULATOR)
+      ChkIntSources();
+#endif
+    } while (!test_timer_done);
+    test_terminate_threads();
+    chSemReset(&sem1, 0);
+    test_wait_threads();
+
+    /* Nanoseconds, without overflowing 32 bits on fast counters.*/
+    ns = 1000000000UL / halGetCounterFrequency();
+    ns = (bmk16_total / n) * ns + (bmk16_total % n) * ns / n;
+    test_print("--- Score : ");
+    test_printn(ns);
+    test_print(" nS/wakeup, ");
+    test_printn(k);
+    test_println(" ready");
+  }
+}
+
+ROMCONST struct testcase testbmk16 = {
+  "Benchmark, wakeup latency",
+  NULL,
+  NULL,
+  bmk16_execute
+};
+#endif /* HAL_IMPLEMENTS_COUNTERS */
+
 /**
  * @brief   Test sequence for benchmarks.
  */
@@ -709,6 +939,13 @@ ROMCONST struct testcase * ROMCONST patternbmk[] = {
   &testbmk12,
 #endif
   &testbmk13,
+  &testbmk14,
+#if CH_USE_MAILBOXES || defined(__DOXYGEN__)
+  &testbmk15,
+#endif
+#if HAL_IMPLEMENTS_COUNTERS
+  &testbmk16,
+#endif
 #endif
   NULL
 };
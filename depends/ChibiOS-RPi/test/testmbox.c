@@ -44,6 +44,7 @@
  *
  * <h2>Test Cases</h2>
  * - @subpage test_mbox_001
+ * - @subpage test_mbox_002
  * .
  * @file testmbox.c
  * @brief Mailboxes test source file
@@ -230,6 +231,123 @@ ROMCONST struct testcase testmbox1 = {
   mbox1_execute
 };
 
+/**
+ * @page test_mbox_002 Batched operations
+ *
+ * <h2>Description</h2>
+ * Batches of messages are posted/fetched, partially fitting batches, the
+ * timeouts, the buffer circularity and the I-Class variants are tested.
+ * Finally a waiting thread is expected to receive a whole batch with a
+ * single wakeup.
+ */
+
+static void mbox2_setup(void) {
+
+  chMBInit(&mb1, (msg_t *)test.wa.T0, MB_SIZE);
+}
+
+static msg_t thread1(void *p) {
+  msg_t buf[MB_SIZE];
+  cnt_t i, n;
+
+  (void)p;
+  n = chMBFetchN(&mb1, buf, MB_SIZE, TIME_INFINITE);
+  test_emit_token('0' + n);
+  for (i = 0; i < n; i++)
+    test_emit_token(buf[i]);
+  return 0;
+}
+
+static void mbox2_execute(void) {
+  static const msg_t msgs[] = {'A', 'B', 'C', 'D', 'E', 'F', 'G'};
+  msg_t buf[MB_SIZE];
+  cnt_t i, n;
+
+  /*
+   * Testing partial posting.
+   */
+  n = chMBPostN(&mb1, msgs, 3, TIME_INFINITE);
+  test_assert(1, n == 3, "wrong count");
+  n = chMBPostN(&mb1, &msgs[3], 4, TIME_INFINITE);
+  test_assert(2, n == 2, "wrong count");
+
+  /*
+   * Testing post timeout.
+   */
+  n = chMBPostN(&mb1, &msgs[5], 2, 1);
+  test_assert(3, n == 0, "not timed out");
+  chSysLock();
+  n = chMBPostNI(&mb1, &msgs[5], 2);
+  chSysUnlock();
+  test_assert(4, n == 0, "not full");
+  test_assert_lock(5, chMBGetUsedCountI(&mb1) == MB_SIZE, "not full");
+
+  /*
+   * Testing dequeuing, the second fetch takes everything left.
+   */
+  n = chMBFetchN(&mb1, buf, 2, TIME_INFINITE);
+  test_assert(6, n == 2, "wrong count");
+  for (i = 0; i < n; i++)
+    test_emit_token(buf[i]);
+  n = chMBFetchN(&mb1, buf, MB_SIZE, TIME_INFINITE);
+  test_assert(7, n == 3, "wrong count");
+  for (i = 0; i < n; i++)
+    test_emit_token(buf[i]);
+  test_assert_sequence(8, "ABCDE");
+
+  /*
+   * Testing fetch timeout.
+   */
+  n = chMBFetchN(&mb1, buf, MB_SIZE, 1);
+  test_assert(9, n == 0, "not timed out");
+  chSysLock();
+  n = chMBFetchNI(&mb1, buf, MB_SIZE);
+  chSysUnlock();
+  test_assert(10, n == 0, "not empty");
+
+  /*
+   * Testing I-Class and buffer circularity.
+   */
+  chSysLock();
+  n = chMBPostNI(&mb1, msgs, 3);
+  chSysUnlock();
+  test_assert(11, n == 3, "wrong count");
+  chSysLock();
+  n = chMBFetchNI(&mb1, buf, MB_SIZE);
+  chSysUnlock();
+  test_assert(12, n == 3, "wrong count");
+  chSysLock();
+  n = chMBPostNI(&mb1, &msgs[3], 4);
+  chSysUnlock();
+  test_assert(13, n == 4, "wrong count");
+  chSysLock();
+  n = chMBFetchNI(&mb1, buf, MB_SIZE);
+  chSysUnlock();
+  test_assert(14, n == 4, "wrong count");
+  for (i = 0; i < n; i++)
+    test_emit_token(buf[i]);
+  test_assert_sequence(15, "DEFG");
+  test_assert_lock(16, chMBGetFreeCountI(&mb1) == MB_SIZE, "not empty");
+  test_assert_lock(17, mb1.mb_rdptr == mb1.mb_wrptr, "pointers not aligned");
+
+  /*
+   * Testing the single wakeup of a waiting thread.
+   */
+  threads[0] = chThdCreateStatic(wa[1], WA_SIZE, chThdGetPriority() + 1,
+                                 thread1, NULL);
+  n = chMBPostN(&mb1, msgs, 4, TIME_INFINITE);
+  test_assert(18, n == 4, "wrong count");
+  test_wait_threads();
+  test_assert_sequence(19, "4ABCD");
+}
+
+ROMCONST struct testcase testmbox2 = {
+  "Mailboxes, batched operations",
+  mbox2_setup,
+  NULL,
+  mbox2_execute
+};
+
 #endif /* CH_USE_MAILBOXES */
 
 /**
@@ -238,6 +356,7 @@ ROMCONST struct testcase testmbox1 = {
 ROMCONST struct testcase * ROMCONST patternmbox[] = {
 #if CH_USE_MAILBOXES || defined(__DOXYGEN__)
   &testmbox1,
+  &testmbox2,
 #endif
   NULL
 };
@@ -0,0 +1,195 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ch.h"
+#include "test.h"
+
+/**
+ * @page test_wq Work queues test
+ *
+ * File: @ref testwq.c
+ *
+ * <h2>Description</h2>
+ * This module implements the test sequence for the @ref work_queues
+ * subsystem.
+ *
+ * <h2>Objective</h2>
+ * Objective of the test module is to cover 100% of the @ref work_queues
+ * subsystem code.<br>
+ * Note that the @ref work_queues subsystem depends on the @ref semaphores
+ * subsystem that has to met its testing objectives as well.
+ *
+ * <h2>Preconditions</h2>
+ * The module requires the following kernel options:
+ * - @p CH_USE_WORKQUEUES
+ * .
+ * In case some of the required options are not enabled then some or all tests
+ * may be skipped.
+ *
+ * <h2>Test Cases</h2>
+ * - @subpage test_wq_001
+ * - @subpage test_wq_002
+ * .
+ * @file testwq.c
+ * @brief Work queues test source file
+ * @file testwq.h
+ * @brief Work queues header file
+ */
+
+#if CH_USE_WORKQUEUES || defined(__DOXYGEN__)
+
+static void work(void *p) {
+
+  test_emit_token(*(char *)p);
+}
+
+/*
+ * Note, the static initializers are not really required because the
+ * variables are explicitly initialized in each test case. It is done in order
+ * to test the macros.
+ */
+static WORKQUEUE_DECL(wq1);
+static WORKITEM_DECL(wi1, work, "A");
+static WORKITEM_DECL(wi2, work, "B");
+static WORKITEM_DECL(wi3, work, "C");
+
+static void wq_setup(void) {
+
+  chWQInit(&wq1);
+  chWQItemInit(&wi1, work, "A");
+  chWQItemInit(&wi2, work, "B");
+  chWQItemInit(&wi3, work, "C");
+}
+
+/**
+ * @page test_wq_001 Queuing and coalescing
+ *
+ * <h2>Description</h2>
+ * Work items are enqueued, one of them twice, and dispatched by the test
+ * thread itself. The items are expected to run once each in FIFO order and
+ * the statistics to account for every operation.
+ */
+
+static void wq1_execute(void) {
+  bool_t queued;
+  msg_t msg;
+
+  test_assert(1, chWQEnqueue(&wq1, &wi1), "not queued");
+  chSysLock();
+  queued = chWQEnqueueI(&wq1, &wi2);
+  chSysUnlock();
+  test_assert(2, queued, "not queued");
+  test_assert(3, chWQEnqueue(&wq1, &wi3), "not queued");
+  test_assert(4, !chWQEnqueue(&wq1, &wi1), "queued twice");
+  test_assert_lock(5, chWQGetDepthI(&wq1) == 3, "wrong depth");
+  test_assert_lock(6, chWQIsPendingI(&wi1), "not pending");
+  test_assert(7, wq1.wq_coalesced == 1, "coalesced not counted");
+
+  while (chWQDispatch(&wq1, TIME_IMMEDIATE) == RDY_OK)
+    ;
+  test_assert_sequence(8, "ABC");
+  test_assert_lock(9, chWQGetDepthI(&wq1) == 0, "not empty");
+  test_assert_lock(10, !chWQIsPendingI(&wi1), "still pending");
+  test_assert(11, wq1.wq_served == 3, "wrong served count");
+  test_assert(12, wq1.wq_maxdepth == 3, "wrong max depth");
+  test_assert(13, wq1.wq_head == NULL, "head not NULL");
+  test_assert(14, wq1.wq_tail == NULL, "tail not NULL");
+
+  msg = chWQDispatch(&wq1, TIME_IMMEDIATE);
+  test_assert(15, msg == RDY_TIMEOUT, "wrong wake-up message");
+
+  /* A run item can be queued again.*/
+  test_assert(16, chWQEnqueue(&wq1, &wi1), "not queued");
+  msg = chWQDispatch(&wq1, TIME_IMMEDIATE);
+  test_assert(17, msg == RDY_OK, "wrong wake-up message");
+  test_assert_sequence(18, "A");
+
+  chWQResetStats(&wq1);
+  test_assert(19, (wq1.wq_served == 0) && (wq1.wq_coalesced == 0) &&
+                  (wq1.wq_maxdepth == 0) && (wq1.wq_latency == 0),
+              "statistics not cleared");
+}
+
+ROMCONST struct testcase testwq1 = {
+  "Work queues, queuing and coalescing",
+  wq_setup,
+  NULL,
+  wq1_execute
+};
+
+/**
+ * @page test_wq_002 Worker threads
+ *
+ * <h2>Description</h2>
+ * Two worker threads with priority above the test thread serve the queue.
+ * Items enqueued from a locked state are expected to run, in FIFO order, as
+ * soon as the test thread reschedules. Resetting the queue semaphore
+ * releases the workers.
+ */
+
+static msg_t worker(void *p) {
+
+  while (chWQDispatch((WorkQueue *)p, TIME_INFINITE) == RDY_OK)
+    ;
+  return 0;
+}
+
+static void wq2_execute(void) {
+  tprio_t prio = chThdGetPriority();
+
+  threads[0] = chThdCreateStatic(wa[0], WA_SIZE, prio + 1, worker, &wq1);
+  threads[1] = chThdCreateStatic(wa[1], WA_SIZE, prio + 1, worker, &wq1);
+
+  chSysLock();
+  chWQEnqueueI(&wq1, &wi1);
+  chWQEnqueueI(&wq1, &wi2);
+  chWQEnqueueI(&wq1, &wi3);
+  chSchRescheduleS();
+  chSysUnlock();
+  test_assert_sequence(1, "ABC");
+  test_assert(2, wq1.wq_served == 3, "wrong served count");
+  test_assert_lock(3, chWQGetDepthI(&wq1) == 0, "not empty");
+
+  chSysLock();
+  chSemResetI(&wq1.wq_sem, 0);
+  chSchRescheduleS();
+  chSysUnlock();
+  test_wait_threads();
+}
+
+ROMCONST struct testcase testwq2 = {
+  "Work queues, worker threads",
+  wq_setup,
+  NULL,
+  wq2_execute
+};
+
+#endif /* CH_USE_WORKQUEUES */
+
+/**
+ * @brief   Test sequence for work queues.
+ */
+ROMCONST struct testcase * ROMCONST patternwq[] = {
+#if CH_USE_WORKQUEUES || defined(__DOXYGEN__)
+  &testwq1,
+  &testwq2,
+#endif
+  NULL
+};
@@ -0,0 +1,109 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ch.h"
+#include "hal.h"
+#include "chprintf.h"
+
+#define ADC_GRP_NUM_CHANNELS    2
+#define ADC_GRP_BUF_DEPTH       256
+
+static adcsample_t samples[ADC_GRP_NUM_CHANNELS * ADC_GRP_BUF_DEPTH];
+
+static uint32_t sums[ADC_GRP_NUM_CHANNELS];
+static uint32_t rows;
+static uint32_t errors;
+
+/*
+ * Accumulates each half buffer as it is converted.
+ */
+static void adccb(ADCDriver *adcp, adcsample_t *buffer, size_t n) {
+  size_t i;
+
+  (void)adcp;
+  for (i = 0; i < n; i++) {
+    sums[0] += buffer[i * ADC_GRP_NUM_CHANNELS];
+    sums[1] += buffer[i * ADC_GRP_NUM_CHANNELS + 1];
+  }
+  rows += n;
+}
+
+static void adcerrcb(ADCDriver *adcp, adcerror_t err) {
+
+  (void)adcp;
+  (void)err;
+  errors++;
+}
+
+/*
+ * MCP3008, 1MHz SCLK: about 30k conversions per second.
+ */
+static const ADCConfig adccfg = {
+  ADC_DEVICE_MCP3008,
+  0,
+  256
+};
+
+static const ADCConversionGroup adcgrpcfg = {
+  TRUE,
+  ADC_GRP_NUM_CHANNELS,
+  adccb,
+  adcerrcb,
+  {ADC_CHANNEL_IN0, ADC_CHANNEL_IN1}
+};
+
+/*
+ * Application entry point.
+ */
+int main(void) {
+  halInit();
+  chSysInit();
+
+  /*
+   * Serial port initialization.
+   */
+  sdStart(&SD1, NULL);
+  chprintf((BaseSequentialStream *)&SD1, "BCM2835 ADC Demonstration\r\n");
+
+  /*
+   * Continuous conversion into a circular buffer.
+   */
+  adcStart(&ADCD1, &adccfg);
+  adcStartConversion(&ADCD1, &adcgrpcfg, samples, ADC_GRP_BUF_DEPTH);
+
+  for (;;) {
+    uint32_t n, s0, s1;
+
+    chThdSleepMilliseconds(1000);
+    chSysLock();
+    n = rows;
+    s0 = sums[0];
+    s1 = sums[1];
+    rows = sums[0] = sums[1] = 0;
+    chSysUnlock();
+
+    if (n > 0)
+      chprintf((BaseSequentialStream *)&SD1,
+               "CH0 %4u  CH1 %4u  %u scans/s  %u errors\r\n",
+               s0 / n, s1 / n, n, errors);
+  }
+
+  return 0;
+}
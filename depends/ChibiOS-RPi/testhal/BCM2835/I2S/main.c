@@ -0,0 +1,128 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ch.h"
+#include "hal.h"
+#include "chprintf.h"
+
+/* 10ms of stereo frames, each half holds 5ms.*/
+#define FRAMES      480
+
+static BCM2835_I2S_BUFFER_DECL(rxbuf, FRAMES * 2);
+
+/* Left channel statistics, accumulated in the callback.*/
+static uint64_t sumsq;
+static uint32_t count, peak;
+
+/*
+ * Integer square root.
+ */
+static uint32_t isqrt(uint64_t x) {
+  uint64_t r = 0, bit = (uint64_t)1 << 62;
+
+  while (bit > x)
+    bit >>= 2;
+  while (bit != 0) {
+    if (x >= r + bit) {
+      x -= r + bit;
+      r = (r >> 1) + bit;
+    }
+    else
+      r >>= 1;
+    bit >>= 2;
+  }
+  return (uint32_t)r;
+}
+
+/*
+ * Half buffer callback, the 24 bit samples are left aligned in their 32
+ * bit slots.
+ */
+static void i2scb(I2SDriver *i2sp, size_t offset, size_t n) {
+  const int32_t *sp = (const int32_t *)rxbuf + offset;
+
+  (void)i2sp;
+  for (; n > 0; n -= 2, sp += 2) {
+    int32_t s = *sp >> 8;
+    uint32_t a = s < 0 ? -s : s;
+
+    sumsq += (uint64_t)((int64_t)s * s);
+    if (a > peak)
+      peak = a;
+    count++;
+  }
+}
+
+/*
+ * MEMS microphone (SPH0645, ICS-43434) with SEL low on the left channel,
+ * Philips format at 48kHz, two 32 bit slots per frame.
+ */
+static const I2SConfig i2scfg = {
+  NULL,
+  rxbuf,
+  FRAMES * 2,
+  i2scb,
+  I2S_MODE_MASTER | I2S_MODE_RX,
+  BCM2835_I2S_FORMAT_PHILIPS,
+  32,
+  2,
+  FALSE,
+  64,
+  48000
+};
+
+/*
+ * Application entry point.
+ */
+int main(void) {
+  halInit();
+  chSysInit();
+
+  /*
+   * Serial port initialization.
+   */
+  sdStart(&SD1, NULL);
+  chprintf((BaseSequentialStream *)&SD1, "BCM2835 I2S Demonstration\r\n");
+
+  i2sStart(&I2SD1, &i2scfg);
+  i2sStartExchangeContinuous(&I2SD1);
+
+  for (;;) {
+    uint64_t sq;
+    uint32_t n, pk;
+
+    chThdSleepMilliseconds(1000);
+
+    chSysLock();
+    sq = sumsq;
+    n = count;
+    pk = peak;
+    sumsq = 0;
+    count = 0;
+    peak = 0;
+    chSysUnlock();
+
+    chprintf((BaseSequentialStream *)&SD1,
+             "%u samples  rms %u  peak %u  overruns %u\r\n",
+             n, n > 0 ? isqrt(sq / n) : 0, pk, I2SD1.overruns);
+  }
+
+  return 0;
+}
@@ -0,0 +1,88 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ch.h"
+#include "hal.h"
+#include "chprintf.h"
+
+static icucnt_t last_width, last_period;
+static uint32_t pulses, stops;
+
+static void icuwidthcb(ICUDriver *icup) {
+
+  last_width = icuGetWidth(icup);
+}
+
+static void icuperiodcb(ICUDriver *icup) {
+
+  last_period = icuGetPeriod(icup);
+  pulses++;
+}
+
+static void icuoverflowcb(ICUDriver *icup) {
+
+  (void)icup;
+  stops++;
+}
+
+/*
+ * Active low input on GPIO17, averaged over 1s gates, 3s without a pulse
+ * is a stop.
+ */
+static const ICUConfig icucfg = {
+  ICU_INPUT_ACTIVE_LOW,
+  SYSTIMER_CLOCK_FREQ,
+  icuwidthcb,
+  icuperiodcb,
+  icuoverflowcb,
+  17,
+  3000000,
+  1000000
+};
+
+/*
+ * Application entry point.
+ */
+int main(void) {
+  halInit();
+  chSysInit();
+
+  /*
+   * Serial port initialization.
+   */
+  sdStart(&SD1, NULL);
+  chprintf((BaseSequentialStream *)&SD1, "BCM2835 ICU Demonstration\r\n");
+
+  icuStart(&ICUD1, &icucfg);
+  palSetPadMode(GPIO17_PORT, GPIO17_PAD, PAL_MODE_INPUT_PULLUP);
+  icuEnable(&ICUD1);
+
+  for (;;) {
+    uint32_t mhz;
+
+    chThdSleepMilliseconds(1000);
+    mhz = icuBCM2835GetFrequency(&ICUD1);
+    chprintf((BaseSequentialStream *)&SD1,
+             "%u.%03u Hz  period %u us  width %u us  pulses %u  stops %u\r\n",
+             mhz / 1000, mhz % 1000, last_period, last_width, pulses, stops);
+  }
+
+  return 0;
+}
@@ -18,41 +18,94 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <time.h>
+
 #include "ch.h"
 #include "hal.h"
 #include "chprintf.h"
+#include "chrtclib.h"
+#include "calendar.h"
+
+#define BENCH_RUNS      1000
+
+static BaseSequentialStream *chp = (BaseSequentialStream *)&SD1;
+
+/*
+ * Time taken by BENCH_RUNS epoch to calendar conversions, the table driven
+ * one against the C library.
+ */
+static void bench(void) {
+  struct tm tm;
+  halrtcnt_t start;
+  uint32_t fast, libc, i;
+  time_t t;
+
+  start = halGetCounterValue();
+  for (i = 0; i < BENCH_RUNS; i++)
+    calEpochToTm(1000000000 + i * 86413, &tm);
+  fast = RTT2US(halGetCounterValue() - start);
+
+  start = halGetCounterValue();
+  for (i = 0; i < BENCH_RUNS; i++) {
+    t = 1000000000 + i * 86413;
+    gmtime_r(&t, &tm);
+  }
+  libc = RTT2US(halGetCounterValue() - start);
+
+  chprintf(chp, "%u conversions: calEpochToTm %u us, gmtime_r %u us\r\n",
+           BENCH_RUNS, fast, libc);
+}
 
 /*
  * Application entry point.
  */
 int main(void) {
+  uint32_t entry = 0;
+  bool_t digits = FALSE;
+  systime_t next;
+
   halInit();
   chSysInit();
 
   /*
    * Serial port initialization.
    */
-  sdStart(&SD1, NULL); 
-  chprintf((BaseSequentialStream *)&SD1, "BCM2835 RTC Demonstration\r\n");
-
-  //uint8_t request[] = { 0x00, 0x30, 0x20, 0x08, 0x06, 0x06, 0x10, 0x12 };
-  //i2cMasterTransmit(&I2C0, 0x68, request, 7, NULL, 0);
+  sdStart(&SD1, NULL);
+  chprintf(chp, "BCM2835 RTC Demonstration\r\n");
+  chprintf(chp, "Type the UNIX time in seconds and Enter to set the clock\r\n");
+  bench();
 
+  next = chTimeNow();
   for (;;) {
+    RTCTime now;
+    struct tm tm;
+    msg_t c;
 
-    RTCTime time;
-    rtcGetTime(&RTCD1, &time);
-    chprintf((BaseSequentialStream *)&SD1, "%.2d/%.2d/%.2d %.2d:%.2d:%.2d\r\n",
-	     rtc_month(time), rtc_day(time), rtc_year(time),
-	     rtc_hour(time), rtc_minute(time), rtc_second(time));
+    /*
+     * Host input: decimal seconds since the epoch, ended by CR or LF.
+     */
+    while ((c = chnGetTimeout((BaseChannel *)&SD1, TIME_IMMEDIATE)) >= 0) {
+      if (c >= '0' && c <= '9') {
+        entry = entry * 10 + (c - '0');
+        digits = TRUE;
+      }
+      else if ((c == '\r' || c == '\n') && digits) {
+        rtcSetTimeUnixSec(&RTCD1, entry);
+        entry = 0;
+        digits = FALSE;
+      }
+    }
 
-    chThdSleepMilliseconds(1000);
-  }
+    rtcGetTime(&RTCD1, &now);
+    calEpochToTm(now.tv_sec, &tm);
+    chprintf(chp, "%04d-%02d-%02d %02d:%02d:%02d.%03u  FAT 0x%08x\r\n",
+             tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+             tm.tm_hour, tm.tm_min, tm.tm_sec, now.tv_msec,
+             rtcGetTimeFat(&RTCD1));
 
-  /*
-   * Events servicing loop.
-   */
-  chThdWait(chThdSelf());
+    next += MS2ST(1000);
+    chThdSleepUntil(next);
+  }
 
   return 0;
 }
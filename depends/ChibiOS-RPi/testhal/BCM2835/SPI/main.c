@@ -18,24 +18,101 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
+
 #include "ch.h"
 #include "hal.h"
 #include "chprintf.h"
 
-SPIConfig spiConfig;
+/*
+ * Throughput and isolation test for the SPI masters.
+ * Jumper MOSI to MISO on each bus (SPI0: GPIO10-GPIO9, SPI1: GPIO20-GPIO19)
+ * to also check the data, without the jumpers only the timing is meaningful.
+ */
+
+#define FRAME_SIZE      8192        /* Display sized push on SPI0.*/
+#define FRAMES          8
+#define SAMPLE_SIZE     6           /* Sensor sized transfer on SPID1.*/
+#define SAMPLES         1000
+
+static BaseSequentialStream *chp = (BaseSequentialStream *)&SD1;
+
+/* SCLK = 250 MHz / 32 = 7.8 MHz on both buses.*/
+static const SPIConfig display_cfg = {NULL, 0, 0, 0, 0, 0, 0, 0, 32};
+static const SPIConfig sensor_cfg = {NULL, 0, 0, 0, 0, 0, 0, 0, 32};
+
+static uint8_t frame_tx[FRAME_SIZE], frame_rx[FRAME_SIZE];
+static uint8_t sample_tx[SAMPLE_SIZE], sample_rx[SAMPLE_SIZE];
+
+static volatile bool_t display_run;
+static uint32_t display_frames;
+
+/*
+ * Returns the bytes per second moved by @p count exchanges of @p n bytes and
+ * whether the data looped back intact.
+ */
+static uint32_t throughput(SPIDriver *spip, const uint8_t *tx, uint8_t *rx,
+                           size_t n, unsigned count, bool_t *loopback) {
+  halrtcnt_t start = halGetCounterValue();
+  unsigned i;
+  uint32_t us;
+
+  *loopback = TRUE;
+  for (i = 0; i < count; i++) {
+    memset(rx, 0, n);
+    spiExchange(spip, n, tx, rx);
+    if (memcmp(tx, rx, n) != 0)
+      *loopback = FALSE;
+  }
+  us = RTT2US(halGetCounterValue() - start);
+  return us == 0 ? 0 : (uint32_t)(((uint64_t)n * count * 1000000) / us);
+}
+
+/*
+ * Display thread, pushes frames on SPI0 back to back.
+ */
+static WORKING_AREA(waDisplay, 512);
+static msg_t display_thread(void *arg) {
+  UNUSED(arg);
 
-static void vt100_clearscreen(void) {
-    chprintf((BaseSequentialStream *)&SD1, "%c[2J", 0x1b);
+  while (display_run) {
+    spiExchange(&SPI0, FRAME_SIZE, frame_tx, frame_rx);
+    display_frames++;
+  }
+  return 0;
 }
 
-static void vt100_cursorhome(void) {
-    chprintf((BaseSequentialStream *)&SD1, "%c[H", 0x1b);
+/*
+ * Runs SAMPLES sensor transfers, one per system tick, and reports their
+ * completion latency.
+ */
+static void sensor_latency(const char *label) {
+  systime_t next = chTimeNow();
+  uint32_t worst = 0, total = 0;
+  unsigned i;
+
+  for (i = 0; i < SAMPLES; i++) {
+    next += 1;
+    chThdSleepUntil(next);
+    halrtcnt_t start = halGetCounterValue();
+    spiExchange(&SPID1, SAMPLE_SIZE, sample_tx, sample_rx);
+    uint32_t us = RTT2US(halGetCounterValue() - start);
+    total += us;
+    if (us > worst)
+      worst = us;
+  }
+  chprintf(chp, "SPID1 %-18s avg %u us, worst %u us\r\n",
+           label, total / SAMPLES, worst);
 }
 
 /*
  * Application entry point.
  */
 int main(void) {
+  unsigned i;
+  bool_t ok;
+  uint32_t bps;
+
   halInit();
   chSysInit();
 
@@ -43,32 +120,42 @@ int main(void) {
    * Serial port initialization.
    */
   sdStart(&SD1, NULL); 
-  chprintf((BaseSequentialStream *)&SD1, "BCM2835 SPI Demonstration\r\n");
+  chprintf(chp, "BCM2835 SPI Throughput Test\r\n");
+
+  for (i = 0; i < FRAME_SIZE; i++)
+    frame_tx[i] = (uint8_t)(i * 7 + (i >> 8));
+  for (i = 0; i < SAMPLE_SIZE; i++)
+    sample_tx[i] = (uint8_t)(0xA5 ^ i);
 
   /*
-   * SPI startup.
+   * SPI startup, the sensor side runs above the display.
    */
-  spiConfig.chip_select = 0;;
-  spiStart(&SPI0, &spiConfig);
-
-  spiSelect(&SPI0);
-  
-  uint8_t txbuf[] = { 0x80, 0x00 };
-  uint8_t rxbuf[] = { 0x00, 0x00 };
+  spiStart(&SPI0, &display_cfg);
+  spiStart(&SPID1, &sensor_cfg);
+  chThdSetPriority(NORMALPRIO + 1);
 
   for (;;) {
-    spiExchange(&SPI0, 3, txbuf, rxbuf);
-    vt100_clearscreen();
-    vt100_cursorhome();
-    chprintf((BaseSequentialStream *)&SD1, "%-5d %.2x %.2x ", 
-	     ((rxbuf[0] & 0x03) << 8) | rxbuf[1], rxbuf[0] & 0x03, rxbuf[1]);
-    chThdSleepMilliseconds(100);
-  }
+    bps = throughput(&SPI0, frame_tx, frame_rx, FRAME_SIZE, FRAMES, &ok);
+    chprintf(chp, "SPI0  %u bytes/s, loopback %s\r\n", bps, ok ? "ok" : "FAIL");
+    bps = throughput(&SPID1, frame_tx, frame_rx, FRAME_SIZE, FRAMES, &ok);
+    chprintf(chp, "SPID1 %u bytes/s, loopback %s\r\n", bps, ok ? "ok" : "FAIL");
+    bps = throughput(&SPID1, sample_tx, sample_rx, SAMPLE_SIZE, SAMPLES, &ok);
+    chprintf(chp, "SPID1 %u bytes/s in %u byte transfers, loopback %s\r\n",
+             bps, SAMPLE_SIZE, ok ? "ok" : "FAIL");
 
-  /*
-   * Events servicing loop.
-   */
-  chThdWait(chThdSelf());
+    sensor_latency("idle:");
+
+    display_run = TRUE;
+    display_frames = 0;
+    Thread *tp = chThdCreateStatic(waDisplay, sizeof(waDisplay), NORMALPRIO,
+                                   display_thread, NULL);
+    sensor_latency("display busy:");
+    display_run = FALSE;
+    chThdWait(tp);
+    chprintf(chp, "SPI0  %u frames pushed meanwhile\r\n\r\n", display_frames);
+
+    chThdSleepMilliseconds(2000);
+  }
 
   return 0;
 }
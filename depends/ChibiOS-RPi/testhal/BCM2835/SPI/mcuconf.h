@@ -49,3 +49,5 @@
 /*
  * SPI driver system settings.
  */
+#define BCM2835_SPI_USE_SPI1                TRUE
+#define BCM2835_SPI_USE_SPI2                FALSE
@@ -12,6 +12,7 @@
 #include "ms8607.h"
 
 #include <assert.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -137,6 +138,8 @@ static enum ms8607_status psensor_read_eeprom(ms8607_sensor *sensor, void *calle
 static enum ms8607_status psensor_conversion_and_read_adc(ms8607_sensor *sensor, uint8_t, uint32_t *, void *caller_context);
 static bool psensor_crc_check (uint16_t *n_prom, uint8_t crc);
 static enum ms8607_status psensor_read_pressure_and_temperature(ms8607_sensor *sensor, int32_t *, int32_t *, void *caller_context);
+static enum ms8607_status psensor_compensate(ms8607_sensor *sensor, uint32_t, uint32_t, int32_t *, int32_t *);
+static int32_t hsensor_compensate(uint16_t);
 
 static enum ms8607_status
 	i2c_controller_read_unimpl(void *caller_context, ms8607_i2c_controller_packet *const packet)
@@ -1142,13 +1145,20 @@ static enum ms8607_status hsensor_read_relative_humidity(ms8607_sensor *sensor,
 	if( status != ms8607_status_ok)
 		return status;
 
-	// Perform conversion function
-	//*humidity = (float)adc * HUMIDITY_COEFF_MUL / (1UL<<16) + HUMIDITY_COEFF_ADD;
-	*humidity = 1000 * adc * HUMIDITY_COEFF_MUL / (1UL<<16) + HUMIDITY_COEFF_ADD;
+	*humidity = hsensor_compensate(adc);
 
 	return status;
 }
 
+/// \brief Converts a raw humidity ADC value to 0.001 %RH.
+///
+static int32_t hsensor_compensate(uint16_t adc)
+{
+	// Perform conversion function
+	//*humidity = (float)adc * HUMIDITY_COEFF_MUL / (1UL<<16) + HUMIDITY_COEFF_ADD;
+	return 1000 * adc * HUMIDITY_COEFF_MUL / (1UL<<16) + HUMIDITY_COEFF_ADD;
+}
+
 #if 0
 // TODO: remove?
 /*static*/ enum ms8607_status hsensor_poll_relative_humidity(ms8607_sensor *sensor, float *humidity, void *caller_context)
@@ -1567,8 +1577,6 @@ static enum ms8607_status psensor_read_pressure_and_temperature(ms8607_sensor *s
 
 	enum ms8607_status status = ms8607_status_ok;
 	uint32_t adc_temperature, adc_pressure;
-	int32_t dT, TEMP;
-	int64_t OFF, SENS, P, T2, OFF2, SENS2;
 	uint8_t cmd;
 
 	// If first time adc is requested, get EEPROM coefficients
@@ -1591,6 +1599,26 @@ static enum ms8607_status psensor_read_pressure_and_temperature(ms8607_sensor *s
 	if( status != ms8607_status_ok)
 		return status;
 
+	return psensor_compensate(sensor, adc_temperature, adc_pressure, temperature, pressure);
+}
+
+/// \brief Computes temperature and pressure from the raw ADC values
+///
+/// \param[in] ms8607_sensor *sensor : Object holding the EEPROM coefficients
+/// \param[in] uint32_t : Raw temperature ADC value
+/// \param[in] uint32_t : Raw pressure ADC value
+/// \param[out] int32_t* : 0.001 degC temperature value
+/// \param[out] int32_t* : 0.001 mbar pressure value
+///
+/// \return ms8607_status : status of MS8607
+///       - ms8607_status_ok : Values computed
+///       - ms8607_status_measurement_invalid : One of the ADC values was zero
+///
+static enum ms8607_status psensor_compensate(ms8607_sensor *sensor, uint32_t adc_temperature, uint32_t adc_pressure, int32_t *temperature, int32_t *pressure)
+{
+	int32_t dT, TEMP;
+	int64_t OFF, SENS, P, T2, OFF2, SENS2;
+
 	if (adc_temperature == 0 || adc_pressure == 0)
 		return ms8607_status_measurement_invalid;
 
@@ -1639,7 +1667,134 @@ static enum ms8607_status psensor_read_pressure_and_temperature(ms8607_sensor *s
 	*temperature = 10*( TEMP - T2 );
 	*pressure = 10*P;
 
-	return status;
+	return ms8607_status_ok;
+}
+
+enum ms8607_status ms8607_start_conversion(ms8607_sensor *sensor, enum ms8607_conversion which, void *caller_context)
+{
+	uint8_t address;
+	uint8_t command;
+
+	enum ms8607_status status =
+		ms8607_get_conversion_command(sensor, which, &address, &command, caller_context);
+	if( status != ms8607_status_ok)
+		return status;
+
+	if ( which == ms8607_conversion_humidity )
+		return hsensor_write_command(sensor, command, caller_context);
+	else
+		return psensor_write_command(sensor, command, caller_context);
+}
+
+enum ms8607_status ms8607_get_conversion_command(ms8607_sensor *sensor, enum ms8607_conversion which, uint8_t *address, uint8_t *command, void *caller_context)
+{
+	if ( sensor == NULL )
+		return ms8607_status_null_sensor;
+
+	if ( address == NULL || command == NULL )
+		return ms8607_status_null_argument;
+
+	enum ms8607_status status = ms8607_status_ok;
+
+	if ( which == ms8607_conversion_humidity )
+	{
+		*address = HSENSOR_ADDR;
+		*command = HSENSOR_READ_HUMIDITY_WO_HOLD_COMMAND;
+		return ms8607_status_ok;
+	}
+
+	if( sensor->psensor_coeff_read == false )
+		status = psensor_read_eeprom(sensor, caller_context);
+	if( status != ms8607_status_ok)
+		return status;
+
+	*address = PSENSOR_ADDR;
+	*command = sensor->psensor_resolution_osr*2 |
+		(which == ms8607_conversion_temperature
+			? PSENSOR_START_TEMPERATURE_ADC_CONVERSION
+			: PSENSOR_START_PRESSURE_ADC_CONVERSION);
+	return ms8607_status_ok;
+}
+
+enum ms8607_status ms8607_read_conversion(ms8607_sensor *sensor, enum ms8607_conversion which, uint32_t *adc, void *caller_context)
+{
+	if ( sensor == NULL )
+		return ms8607_status_null_sensor;
+
+	if ( adc == NULL )
+		return ms8607_status_null_argument;
+
+	enum ms8607_status status;
+	uint8_t buffer[3];
+
+	buffer[0] = 0;
+	buffer[1] = 0;
+	buffer[2] = 0;
+
+	ms8607_i2c_controller_packet read_transfer = {
+		.address     = which == ms8607_conversion_humidity ? HSENSOR_ADDR : PSENSOR_ADDR,
+		.data_length = 3,
+		.data        = buffer,
+	};
+
+	if ( which == ms8607_conversion_humidity )
+	{
+		// The humidity part NACKs its address until the conversion is done.
+		status = sensor->host_funcs->i2c_controller_read(caller_context, &read_transfer);
+		if ( status == ms8607_status_callback_i2c_nack )
+			return ms8607_status_waiting;
+		if ( status != ms8607_status_ok )
+			return status;
+
+		status = hsensor_crc_check((buffer[0] << 8) | buffer[1], buffer[2]);
+		if ( status != ms8607_status_ok )
+			return status;
+
+		*adc = (buffer[0] << 8) | buffer[1];
+		return ms8607_status_ok;
+	}
+
+	status = psensor_write_command(sensor, PSENSOR_READ_ADC, caller_context);
+	if( status != ms8607_status_ok)
+		return status;
+
+	status = sensor->host_funcs->i2c_controller_read(caller_context, &read_transfer);
+	if( status != ms8607_status_ok )
+		return status;
+
+	*adc = ((uint32_t)buffer[0] << 16) | ((uint32_t)buffer[1] << 8) | buffer[2];
+
+	return ms8607_status_ok;
+}
+
+uint32_t ms8607_get_conversion_time(const ms8607_sensor *sensor, enum ms8607_conversion which)
+{
+	assert( sensor != NULL );
+
+	if ( which == ms8607_conversion_humidity )
+		return sensor->hsensor_conversion_time;
+	return psensor_conversion_time[sensor->psensor_resolution_osr];
+}
+
+enum ms8607_status ms8607_compensate_int32(ms8607_sensor *sensor, uint32_t adc_t, uint32_t adc_p, uint32_t adc_h, int32_t *t, int32_t *p, int32_t *h)
+{
+	if ( sensor == NULL )
+		return ms8607_status_null_sensor;
+
+	if ( t == NULL || p == NULL || h == NULL )
+		return ms8607_status_null_argument;
+
+	enum ms8607_status status;
+
+	if ( sensor->psensor_coeff_read == false )
+		return ms8607_status_measurement_invalid;
+
+	status = psensor_compensate(sensor, adc_t, adc_p, t, p);
+	if ( status != ms8607_status_ok )
+		return status;
+
+	*h = hsensor_compensate((uint16_t)adc_h);
+	return ms8607_status_ok;
 }
 
 #if 0
@@ -87,6 +87,13 @@ enum ms8607_pressure_resolution {
 	ms8607_pressure_resolution_osr_8192
 };
 
+/// \brief   Conversions run by the split-phase interface, see `ms8607_start_conversion`.
+enum ms8607_conversion {
+	ms8607_conversion_temperature = 0,
+	ms8607_conversion_pressure,
+	ms8607_conversion_humidity
+};
+
 // TODO: probable in-order:
 // - Change how ms8607_host_functions initializes ##done
 // - Replace comment style with triple-slash ##done
@@ -501,6 +508,116 @@ enum ms8607_status ms8607_read_temperature_pressure_humidity_int32(ms8607_sensor
 ///
 enum ms8607_status ms8607_read_temperature_pressure_humidity_float32(ms8607_sensor *sensor, float *, float *, float *, void *caller_context);
 
+/// \brief   Starts one ADC conversion without waiting for it.
+///
+/// \details This is the split-phase alternative to the blocking reads above:
+///          the caller starts a conversion, does something else for at least
+///          `ms8607_get_conversion_time` microseconds, then fetches the result
+///          with `ms8607_read_conversion` and converts the results of one
+///          temperature, one pressure and one humidity conversion with
+///          `ms8607_compensate_int32`. It never calls `sleep_ms`.
+///
+///          The pressure/temperature and the humidity parts of the MS8607 are
+///          separate devices, so a humidity conversion can run alongside
+///          either of the other two. The temperature and pressure conversions
+///          share one ADC and must not overlap.
+///
+///          Humidity conversions always run in the no hold mode, regardless
+///          of `ms8607_set_humidity_i2c_controller_mode`: a held bus could not
+///          be shared while the conversion runs.
+///
+///          The first temperature or pressure conversion also reads the
+///          EEPROM coefficients, if no earlier read did.
+///
+/// \param[in] ms8607_sensor *sensor : Object representing the sensor to start the conversion on
+/// \param[in] ms8607_conversion : Conversion to start
+/// \param[in] void* caller_context : When this function calls any callbacks
+///         from the `ms8607_host_functions` structure, this will be passed
+///         directly to those callbacks' `caller_context` parameter.
+///
+/// \return ms8607_status : status of MS8607
+///       - ms8607_status_ok : Conversion started
+///       - ms8607_status_null_sensor : The pointer provided for the `sensor` parameter was NULL.
+///       - ms8607_status_callback_error : Error occurred within a ms8607_host_functions function
+///       - ms8607_status_eeprom_crc_error : CRC check error on the sensor's EEPROM coefficients
+///
+enum ms8607_status ms8607_start_conversion(ms8607_sensor *sensor, enum ms8607_conversion, void *caller_context);
+
+/// \brief   Returns the bus transaction that `ms8607_start_conversion` would issue.
+///
+/// \details The transaction is a one byte write of `command` to `address`. A
+///          host that starts many sensors at once can issue it itself, for
+///          instance on several buses at the same instant, and then carry on
+///          with `ms8607_read_conversion` as if `ms8607_start_conversion` had
+///          been called.
+///
+///          Like `ms8607_start_conversion`, this reads the EEPROM coefficients
+///          for a temperature or pressure conversion if no earlier read did.
+///          It performs no other I/O.
+///
+/// \param[in] ms8607_sensor *sensor : Object representing the sensor to start the conversion on
+/// \param[in] ms8607_conversion : Conversion to start
+/// \param[out] uint8_t* : 7 bit address the command goes to
+/// \param[out] uint8_t* : Command byte
+/// \param[in] void* caller_context : When this function calls any callbacks
+///         from the `ms8607_host_functions` structure, this will be passed
+///         directly to those callbacks' `caller_context` parameter.
+///
+/// \return ms8607_status : status of MS8607
+///       - ms8607_status_ok : Transaction returned
+///       - ms8607_status_null_sensor : The pointer provided for the `sensor` parameter was NULL.
+///       - ms8607_status_null_argument : The `address` or `command` pointer was NULL.
+///       - ms8607_status_callback_error : Error occurred within a ms8607_host_functions function
+///       - ms8607_status_eeprom_crc_error : CRC check error on the sensor's EEPROM coefficients
+///
+enum ms8607_status ms8607_get_conversion_command(ms8607_sensor *sensor, enum ms8607_conversion, uint8_t *address, uint8_t *command, void *caller_context);
+
+/// \brief   Fetches the result of a conversion started by `ms8607_start_conversion`.
+///
+/// \param[in] ms8607_sensor *sensor : Object representing the sensor to read the result from
+/// \param[in] ms8607_conversion : Conversion whose result is read
+/// \param[out] uint32_t* : Raw ADC value
+/// \param[in] void* caller_context : When this function calls any callbacks
+///         from the `ms8607_host_functions` structure, this will be passed
+///         directly to those callbacks' `caller_context` parameter.
+///
+/// \return ms8607_status : status of MS8607
+///       - ms8607_status_ok : Result read
+///       - ms8607_status_waiting : The humidity conversion is still running (the part NACKed), try again later
+///       - ms8607_status_null_sensor : The pointer provided for the `sensor` parameter was NULL.
+///       - ms8607_status_null_argument : The `adc` pointer was NULL.
+///       - ms8607_status_callback_error : Error occurred within a ms8607_host_functions function
+///       - ms8607_status_measurement_invalid : I2C transfer completed, but data received was invalid
+///
+enum ms8607_status ms8607_read_conversion(ms8607_sensor *sensor, enum ms8607_conversion, uint32_t *adc, void *caller_context);
+
+/// \brief   Returns how long a conversion takes at the current resolution, in microseconds.
+///
+/// \details This function is reentrant, non-blocking and performs no I/O.
+///
+uint32_t ms8607_get_conversion_time(const ms8607_sensor *sensor, enum ms8607_conversion);
+
+/// \brief   Converts raw ADC values to temperature, pressure and relative humidity.
+///
+/// \details Same arithmetic and units as `ms8607_read_temperature_pressure_humidity_int32`.
+///          This function is reentrant, non-blocking and performs no I/O.
+///
+/// \param[in] ms8607_sensor *sensor : Object representing the sensor the values were read from
+/// \param[in] uint32_t : Raw temperature ADC value
+/// \param[in] uint32_t : Raw pressure ADC value
+/// \param[in] uint32_t : Raw humidity ADC value
+/// \param[out] int32_t* : 0.001 degC temperature value
+/// \param[out] int32_t* : 0.001 mbar pressure value
+/// \param[out] int32_t* : 0.001 %RH relative humidity value
+///
+/// \return ms8607_status : status of MS8607
+///       - ms8607_status_ok : Values converted
+///       - ms8607_status_null_sensor : The pointer provided for the `sensor` parameter was NULL.
+///       - ms8607_status_null_argument : One or more of the `t`, `p`, or `h` pointers were NULL.
+///       - ms8607_status_measurement_invalid : The EEPROM coefficients were never read, or a raw value was zero
+///
+enum ms8607_status ms8607_compensate_int32(ms8607_sensor *sensor, uint32_t adc_t, uint32_t adc_p, uint32_t adc_h, int32_t *t, int32_t *p, int32_t *h);
+
 /// \brief Provide battery status
 ///
 /// \param[in] ms8607_sensor *sensor : Object representing the sensor to get battery status from
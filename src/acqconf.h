@@ -0,0 +1,98 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Sensor acquisition topology.
+ *
+ * Every bus and every sensor is declared here, once. main.c derives from
+ * these lists at compile time the bus and sensor tables, the working areas
+ * of the acquisition threads and a fixed slot schedule per bus.
+ *
+ * Acquisition is a cyclic executive: each bus repeats a frame of
+ * ACQ_FRAME_MS in which its sensors own back to back slots, in the order
+ * they are listed. A slot lasts the worst case wire time of one reading at
+ * the bus speed plus the conversion waits at the sensor OSR. A sensor is
+ * read in one frame out of period_ms / ACQ_FRAME_MS.
+ *
+ * The build fails if the slots of a bus do not fit in the frame, if a
+ * period is not a multiple of the frame or if two sensors on the same bus
+ * answer to the same address.
+ */
+
+#ifndef _ACQCONF_H_
+#define _ACQCONF_H_
+
+/*
+ * Length of the acquisition frame.
+ */
+#define ACQ_FRAME_MS                        1000
+
+/*
+ * Stack of each acquisition thread.
+ */
+#define ACQ_THREAD_WA_SIZE                  16384
+
+/*
+ * Coherent acquisition. When TRUE the slot schedules are replaced by a
+ * single thread that, every frame, starts each conversion on all the due
+ * sensors at once, on all the buses in parallel, and then collects the
+ * results. The readings of different sensors then start within tens of
+ * microseconds of each other instead of a slot apart, as differential
+ * pressure measurements need. Sensors sharing a bus still start one
+ * command apart. The "skew" shell command reports the spread achieved.
+ */
+#if !defined(ACQ_COHERENT)
+#define ACQ_COHERENT                        FALSE
+#endif
+
+#if BCM2835_I2C_USE_I2C0
+#define ACQ_WITH_BSC0(entry)                entry
+#else
+#define ACQ_WITH_BSC0(entry)
+#endif
+
+/*
+ * Buses: X(ctx, id, driver, name, speed_hz)
+ *   id         name the sensors refer to the bus by
+ *   driver     I2C driver of the controller
+ *   name       bus and acquisition thread name
+ *   speed_hz   SCL frequency
+ */
+#define ACQ_BUSES(X, ctx)                                                   \
+  X(ctx, BSC1, I2CD1, "i2c.bsc1", 1500)                                     \
+  ACQ_WITH_BSC0(X(ctx, BSC0, I2CD0, "i2c.bsc0", 1500))
+
+/*
+ * Sensors: X(ctx, id, name, type, bus, addr0, addr1, osr, period_ms)
+ *   id         unique identifier
+ *   name       name used in reports
+ *   type       sensor type, only MS8607 for now
+ *   bus        id of the bus the sensor is wired to
+ *   addr0/1    addresses the part answers to, 0 if unused
+ *   osr        pressure oversampling ratio, 256 to 8192
+ *   period_ms  sampling period, a multiple of ACQ_FRAME_MS
+ *
+ * The MS8607 addresses are fixed: a second part needs the second bus.
+ */
+#define ACQ_SENSORS(X, ctx)                                                 \
+  X(ctx, MS8607_0, "MS8607.0", MS8607, BSC1, 0x76, 0x40, 2048, 1000)        \
+  ACQ_WITH_BSC0(X(ctx, MS8607_1, "MS8607.1", MS8607, BSC0, 0x76, 0x40, 2048, 1000))
+
+#endif /* _ACQCONF_H_ */
@@ -270,6 +270,18 @@
 #define CH_USE_MAILBOXES                TRUE
 #endif
 
+/**
+ * @brief   Work queues APIs.
+ * @details If enabled then the deferred work (interrupt bottom halves)
+ *          APIs are included in the kernel.
+ *
+ * @note    The default is @p FALSE.
+ * @note    Requires @p CH_USE_SEMAPHORES.
+ */
+#if !defined(CH_USE_WORKQUEUES) || defined(__DOXYGEN__)
+#define CH_USE_WORKQUEUES               TRUE
+#endif
+
 /**
  * @brief   I/O Queues APIs.
  * @details If enabled then the I/O queues APIs are included in the kernel.
@@ -507,10 +519,18 @@
  *          after processing the virtual timers queue.
  */
 #if !defined(SYSTEM_TICK_EVENT_HOOK) || defined(__DOXYGEN__)
+#if defined(EXTENDED_SHELL)
+/* Samples the interrupted PC for the pcprof shell command.*/
+#define SYSTEM_TICK_EVENT_HOOK() {                                          \
+  extern void pcprofSampleI(void);                                          \
+  pcprofSampleI();                                                          \
+}
+#else
 #define SYSTEM_TICK_EVENT_HOOK() {                                          \
   /* System tick event code here.*/                                         \
 }
 #endif
+#endif
 
 /**
  * @brief   System halt hook.
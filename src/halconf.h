@@ -83,6 +83,13 @@
 #define HAL_USE_I2C                 TRUE
 #endif
 
+/**
+ * @brief   Enables the I2S subsystem.
+ */
+#if !defined(HAL_USE_I2S) || defined(__DOXYGEN__)
+#define HAL_USE_I2S                 FALSE
+#endif
+
 /**
  * @brief   Enables the ICU subsystem.
  */
@@ -115,7 +122,7 @@
  * @brief   Enables the RTC subsystem.
  */
 #if !defined(HAL_USE_RTC) || defined(__DOXYGEN__)
-#define HAL_USE_RTC                 FALSE
+#define HAL_USE_RTC                 TRUE
 #endif
 
 /**
@@ -202,6 +209,13 @@
 #define I2C_USE_MUTUAL_EXCLUSION    TRUE
 #endif
 
+/**
+ * @brief   Enables the transaction capture APIs, see the i2ctrace command.
+ */
+#if !defined(I2C_USE_CAPTURE) || defined(__DOXYGEN__)
+#define I2C_USE_CAPTURE             TRUE
+#endif
+
 /*===========================================================================*/
 /* MAC driver related settings.                                              */
 /*===========================================================================*/
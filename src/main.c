@@ -18,22 +18,39 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "ch.h"
 #include "hal.h"
 #include "test.h"
 #include "shell.h"
 #include "chprintf.h"
+#include "memstreams.h"
+#include "bulkxfer.h"
+#include "fixfft.h"
+#include "lvtable.h"
+#include "calendar.h"
 
 #include "ms8607.h"
+#include "acqconf.h"
 
 // Pin allocations:
 // - Pins 2 & 3 are allocated for I2C.
 // - Pins 14 & 15 are allocated for UART. (see also: sdcard-boilerplate/config.txt)
+// - Pins 18 & 19 are allocated for the I2C slave (sensor hub mode), but only
+//     when BCM2835_I2C_USE_SLAVE is enabled in mcuconf.h.
 // - Pins 22-27 might be nice to avoid, because they might be used for JTAG
 //     debugging at some point. Right now (at least, 2022-01-02) it doesn't work
 //     though, so it's not a big deal.
 
+#if BCM2835_I2C_USE_SLAVE
+// GPIO18 & GPIO19 belong to the BSC slave (sensor hub mode), so the LEDs
+// normally on those pins move to GPIO12 & GPIO4.
+#define PROGRESS_LED_PAD_01  GPIO12_PAD
+#else
 #define PROGRESS_LED_PAD_01  GPIO18_PAD
+#endif
 #define PROGRESS_LED_PAD_02  GPIO17_PAD
 #define PROGRESS_LED_PAD_03  GPIO10_PAD
 #define PROGRESS_LED_PAD_04  GPIO9_PAD
@@ -41,10 +58,18 @@
 #define PROGRESS_LED_PAD_06  GPIO5_PAD
 #define PROGRESS_LED_PAD_07  GPIO6_PAD
 #define PROGRESS_LED_PAD_08  GPIO13_PAD
+#if BCM2835_I2C_USE_SLAVE
+#define PROGRESS_LED_PAD_09  GPIO4_PAD
+#else
 #define PROGRESS_LED_PAD_09  GPIO19_PAD
+#endif
 //#define PROGRESS_LED_PAD_10  GPIO19_PAD
 
+#if BCM2835_I2C_USE_SLAVE
+#define PROGRESS_LED_PORT_01  GPIO12_PORT
+#else
 #define PROGRESS_LED_PORT_01  GPIO18_PORT
+#endif
 #define PROGRESS_LED_PORT_02  GPIO17_PORT
 #define PROGRESS_LED_PORT_03  GPIO10_PORT
 #define PROGRESS_LED_PORT_04  GPIO9_PORT
@@ -52,7 +77,11 @@
 #define PROGRESS_LED_PORT_06  GPIO5_PORT
 #define PROGRESS_LED_PORT_07  GPIO6_PORT
 #define PROGRESS_LED_PORT_08  GPIO13_PORT
+#if BCM2835_I2C_USE_SLAVE
+#define PROGRESS_LED_PORT_09  GPIO4_PORT
+#else
 #define PROGRESS_LED_PORT_09  GPIO19_PORT
+#endif
 //#define PROGRESS_LED_PORT_10  GPIO19_PORT
 
 
@@ -60,7 +89,225 @@
 
 static BaseSequentialStream *bss;
 
+// Serializes the console output of the acquisition threads, and the I2C
+// error counters.
+static MUTEX_DECL(report_mtx);
+
+
+
+// =============================================================================
+// Sensor buses and sensors, as declared in acqconf.h. Every bus has its own
+// acquisition thread, so sensors on different buses never serialize their
+// transfers. The tables, the slot schedule and the checks that it fits are
+// all produced here at compile time; nothing is placed at run time.
+
+/// Bytes on the wire for one MS8607 temperature/pressure/humidity reading,
+/// address bytes included: two ADC conversions (command, ADC read command,
+/// 3 byte read) and one humidity measurement (command, 3 byte read).
+#define MS8607_SAMPLE_BYTES  (2 * (2 + 2 + 4) + (2 + 4))
+
+/// Pressure ADC conversion times the MS8607 driver waits, per OSR.
+#define MS8607_CONV_US_256   1000
+#define MS8607_CONV_US_512   2000
+#define MS8607_CONV_US_1024  3000
+#define MS8607_CONV_US_2048  5000
+#define MS8607_CONV_US_4096  9000
+#define MS8607_CONV_US_8192  18000
+
+/// Time one reading waits for: temperature and pressure conversions plus a
+/// 12 bit humidity measurement. Each wait may last one system tick longer
+/// than asked. An upper bound, the humidity measurement runs alongside the
+/// pressure conversion.
+#define MS8607_WAIT_US(osr)  (2 * MS8607_CONV_US_##osr + 16000 + 3 * (1000000 / CH_FREQUENCY))
+
+#define MS8607_OSR(osr)      ms8607_pressure_resolution_osr_##osr
+
+/// Worst case bus time of one reading (9 clocks a byte) and slot length.
+#define ACQ_WIRE_US(type, bus)                                              \
+	((uint32_t)(type##_SAMPLE_BYTES * 9 * 1000000UL / ACQ_SPEED_##bus))
+#define ACQ_SLOT_US(type, bus, osr)                                         \
+	(ACQ_WIRE_US(type, bus) + type##_WAIT_US(osr))
+
+/// Bit of an address in the low (base 0) or high (base 64) half of the
+/// 7 bit address space, 0 for an unused address.
+#define ACQ_ADDR_BIT(a, base)                                               \
+	((a) != 0 && (a) >= (base) && (a) < (base) + 64 ? 1ULL << (((a) - (base)) & 63) : 0)
+
+#define ACQ_BUS_INDEX(ctx, id, driver, name, speed)  ACQ_BUS_##id,
+#define ACQ_BUS_SPEED(ctx, id, driver, name, speed)  ACQ_SPEED_##id = speed,
+#define ACQ_SENSOR_INDEX(ctx, id, name, type, bus, a0, a1, osr, period)     \
+	ACQ_SENSOR_##id,
+
+enum { ACQ_BUSES(ACQ_BUS_INDEX, ~) N_BUSES };
+enum { ACQ_BUSES(ACQ_BUS_SPEED, ~) };
+enum { ACQ_SENSORS(ACQ_SENSOR_INDEX, ~) N_SENSORS };
+
+/// Slot schedule of bus b: ACQ_AT_<b>_<sensor> is where the slot of each
+/// sensor starts within the frame, ACQ_USED_<b> the frame time taken.
+/// Sensors on other buses get empty slots.
+#define ACQ_SLOT(b, id, name, type, bus, a0, a1, osr, period)               \
+	ACQ_AT_##b##_##id, ACQ_END_##b##_##id = ACQ_AT_##b##_##id - 1 +         \
+		(ACQ_BUS_##b == ACQ_BUS_##bus ? (int32_t)ACQ_SLOT_US(type, bus, osr) : 0),
+
+#define ACQ_ADDR_SUM(b, id, name, type, bus, a0, a1, osr, period, base)     \
+	+ (ACQ_BUS_##b == ACQ_BUS_##bus ? ACQ_ADDR_BIT(a0, base) + ACQ_ADDR_BIT(a1, base) : 0)
+#define ACQ_ADDR_OR(b, id, name, type, bus, a0, a1, osr, period, base)      \
+	| (ACQ_BUS_##b == ACQ_BUS_##bus ? ACQ_ADDR_BIT(a0, base) | ACQ_ADDR_BIT(a1, base) : 0)
+#define ACQ_ADDR_SUM_LO(b, ...)  ACQ_ADDR_SUM(b, __VA_ARGS__, 0)
+#define ACQ_ADDR_SUM_HI(b, ...)  ACQ_ADDR_SUM(b, __VA_ARGS__, 64)
+#define ACQ_ADDR_OR_LO(b, ...)   ACQ_ADDR_OR(b, __VA_ARGS__, 0)
+#define ACQ_ADDR_OR_HI(b, ...)   ACQ_ADDR_OR(b, __VA_ARGS__, 64)
+
+/// The address bits of the sensors on a bus add up to their union only if
+/// no two of them overlap.
+#define ACQ_BUS_SCHEDULE(ctx, b, driver, name, speed)                       \
+	enum { ACQ_SENSORS(ACQ_SLOT, b) ACQ_USED_##b };                         \
+	_Static_assert(ACQ_USED_##b <= ACQ_FRAME_MS * 1000L,                    \
+		"sensor slots on " name " exceed ACQ_FRAME_MS, lower the OSR or move a sensor"); \
+	_Static_assert((0 ACQ_SENSORS(ACQ_ADDR_SUM_LO, b)) == (0 ACQ_SENSORS(ACQ_ADDR_OR_LO, b)) && \
+		(0 ACQ_SENSORS(ACQ_ADDR_SUM_HI, b)) == (0 ACQ_SENSORS(ACQ_ADDR_OR_HI, b)), \
+		"two sensors on " name " share an address");
+
+#define ACQ_SENSOR_CHECK(ctx, id, name, type, bus, a0, a1, osr, period)     \
+	_Static_assert((period) > 0 && (period) % ACQ_FRAME_MS == 0,            \
+		name ": the period must be a multiple of ACQ_FRAME_MS");
+
+ACQ_BUSES(ACQ_BUS_SCHEDULE, ~)
+ACQ_SENSORS(ACQ_SENSOR_CHECK, ~)
+
+/// One BSC controller and the bookkeeping of its acquisition thread.
+/// The counters only grow, readouts work on differences.
+typedef struct sensor_bus {
+	I2CDriver   *driver;
+	const char  *name;        // Also the acquisition thread name.
+	I2CConfig    config;
+	stkalign_t  *wa;          // Working area of the acquisition thread.
+	uint32_t     planned;     // Expected occupancy, bus us per second.
+	uint32_t     frame_us;    // Frame time taken by the slots.
+	uint32_t     busy_us;     // Time spent in transfers.
+	uint32_t     transfers;
+	uint32_t     failures;
+	uint32_t     samples;
+	uint32_t     overruns;    // Readings that ran past the end of their slot.
+} sensor_bus;
+
+#if ACQ_COHERENT
+// The coherent acquisition thread serves all the buses.
+#define ACQ_WA(id)  NULL
+#else
+#define ACQ_BUS_WA(ctx, id, driver, name, speed)                            \
+	static WORKING_AREA(waBus##id, ACQ_THREAD_WA_SIZE);
+
+ACQ_BUSES(ACQ_BUS_WA, ~)
+#define ACQ_WA(id)  waBus##id
+#endif
+
+#define ACQ_PLANNED(b, id, name, type, bus, a0, a1, osr, period)            \
+	+ (ACQ_BUS_##b == ACQ_BUS_##bus ? ACQ_WIRE_US(type, bus) * 1000 / (period) : 0)
+#define ACQ_BUS_ENTRY(ctx, id, driver, name, speed)                         \
+	{ &driver, name, { speed }, ACQ_WA(id), 0 ACQ_SENSORS(ACQ_PLANNED, id),  \
+	  ACQ_USED_##id, 0, 0, 0, 0, 0 },
+
+static sensor_bus  buses[N_BUSES] = {
+	ACQ_BUSES(ACQ_BUS_ENTRY, ~)
+};
+
+/// Raw ADC values of one reading, on their way from the acquisition thread
+/// to the report worker.
+typedef struct sensor_reading {
+	enum ms8607_status  status;
+	uint32_t            adc[3];   // Temperature, pressure, humidity.
+	bool_t              fresh;    // Not yet taken by the worker.
+} sensor_reading;
+
+/// A sensor, its slot and its driver state.
+typedef struct bus_sensor {
+	const char     *name;
+	sensor_bus     *bus;
+	enum ms8607_pressure_resolution  osr;
+	uint32_t        osr_ratio;
+	uint32_t        slot_us;     // Start of the slot within the frame.
+	uint32_t        length_us;   // Length of the slot.
+	uint32_t        every;       // Read in one frame out of `every`.
+	bool_t          ready;       // Set up, read from its slot.
+	ms8607_sensor   dev;
+	WorkItem        report;      // Queues `reading` for the report worker.
+	sensor_reading  reading;     // Last reading handed over, under the lock.
+} bus_sensor;
+
+#define ACQ_SENSOR_ENTRY(ctx, id, name, type, bus, a0, a1, osr, period)     \
+	{ name, &buses[ACQ_BUS_##bus], type##_OSR(osr), osr,                    \
+	  ACQ_AT_##bus##_##id, ACQ_SLOT_US(type, bus, osr),                     \
+	  (period) / ACQ_FRAME_MS, FALSE, {0}, {0}, {0} },
+
+static bus_sensor  sensors[N_SENSORS] = {
+	ACQ_SENSORS(ACQ_SENSOR_ENTRY, ~)
+};
+
+#if LV_VALUES < 3
+#error "the latest value table needs LV_VALUES >= 3"
+#endif
+
+/// Readings handed over by the acquisition threads. The report worker
+/// compensates, logs, publishes and prints them, below the acquisition
+/// threads in priority, so none of this runs in a slot.
+static WORKQUEUE_DECL(report_wq);
+static WORKING_AREA(waReport, ACQ_THREAD_WA_SIZE);
+static uint32_t  report_dropped;  // Replaced before the worker took them.
+
+/// Newest temperature, pressure and humidity of each sensor. Consumers read
+/// it without a lock, the acquisition threads never wait for them.
+static LvChannel   latest_channels[N_SENSORS];
+static LvTable     latest;
+
+#if ACQ_COHERENT
+/// Conversions of one coherent frame, in the order they are started.
+/// Pressure and humidity are separate dies and convert together.
+#define N_CONVERSIONS  3
+
+static const enum ms8607_conversion  coherent_order[N_CONVERSIONS] = {
+	ms8607_conversion_temperature,
+	ms8607_conversion_pressure,
+	ms8607_conversion_humidity,
+};
+
+static const char  *const coherent_names[N_CONVERSIONS] = {
+	"temperature", "pressure", "humidity",
+};
 
+/// Spread of the start times of one conversion over the sensors of a frame.
+typedef struct skew_stats {
+	uint32_t  frames;      // Frames with at least two sensors started.
+	uint32_t  min_us;
+	uint32_t  max_us;
+	uint64_t  sum_us;
+} skew_stats;
+
+static skew_stats  coherent_skew[N_CONVERSIONS];
+
+/// Start of each sensor conversion after the first one of its frame:
+/// in the last frame and at most.
+static uint32_t    coherent_offset_us[N_SENSORS][N_CONVERSIONS];
+static uint32_t    coherent_offset_max_us[N_SENSORS][N_CONVERSIONS];
+#endif // ACQ_COHERENT
+
+/// Charges a transfer started at `start` to the bus of `driver`.
+/// Called only from the acquisition thread of that bus.
+static void bus_account(I2CDriver *driver, halrtcnt_t start, msg_t stat)
+{
+	halrtcnt_t  end = halGetCounterValue();
+	size_t      i;
+
+	for (i = 0; i < N_BUSES; i++) {
+		if ( buses[i].driver != driver )
+			continue;
+		buses[i].busy_us += RTT2US(end - start);
+		buses[i].transfers++;
+		if ( stat != RDY_OK )
+			buses[i].failures++;
+		return;
+	}
+}
 
 uint8_t  handle_i2c_errors(I2CDriver *driver,  msg_t  stat,  char T_or_R);
 uint8_t  handle_i2c_errors_(I2CDriver *driver,  msg_t  stat,  char T_or_R, i2cflags_t *errors);
@@ -69,9 +316,11 @@ uint8_t  handle_i2c_errors_(I2CDriver *driver,  msg_t  stat,  char T_or_R, i2cfl
 static enum ms8607_status i2c_controller_read(void *caller_context, ms8607_i2c_controller_packet *const packet)
 {
 	I2CDriver *i2c_driver = caller_context;
+	halrtcnt_t start = halGetCounterValue();
 	msg_t  stat = i2cMasterReceive(
 		i2c_driver, packet->address,
 		packet->data, packet->data_length);
+	bus_account(i2c_driver, start, stat);
 
 	i2cflags_t  errors;
 	if ( handle_i2c_errors_(i2c_driver, stat, 'R', &errors) )
@@ -90,10 +339,12 @@ static enum ms8607_status i2c_controller_write(void *caller_context, ms8607_i2c_
 	msg_t   stat;
 	uint8_t rxbuf[1];
 	I2CDriver *i2c_driver = caller_context;
+	halrtcnt_t start = halGetCounterValue();
 
 	stat = i2cMasterTransmit(
 		i2c_driver, packet->address,
 		packet->data, packet->data_length, rxbuf, 0);
+	bus_account(i2c_driver, start, stat);
 
 	if ( handle_i2c_errors(i2c_driver, stat, 'T') )
 		return ms8607_status_callback_error;
@@ -133,6 +384,63 @@ static void  print_int64(void *caller_context,  int64_t  number, uint8_t pad_wid
 
 
 
+// =============================================================================
+// Sample log: every reading is appended here and can be downloaded in bulk
+// with the `download` shell command and tools/bxrecv on the host (see
+// bulkxfer.h for the wire protocol).
+// The log is append-only, so the transfer reads straight out of it and data
+// already handed out never changes underneath a retransmission.
+
+#define SAMPLE_LOG_LEN       (1024)
+
+/// One logged reading. Multi-byte fields are little-endian.
+typedef struct sample_record {
+	uint32_t  time;         // chTimeNow() at the reading.
+	uint32_t  utc;          // RTC time at the reading, UNIX seconds.
+	int32_t   temperature;  // 0.001 degC
+	int32_t   pressure;     // 0.001 mbar
+	int32_t   humidity;     // 0.001 %RH
+} sample_record;
+
+static sample_record  sample_log[SAMPLE_LOG_LEN];
+static size_t         sample_log_count = 0;
+
+/// Appends a reading. The log stops growing once it is full.
+static void sample_log_append(int32_t temperature, int32_t pressure, int32_t humidity)
+{
+	sample_record *rec;
+	RTCTime        now;
+
+	if ( sample_log_count >= SAMPLE_LOG_LEN )
+		return;
+	rec = &sample_log[sample_log_count];
+	rec->time        = chTimeNow();
+	rtcGetTime(&RTCD1, &now);
+	rec->utc         = now.tv_sec;
+	rec->temperature = temperature;
+	rec->pressure    = pressure;
+	rec->humidity    = humidity;
+	// Publish the record only after it is complete.
+	chSysLock();
+	sample_log_count++;
+	chSysUnlock();
+}
+
+/// BxSource read function: hands out pointers into the log itself.
+static size_t sample_log_read(void *ctx, uint32_t offset, const uint8_t **datap, size_t max)
+{
+	size_t  size;
+	(void)ctx;
+
+	chSysLock();
+	size = sample_log_count * sizeof(sample_record);
+	chSysUnlock();
+	if ( offset >= size )
+		return 0;
+	*datap = (const uint8_t*)sample_log + offset;
+	return (size - offset < max) ? size - offset : max;
+}
+
 #ifdef EXTENDED_SHELL
 
 #define TEST_WA_SIZE        THD_WA_SIZE(4096)
@@ -188,6 +496,601 @@ static void cmd_test(BaseSequentialStream *chp, int argc, char *argv[]) {
   chThdWait(tp);
 }
 
+/*
+ * Stands in for the console while a shell command runs or the serial port
+ * carries a bulk transfer, nothing can be written to an empty memory stream.
+ */
+static MemoryStream bss_muted;
+static BaseSequentialStream *bss_console;
+static unsigned bss_mute_count;
+
+/*
+ * Diverts the console output of the acquisition threads, or restores it.
+ * Calls nest, the output comes back with the last restore.
+ */
+static void console_mute(bool_t mute) {
+
+  chMtxLock(&report_mtx);
+  if (mute) {
+    if (bss_mute_count++ == 0) {
+      msObjectInit(&bss_muted, NULL, 0, 0);
+      bss_console = bss;
+      bss = (BaseSequentialStream *)&bss_muted;
+    }
+  }
+  else if (--bss_mute_count == 0)
+    bss = bss_console;
+  chMtxUnlock();
+}
+
+static void cmd_download(BaseSequentialStream *chp, int argc, char *argv[]) {
+  static const BxSource source = {sample_log_read, NULL};
+  static const BxConfig config = {
+    BX_MAX_BLOCK_SIZE,      /* block_size */
+    BX_MAX_WINDOW,          /* window */
+    MS2ST(500),             /* rto */
+    S2ST(30),               /* start_timeout */
+    TRUE                    /* compress */
+  };
+  BxStats stats;
+  msg_t msg;
+
+  UNUSED(argv);
+  if (argc > 0) {
+    chprintf(chp, "Usage: download\r\n");
+    return;
+  }
+  chprintf(chp, "bulk transfer ready, start the host side\r\n");
+  /* The sensor reports would land in the middle of the frames.*/
+  console_mute(TRUE);
+  msg = bxSend((BaseChannel *)chp, &source, &config, &stats);
+  console_mute(FALSE);
+  chprintf(chp, "\r\n%s: %lu frames, %lu resent, %lu timeouts, %lu bad\r\n",
+           msg == RDY_OK ? "done" : msg == RDY_TIMEOUT ? "timed out" : "aborted",
+           stats.frames, stats.retransmits, stats.timeouts, stats.bad_frames);
+  chprintf(chp, "%lu bytes sent as %lu bytes on the wire\r\n",
+           stats.payload_bytes, stats.wire_bytes);
+}
+
+/*
+ * Bus utilization since the previous readout: time spent in transfers,
+ * the occupancy the schedule expects, readings that ran past their slot
+ * and the samples taken per second.
+ */
+static void cmd_buses(BaseSequentialStream *chp, int argc, char *argv[]) {
+  static systime_t last;
+  static sensor_bus prev[N_BUSES];
+  systime_t now = chTimeNow();
+  uint32_t ms, util, rate, total = 0;
+  size_t i;
+
+  UNUSED(argv);
+  if (argc > 0) {
+    chprintf(chp, "Usage: buses\r\n");
+    return;
+  }
+  ms = (uint32_t)(now - last) * 1000 / CH_FREQUENCY;
+  if (ms == 0)
+    return;
+  chprintf(chp, "bus        util  expect  xfers  fails  late  samples/s\r\n");
+  for (i = 0; i < N_BUSES; i++) {
+    sensor_bus cur = buses[i];
+
+    util = (cur.busy_us - prev[i].busy_us) / ms;
+    rate = (cur.samples - prev[i].samples) * 100000 / ms;
+    total += rate;
+    chprintf(chp, "%-9s %3u.%u%% %3u.%u%% %6u %6u %5u %7u.%02u\r\n",
+             cur.name, util / 10, util % 10,
+             cur.planned / 10000, cur.planned / 1000 % 10,
+             cur.transfers - prev[i].transfers,
+             cur.failures - prev[i].failures,
+             cur.overruns - prev[i].overruns,
+             rate / 100, rate % 100);
+    prev[i] = cur;
+  }
+  chprintf(chp, "%u buses, %u.%02u samples/s over %u ms\r\n",
+           N_BUSES, total / 100, total % 100, ms);
+  {
+    WorkQueue wq;
+    uint32_t dropped;
+
+    chSysLock();
+    wq = report_wq;
+    dropped = report_dropped;
+    chWQResetStatsI(&report_wq);
+    report_dropped = 0;
+    chSysUnlock();
+    if (wq.wq_served > 0)
+      chprintf(chp, "%u readings reported, %u dropped, latency avg %u max "
+               "%u us\r\n", wq.wq_served, dropped,
+               (uint32_t)(wq.wq_latency / wq.wq_served), wq.wq_maxlatency);
+  }
+  last = now;
+}
+
+static void print_milli(BaseSequentialStream *chp, int32_t v) {
+  uint32_t a = v < 0 ? (uint32_t)-v : (uint32_t)v;
+
+  chprintf(chp, "%s%u.%03u", v < 0 ? "-" : "", a / 1000, a % 1000);
+}
+
+/*
+ * Newest reading of every sensor, from the latest value table.
+ */
+static void cmd_latest(BaseSequentialStream *chp, int argc, char *argv[]) {
+  systime_t now = chTimeNow();
+  LvRecord rec;
+  size_t i;
+
+  UNUSED(argv);
+  if (argc > 0) {
+    chprintf(chp, "Usage: latest\r\n");
+    return;
+  }
+  for (i = 0; i < N_SENSORS; i++) {
+    lvRead(&latest, i, &rec);
+    chprintf(chp, "%-9s ", sensors[i].name);
+    if (rec.count == 0) {
+      chprintf(chp, "no reading yet\r\n");
+      continue;
+    }
+    print_milli(chp, rec.value[0]);
+    chprintf(chp, " degC  ");
+    print_milli(chp, rec.value[1]);
+    chprintf(chp, " mbar  ");
+    print_milli(chp, rec.value[2]);
+    chprintf(chp, " %%RH  #%u, %u ms ago\r\n", rec.count,
+             (uint32_t)(now - rec.stamp) * 1000 / CH_FREQUENCY);
+  }
+}
+
+/*
+ * Wall clock time, kept by the system timer from when it was last set.
+ * "date <seconds>" sets it to a UNIX time, e.g. from `date +%s` on the host.
+ */
+static void cmd_date(BaseSequentialStream *chp, int argc, char *argv[]) {
+  RTCTime now;
+  struct tm tm;
+
+  if (argc > 1) {
+    chprintf(chp, "Usage: date [seconds]\r\n");
+    return;
+  }
+  if (argc == 1) {
+    now.tv_sec = strtoul(argv[0], NULL, 10);
+    now.tv_msec = 0;
+    rtcSetTime(&RTCD1, &now);
+  }
+  rtcGetTime(&RTCD1, &now);
+  calEpochToTm(now.tv_sec, &tm);
+  chprintf(chp, "%04d-%02d-%02d %02d:%02d:%02d.%03u UTC\r\n",
+           tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+           tm.tm_hour, tm.tm_min, tm.tm_sec, now.tv_msec);
+}
+
+#if ACQ_COHERENT
+/*
+ * Conversion start skew of the coherent acquisition: spread between the
+ * first and the last sensor of a frame, then the offset of each sensor
+ * from the first one. "skew reset" clears the statistics.
+ */
+static void cmd_skew(BaseSequentialStream *chp, int argc, char *argv[]) {
+  size_t i, k;
+
+  if (argc == 1 && strcmp(argv[0], "reset") == 0) {
+    chSysLock();
+    memset(coherent_skew, 0, sizeof(coherent_skew));
+    memset(coherent_offset_max_us, 0, sizeof(coherent_offset_max_us));
+    chSysUnlock();
+    return;
+  }
+  if (argc > 0) {
+    chprintf(chp, "Usage: skew [reset]\r\n");
+    return;
+  }
+  chprintf(chp, "conversion    frames  min us  avg us  max us\r\n");
+  for (k = 0; k < N_CONVERSIONS; k++) {
+    skew_stats st = coherent_skew[k];
+
+    chprintf(chp, "%-12s %7u %7u %7u %7u\r\n", coherent_names[k], st.frames,
+             st.min_us, st.frames ? (uint32_t)(st.sum_us / st.frames) : 0,
+             st.max_us);
+  }
+  chprintf(chp, "sensor     offset us, last/max:");
+  for (k = 0; k < N_CONVERSIONS; k++)
+    chprintf(chp, "  %s", coherent_names[k]);
+  chprintf(chp, "\r\n");
+  for (i = 0; i < N_SENSORS; i++) {
+    chprintf(chp, "%-9s", sensors[i].name);
+    for (k = 0; k < N_CONVERSIONS; k++)
+      chprintf(chp, "  %u/%u", coherent_offset_us[i][k],
+               coherent_offset_max_us[i][k]);
+    chprintf(chp, "\r\n");
+  }
+}
+#endif
+
+#if I2C_USE_CAPTURE
+/*
+ * Sensor bus capture. The trace (see I2C_TRACE_MAGIC in i2c.h) goes out
+ * through the bulk transfer protocol, as the console also carries the log.
+ * It is staged in a ring as large as the transfer window, so frames not yet
+ * acknowledged can still be resent. The capture starts when the host opens
+ * the session and stops after the requested time, the transfer ends once
+ * the trace is drained. tools/i2ctrace decodes the received trace, the
+ * Posix simulator replays it.
+ */
+#define I2C_TRACE_BLOCK     256
+#define I2C_TRACE_WINDOW    8
+#define I2C_TRACE_RING      (I2C_TRACE_BLOCK * I2C_TRACE_WINDOW)
+
+static uint8_t     i2c_trace_buf[1024];
+static I2CCapture  i2c_trace;
+static uint8_t     i2c_trace_ring[I2C_TRACE_RING];
+static uint32_t    i2c_trace_end;
+static systime_t   i2c_trace_start, i2c_trace_time;
+static bool_t      i2c_trace_started, i2c_trace_stopped;
+
+static size_t i2c_trace_read(void *ctx, uint32_t offset, const uint8_t **datap, size_t max)
+{
+	size_t pos = offset % I2C_TRACE_RING;
+	size_t n;
+
+	(void)ctx;
+	if ( offset > i2c_trace_end || i2c_trace_end - offset > I2C_TRACE_RING )
+		return 0;
+	if ( max > I2C_TRACE_RING - pos )
+		max = I2C_TRACE_RING - pos;
+
+	// New data: waits for the next burst of records.
+	while ( offset == i2c_trace_end ) {
+		if ( !i2c_trace_started ) {
+			i2cCaptureStart(&I2CD, &i2c_trace);
+			i2c_trace_start = chTimeNow();
+			i2c_trace_started = TRUE;
+		}
+		if ( !i2c_trace_stopped && chTimeNow() - i2c_trace_start >= i2c_trace_time ) {
+			i2cCaptureStop(&I2CD);
+			i2c_trace_stopped = TRUE;
+		}
+		n = i2cCaptureRead(&i2c_trace, &i2c_trace_ring[pos], max,
+			i2c_trace_stopped ? TIME_IMMEDIATE : MS2ST(200));
+		if ( n == 0 && i2c_trace_stopped )
+			return 0;
+		i2c_trace_end += n;
+	}
+
+	*datap = &i2c_trace_ring[pos];
+	n = i2c_trace_end - offset;
+	return (n < max) ? n : max;
+}
+
+static void cmd_i2ctrace(BaseSequentialStream *chp, int argc, char *argv[]) {
+  static const BxSource source = {i2c_trace_read, NULL};
+  static const BxConfig config = {
+    I2C_TRACE_BLOCK,        /* block_size */
+    I2C_TRACE_WINDOW,       /* window */
+    MS2ST(500),             /* rto */
+    S2ST(30),               /* start_timeout */
+    FALSE                   /* compress */
+  };
+  BxStats stats;
+  msg_t msg;
+  int seconds = 60;
+
+  if (argc > 1 || (argc == 1 && (seconds = atoi(argv[0])) <= 0)) {
+    chprintf(chp, "Usage: i2ctrace [seconds]\r\n");
+    return;
+  }
+  i2cCaptureObjectInit(&i2c_trace, i2c_trace_buf, sizeof i2c_trace_buf);
+  i2c_trace_end = 0;
+  i2c_trace_time = S2ST(seconds);
+  i2c_trace_started = FALSE;
+  i2c_trace_stopped = FALSE;
+  chprintf(chp, "i2c trace ready, start the host side\r\n");
+  /* Also a bulk transfer on the console port.*/
+  console_mute(TRUE);
+  msg = bxSend((BaseChannel *)chp, &source, &config, &stats);
+  console_mute(FALSE);
+  if (i2c_trace_started && !i2c_trace_stopped)
+    i2cCaptureStop(&I2CD);
+  chprintf(chp, "\r\n%s: %lu records, %lu dropped, %lu bytes\r\n",
+           msg == RDY_OK ? "done" : msg == RDY_TIMEOUT ? "timed out" : "aborted",
+           i2c_trace.records, i2c_trace.dropped, i2c_trace_end);
+}
+#endif /* I2C_USE_CAPTURE */
+
+/*
+ * ARM1176 cycle counter, in the CP15 performance monitor.
+ */
+static void ccnt_start(void) {
+  __asm__ volatile ("mcr p15, 0, %0, c15, c12, 0" : : "r" (1 | 4));
+}
+
+static uint32_t ccnt_read(void) {
+  uint32_t c;
+
+  __asm__ volatile ("mrc p15, 0, %0, c15, c12, 1" : "=r" (c));
+  return c;
+}
+
+#define FFT_BENCH_RUNS      8
+
+static void cmd_fft(BaseSequentialStream *chp, int argc, char *argv[]) {
+  static int16_t input[FFT_MAX_SIZE] __attribute__((aligned(4)));
+  static int16_t buf[FFT_MAX_SIZE] __attribute__((aligned(4)));
+  static int16_t window[FFT_MAX_SIZE] __attribute__((aligned(4)));
+  uint32_t seed = 1;
+  size_t n, i;
+
+  UNUSED(argv);
+  if (argc > 0) {
+    chprintf(chp, "Usage: fft\r\n");
+    return;
+  }
+  for (i = 0; i < FFT_MAX_SIZE; i++) {
+    seed = seed * 1664525 + 1013904223;
+    input[i] = (int16_t)(seed >> 16) >> 1;
+  }
+
+  /* Best of a few runs, with interrupts masked so that only the code under
+     test is counted.*/
+  chprintf(chp, "   n   window      fft  bands  cycles/sample\r\n");
+  ccnt_start();
+  for (n = FFT_MIN_SIZE; n <= FFT_MAX_SIZE; n *= 2) {
+    uint32_t tw = ~0, tf = ~0, tb = ~0;
+    unsigned run;
+
+    fftWindowHann(window, n);
+    for (run = 0; run < FFT_BENCH_RUNS; run++) {
+      uint32_t t0, t1, t2, t3;
+
+      memcpy(buf, input, n * sizeof buf[0]);
+      chSysLock();
+      t0 = ccnt_read();
+      fftApplyWindowQ15(buf, window, n);
+      t1 = ccnt_read();
+      fftRealQ15(buf, n);
+      t2 = ccnt_read();
+      (void)fftBandEnergyQ15(buf, n, 0, n / 2 + 1);
+      t3 = ccnt_read();
+      chSysUnlock();
+      if (t1 - t0 < tw)
+        tw = t1 - t0;
+      if (t2 - t1 < tf)
+        tf = t2 - t1;
+      if (t3 - t2 < tb)
+        tb = t3 - t2;
+    }
+    chprintf(chp, "%4u %8u %8u %6u %8u\r\n",
+             n, tw, tf, tb, (tw + tf + tb) / n);
+  }
+}
+
+/*
+ * Memory routines benchmark, see armmem.s in the port. Bytes moved per
+ * thousand cycles, MB/s at 1 GHz, for each size and destination/source
+ * misalignment, against a plain byte loop. memmove moves the area 8 bytes
+ * up over itself, which runs backwards. Every memcpy is also checked
+ * against the byte loop.
+ */
+#define MEMBENCH_MAX        16384
+#define MEMBENCH_RUNS       4
+
+#define MEMBENCH_MEMCPY     0
+#define MEMBENCH_MEMMOVE    1
+#define MEMBENCH_MEMSET     2
+#define MEMBENCH_BYTES      3
+
+static uint8_t membench_src[MEMBENCH_MAX + 16] __attribute__((aligned(32)));
+static uint8_t membench_dst[MEMBENCH_MAX + 16] __attribute__((aligned(32)));
+static uint8_t membench_ref[MEMBENCH_MAX + 16] __attribute__((aligned(32)));
+
+/* Volatile so that the compiler does not make it a memcpy() call.*/
+static void byte_copy(volatile uint8_t *d, const uint8_t *s, size_t n) {
+  while (n-- > 0)
+    *d++ = *s++;
+}
+
+/* Bytes per thousand cycles, best of a few runs with interrupts masked.*/
+static uint32_t membench_rate(unsigned op, uint8_t *d, const uint8_t *s,
+                              size_t n) {
+  uint32_t best = ~0, t0, t1;
+  unsigned run;
+
+  for (run = 0; run < MEMBENCH_RUNS; run++) {
+    chSysLock();
+    t0 = ccnt_read();
+    switch (op) {
+    case MEMBENCH_MEMCPY:
+      memcpy(d, s, n);
+      break;
+    case MEMBENCH_MEMMOVE:
+      memmove(d, s, n);
+      break;
+    case MEMBENCH_MEMSET:
+      memset(d, 0x5A, n);
+      break;
+    default:
+      byte_copy(d, s, n);
+    }
+    t1 = ccnt_read();
+    chSysUnlock();
+    if (t1 - t0 < best)
+      best = t1 - t0;
+  }
+  return best > 0 ? n * 1000 / best : 0;
+}
+
+static void cmd_membench(BaseSequentialStream *chp, int argc, char *argv[]) {
+  static const uint8_t offsets[][2] = {{0, 0}, {1, 1}, {0, 1}, {0, 2}, {3, 0}};
+  size_t n, i;
+
+  UNUSED(argv);
+  if (argc > 0) {
+    chprintf(chp, "Usage: membench\r\n");
+    return;
+  }
+  for (i = 0; i < sizeof membench_src; i++)
+    membench_src[i] = (uint8_t)(i * 7 + 3);
+
+  chprintf(chp, " size d s   memcpy  memmove   memset    bytes\r\n");
+  ccnt_start();
+  for (n = 16; n <= MEMBENCH_MAX; n *= 4) {
+    for (i = 0; i < sizeof offsets / sizeof offsets[0]; i++) {
+      uint8_t *d = membench_dst + offsets[i][0];
+      uint8_t *ref = membench_ref + offsets[i][0];
+      const uint8_t *s = membench_src + offsets[i][1];
+      uint32_t bc, bm, bs, bb;
+      bool_t ok;
+
+      bb = membench_rate(MEMBENCH_BYTES, ref, s, n);
+      bc = membench_rate(MEMBENCH_MEMCPY, d, s, n);
+      ok = memcmp(d, ref, n) == 0;
+      bm = membench_rate(MEMBENCH_MEMMOVE, membench_dst + 8 + offsets[i][0],
+                         membench_dst + offsets[i][1], n);
+      bs = membench_rate(MEMBENCH_MEMSET, d, NULL, n);
+      chprintf(chp, "%5u %u %u %8u %8u %8u %8u%s\r\n",
+               n, offsets[i][0], offsets[i][1], bc, bm, bs, bb,
+               ok ? "" : " memcpy mismatch");
+    }
+  }
+}
+
+/*
+ * Code placement profile, see tools/hotcold. The tick hook in chconf.h
+ * samples the PC the timer interrupt returns to: the LR that the IRQ
+ * prologue pushes at the top of the IRQ stack. Interrupts do not nest, so
+ * that frame is always the interrupted thread's. Code running with
+ * interrupts masked is credited to the point where it unmasks them.
+ */
+#define PCPROF_SAMPLES      4096
+
+extern uint32_t __irq_stack_top__[];
+
+static uint32_t         pcprof_buf[PCPROF_SAMPLES];
+static volatile size_t  pcprof_count;
+static volatile bool_t  pcprof_on;
+
+void pcprofSampleI(void) {
+  if (pcprof_on && pcprof_count < PCPROF_SAMPLES)
+    pcprof_buf[pcprof_count++] = __irq_stack_top__[-1] - 4;
+}
+
+static void cmd_pcprof(BaseSequentialStream *chp, int argc, char *argv[]) {
+  int seconds = 1;
+  size_t i;
+
+  if (argc > 1 || (argc == 1 && (seconds = atoi(argv[0])) <= 0)) {
+    chprintf(chp, "Usage: pcprof [seconds]\r\n");
+    return;
+  }
+  pcprof_count = 0;
+  pcprof_on = TRUE;
+  chThdSleepSeconds(seconds);
+  pcprof_on = FALSE;
+  for (i = 0; i < pcprof_count; i++)
+    chprintf(chp, "0x%08x\r\n", pcprof_buf[i]);
+  chprintf(chp, "%u samples\r\n", pcprof_count);
+}
+
+/*
+ * Code placement benchmark: the image layout from the linker script and
+ * one second of normal operation seen by the performance monitor, PMN0
+ * counting instruction cache misses and PMN1 executed instructions. Builds
+ * with and without HOTCOLD_PROFILE and COLD_THUMB are compared on these.
+ * The counters are not reset, the cycle counter is shared with the other
+ * benchmarks, and deltas are reported instead.
+ */
+#define PMNC_ENABLE         (1 << 0)
+#define PMNC_EVT0(e)        ((uint32_t)(e) << 20)
+#define PMNC_EVT1(e)        ((uint32_t)(e) << 12)
+#define PMU_ICACHE_MISS     0x00
+#define PMU_INSTRUCTION     0x07
+#define SCTLR_I             (1 << 12)
+
+extern uint8_t _text[], _etext[];
+extern uint8_t __hot_text_start__[], __hot_text_end__[];
+extern uint8_t __cold_text_start__[], __cold_text_end__[];
+
+static void pmu_read(uint32_t *cycles, uint32_t *misses,
+                     uint32_t *instructions) {
+
+  *cycles = ccnt_read();
+  __asm__ volatile ("mrc p15, 0, %0, c15, c12, 2" : "=r" (*misses));
+  __asm__ volatile ("mrc p15, 0, %0, c15, c12, 3" : "=r" (*instructions));
+}
+
+static void cmd_icache(BaseSequentialStream *chp, int argc, char *argv[]) {
+  uint32_t sctlr, cycles, misses, instructions;
+  uint32_t cycles0, misses0, instructions0;
+
+  if (argc > 1 || (argc == 1 && strcmp(argv[0], "on") != 0 &&
+                   strcmp(argv[0], "off") != 0)) {
+    chprintf(chp, "Usage: icache [on|off]\r\n");
+    return;
+  }
+  __asm__ volatile ("mrc p15, 0, %0, c1, c0, 0" : "=r" (sctlr));
+  if (argc == 1) {
+    if (strcmp(argv[0], "on") == 0)
+      sctlr |= SCTLR_I;
+    else
+      sctlr &= ~SCTLR_I;
+    /* Nothing to clean, the instruction cache is invalidated before it
+       goes on so that no stale line survives.*/
+    __asm__ volatile ("mcr p15, 0, %0, c7, c5, 0" : : "r" (0) : "memory");
+    __asm__ volatile ("mcr p15, 0, %0, c1, c0, 0" : : "r" (sctlr) : "memory");
+    __asm__ volatile ("mcr p15, 0, %0, c7, c5, 4" : : "r" (0) : "memory");
+  }
+
+  chprintf(chp, "text %u bytes, hot %u, cold %u, icache %s\r\n",
+           (unsigned)(_etext - _text),
+           (unsigned)(__hot_text_end__ - __hot_text_start__),
+           (unsigned)(__cold_text_end__ - __cold_text_start__),
+           (sctlr & SCTLR_I) ? "on" : "off");
+  __asm__ volatile ("mcr p15, 0, %0, c15, c12, 0" : :
+                    "r" (PMNC_ENABLE | PMNC_EVT0(PMU_ICACHE_MISS) |
+                         PMNC_EVT1(PMU_INSTRUCTION)));
+  pmu_read(&cycles0, &misses0, &instructions0);
+  chThdSleepSeconds(1);
+  pmu_read(&cycles, &misses, &instructions);
+  cycles -= cycles0;
+  misses -= misses0;
+  instructions -= instructions0;
+  chprintf(chp, "1 s: %u cycles, %u instructions, %u misses, %u per 1000\r\n",
+           cycles, instructions, misses,
+           instructions >= 1000 ? misses / (instructions / 1000) : 0);
+}
+
+/*
+ * The shell shares SD1 with the sensor reports, its commands run with the
+ * reports muted so that their output comes out in one piece.
+ */
+#define QUIET_COMMAND(name)                                                 \
+static void name##_quiet(BaseSequentialStream *chp, int argc, char *argv[]) { \
+  console_mute(TRUE);                                                       \
+  name(chp, argc, argv);                                                    \
+  console_mute(FALSE);                                                      \
+}
+
+QUIET_COMMAND(cmd_mem)
+QUIET_COMMAND(cmd_threads)
+QUIET_COMMAND(cmd_test)
+QUIET_COMMAND(cmd_download)
+QUIET_COMMAND(cmd_buses)
+QUIET_COMMAND(cmd_latest)
+QUIET_COMMAND(cmd_date)
+#if ACQ_COHERENT
+QUIET_COMMAND(cmd_skew)
+#endif
+#if I2C_USE_CAPTURE
+QUIET_COMMAND(cmd_i2ctrace)
+#endif
+QUIET_COMMAND(cmd_fft)
+QUIET_COMMAND(cmd_membench)
+QUIET_COMMAND(cmd_pcprof)
+QUIET_COMMAND(cmd_icache)
+
 #endif // EXTENDED_SHELL
 
 static void cmd_reboot(BaseSequentialStream *chp, int argc, char *argv[]) {
@@ -203,9 +1106,23 @@ static void cmd_reboot(BaseSequentialStream *chp, int argc, char *argv[]) {
 
 static const ShellCommand commands[] = {
 #ifdef EXTENDED_SHELL
-  {"mem", cmd_mem},
-  {"threads", cmd_threads},
-  {"test", cmd_test},
+  {"mem", cmd_mem_quiet},
+  {"threads", cmd_threads_quiet},
+  {"test", cmd_test_quiet},
+  {"download", cmd_download_quiet},
+  {"buses", cmd_buses_quiet},
+  {"latest", cmd_latest_quiet},
+  {"date", cmd_date_quiet},
+#if ACQ_COHERENT
+  {"skew", cmd_skew_quiet},
+#endif
+#if I2C_USE_CAPTURE
+  {"i2ctrace", cmd_i2ctrace_quiet},
+#endif
+  {"fft", cmd_fft_quiet},
+  {"membench", cmd_membench_quiet},
+  {"pcprof", cmd_pcprof_quiet},
+  {"icache", cmd_icache_quiet},
 #endif
   {"reboot", cmd_reboot},
   {NULL, NULL}
@@ -243,13 +1160,16 @@ uint8_t  handle_i2c_errors_(I2CDriver *driver,  msg_t  stat,  char T_or_R, i2cfl
 	*i2c_errors = I2CD_NO_ERROR;
 	size_t cmd_count = 0;
 
+	chMtxLock(&report_mtx);
 	switch(T_or_R) {
 		case 't': case 'T': cmd_count = i2c_tx_count; i2c_tx_count++; break;
 		case 'r': case 'R': cmd_count = i2c_rx_count; i2c_rx_count++; break;
 	}
 
-	if ( stat == RDY_OK )
+	if ( stat == RDY_OK ) {
+		chMtxUnlock();
 		return 0;
+	}
 
 	if ( stat == RDY_RESET )
 	{
@@ -328,6 +1248,7 @@ uint8_t  handle_i2c_errors_(I2CDriver *driver,  msg_t  stat,  char T_or_R, i2cfl
 			T_or_R, cmd_count, i2c_fail_count, stat);
 
 	i2c_fail_count++;
+	chMtxUnlock();
 	return 1;
 }
 
@@ -999,74 +1920,102 @@ static msg_t Thread1(void *p)
 #endif
 
 // =============================================================================
-// Version that uses mostly-original driver API.
-#if 1
-//static WORKING_AREA(waThread1, 4096);
-static WORKING_AREA(waThread1, 16384);
-//static WORKING_AREA(waThread1, 65536);
-static msg_t Thread1(void *p)
+// Sensor hub mode: an external I2C host reads the latest readings from us.
+#if BCM2835_I2C_USE_SLAVE
+
+#define HUB_I2C_SLAVE_ADDR   (0x2A)
+
+/// Register map served to the host. The host reads all of it in one burst
+/// (or writes a one-byte register offset first to start elsewhere).
+/// Multi-byte fields are little-endian.
+typedef struct hub_registers {
+	uint8_t   status;       // `ms8607_status` of the last reading.
+	uint8_t   reserved[3];
+	uint32_t  sequence;     // Incremented for every published reading.
+	int32_t   temperature;  // 0.001 degC
+	int32_t   pressure;     // 0.001 mbar
+	int32_t   humidity;     // 0.001 %RH
+} hub_registers;
+
+static hub_registers  hub_regs[2];
+// Last published snapshot. The back buffer holds the one before it.
+static hub_registers  hub_last;
+
+static const I2CSlaveConfig  hub_config = {
+	HUB_I2C_SLAVE_ADDR,
+	sizeof(hub_registers),
+	{ (uint8_t*)&hub_regs[0], (uint8_t*)&hub_regs[1] },
+	NULL
+};
+
+static void hub_publish(enum ms8607_status status,
+	int32_t temperature, int32_t pressure, int32_t humidity)
 {
-	(void)p;
-	chRegSetThreadName("i2c");
+	// Fill the back buffer in place; the commit swaps it in between host bursts.
+	// Every field is written: a failed reading keeps the values of the last
+	// good one, not those of the stale back buffer.
+	hub_registers *regs = (hub_registers*)i2csGetUpdateBuffer(&I2CSD1);
+	hub_last.status   = (uint8_t)status;
+	hub_last.sequence++;
+	if ( status == ms8607_status_ok ) {
+		hub_last.temperature = temperature;
+		hub_last.pressure    = pressure;
+		hub_last.humidity    = humidity;
+	}
+	*regs = hub_last;
+	i2csCommitUpdate(&I2CSD1);
+}
 
-	I2CDriver  *i2c_driver = &I2CD;
-	I2CConfig  i2c_config;
-	i2c_config.ic_speed = 1500;
-	i2cStart(i2c_driver, &i2c_config);
+#endif // BCM2835_I2C_USE_SLAVE
 
-	enum ms8607_status  sensor_status;
-	ms8607_sensor       sensor;
+// =============================================================================
+// Sensor acquisition: one thread per bus, each running the slot schedule
+// of its bus (see acqconf.h). Console output, the sample log and the hub
+// registers are shared between the threads, the output under report_mtx.
 
-#if 0
-	// TODO: Probably delete this old code.
-	chprintf(bss, "I2C.MS8607: (INFO)  Initializing MS8607 driver.\n");
-	chibi_ms8607_init();
-	palSetPad(PROGRESS_LED_PORT_01, PROGRESS_LED_PAD_01);
-#endif
+static void sensor_say(const bus_sensor *s, const char *level, const char *text)
+{
+	chMtxLock(&report_mtx);
+	chprintf(bss, "I2C.%s: (%s) %s\n", s->name, level, text);
+	chMtxUnlock();
+}
 
-	chprintf(bss, "I2C.MS8607: (INFO)  Initializing MS8607 host functions / integration.\n");
-	sensor_status = ms8607_init_and_assign_host_functions(&host_funcs, NULL, &chibi_ms8607_assign_functions);
-	if ( sensor_status != ms8607_status_ok ) {
-		chprintf(bss, "I2C.MS8607: (ERROR) In function `ms8607_init_and_assign_host_functions`:\n");
-		chprintf(bss, "I2C.MS8607: (ERROR) %s\n", ms8607_stringize_error(sensor_status));
-		chprintf(bss, "I2C.MS8607: (ERROR) Unable to continue.\n");
-		return 1;
+/// Retries a setup step once per second until it succeeds.
+#define SENSOR_SETUP_STEP(s, what, call)                                    \
+	while ( true ) {                                                        \
+		enum ms8607_status  st_ = (call);                                   \
+		if ( st_ == ms8607_status_ok )                                      \
+			break;                                                          \
+		if ( st_ != ms8607_status_callback_error )                          \
+			sensor_say((s), "ERROR", ms8607_stringize_error(st_));          \
+		sensor_say((s), "ERROR", "Failed: " what);                          \
+		chThdSleepMilliseconds(1000);                                       \
+		sensor_say((s), "INFO ", "Retrying: " what);                        \
 	}
 
-	chprintf(bss, "I2C.MS8607: (INFO)  Initializing MS8607 sensor object.\n");
-	sensor_status = ms8607_init_sensor(&sensor, &host_funcs);
+/// Brings a sensor to its sampling configuration.
+static bool_t sensor_setup(bus_sensor *s)
+{
+	I2CDriver           *i2c_driver = s->bus->driver;
+	enum ms8607_status  sensor_status;
+
+	sensor_say(s, "INFO ", "Initializing MS8607 sensor object.");
+	sensor_status = ms8607_init_sensor(&s->dev, &host_funcs);
 	if ( sensor_status != ms8607_status_ok ) {
-		chprintf(bss, "I2C.MS8607: (ERROR) In function `ms8607_init_sensor`:\n");
-		chprintf(bss, "I2C.MS8607: (ERROR) %s\n", ms8607_stringize_error(sensor_status));
-		chprintf(bss, "I2C.MS8607: (ERROR) Unable to continue.\n");
-		return 1;
+		sensor_say(s, "ERROR", ms8607_stringize_error(sensor_status));
+		sensor_say(s, "ERROR", "Unable to continue.");
+		return FALSE;
 	}
 	palSetPad(PROGRESS_LED_PORT_01, PROGRESS_LED_PAD_01);
 
-	chprintf(bss, "I2C.MS8607: (INFO)  Resetting sensor.\n");
-	while ( true ) {
-		sensor_status = ms8607_reset(&sensor, i2c_driver);
-		if ( sensor_status == ms8607_status_ok )
-			break;
-		if ( sensor_status != ms8607_status_callback_error )
-			chprintf(bss, "I2C.MS8607: (ERROR) %s\n", ms8607_stringize_error(sensor_status));
-		chprintf(bss, "I2C.MS8607: (ERROR) Sensor reset failed.\n");
-		chThdSleepMilliseconds(1000);
-		chprintf(bss, "I2C.MS8607: (INFO)  Attempting another reset.\n");
-	}
+	sensor_say(s, "INFO ", "Resetting sensor.");
+	SENSOR_SETUP_STEP(s, "sensor reset.",
+		ms8607_reset(&s->dev, i2c_driver));
 	palSetPad(PROGRESS_LED_PORT_02, PROGRESS_LED_PAD_02);
 
-	chprintf(bss, "I2C.MS8607: (INFO)  Disabling heater.\n");
-	while ( true ) {
-		sensor_status = ms8607_disable_heater(&sensor, i2c_driver);
-		if ( sensor_status == ms8607_status_ok )
-			break;
-		if ( sensor_status != ms8607_status_callback_error )
-			chprintf(bss, "I2C.MS8607: (ERROR) %s\n", ms8607_stringize_error(sensor_status));
-		chprintf(bss, "I2C.MS8607: (ERROR) Failed to disable heater.\n");
-		chThdSleepMilliseconds(1000);
-		chprintf(bss, "I2C.MS8607: (INFO)  Retrying heater disable.\n");
-	}
+	sensor_say(s, "INFO ", "Disabling heater.");
+	SENSOR_SETUP_STEP(s, "heater disable.",
+		ms8607_disable_heater(&s->dev, i2c_driver));
 	palSetPad(PROGRESS_LED_PORT_03, PROGRESS_LED_PAD_03);
 
 	// TODO: Once we have a polling-type interface implemented, switch to
@@ -1093,76 +2042,462 @@ static msg_t Thread1(void *p)
 	// apnea when you're awake!  Ironically, the eargear might be in a position
 	// to detect such things and provide such fallbacks.)
 
-	chprintf(bss, "I2C.MS8607: (INFO)  Setting humidity resolution to 10b.\n");
-	while ( true )
-	{
-		//sensor_status = ms8607_set_humidity_resolution(i2c_driver, ms8607_humidity_resolution_10b);
-		sensor_status = ms8607_set_humidity_resolution(&sensor, ms8607_humidity_resolution_12b, i2c_driver);
-		if ( sensor_status == ms8607_status_ok )
-			break;
-		if ( sensor_status != ms8607_status_callback_error )
-			chprintf(bss, "I2C.MS8607: (ERROR) %s\n", ms8607_stringize_error(sensor_status));
-		chprintf(bss, "I2C.MS8607: (ERROR) Failed to set humidity resolution.\n");
-		chThdSleepMilliseconds(1000);
-		chprintf(bss, "I2C.MS8607: (INFO)  Retrying setting of humidity resolution to 10b.\n");
-	}
+	sensor_say(s, "INFO ", "Setting humidity resolution to 12b.");
+	SENSOR_SETUP_STEP(s, "setting humidity resolution.",
+		ms8607_set_humidity_resolution(&s->dev, ms8607_humidity_resolution_12b, i2c_driver));
 	palSetPad(PROGRESS_LED_PORT_04, PROGRESS_LED_PAD_04);
 
-	chprintf(bss, "I2C.MS8607: (INFO)  Setting pressure resolution to 2048.\n");
-	ms8607_set_pressure_resolution(&sensor, ms8607_pressure_resolution_osr_2048, i2c_driver);
+	chMtxLock(&report_mtx);
+	chprintf(bss, "I2C.%s: (INFO ) Setting pressure resolution to %u.\n", s->name, s->osr_ratio);
+	chMtxUnlock();
+	ms8607_set_pressure_resolution(&s->dev, s->osr, i2c_driver);
 	palSetPad(PROGRESS_LED_PORT_05, PROGRESS_LED_PAD_05);
 
-	chprintf(bss, "I2C.MS8607: (INFO)  Setting controller mode to NO HOLD.\n");
-	ms8607_set_humidity_i2c_controller_mode(&sensor, ms8607_i2c_no_hold, i2c_driver);
+	sensor_say(s, "INFO ", "Setting controller mode to NO HOLD.");
+	ms8607_set_humidity_i2c_controller_mode(&s->dev, ms8607_i2c_no_hold, i2c_driver);
 	palSetPad(PROGRESS_LED_PORT_06, PROGRESS_LED_PAD_06);
+	return TRUE;
+}
 
-	chprintf(bss, "I2C.MS8607: (INFO)  Humidity controller mode was set.\n");
-	while (TRUE) {
-#if 0
-		float temperature = 0.0; // degC
-		float pressure    = 0.0; // mbar
-		float humidity    = 0.0; // %RH
+/// Shows that a reading is under way.
+static void sensor_leds_reading(void)
+{
+	palClearPad(PROGRESS_LED_PORT_07, PROGRESS_LED_PAD_07);
+	palClearPad(PROGRESS_LED_PORT_08, PROGRESS_LED_PAD_08);
+	palSetPad(PROGRESS_LED_PORT_09, PROGRESS_LED_PAD_09);
+}
+
+/// Publishes and reports the outcome of one reading.
+static void sensor_report(bus_sensor *s, enum ms8607_status sensor_status,
+	int32_t temperature, int32_t pressure, int32_t humidity)
+{
+	if ( sensor_status == ms8607_status_ok ) {
+		int32_t  values[LV_VALUES] = { temperature, pressure, humidity };
+		lvWrite(&latest, s - sensors, values);
+	}
+
+	chMtxLock(&report_mtx);
+	chprintf(bss, "\n");
+	if ( sensor_status != ms8607_status_ok )
+	{
+		palClearPad(PROGRESS_LED_PORT_09, PROGRESS_LED_PAD_09);
+		palSetPad(PROGRESS_LED_PORT_07, PROGRESS_LED_PAD_07);
+		if ( sensor_status != ms8607_status_callback_error )
+			chprintf(bss, "I2C.%s: (ERROR) %s\n", s->name, ms8607_stringize_error(sensor_status));
+		chprintf(bss, "I2C.%s: (ERROR) Failed to read TPH data.\n", s->name);
+	}
+	else
+	{
+		palClearPad(PROGRESS_LED_PORT_09, PROGRESS_LED_PAD_09);
+		palSetPad(PROGRESS_LED_PORT_08, PROGRESS_LED_PAD_08);
+		chprintf(bss, "I2C.%s: (INFO)  TPH data received on %s:\n", s->name, s->bus->name);
+		chprintf(bss, "    Temperature = %d.%d%d%d degC\n", (int)(temperature/1000), (int)((temperature/100)%10), (int)((temperature/10)%10), (int)(temperature%10) );
+		chprintf(bss, "    Pressure    = %d.%d%d%d mbar\n", (int)(pressure/1000),    (int)((pressure/100)%10),    (int)((pressure/10)%10),    (int)(pressure%10) );
+		chprintf(bss, "    Humidity    = %d.%d%d%d %%RH\n", (int)(humidity/1000),    (int)((humidity/100)%10),    (int)((humidity/10)%10),    (int)(humidity%10) );
+		sample_log_append(temperature, pressure, humidity);
+		s->bus->samples++;
+	}
+#if BCM2835_I2C_USE_SLAVE
+	hub_publish(sensor_status, temperature, pressure, humidity);
 #endif
-		int32_t temperature = 0.0; // degC
-		int32_t pressure    = 0.0; // mbar
-		int32_t humidity    = 0.0; // %RH
+	chMtxUnlock();
+}
 
-		palClearPad(PROGRESS_LED_PORT_07, PROGRESS_LED_PAD_07);
-		palClearPad(PROGRESS_LED_PORT_08, PROGRESS_LED_PAD_08);
-		palSetPad(PROGRESS_LED_PORT_09, PROGRESS_LED_PAD_09);
+/// Work function of a sensor: compensates and reports the reading it was
+/// handed, in the report worker.
+static void sensor_report_work(void *p)
+{
+	bus_sensor          *s = p;
+	sensor_reading      r;
+	enum ms8607_status  st;
+	int32_t  temperature = 0, pressure = 0, humidity = 0;
+
+	chSysLock();
+	r = s->reading;
+	s->reading.fresh = FALSE;
+	chSysUnlock();
+	// Already taken by the previous run, queued again before it copied it.
+	if ( !r.fresh )
+		return;
+	st = r.status;
+	if ( st == ms8607_status_ok )
+		st = ms8607_compensate_int32(&s->dev, r.adc[0], r.adc[1], r.adc[2],
+			&temperature, &pressure, &humidity);
+	sensor_report(s, st, temperature, pressure, humidity);
+}
 
-		chprintf(bss, "\n");
-		chprintf(bss, "I2C.MS8607: (INFO)  Retrieving TPH (temperature-pressure-humidity) readings.\n");
-		sensor_status = ms8607_read_temperature_pressure_humidity_int32(
-				&sensor, &temperature, &pressure, &humidity, i2c_driver);
-		if ( sensor_status != ms8607_status_ok )
-		{
-			palClearPad(PROGRESS_LED_PORT_09, PROGRESS_LED_PAD_09);
-			palSetPad(PROGRESS_LED_PORT_07, PROGRESS_LED_PAD_07);
-			if ( sensor_status != ms8607_status_callback_error )
-				chprintf(bss, "I2C.MS8607: (ERROR) %s\n", ms8607_stringize_error(sensor_status));
-			chprintf(bss, "I2C.MS8607: (ERROR) Failed to read TPH data.\n");
+/// Hands a reading over to the report worker. One the worker has not taken
+/// yet is replaced and counted as dropped.
+static void sensor_hand_over(bus_sensor *s, enum ms8607_status status,
+	const uint32_t *adc)
+{
+	chSysLock();
+	if ( s->reading.fresh )
+		report_dropped++;
+	s->reading.status = status;
+	s->reading.adc[0] = adc[0];
+	s->reading.adc[1] = adc[1];
+	s->reading.adc[2] = adc[2];
+	s->reading.fresh  = TRUE;
+	chWQEnqueueI(&report_wq, &s->report);
+	chSchRescheduleS();
+	chSysUnlock();
+}
+
+/// Humidity results polled for, one millisecond apart, past the expected
+/// conversion time.
+#define HUMIDITY_RETRIES  20
+
+/// Sleeps until `t`, returns at once if `t` has already passed.
+static void sleep_until(systime_t t)
+{
+	if ( (int32_t)(t - chTimeNow()) > 0 )
+		chThdSleepUntil(t);
+}
+
+/// Ends the current frame, which started at `*frame`, and waits for the
+/// next one. Returns FALSE if the frame overran a whole frame, in which
+/// case the next one starts now rather than in a burst.
+static bool_t frame_next(systime_t *frame)
+{
+	*frame += MS2ST(ACQ_FRAME_MS);
+	if ( (int32_t)(chTimeNow() - *frame) > 0 ) {
+		*frame = chTimeNow();
+		return FALSE;
+	}
+	sleep_until(*frame);
+	return TRUE;
+}
+
+#if ACQ_COHERENT
+// -----------------------------------------------------------------------------
+// Coherent acquisition: a single thread owns all the buses. Each conversion
+// is started on every due sensor with I2C command bursts, one command per
+// bus and burst, so that sensors on different buses start converting on
+// the same bus clock edge give or take. The start of a conversion is the
+// end of its command, stamped with the system timer by the completion
+// interrupt. The results are collected once the slowest conversion is done.
+
+static WORKING_AREA(waCoherent, ACQ_THREAD_WA_SIZE);
+
+/// Sleeps until `us` microseconds after the counter value `t`.
+static void sleep_after(halrtcnt_t t, uint32_t us)
+{
+	int32_t  left = (int32_t)(t + US2RTT(us) - halGetCounterValue());
+
+	if ( left > 0 )
+		chThdSleep(US2ST(RTT2US((uint32_t)left)));
+}
+
+/// Starts conversion `k` of coherent_order on the sensors with `due` set
+/// and records their start times in `started`. A sensor that fails is
+/// cleared from `due`.
+static void coherent_start(size_t k, bool_t *due, halrtcnt_t *started)
+{
+	enum ms8607_conversion  which = coherent_order[k];
+	I2CBurstCommand  cmds[N_BUSES];
+	size_t           at[N_BUSES];
+	bool_t           pending[N_SENSORS];
+	uint8_t          addr[N_SENSORS], command[N_SENSORS];
+	halrtcnt_t       first = 0, last = 0;
+	uint32_t         timeout_us = 0;
+	tprio_t          prio;
+	size_t           i, j, n, started_n = 0;
+
+	// The commands are fetched ahead, the first fetch reads the EEPROM.
+	for (i = 0; i < N_SENSORS; i++) {
+		bus_sensor  *s = &sensors[i];
+
+		pending[i] = due[i] && ms8607_get_conversion_command(&s->dev, which,
+			&addr[i], &command[i], s->bus->driver) == ms8607_status_ok;
+		due[i] = pending[i];
+		// Address and command bytes, with margin.
+		if ( pending[i] && 4 * 9 * 1000000 / s->bus->config.ic_speed > timeout_us )
+			timeout_us = 4 * 9 * 1000000 / s->bus->config.ic_speed;
+	}
+
+	prio = chThdSetPriority(HIGHPRIO);
+	do {
+		n = 0;
+		for (i = 0; i < N_SENSORS; i++) {
+			if ( !pending[i] )
+				continue;
+			for (j = 0; j < n && cmds[j].driver != sensors[i].bus->driver; j++)
+				;
+			if ( j < n )
+				continue; // Bus already taken by this burst.
+			cmds[n].driver  = sensors[i].bus->driver;
+			cmds[n].addr    = addr[i];
+			cmds[n].command = command[i];
+			at[n++] = i;
+			pending[i] = FALSE;
 		}
-		else
-		{
-			palClearPad(PROGRESS_LED_PORT_09, PROGRESS_LED_PAD_09);
-			palSetPad(PROGRESS_LED_PORT_08, PROGRESS_LED_PAD_08);
-			chprintf(bss, "I2C.MS8607: (INFO)  TPH data received:\n");
-			// chprintf(bss, "    Temperature = %.2f degC\n", temperature);
-			// chprintf(bss, "    Pressure    = %.2f mbar\n", pressure);
-			// chprintf(bss, "    Humidity    = %.2f %RH\n",  humidity);
-			chprintf(bss, "    Temperature = %d.%d%d%d degC\n", (int)(temperature/1000), (int)((temperature/100)%10), (int)((temperature/10)%10), (int)(temperature%10) );
-			chprintf(bss, "    Pressure    = %d.%d%d%d mbar\n", (int)(pressure/1000),    (int)((pressure/100)%10),    (int)((pressure/10)%10),    (int)(pressure%10) );
-			chprintf(bss, "    Humidity    = %d.%d%d%d %%RH\n", (int)(humidity/1000),    (int)((humidity/100)%10),    (int)((humidity/10)%10),    (int)(humidity%10) );
+		if ( n == 0 )
+			break;
+		i2cMasterCommandBurst(cmds, n, US2ST(timeout_us));
+
+		for (j = 0; j < n; j++) {
+			sensor_bus  *bus = sensors[at[j]].bus;
+
+			bus->busy_us += RTT2US(cmds[j].end - cmds[j].start);
+			bus->transfers++;
+			if ( cmds[j].status != RDY_OK ) {
+				bus->failures++;
+				due[at[j]] = FALSE;
+				continue;
+			}
+			started[at[j]] = cmds[j].end;
+			if ( started_n == 0 || (int32_t)(cmds[j].end - first) < 0 )
+				first = cmds[j].end;
+			if ( started_n == 0 || (int32_t)(cmds[j].end - last) > 0 )
+				last = cmds[j].end;
+			started_n++;
 		}
-		chThdSleepMilliseconds(1000);
+	} while ( true );
+	chThdSetPriority(prio);
+
+	for (i = 0; i < N_SENSORS; i++) {
+		if ( !due[i] )
+			continue;
+		coherent_offset_us[i][k] = RTT2US(started[i] - first);
+		if ( coherent_offset_us[i][k] > coherent_offset_max_us[i][k] )
+			coherent_offset_max_us[i][k] = coherent_offset_us[i][k];
+	}
+	if ( started_n > 1 ) {
+		skew_stats  *st = &coherent_skew[k];
+		uint32_t     spread = RTT2US(last - first);
+
+		if ( st->frames == 0 || spread < st->min_us )
+			st->min_us = spread;
+		if ( spread > st->max_us )
+			st->max_us = spread;
+		st->sum_us += spread;
+		st->frames++;
+	}
+}
+
+/// Reads the results of conversion `k` of coherent_order into `adc`, each
+/// once its conversion time has passed. A sensor that fails is cleared
+/// from `due`.
+static void coherent_collect(size_t k, bool_t *due, const halrtcnt_t *started,
+	uint32_t *adc)
+{
+	enum ms8607_conversion  which = coherent_order[k];
+	enum ms8607_status      st;
+	size_t  i, tries;
+
+	for (i = 0; i < N_SENSORS; i++) {
+		bus_sensor  *s = &sensors[i];
+
+		if ( !due[i] )
+			continue;
+		sleep_after(started[i], ms8607_get_conversion_time(&s->dev, which));
+		for (tries = 0; ; tries++) {
+			st = ms8607_read_conversion(&s->dev, which, &adc[i], s->bus->driver);
+			if ( st != ms8607_status_waiting || tries == HUMIDITY_RETRIES )
+				break;
+			chThdSleepMilliseconds(1);
+		}
+		if ( st != ms8607_status_ok ) {
+			sensor_say(s, "ERROR", ms8607_stringize_error(st));
+			due[i] = FALSE;
+		}
+	}
+}
+
+/// Coherent acquisition thread: every ACQ_FRAME_MS, starts the conversions
+/// of all the due sensors together and reports the readings.
+static msg_t coherent_thread(void *p)
+{
+	bool_t      due[N_SENSORS];
+	bool_t      t_due[N_SENSORS], p_due[N_SENSORS], h_due[N_SENSORS];
+	halrtcnt_t  started[N_CONVERSIONS][N_SENSORS];
+	uint32_t    adc[N_CONVERSIONS][N_SENSORS];
+	systime_t   frame;
+	uint32_t    n;
+	size_t      i, k;
+
+	(void)p;
+	chRegSetThreadName("acq.coherent");
+	for (i = 0; i < N_BUSES; i++) {
+		for (k = 0; k < N_SENSORS; k++)
+			if ( sensors[k].bus == &buses[i] )
+				break;
+		if ( k < N_SENSORS )
+			i2cStart(buses[i].driver, &buses[i].config);
+	}
+	for (i = 0; i < N_SENSORS; i++)
+		sensors[i].ready = sensor_setup(&sensors[i]);
+
+	frame = chTimeNow();
+	for (n = 0; ; n++) {
+		for (i = 0; i < N_SENSORS; i++)
+			due[i] = sensors[i].ready && n % sensors[i].every == 0;
+		sensor_leds_reading();
+
+		// Temperature and pressure share an ADC, humidity runs alongside
+		// the pressure conversion. Each conversion works on its own copy
+		// of `due`: a sensor failing one is still started on the others.
+		memcpy(t_due, due, sizeof(due));
+		coherent_start(0, t_due, started[0]);
+		coherent_collect(0, t_due, started[0], adc[0]);
+		memcpy(p_due, due, sizeof(due));
+		memcpy(h_due, due, sizeof(due));
+		coherent_start(1, p_due, started[1]);
+		coherent_start(2, h_due, started[2]);
+		coherent_collect(1, p_due, started[1], adc[1]);
+		coherent_collect(2, h_due, started[2], adc[2]);
+
+		for (i = 0; i < N_SENSORS; i++) {
+			uint32_t  raw[3] = { adc[0][i], adc[1][i], adc[2][i] };
+
+			if ( due[i] )
+				sensor_hand_over(&sensors[i], t_due[i] && p_due[i] && h_due[i] ?
+					ms8607_status_ok : ms8607_status_callback_error, raw);
+		}
+
+		if ( !frame_next(&frame) )
+			for (i = 0; i < N_SENSORS; i++)
+				if ( due[i] )
+					sensors[i].bus->overruns++;
+	}
+	return 0;
+}
+
+#else // !ACQ_COHERENT
+
+/// Sleeps for `us` microseconds, rounded up to the next tick.
+static void sleep_us(uint32_t us)
+{
+	if ( us > 0 )
+		chThdSleep(US2ST(us));
+}
+
+/// Takes the raw values of one reading and hands them over to the report
+/// worker. The humidity conversion runs alongside the pressure one.
+static void sensor_sample(bus_sensor *s)
+{
+	I2CDriver           *driver = s->bus->driver;
+	uint32_t            adc[3] = { 0, 0, 0 };
+	uint32_t            p_us, h_us;
+	enum ms8607_status  st;
+	size_t              tries;
+
+	sensor_leds_reading();
+	p_us = ms8607_get_conversion_time(&s->dev, ms8607_conversion_pressure);
+	h_us = ms8607_get_conversion_time(&s->dev, ms8607_conversion_humidity);
+	st = ms8607_start_conversion(&s->dev, ms8607_conversion_temperature, driver);
+	if ( st == ms8607_status_ok ) {
+		sleep_us(ms8607_get_conversion_time(&s->dev, ms8607_conversion_temperature));
+		st = ms8607_read_conversion(&s->dev, ms8607_conversion_temperature, &adc[0], driver);
+	}
+	if ( st == ms8607_status_ok )
+		st = ms8607_start_conversion(&s->dev, ms8607_conversion_pressure, driver);
+	if ( st == ms8607_status_ok )
+		st = ms8607_start_conversion(&s->dev, ms8607_conversion_humidity, driver);
+	if ( st == ms8607_status_ok ) {
+		sleep_us(p_us);
+		st = ms8607_read_conversion(&s->dev, ms8607_conversion_pressure, &adc[1], driver);
+	}
+	if ( st == ms8607_status_ok ) {
+		sleep_us(h_us > p_us ? h_us - p_us : 0);
+		for (tries = 0; ; tries++) {
+			st = ms8607_read_conversion(&s->dev, ms8607_conversion_humidity, &adc[2], driver);
+			if ( st != ms8607_status_waiting || tries == HUMIDITY_RETRIES )
+				break;
+			chThdSleepMilliseconds(1);
+		}
+	}
+	sensor_hand_over(s, st, adc);
+}
+
+/// Acquisition thread of one bus: runs the slot schedule of the bus, one
+/// frame every ACQ_FRAME_MS.
+static msg_t bus_thread(void *p)
+{
+	sensor_bus  *bus = p;
+	systime_t   frame, start;
+	uint32_t    n;
+	size_t      i;
+
+	chRegSetThreadName(bus->name);
+	i2cStart(bus->driver, &bus->config);
+
+	for (i = 0; i < N_SENSORS; i++)
+		if ( sensors[i].bus == bus )
+			sensors[i].ready = sensor_setup(&sensors[i]);
+
+	frame = chTimeNow();
+	for (n = 0; ; n++) {
+		for (i = 0; i < N_SENSORS; i++) {
+			bus_sensor  *s = &sensors[i];
+
+			if ( s->bus != bus || !s->ready || n % s->every != 0 )
+				continue;
+			start = frame + US2ST(s->slot_us);
+			sleep_until(start);
+			sensor_sample(s);
+			if ( (int32_t)(chTimeNow() - (start + US2ST(s->length_us))) > 0 )
+				bus->overruns++;
+		}
+		frame_next(&frame);
 	}
 
 	// poor i2cStop statement can never execute.
-	i2cStop(i2c_driver);
+	i2cStop(bus->driver);
 	return 0;
 }
+#endif // ACQ_COHERENT
+
+/// Starts the acquisition: one thread per bus that has any sensor.
+static void acquisition_start(void)
+{
+	enum ms8607_status  sensor_status;
+	size_t  i, k;
+
+	// Before anything can fail, "latest" reads the table either way.
+	lvObjectInit(&latest, latest_channels, N_SENSORS);
+
+	for (i = 0; i < N_SENSORS; i++)
+		chWQItemInit(&sensors[i].report, sensor_report_work, &sensors[i]);
+	chThdCreateStatic(waReport, sizeof(waReport), NORMALPRIO - 1,
+		chWQWorker, &report_wq);
+
+	chprintf(bss, "I2C.MS8607: (INFO)  Initializing MS8607 host functions / integration.\n");
+	sensor_status = ms8607_init_and_assign_host_functions(&host_funcs, NULL, &chibi_ms8607_assign_functions);
+	if ( sensor_status != ms8607_status_ok ) {
+		chprintf(bss, "I2C.MS8607: (ERROR) In function `ms8607_init_and_assign_host_functions`:\n");
+		chprintf(bss, "I2C.MS8607: (ERROR) %s\n", ms8607_stringize_error(sensor_status));
+		chprintf(bss, "I2C.MS8607: (ERROR) Unable to continue.\n");
+		return;
+	}
+
+#if ACQ_COHERENT
+	(void)k;
+	for (i = 0; i < N_SENSORS; i++)
+		chprintf(bss, "I2C: (INFO)  %s on %s, coherent, every %u ms.\n",
+			sensors[i].name, sensors[i].bus->name,
+			sensors[i].every * ACQ_FRAME_MS);
+
+	chThdCreateStatic(waCoherent, sizeof(waCoherent),
+		NORMALPRIO, coherent_thread, NULL);
+#else
+	for (i = 0; i < N_SENSORS; i++)
+		chprintf(bss, "I2C: (INFO)  %s on %s, slot at %u ms for %u ms, every %u ms.\n",
+			sensors[i].name, sensors[i].bus->name,
+			sensors[i].slot_us / 1000, sensors[i].length_us / 1000,
+			sensors[i].every * ACQ_FRAME_MS);
+
+	for (i = 0; i < N_BUSES; i++) {
+		for (k = 0; k < N_SENSORS; k++)
+			if ( sensors[k].bus == &buses[i] )
+				break;
+		if ( k < N_SENSORS )
+			chThdCreateStatic(buses[i].wa, THD_WA_SIZE(ACQ_THREAD_WA_SIZE),
+				NORMALPRIO, bus_thread, &buses[i]);
+	}
 #endif
+}
 
 #if 0
 #define N_SENSORS  (4)
@@ -1223,11 +2558,9 @@ int main(void) {
 	sdStart(&SD1, NULL); 
 	chprintf((BaseSequentialStream *)&SD1, "Main (SD1 started)\r\n");
 
-	// Shell initialization.
-#if 0
+	// Shell initialization, on the same port as the sensor reports.
 	shellInit();
 	shellCreate(&shell_config, SHELL_WA_SIZE, NORMALPRIO + 1);
-#endif
 
 	// Set mode of onboard LEDs
 
@@ -1260,8 +2593,15 @@ int main(void) {
 
 	//palSetPadMode(ONBOARD_LED_PORT, ONBOARD_LED_PAD, PAL_MODE_OUTPUT);
 
-	// Creates the blinker thread.
-	chThdCreateStatic(waThread1, sizeof(waThread1), NORMALPRIO, Thread1, NULL);
+#if BCM2835_I2C_USE_SLAVE
+	// Both snapshots start out zeroed, with status "waiting".
+	hub_regs[0].status = ms8607_status_waiting;
+	hub_regs[1].status = ms8607_status_waiting;
+	i2csStart(&I2CSD1, &hub_config);
+#endif
+
+	// Creates the acquisition threads.
+	acquisition_start();
 /*
 	// Creates the i2c thread.
 	chThdCreateStatic(waThread2, sizeof(waThread2), NORMALPRIO, Thread2, NULL);
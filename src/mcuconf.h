@@ -29,11 +29,43 @@
 /*
  * ADC driver system settings.
  */
+#define BCM2835_ADC_DMA_RX_CHANNEL          4
+#define BCM2835_ADC_DMA_TX_CHANNEL          5
 
 /*
  * CAN driver system settings.
  */
 
+/*
+ * I2S driver system settings.
+ */
+#define BCM2835_I2S_DMA_RX_CHANNEL          8
+
+/*
+ * ICU driver system settings.
+ */
+#define BCM2835_ICU_USE_ICU1                TRUE
+#define BCM2835_ICU_USE_ICU2                FALSE
+#define BCM2835_ICU_USE_ICU3                FALSE
+#define BCM2835_ICU_USE_ICU4                FALSE
+
+/*
+ * I2C driver system settings.
+ * BSC1 (GPIO2/GPIO3, header pins 3/5) is the board default. Enable BSC0
+ * (GPIO0/GPIO1, header pins 27/28) as well to spread the sensors over two
+ * buses, each served by its own acquisition thread: `make DUAL_BUS=yes`.
+ */
+#if !defined(BCM2835_I2C_USE_I2C0)
+#define BCM2835_I2C_USE_I2C0                FALSE
+#endif
+#define BCM2835_I2C_USE_I2C1                TRUE
+
+/*
+ * I2C slave (BSC/SPI slave) driver system settings.
+ * Enable to serve readings to an I2C host on GPIO18/GPIO19.
+ */
+#define BCM2835_I2C_USE_SLAVE               FALSE
+
 /*
  * MAC driver system settings.
  */
@@ -44,8 +76,15 @@
 
 /*
  * SERIAL driver system settings.
+ * In RS-485 mode the driver enable is released from a system timer compare
+ * channel, keep it clear of the GPT drivers.
  */
+#define BCM2835_SERIAL_DE_TIMER             3
 
 /*
  * SPI driver system settings.
+ * SPI0 is left to the display; enable SPID1 (GPIO16..GPIO21) to give SPI
+ * sensors a bus of their own.
  */
+#define BCM2835_SPI_USE_SPI1                FALSE
+#define BCM2835_SPI_USE_SPI2                FALSE
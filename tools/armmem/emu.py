@@ -0,0 +1,241 @@
+"""Instruction level interpreter for the ARM (A32) subset armmem.s uses.
+
+Enough of the data processing, load/store, load/store multiple and branch
+encodings to run the routines out of the assembled object, nothing more:
+any other encoding, an unaligned word access, an access past the memory
+or a jump out of the code raises Fault. Every load is recorded in
+CPU.reads, so a test can check which bytes a routine looked at.
+"""
+
+import struct
+import subprocess
+
+M32 = 0xFFFFFFFF
+
+
+class Fault(Exception):
+    pass
+
+
+class CPU:
+    def __init__(self, code, base=0):
+        self.mem = bytearray(0x100000)
+        self.mem[base:base + len(code)] = code
+        self.code_end = base + len(code)
+        self.r = [0] * 16
+        self.N = self.Z = self.C = self.V = 0
+        self.reads = []
+        self.steps = 0
+
+    def addr(self, a, n):
+        if a + n > len(self.mem):
+            raise Fault("access at %x" % a)
+        return a
+
+    def rd8(self, a):
+        self.addr(a, 1)
+        self.reads.append((a, 1))
+        return self.mem[a]
+
+    def rd32(self, a):
+        if a & 3:
+            raise Fault("unaligned ldr %x" % a)
+        self.addr(a, 4)
+        self.reads.append((a, 4))
+        return struct.unpack_from("<I", self.mem, a)[0]
+
+    def wr8(self, a, v):
+        self.addr(a, 1)
+        self.mem[a] = v & 0xFF
+
+    def wr32(self, a, v):
+        if a & 3:
+            raise Fault("unaligned str %x" % a)
+        self.addr(a, 4)
+        struct.pack_into("<I", self.mem, a, v & M32)
+
+    def cond(self, c):
+        N, Z, C, V = self.N, self.Z, self.C, self.V
+        return [Z, not Z, C, not C, N, not N, V, not V,
+                C and not Z, (not C) or Z, N == V, N != V,
+                (not Z) and N == V, Z or N != V, True, False][c]
+
+    def shift(self, val, typ, amt, carry):
+        if typ == 0:    # LSL
+            if amt == 0:
+                return val, carry
+            if amt < 32:
+                return (val << amt) & M32, (val >> (32 - amt)) & 1
+            return 0, val & 1 if amt == 32 else 0
+        if typ == 1:    # LSR
+            if amt == 0:
+                return val, carry
+            if amt < 32:
+                return val >> amt, (val >> (amt - 1)) & 1
+            return 0, val >> 31 if amt == 32 else 0
+        raise Fault("shift type %d" % typ)
+
+    def reg(self, n):
+        return (self.r[15] + 8) & M32 if n == 15 else self.r[n]
+
+    def op2(self, ins):
+        """Shifter operand and its carry out."""
+        if ins & (1 << 25):
+            imm = ins & 0xFF
+            rot = ((ins >> 8) & 0xF) * 2
+            if rot == 0:
+                return imm, self.C
+            v = ((imm >> rot) | (imm << (32 - rot))) & M32
+            return v, v >> 31
+        rm = self.reg(ins & 0xF)
+        typ = (ins >> 5) & 3
+        if ins & (1 << 4):
+            return self.shift(rm, typ, self.r[(ins >> 8) & 0xF] & 0xFF, self.C)
+        amt = (ins >> 7) & 0x1F
+        if amt == 0 and typ == 1:
+            amt = 32
+        return self.shift(rm, typ, amt, self.C)
+
+    def step(self):
+        pc = self.r[15]
+        if pc & 3 or pc >= self.code_end:
+            raise Fault("pc %x" % pc)
+        ins = struct.unpack_from("<I", self.mem, pc)[0]
+        self.steps += 1
+        self.r[15] = pc + 4
+        if (ins & 0xFD70F000) == 0xF550F000:        # PLD
+            return
+        if not self.cond(ins >> 28):
+            return
+        if (ins & 0x0FFFFFF0) == 0x012FFF10:        # BX
+            self.r[15] = self.r[ins & 0xF]
+            return
+        t = (ins >> 25) & 7
+        if t == 5:
+            self.branch(ins, pc)
+        elif t == 4:
+            self.block(ins)
+        elif t in (2, 3):
+            self.single(ins, t)
+        elif t in (0, 1):
+            self.data(ins, t)
+        else:
+            raise Fault("unknown %08x" % ins)
+
+    def branch(self, ins, pc):
+        off = ins & 0xFFFFFF
+        if off & 0x800000:
+            off -= 0x1000000
+        if ins & (1 << 24):
+            self.r[14] = pc + 4
+        self.r[15] = (pc + 8 + off * 4) & M32
+
+    def block(self, ins):
+        """LDM and STM, without the S bit."""
+        if ins & (1 << 22):
+            raise Fault("S bit")
+        rn = (ins >> 16) & 0xF
+        regs = [i for i in range(16) if ins & (1 << i)]
+        P, U, W, L = [(ins >> s) & 1 for s in (24, 23, 21, 20)]
+        base = self.r[rn]
+        n = len(regs)
+        a = base if U else base - 4 * n
+        if P == U:
+            a += 4
+        loaded = {}
+        for i in regs:
+            if L:
+                loaded[i] = self.rd32(a)
+            else:
+                self.wr32(a, self.r[i])
+            a += 4
+        if W:
+            self.r[rn] = (base + 4 * n if U else base - 4 * n) & M32
+        for i, v in loaded.items():
+            self.r[i] = v
+
+    def single(self, ins, t):
+        """LDR, LDRB, STR and STRB."""
+        if t == 3 and ins & 0x10:
+            raise Fault("media %08x" % ins)
+        rn = (ins >> 16) & 0xF
+        rd = (ins >> 12) & 0xF
+        P, U, B, W, L = [(ins >> s) & 1 for s in (24, 23, 22, 21, 20)]
+        if t == 2:
+            off = ins & 0xFFF
+        else:
+            off, _ = self.op2(ins & ~(1 << 25))
+        base = self.reg(rn)
+        addr = (base + off if U else base - off) & M32
+        ea = addr if P else base
+        if L:
+            v = self.rd8(ea) if B else self.rd32(ea)
+        elif B:
+            self.wr8(ea, self.r[rd])
+        else:
+            self.wr32(ea, self.r[rd])
+        if not P or W:
+            self.r[rn] = addr
+        if L:
+            self.r[rd] = v
+
+    def data(self, ins, t):
+        """AND, SUB, RSB, ADD, TST, CMP, ORR, MOV and BIC."""
+        if t == 0 and (ins & 0x90) == 0x90:
+            raise Fault("extra load/store %08x" % ins)
+        opc = (ins >> 21) & 0xF
+        S = (ins >> 20) & 1
+        rn = self.reg((ins >> 16) & 0xF)
+        rd = (ins >> 12) & 0xF
+        b, sc = self.op2(ins)
+
+        def sub(x, y):
+            res = x + ((~y) & M32) + 1
+            return res & M32, res >> 32, ((x ^ y) & (x ^ res)) >> 31 & 1
+
+        logic = False
+        c = v = 0
+        if opc in (0, 8):
+            res, logic = rn & b, True
+        elif opc in (2, 10):
+            res, c, v = sub(rn, b)
+        elif opc == 3:
+            res, c, v = sub(b, rn)
+        elif opc == 4:
+            s = rn + b
+            res, c = s & M32, s >> 32
+            v = ((~(rn ^ b)) & (rn ^ res)) >> 31 & 1
+        elif opc == 12:
+            res, logic = rn | b, True
+        elif opc == 13:
+            res, logic = b, True
+        elif opc == 14:
+            res, logic = rn & (~b & M32), True
+        else:
+            raise Fault("data processing opcode %d" % opc)
+        if S:
+            self.N = res >> 31
+            self.Z = int(res == 0)
+            if logic:
+                self.C = sc
+            else:
+                self.C, self.V = c, v
+        if opc not in (8, 10):
+            if rd == 15:
+                raise Fault("data processing to pc")
+            self.r[rd] = res
+
+
+def load(obj):
+    """The .text image of an object and the addresses of its functions."""
+    out = subprocess.run(["llvm-objdump", "-t", obj], capture_output=True,
+                         text=True, check=True).stdout
+    syms = {}
+    for line in out.splitlines():
+        p = line.split()
+        if len(p) >= 5 and p[-2] != "*ABS*" and "F" in p:
+            syms[p[-1]] = int(p[0], 16)
+    subprocess.run(["llvm-objcopy", "-O", "binary", "--only-section=.text",
+                    obj, obj + ".bin"], check=True)
+    with open(obj + ".bin", "rb") as f:
+        return f.read(), syms
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""Runs the routines of armmem.s in the emulator of emu.py.
+
+memcpy over every source and destination alignment, memmove over
+overlapping ranges both ways, memset with values above a byte and strlen
+at every alignment, each at lengths around the burst sizes. A case fails
+on a wrong result or return value, on r4-r11 or sp not kept, or on a read
+outside the words holding the source.
+
+Usage: run.py armmem.o
+"""
+
+import sys
+
+from emu import CPU, Fault, load
+
+RET, STACK, AREA = 0xF0000, 0x80000, 0x40000
+SIZE = 300
+LENGTHS = list(range(80)) + [95, 96, 97, 127, 128, 129, 130, 131, 160, 200,
+                             255, 256, 257]
+
+cases = failures = 0
+
+
+def call(cpu, syms, fn, *args):
+    for i, a in enumerate(args):
+        cpu.r[i] = a & 0xFFFFFFFF
+    for i in range(4, 13):
+        cpu.r[i] = 0x1000 + i
+    saved = cpu.r[4:12]
+    cpu.r[13], cpu.r[14], cpu.r[15] = STACK, RET, syms[fn]
+    cpu.reads = []
+    cpu.steps = 0
+    while cpu.r[15] != RET:
+        cpu.step()
+        if cpu.steps > 10 ** 7:
+            raise Fault("%s runs away" % fn)
+    if cpu.r[4:12] != saved:
+        raise Fault("%s clobbers r4-r11" % fn)
+    if cpu.r[13] != STACK:
+        raise Fault("%s does not restore sp" % fn)
+    return cpu.r[0]
+
+
+def reads_ok(cpu, lo, hi):
+    """Reads off the stack stay within the aligned words covering [lo, hi)."""
+    wl, wh = lo & ~3, (hi + 3) & ~3
+    for a, n in cpu.reads:
+        if STACK - 64 <= a < STACK:
+            continue
+        if a < wl or a + n > wh:
+            return False
+    return True
+
+
+def check(ok, *info):
+    global cases, failures
+    cases += 1
+    if not ok:
+        failures += 1
+        if failures < 10:
+            print("FAIL", *info)
+
+
+def pattern(n, seed):
+    return bytes((seed + i * 7 + (i >> 8)) & 0xFF for i in range(n))
+
+
+def test_memcpy(cpu, syms):
+    n_area = SIZE + 16
+    for n in LENGTHS:
+        for doff in range(8):
+            for soff in range(8):
+                src, dst = AREA + soff, AREA + 0x2000 + doff
+                cpu.mem[AREA:AREA + n_area] = pattern(n_area, n)
+                cpu.mem[AREA + 0x2000:AREA + 0x2000 + n_area] = b"\xA5" * n_area
+                ref = bytearray(b"\xA5" * n_area)
+                ref[doff:doff + n] = cpu.mem[src:src + n]
+                r = call(cpu, syms, "memcpy", dst, src, n)
+                check(r == dst and
+                      cpu.mem[AREA + 0x2000:AREA + 0x2000 + n_area] == ref and
+                      reads_ok(cpu, src, src + n), "memcpy", n, doff, soff)
+
+
+def test_memmove(cpu, syms):
+    n_area = SIZE + 64
+    soff = 16
+    for n in LENGTHS:
+        for doff in range(soff - 8, soff + n + 9):
+            if doff + n > n_area:
+                break
+            init = pattern(n_area, doff)
+            cpu.mem[AREA:AREA + n_area] = init
+            ref = bytearray(init)
+            ref[doff:doff + n] = init[soff:soff + n]
+            r = call(cpu, syms, "memmove", AREA + doff, AREA + soff, n)
+            check(r == AREA + doff and cpu.mem[AREA:AREA + n_area] == ref and
+                  reads_ok(cpu, AREA + soff, AREA + soff + n),
+                  "memmove", n, doff)
+
+
+def test_memset(cpu, syms):
+    n_area = SIZE + 16
+    for n in LENGTHS:
+        for doff in range(8):
+            for v in (0, 0xFF, 0x5A, 0x1C3):
+                dst = AREA + doff
+                cpu.mem[AREA:AREA + n_area] = b"\xA5" * n_area
+                ref = bytearray(b"\xA5" * n_area)
+                ref[doff:doff + n] = bytes([v & 0xFF]) * n
+                r = call(cpu, syms, "memset", dst, v, n)
+                check(r == dst and cpu.mem[AREA:AREA + n_area] == ref,
+                      "memset", n, doff, v)
+
+
+def test_strlen(cpu, syms):
+    n_area = SIZE + 16
+    for n in list(range(70)) + [200]:
+        for soff in range(8):
+            s = AREA + soff
+            cpu.mem[AREA:AREA + n_area] = bytes(1 + (i + n) % 255
+                                                for i in range(n_area))
+            cpu.mem[s + n] = 0
+            r = call(cpu, syms, "strlen", s)
+            check(r == n and reads_ok(cpu, s, s + n + 1), "strlen", n, soff, r)
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("usage: run.py armmem.o")
+    code, syms = load(sys.argv[1])
+    cpu = CPU(code)
+    try:
+        test_memcpy(cpu, syms)
+        test_memmove(cpu, syms)
+        test_memset(cpu, syms)
+        test_strlen(cpu, syms)
+    except Fault as e:
+        print("FAIL", e)
+        return 1
+    print(cases, "cases", failures, "failures")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
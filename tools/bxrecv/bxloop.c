@@ -0,0 +1,224 @@
+/*
+ * Loopback test of the bulk transfer protocol: the firmware sender,
+ * os/various/bulkxfer.c built over host/ch.h, serves a buffer to bxrecv
+ * through a socket pair. The runs cover a clean link, a link that drops
+ * and corrupts bytes both ways, and a resumed transfer; each must leave
+ * the whole buffer in the output file.
+ *
+ *   bxloop ./bxrecv
+ */
+
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ch.h"
+#include "bulkxfer.h"
+
+#define SOURCE_SIZE                 300000
+#define OUTPUT                      "bxloop.out"
+
+/* Byte positions damaged on a lossy link.*/
+#define TX_FLIP_EVERY               2903
+#define TX_DROP_EVERY               4099
+#define RX_FLIP_EVERY               97
+
+typedef struct {
+  const char        *name;
+  int               lossy;
+  uint32_t          resume_at;
+} run_t;
+
+static const run_t runs[] = {
+  {"clean",         0,      0},
+  {"lossy",         1,      0},
+  {"resume",        1,      70001}
+};
+
+static uint8_t source[SOURCE_SIZE];
+static int lossy;
+static unsigned long tx_pos, rx_pos;
+static int failures;
+
+systime_t chTimeNow(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (systime_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+size_t chnWrite(BaseChannel *chp, const uint8_t *bp, size_t n) {
+  uint8_t buf[BX_MAX_BLOCK_SIZE + BX_HEADER_SIZE + BX_CRC_SIZE];
+  size_t i, o = 0, done = 0;
+
+  for (i = 0; i < n; i++, tx_pos++) {
+    if (lossy && tx_pos % TX_DROP_EVERY == TX_DROP_EVERY / 2)
+      continue;
+    buf[o++] = bp[i];
+    if (lossy && tx_pos % TX_FLIP_EVERY == TX_FLIP_EVERY / 2)
+      buf[o - 1] ^= 0x10;
+  }
+  while (done < o) {
+    ssize_t w = write(chp->fd, buf + done, o - done);
+
+    if (w <= 0)
+      return 0;
+    done += w;
+  }
+  return n;
+}
+
+msg_t chnGetTimeout(BaseChannel *chp, systime_t timeout) {
+  struct pollfd pfd = {chp->fd, POLLIN, 0};
+  uint8_t b;
+
+  if (poll(&pfd, 1, (int)timeout) == 0)
+    return Q_TIMEOUT;
+  if (read(chp->fd, &b, 1) != 1)
+    return Q_RESET;
+  if (lossy && rx_pos++ % RX_FLIP_EVERY == RX_FLIP_EVERY / 2)
+    b ^= 0x01;
+  return b;
+}
+
+static void check(int ok, const char *name, const char *what) {
+
+  if (!ok) {
+    printf("%s: FAIL, %s\n", name, what);
+    failures++;
+  }
+}
+
+/* Runs of repeated bytes, which compress, between pseudo random stretches,
+   which do not.*/
+static void make_source(void) {
+  uint32_t x = 12345;
+  size_t i = 0;
+
+  while (i < SOURCE_SIZE) {
+    size_t n;
+
+    x = x * 1103515245 + 12345;
+    n = 1 + (x >> 16) % 3000;
+    if (n > SOURCE_SIZE - i)
+      n = SOURCE_SIZE - i;
+    if (x & 0x80000000)
+      memset(&source[i], (int)(x >> 8), n);
+    else {
+      size_t k;
+
+      for (k = 0; k < n; k++) {
+        x = x * 1103515245 + 12345;
+        source[i + k] = (uint8_t)(x >> 24);
+      }
+    }
+    i += n;
+  }
+}
+
+static int output_matches(void) {
+  static uint8_t buf[SOURCE_SIZE + 1];
+  FILE *f = fopen(OUTPUT, "rb");
+  size_t n;
+
+  if (f == NULL)
+    return 0;
+  n = fread(buf, 1, sizeof buf, f);
+  fclose(f);
+  return n == SOURCE_SIZE && memcmp(buf, source, SOURCE_SIZE) == 0;
+}
+
+static void run(const char *recv, const run_t *rp) {
+  static BxMemory mem = {source, SOURCE_SIZE};
+  static const BxSource src = {bxMemoryRead, &mem};
+  static const BxConfig cfg = {
+    BX_MAX_BLOCK_SIZE,      /* block_size */
+    BX_MAX_WINDOW,          /* window */
+    MS2ST(100),             /* rto */
+    S2ST(5),                /* start_timeout */
+    TRUE                    /* compress */
+  };
+  BaseChannel ch;
+  BxStats stats;
+  msg_t msg;
+  pid_t pid;
+  int sv[2], status;
+
+  unlink(OUTPUT);
+  if (rp->resume_at > 0) {
+    FILE *f = fopen(OUTPUT, "wb");
+
+    if (f == NULL || fwrite(source, 1, rp->resume_at, f) != rp->resume_at) {
+      perror(OUTPUT);
+      exit(1);
+    }
+    fclose(f);
+  }
+
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+    perror("socketpair");
+    exit(1);
+  }
+  pid = fork();
+  if (pid == 0) {
+    char *args[] = {(char *)recv, "-t", "5", "-l", "300", "-", OUTPUT,
+                    NULL, NULL};
+
+    if (rp->resume_at > 0) {
+      memmove(&args[2], &args[1], 6 * sizeof args[0]);
+      args[1] = "-r";
+    }
+    close(sv[0]);
+    dup2(sv[1], 0);
+    dup2(sv[1], 1);
+    execv(recv, args);
+    perror(recv);
+    _exit(127);
+  }
+  close(sv[1]);
+
+  lossy = rp->lossy;
+  tx_pos = rx_pos = 0;
+  ch.fd = sv[0];
+  msg = bxSend(&ch, &src, &cfg, &stats);
+  close(sv[0]);
+  waitpid(pid, &status, 0);
+
+  printf("%s: %s, %u frames, %u resent, %u timeouts, %u bad, "
+         "%u bytes as %u on the wire\n", rp->name,
+         msg == RDY_OK ? "done" : msg == RDY_TIMEOUT ? "timed out" : "aborted",
+         stats.frames, stats.retransmits, stats.timeouts, stats.bad_frames,
+         stats.payload_bytes, stats.wire_bytes);
+  check(msg == RDY_OK, rp->name, "the session failed");
+  check(WIFEXITED(status) && WEXITSTATUS(status) == 0, rp->name,
+        "the receiver failed");
+  check(output_matches(), rp->name, "the output differs from the source");
+  check(stats.payload_bytes == SOURCE_SIZE - rp->resume_at, rp->name,
+        "not resumed at the file size");
+  if (rp->lossy)
+    check(stats.retransmits > 0 && stats.bad_frames > 0, rp->name,
+          "the link lost nothing");
+  else
+    check(stats.retransmits == 0 && stats.wire_bytes < SOURCE_SIZE,
+          rp->name, "resent or not compressed on a clean link");
+}
+
+int main(int argc, char *argv[]) {
+  size_t i;
+
+  if (argc != 2) {
+    fprintf(stderr, "usage: bxloop receiver\n");
+    return 2;
+  }
+  check(bxCrc32(0, (const uint8_t *)"123456789", 9) == 0xCBF43926, "crc",
+        "wrong check value");
+  make_source();
+  for (i = 0; i < sizeof runs / sizeof runs[0]; i++)
+    run(argv[1], &runs[i]);
+  unlink(OUTPUT);
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
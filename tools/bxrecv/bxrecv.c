@@ -0,0 +1,374 @@
+/*
+ * Host side of the bulk transfer protocol, see
+ * depends/ChibiOS-RPi/os/various/bulkxfer.h.
+ *
+ * Opens a session on the serial port, stores the data frames at their
+ * offsets in the output file, acknowledges them and answers the end
+ * handshake. With -r the transfer resumes from the current size of the
+ * output file. The firmware serves the sample log with the download shell
+ * command and I2C traces with the i2ctrace one:
+ *
+ *   bxrecv [-r] [-b baud] [-t seconds] [-l ms] port output
+ *
+ * A port of "-" means standard input and output. The exit status is zero
+ * once the whole source is in the output file.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Mirrors os/various/bulkxfer.h.*/
+#define BX_SYNC0                    'B'
+#define BX_SYNC1                    'X'
+#define BX_TYPE_DATA                0x01
+#define BX_TYPE_END                 0x02
+#define BX_TYPE_START               0x10
+#define BX_TYPE_ACK                 0x11
+#define BX_TYPE_ABORT               0x12
+#define BX_FLAG_RLE                 0x01
+#define BX_HEADER_SIZE              12
+#define BX_CRC_SIZE                 4
+
+/* Larger than any firmware block, longer frames are taken for noise.*/
+#define MAX_PAYLOAD                 4096
+#define MAX_BLOCK                   65536
+
+#define START_INTERVAL_MS           500
+
+static int rfd, wfd, out;
+static uint8_t frame[BX_HEADER_SIZE + MAX_PAYLOAD + BX_CRC_SIZE];
+static size_t framen;
+static uint8_t block[MAX_BLOCK];
+
+/* Session, in 32 bit sequence numbers.*/
+static uint32_t expected, bitmap;
+static uint32_t start_offset, total;
+static int done;
+
+static unsigned long frames, bad, duplicates, bytes;
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: bxrecv [-r] [-b baud] [-t seconds] [-l ms] port output\n");
+  exit(2);
+}
+
+/* Bitwise CRC-32 (IEEE), independent of the firmware table.*/
+static uint32_t crc32(uint32_t crc, const uint8_t *p, size_t n) {
+  int k;
+
+  crc = ~crc;
+  while (n--) {
+    crc ^= *p++;
+    for (k = 0; k < 8; k++)
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+  }
+  return ~crc;
+}
+
+static uint32_t get_le16(const uint8_t *p) {
+
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+
+  return get_le16(p) | (get_le16(p + 2) << 16);
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static long now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+static void send_frame(uint8_t type, uint32_t seq, uint32_t offset) {
+  uint8_t f[BX_HEADER_SIZE + BX_CRC_SIZE];
+  size_t n = 0;
+
+  f[0] = BX_SYNC0;
+  f[1] = BX_SYNC1;
+  f[2] = type;
+  f[3] = 0;
+  f[4] = (uint8_t)seq;
+  f[5] = (uint8_t)(seq >> 8);
+  f[6] = f[7] = 0;
+  put_le32(&f[8], offset);
+  put_le32(&f[12], crc32(0, &f[2], BX_HEADER_SIZE - 2));
+  while (n < sizeof f) {
+    ssize_t w = write(wfd, f + n, sizeof f - n);
+
+    if (w < 0 && errno != EINTR) {
+      perror("write");
+      exit(1);
+    }
+    if (w > 0)
+      n += w;
+  }
+}
+
+static void ack(void) {
+
+  send_frame(BX_TYPE_ACK, expected, bitmap);
+}
+
+/* PackBits, as encoded by the firmware.*/
+static long rle_decode(const uint8_t *p, size_t n) {
+  size_t i = 0, o = 0;
+
+  while (i < n) {
+    unsigned c = p[i++];
+
+    if (c < 128) {
+      if (i + c + 1 > n || o + c + 1 > MAX_BLOCK)
+        return -1;
+      memcpy(&block[o], &p[i], c + 1);
+      i += c + 1;
+      o += c + 1;
+    }
+    else if (c > 128) {
+      if (i >= n || o + 257 - c > MAX_BLOCK)
+        return -1;
+      memset(&block[o], p[i++], 257 - c);
+      o += 257 - c;
+    }
+  }
+  return (long)o;
+}
+
+static void store(uint32_t offset, const uint8_t *p, size_t n) {
+
+  if (pwrite(out, p, n, offset) != (ssize_t)n) {
+    perror("pwrite");
+    exit(1);
+  }
+  bytes += n;
+}
+
+static void handle_data(uint32_t seq, uint8_t flags, uint32_t offset,
+                        const uint8_t *payload, size_t len) {
+  int32_t d = (int32_t)(seq - expected);
+
+  if (d < 0 || (d > 0 && (bitmap & (1UL << (d - 1))))) {
+    duplicates++;
+    ack();
+    return;
+  }
+  if (d > 32)
+    return;
+  if (flags & BX_FLAG_RLE) {
+    long n = rle_decode(payload, len);
+
+    if (n < 0) {
+      bad++;
+      return;
+    }
+    store(offset, block, n);
+  }
+  else
+    store(offset, payload, len);
+
+  if (d > 0)
+    bitmap |= 1UL << (d - 1);
+  else {
+    expected++;
+    while (bitmap & 1) {
+      bitmap >>= 1;
+      expected++;
+    }
+    bitmap >>= 1;
+  }
+  ack();
+}
+
+static void handle_frame(void) {
+  uint8_t type = frame[2];
+  uint32_t len = get_le16(&frame[6]);
+  uint32_t seq = expected + (int16_t)(get_le16(&frame[4]) - (uint16_t)expected);
+
+  frames++;
+  if (type == BX_TYPE_DATA && !done)
+    handle_data(seq, frame[3], get_le32(&frame[8]),
+                &frame[BX_HEADER_SIZE], len);
+  else if (type == BX_TYPE_END && seq == expected) {
+    /* Everything before the END frame is acknowledged, so held.*/
+    if (!done) {
+      total = get_le32(&frame[8]);
+      if (ftruncate(out, total) != 0) {
+        perror("ftruncate");
+        exit(1);
+      }
+      done = 1;
+    }
+    send_frame(BX_TYPE_ACK, seq + 1, 0);
+  }
+}
+
+/* Frame parser, on a bad frame it resumes at the next sync byte.*/
+static void parse(uint8_t b) {
+  uint32_t len;
+
+  frame[framen++] = b;
+  while (framen > 0) {
+    uint8_t *p;
+
+    if (frame[0] != BX_SYNC0 || (framen > 1 && frame[1] != BX_SYNC1))
+      goto resync;
+    if (framen < BX_HEADER_SIZE)
+      return;
+    len = get_le16(&frame[6]);
+    if (len > MAX_PAYLOAD)
+      goto resync;
+    if (framen < BX_HEADER_SIZE + len + BX_CRC_SIZE)
+      return;
+    if (crc32(0, &frame[2], BX_HEADER_SIZE - 2 + len) ==
+        get_le32(&frame[BX_HEADER_SIZE + len])) {
+      handle_frame();
+      framen -= BX_HEADER_SIZE + len + BX_CRC_SIZE;
+      memmove(frame, &frame[BX_HEADER_SIZE + len + BX_CRC_SIZE], framen);
+      continue;
+    }
+    bad++;
+resync:
+    p = memchr(&frame[1], BX_SYNC0, framen - 1);
+    if (p == NULL) {
+      framen = 0;
+      return;
+    }
+    framen -= p - frame;
+    memmove(frame, p, framen);
+  }
+}
+
+static speed_t baud_of(long baud) {
+
+  switch (baud) {
+  case 9600:    return B9600;
+  case 19200:   return B19200;
+  case 38400:   return B38400;
+  case 57600:   return B57600;
+  case 115200:  return B115200;
+  case 230400:  return B230400;
+  }
+  fprintf(stderr, "bxrecv: unsupported baud rate %ld\n", baud);
+  exit(2);
+}
+
+static void open_port(const char *path, long baud) {
+  struct termios t;
+
+  if (strcmp(path, "-") == 0) {
+    rfd = 0;
+    wfd = 1;
+    return;
+  }
+  rfd = wfd = open(path, O_RDWR | O_NOCTTY);
+  if (rfd < 0) {
+    perror(path);
+    exit(1);
+  }
+  if (tcgetattr(rfd, &t) != 0) {
+    perror("tcgetattr");
+    exit(1);
+  }
+  cfmakeraw(&t);
+  cfsetispeed(&t, baud_of(baud));
+  cfsetospeed(&t, baud_of(baud));
+  t.c_cc[VMIN] = 0;
+  t.c_cc[VTIME] = 0;
+  if (tcsetattr(rfd, TCSANOW, &t) != 0) {
+    perror("tcsetattr");
+    exit(1);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  long baud = 115200, timeout = 10000, linger = 1000;
+  long last_rx, last_start = 0;
+  int resume = 0, i;
+
+  for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+    if (strcmp(argv[i], "-r") == 0)
+      resume = 1;
+    else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+      baud = strtol(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+      timeout = strtol(argv[++i], NULL, 0) * 1000;
+    else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+      linger = strtol(argv[++i], NULL, 0);
+    else
+      usage();
+  }
+  if (i != argc - 2)
+    usage();
+
+  out = open(argv[i + 1], O_RDWR | O_CREAT | (resume ? 0 : O_TRUNC), 0644);
+  if (out < 0) {
+    perror(argv[i + 1]);
+    exit(1);
+  }
+  if (resume) {
+    off_t size = lseek(out, 0, SEEK_END);
+
+    start_offset = size > 0 ? (uint32_t)size : 0;
+  }
+  open_port(argv[i], baud);
+
+  /* The START frame is repeated until the first frame comes back, the
+     shell command may not be running yet.*/
+  last_rx = now_ms();
+  while (1) {
+    struct pollfd pfd = {rfd, POLLIN, 0};
+    uint8_t buf[512];
+    long t = now_ms();
+    ssize_t n, k;
+
+    if (frames == 0 && t - last_start >= START_INTERVAL_MS) {
+      send_frame(BX_TYPE_START, 0, start_offset);
+      last_start = t;
+    }
+    if (t - last_rx >= (done ? linger : timeout))
+      break;
+    if (poll(&pfd, 1, 50) < 0 && errno != EINTR) {
+      perror("poll");
+      exit(1);
+    }
+    if (!(pfd.revents & (POLLIN | POLLHUP)))
+      continue;
+    n = read(rfd, buf, sizeof buf);
+    if (n <= 0)
+      break;
+    last_rx = now_ms();
+    for (k = 0; k < n; k++)
+      parse(buf[k]);
+  }
+
+  if (!done) {
+    send_frame(BX_TYPE_ABORT, 0, 0);
+    fprintf(stderr, "bxrecv: %s at %lu bytes\n",
+            frames ? "transfer stalled" : "no answer", (unsigned long)
+            (start_offset + bytes));
+    return 1;
+  }
+  fprintf(stderr, "bxrecv: %lu bytes from offset %lu, %lu frames, "
+          "%lu bad, %lu duplicates\n", (unsigned long)(total - start_offset),
+          (unsigned long)start_offset, frames, bad, duplicates);
+  return 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * The few kernel definitions os/various/bulkxfer.c uses, over a file
+ * descriptor, for the loopback test in bxloop.c. Ticks are milliseconds.
+ */
+
+#ifndef _CH_H_
+#define _CH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef int32_t     bool_t;
+typedef int32_t     msg_t;
+typedef uint32_t    systime_t;
+
+#define FALSE       0
+#define TRUE        (!FALSE)
+
+#define RDY_OK      0
+#define RDY_TIMEOUT -1
+#define RDY_RESET   -2
+#define Q_OK        RDY_OK
+#define Q_TIMEOUT   RDY_TIMEOUT
+#define Q_RESET     RDY_RESET
+
+#define MS2ST(ms)   ((systime_t)(ms))
+#define S2ST(s)     ((systime_t)(s) * 1000)
+
+typedef struct {
+  int       fd;
+} BaseChannel;
+
+#define chDbgCheck(c, func) {                                           \
+  if (!(c)) {                                                           \
+    fprintf(stderr, "%s(), line %d: check failed\n", func, __LINE__);   \
+    abort();                                                            \
+  }                                                                     \
+}
+
+systime_t chTimeNow(void);
+size_t chnWrite(BaseChannel *chp, const uint8_t *bp, size_t n);
+msg_t chnGetTimeout(BaseChannel *chp, systime_t timeout);
+
+#endif /* _CH_H_ */
@@ -0,0 +1 @@
+/* Nothing from the HAL is needed, see ch.h.*/
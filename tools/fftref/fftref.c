@@ -0,0 +1,202 @@
+/*
+ * Host reference for the fixed point FFT in os/various/fixfft.c.
+ *
+ * Runs the FFT and the band power analyzer on synthetic signals and checks
+ * them against a double precision DFT. On the host fixfft.c builds its
+ * plain C path, which is bit identical to the ARMv6 SIMD one.
+ *
+ *   make -C tools/fftref check
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fixfft.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static double ref_re[FFT_MAX_SIZE / 2 + 1], ref_im[FFT_MAX_SIZE / 2 + 1];
+static int failures;
+
+/* Double precision DFT of n real samples, bins 0..n/2, divided by n.*/
+static void dft(const double *x, size_t n) {
+  size_t k, i;
+
+  for (k = 0; k <= n / 2; k++) {
+    double re = 0, im = 0;
+
+    for (i = 0; i < n; i++) {
+      double a = 2 * M_PI * (double)((k * i) % n) / n;
+
+      re += x[i] * cos(a);
+      im -= x[i] * sin(a);
+    }
+    ref_re[k] = re / n;
+    ref_im[k] = im / n;
+  }
+}
+
+static double bin_re(const int16_t *s, size_t n, size_t k) {
+
+  return k == 0 ? s[0] : k == n / 2 ? s[1] : s[2 * k];
+}
+
+static double bin_im(const int16_t *s, size_t n, size_t k) {
+
+  return (k == 0) || (k == n / 2) ? 0 : s[2 * k + 1];
+}
+
+/* Signal to error ratio of the fixed point spectrum, in dB.*/
+static double fft_snr(const int16_t *in, size_t n) {
+  static int16_t buf[FFT_MAX_SIZE] __attribute__((aligned(4)));
+  static double x[FFT_MAX_SIZE];
+  double sig = 0, err = 0;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    x[i] = buf[i] = in[i];
+  fftRealQ15(buf, n);
+  dft(x, n);
+  for (i = 0; i <= n / 2; i++) {
+    double er = bin_re(buf, n, i) - ref_re[i];
+    double ei = bin_im(buf, n, i) - ref_im[i];
+
+    sig += ref_re[i] * ref_re[i] + ref_im[i] * ref_im[i];
+    err += er * er + ei * ei;
+  }
+  return 10 * log10(sig / (err > 0 ? err : 1e-30));
+}
+
+static void check(int ok, const char *what) {
+
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static void test_fft(void) {
+  static int16_t in[FFT_MAX_SIZE];
+  size_t n, i;
+
+  printf("FFT SNR against double precision DFT\n");
+  printf("   n    noise dB   tone dB\n");
+  for (n = FFT_MIN_SIZE; n <= FFT_MAX_SIZE; n *= 2) {
+    double noise, tone;
+
+    for (i = 0; i < n; i++)
+      in[i] = (int16_t)(rand() % 32769 - 16384);
+    noise = fft_snr(in, n);
+    for (i = 0; i < n; i++)
+      in[i] = (int16_t)lrint(16000 * sin(2 * M_PI * 3.3 * i / n) +
+                             300 * cos(2 * M_PI * (n / 5) * i / n));
+    tone = fft_snr(in, n);
+    printf("%5u   %8.1f  %8.1f\n", (unsigned)n, noise, tone);
+    check(noise > 65 - 3.5 * log2((double)n / FFT_MIN_SIZE), "FFT noise SNR");
+    check(tone > 50, "FFT tone SNR");
+  }
+}
+
+/*
+ * Pressure like stream: 1013.25 hPa in 0.001 mbar units with a 0.05 Hz
+ * oscillation, a 2 Hz one, a slow drift and some noise, sampled at 20 Hz.
+ */
+#define AN_N        512
+#define AN_FS       20000                   /* mHz */
+#define AN_SAMPLES  (AN_N * 16)
+
+static const FftBand bands[] = {
+  {FFT_BIN(20, AN_FS, AN_N), FFT_BIN(200, AN_FS, AN_N)},
+  {FFT_BIN(200, AN_FS, AN_N), FFT_BIN(1000, AN_FS, AN_N)},
+  {FFT_BIN(1000, AN_FS, AN_N), FFT_BIN(5000, AN_FS, AN_N)},
+  {FFT_BIN(5000, AN_FS, AN_N), AN_N / 2 + 1},
+  {0, AN_N / 2 + 1}                         /* Must be the last one.*/
+};
+#define AN_BANDS    (sizeof bands / sizeof bands[0])
+
+static void test_analyzer(void) {
+  static int32_t history[AN_N];
+  static int16_t work[AN_N] __attribute__((aligned(4)));
+  static int16_t window[AN_N] __attribute__((aligned(4)));
+  static const FftAnalyzerConfig cfg = {
+    AN_N, AN_N / 2, bands, AN_BANDS, history, work, window
+  };
+  static int32_t stream[AN_SAMPLES];
+  static double x[AN_N];
+  double ref[AN_BANDS] = {0};
+  uint64_t power[AN_BANDS];
+  FftAnalyzer an;
+  unsigned frames = 0, b;
+  size_t i, start;
+  uint32_t got;
+  double total;
+
+  for (i = 0; i < AN_SAMPLES; i++) {
+    double t = (double)i * 1000 / AN_FS;
+
+    stream[i] = (int32_t)lrint(1013250 + 40 * sin(2 * M_PI * 0.05 * t) +
+                               3 * sin(2 * M_PI * 2 * t) + 0.2 * t +
+                               (rand() % 201 - 100) / 100.0);
+  }
+
+  /* Reference: the same frames, double precision all the way.*/
+  for (start = 0; start + AN_N <= AN_SAMPLES; start += AN_N / 2) {
+    double mean = 0, w2 = 0;
+
+    for (i = 0; i < AN_N; i++)
+      mean += stream[start + i];
+    mean /= AN_N;
+    for (i = 0; i < AN_N; i++) {
+      double w = 0.5 - 0.5 * cos(2 * M_PI * i / AN_N);
+
+      x[i] = (stream[start + i] - mean) * w;
+      w2 += w * w;
+    }
+    w2 /= AN_N;
+    dft(x, AN_N);
+    for (b = 0; b < AN_BANDS; b++) {
+      unsigned k;
+
+      for (k = bands[b].lo; k < bands[b].hi; k++) {
+        double p = ref_re[k] * ref_re[k] + ref_im[k] * ref_im[k];
+
+        ref[b] += ((k == 0) || (k == AN_N / 2) ? p : 2 * p) / w2;
+      }
+    }
+    frames++;
+  }
+
+  fftAnalyzerInit(&an, &cfg);
+  for (i = 0; i < AN_SAMPLES; i++)
+    fftAnalyzerPut(&an, stream[i]);
+  got = fftAnalyzerRead(&an, power);
+  check(got == frames, "analyzer frame count");
+
+  printf("\nAnalyzer band powers, %u frames of %u samples at %u.%03u Hz\n",
+         frames, AN_N, AN_FS / 1000, AN_FS % 1000);
+  printf("  bins        fixed        reference    error\n");
+  total = ref[AN_BANDS - 1] / frames;
+  for (b = 0; b < AN_BANDS; b++) {
+    double p = (double)power[b] / (1 << FFT_POWER_FRAC);
+    double r = ref[b] / frames;
+    double e = r > 0 ? (p - r) / r : 0;
+
+    printf("%3u-%-3u  %12.4f  %12.4f  %+7.3f%%\n",
+           bands[b].lo, bands[b].hi - 1, p, r, 100 * e);
+    /* 1% or the quantization floor of the 14 bit frames.*/
+    check(fabs(p - r) < 0.01 * r + 1e-4 * total, "analyzer band power");
+  }
+}
+
+int main(void) {
+
+  srand(1);
+  test_fft();
+  test_analyzer();
+  printf("\n%s\n", failures ? "FAILED" : "OK");
+  return failures ? 1 : 0;
+}
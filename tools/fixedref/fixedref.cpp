@@ -0,0 +1,540 @@
+/*
+ * Host reference for the fixed point library in os/various/fixed.hpp.
+ *
+ * Runs the MS8607 compensation, humidity, dew point and filter formulas
+ * three ways: in double precision as the reference, in single precision
+ * float as the firmware does today, and in fixed point. Reports the worst
+ * error of each against the reference and the time per evaluation.
+ *
+ * The fixed point pressure and temperature compensation must match the
+ * integer code of psensor_read_pressure_and_temperature() in
+ * depends/drivers/MS8607/ms8607.c bit for bit.
+ *
+ * The timings are host timings and do not carry over to the ARM1176. On
+ * the host float is done in hardware. The firmware is built with
+ * -mfloat-abi=soft, where every float operation, pow() and log10() are
+ * library calls. With VFP the float column would be closer to the host
+ * one. The fixed point code has its own target costs: ARMv6 has no divide
+ * instruction, and a 64 bit multiply is a UMULL/SMULL pair. Compare the
+ * columns on the target before drawing conclusions.
+ *
+ *   make -C tools/fixedref check
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES_UNIT "cycles"
+static inline uint64_t cycles(void) {
+  return __rdtsc();
+}
+#else
+#define CYCLES_UNIT "ns"
+static inline uint64_t cycles(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+#endif
+
+#include "fixed.hpp"
+
+using namespace chibios_rt;
+
+static int failures;
+
+static void check(bool ok, const char *what, double value, double limit) {
+  printf("  %-44s %12.6g %s %g\n", what, value, ok ? "<=" : "EXCEEDS", limit);
+  if (!ok)
+    failures++;
+}
+
+/*===========================================================================*/
+/* Compile time properties.                                                  */
+/*===========================================================================*/
+
+static_assert(sizeof(Fixed<16, 16>::raw_t) == 4, "32 bit storage");
+static_assert(sizeof(Fixed<17, 16>::raw_t) == 8, "64 bit storage");
+static_assert(Fixed<16, 16>(1.5).Raw() == 0x18000, "literal conversion");
+static_assert(Fixed<4, 12>(-8.0).Raw() == -0x8000, "bottom of the range");
+static_assert(Fixed<1, 15>(-0.15).Raw() == -4915, "rounding to nearest");
+static_assert(Fixed<8, 8>(2.5) + Fixed<4, 12>(0.25) == Fixed<16, 16>(2.75),
+              "aligned sum");
+static_assert((Fixed<8, 8>(1.5) * Fixed<8, 8>(-2.0)).Raw() == -196608,
+              "exact product");
+static_assert((Fixed<8, 8>(1.5) * Fixed<8, 8>(-2.0)).int_bits == 16,
+              "product integer bits");
+static_assert(sizeof((Fixed<8, 8>(1.0) * Fixed<8, 8>(1.0)).Raw()) == 4,
+              "product in 32 bits while it fits");
+static_assert(sizeof((Fixed<16, 16>(1.0) * Fixed<8, 8>(1.0)).Raw()) == 8,
+              "product in 64 bits beyond");
+static_assert(Fixed<8, 8>(-1.75).As<8, 0>().Raw() == -2, "As() floors");
+static_assert(Fixed<8, 8>(-1.75).Round<8, 0>().Raw() == -2, "Round()");
+static_assert(Fixed<8, 8>(1.25).Round<8, 1>().Raw() == 3, "Round() half up");
+static_assert(Fixed<16, 0>::FromInt(1000).Shr<3>() == Fixed<16, 8>(125.0),
+              "Shr() moves the binary point");
+static_assert(Fixed<8, 16>(1.2346).Scaled<1000>() == 1235, "Scaled()");
+static_assert(Div<16, 16>(Fixed<8, 8>(1.0), Fixed<8, 8>(3.0)).Raw() == 21845,
+              "Div()");
+static_assert(Fixed<8, 8>(3.0) / Fixed<8, 8>(-0.5) == Fixed<8, 0>(-6.0),
+              "operator/");
+static_assert(Fixed<8, 8>(1.0) < Fixed<16, 16>(1.0 + 1.0 / 65536),
+              "comparison at the finer precision");
+
+/*===========================================================================*/
+/* Pressure and temperature compensation.                                    */
+/*===========================================================================*/
+
+/* PROM words C1..C6, C0 unused.*/
+typedef uint16_t prom_t[7];
+
+/* Arithmetic of psensor_read_pressure_and_temperature().*/
+static void pt_integer(const prom_t c, uint32_t d1, uint32_t d2,
+                       int32_t *t, int32_t *p) {
+  int32_t dT, TEMP;
+  int64_t OFF, SENS, P, T2, OFF2, SENS2;
+
+  dT = (int32_t)d2 - ((int32_t)c[5] << 8);
+  TEMP = 2000 + ((int64_t)dT * (int64_t)c[6] >> 23);
+  if (TEMP < 2000) {
+    T2 = (3 * ((int64_t)dT * (int64_t)dT)) >> 33;
+    OFF2 = 61 * ((int64_t)TEMP - 2000) * ((int64_t)TEMP - 2000) / 16;
+    SENS2 = 29 * ((int64_t)TEMP - 2000) * ((int64_t)TEMP - 2000) / 16;
+    if (TEMP < -1500) {
+      OFF2 += 17 * ((int64_t)TEMP + 1500) * ((int64_t)TEMP + 1500);
+      SENS2 += 9 * ((int64_t)TEMP + 1500) * ((int64_t)TEMP + 1500);
+    }
+  }
+  else {
+    T2 = (5 * ((int64_t)dT * (int64_t)dT)) >> 38;
+    OFF2 = 0;
+    SENS2 = 0;
+  }
+  OFF = ((int64_t)c[2] << 17) + (((int64_t)c[4] * dT) >> 6);
+  OFF -= OFF2;
+  SENS = ((int64_t)c[1] << 16) + (((int64_t)c[3] * dT) >> 7);
+  SENS -= SENS2;
+  P = (((d1 * SENS) >> 21) - OFF) >> 15;
+  *t = 10 * (TEMP - T2);
+  *p = 10 * P;
+}
+
+/* Same formulas in fixed point, the types carry the 2^-n scalings of the
+   datasheet instead of hand written shifts.*/
+typedef Fixed<25, 0> Adc;                   /* 24 bit conversion.          */
+typedef Fixed<17, 0> Prom;                  /* 16 bit calibration word.    */
+
+static void pt_fixed(const prom_t c, uint32_t d1, uint32_t d2,
+                     int32_t *t, int32_t *p) {
+  const Fixed<12, 0> t_ref(2000.0);
+  Fixed<26, 0> dT = Adc::FromInt(d2) - Prom::FromInt(c[5]).Shl<8>();
+  Fixed<24, 0> TEMP = t_ref + (dT * Prom::FromInt(c[6])).Shr<23>().As<20, 0>();
+  Fixed<24, 0> dTEMP = (TEMP - t_ref).As<24, 0>();
+  Fixed<24, 0> T2;
+  Fixed<48, 0> OFF2, SENS2;
+
+  if (TEMP < t_ref) {
+    Fixed<48, 0> sq = (dTEMP * dTEMP).As<48, 0>();
+
+    T2 = (dT * dT * Fixed<3, 0>(3.0)).Shr<33>().As<24, 0>();
+    OFF2 = (sq * Fixed<8, 0>(61.0)).Shr<4>().As<48, 0>();
+    SENS2 = (sq * Fixed<6, 0>(29.0)).Shr<4>().As<48, 0>();
+    if (TEMP < Fixed<12, 0>(-1500.0)) {
+      Fixed<25, 0> low = (TEMP + Fixed<12, 0>(1500.0)).As<25, 0>();
+      Fixed<48, 0> sq2 = (low * low).As<48, 0>();
+
+      OFF2 = (OFF2 + sq2 * Fixed<6, 0>(17.0)).As<48, 0>();
+      SENS2 = (SENS2 + sq2 * Fixed<5, 0>(9.0)).As<48, 0>();
+    }
+  }
+  else
+    T2 = (dT * dT * Fixed<4, 0>(5.0)).Shr<38>().As<24, 0>();
+
+  Fixed<48, 0> OFF = (Prom::FromInt(c[2]).Shl<17>() +
+                      (Prom::FromInt(c[4]) * dT).Shr<6>().As<38, 0>() -
+                      OFF2).As<48, 0>();
+  /* C1 * 2^16 plus C3 * dT / 2^7 stays within 2^34, so that the 24 bit
+     conversion times SENS fits 64 bits.*/
+  Fixed<36, 0> SENS = (Prom::FromInt(c[1]).Shl<16>() +
+                       (Prom::FromInt(c[3]) * dT).Shr<7>().As<37, 0>() -
+                       SENS2).As<36, 0>();
+  Fixed<48, 0> P = ((Adc::FromInt(d1) * SENS).Shr<21>().As<44, 0>() -
+                    OFF).Shr<15>().As<48, 0>();
+
+  *t = 10 * (int32_t)(TEMP - T2).ToInt();
+  *p = 10 * (int32_t)P.ToInt();
+}
+
+/* The same keeping fractional bits where the driver truncates: hundredths
+   of degC with 8 fractional bits, OFF with 8 and SENS with 4, few enough
+   for the 24 bit conversion times SENS to still fit 64 bits.*/
+static void pt_fixed_fine(const prom_t c, uint32_t d1, uint32_t d2,
+                          Fixed<20, 8> *t, Fixed<32, 8> *p) {
+  const Fixed<12, 0> t_ref(2000.0);
+  Fixed<26, 0> dT = Adc::FromInt(d2) - Prom::FromInt(c[5]).Shl<8>();
+  Fixed<16, 8> TEMP = (t_ref + (dT * Prom::FromInt(c[6])).Shr<23>())
+                      .Round<16, 8>();
+  Fixed<17, 8> dTEMP = TEMP - t_ref;
+  Fixed<16, 8> T2;
+  Fixed<40, 8> OFF2, SENS2;
+
+  if (TEMP < t_ref) {
+    Fixed<34, 16> sq = dTEMP * dTEMP;
+
+    T2 = (dT * dT * Fixed<3, 0>(3.0)).Shr<33>().Round<16, 8>();
+    OFF2 = (sq * Fixed<8, 0>(61.0)).Shr<4>().Round<40, 8>();
+    SENS2 = (sq * Fixed<6, 0>(29.0)).Shr<4>().Round<40, 8>();
+    if (TEMP < Fixed<12, 0>(-1500.0)) {
+      Fixed<17, 8> low = TEMP + Fixed<12, 0>(1500.0);
+      Fixed<34, 16> sq2 = low * low;
+
+      OFF2 = (OFF2 + (sq2 * Fixed<6, 0>(17.0)).Round<40, 8>()).As<40, 8>();
+      SENS2 = (SENS2 + (sq2 * Fixed<5, 0>(9.0)).Round<40, 8>()).As<40, 8>();
+    }
+  }
+  else
+    T2 = (dT * dT * Fixed<4, 0>(5.0)).Shr<38>().Round<16, 8>();
+
+  Fixed<40, 8> OFF = (Prom::FromInt(c[2]).Shl<17>() +
+                      (Prom::FromInt(c[4]) * dT).Shr<6>() - OFF2).As<40, 8>();
+  Fixed<35, 4> SENS = (Prom::FromInt(c[1]).Shl<16>() +
+                       (Prom::FromInt(c[3]) * dT).Shr<7>() - SENS2)
+                      .Round<35, 4>();
+  Fixed<32, 8> P = (((Adc::FromInt(d1) * SENS).Shr<21>().Round<40, 8>() -
+                     OFF).Shr<15>()).Round<32, 8>();
+
+  *t = ((TEMP - T2) * Fixed<5, 0>(10.0)).As<20, 8>();
+  *p = (P * Fixed<5, 0>(10.0)).As<32, 8>();
+}
+
+/* Exact reference, in milli degC and microbar.*/
+static void pt_double(const prom_t c, uint32_t d1, uint32_t d2,
+                      double *t, double *p) {
+  double dT = (double)d2 - c[5] * 256.0;
+  double TEMP = 2000 + dT * c[6] / 8388608.0;
+  double T2, OFF2, SENS2;
+
+  if (TEMP < 2000) {
+    T2 = 3 * dT * dT / 8589934592.0;
+    OFF2 = 61 * (TEMP - 2000) * (TEMP - 2000) / 16;
+    SENS2 = 29 * (TEMP - 2000) * (TEMP - 2000) / 16;
+    if (TEMP < -1500) {
+      OFF2 += 17 * (TEMP + 1500) * (TEMP + 1500);
+      SENS2 += 9 * (TEMP + 1500) * (TEMP + 1500);
+    }
+  }
+  else {
+    T2 = 5 * dT * dT / 274877906944.0;
+    OFF2 = 0;
+    SENS2 = 0;
+  }
+  double OFF = c[2] * 131072.0 + c[4] * dT / 64 - OFF2;
+  double SENS = c[1] * 65536.0 + c[3] * dT / 128 - SENS2;
+  *t = 10 * (TEMP - T2);
+  *p = 10 * ((d1 * SENS / 2097152 - OFF) / 32768);
+}
+
+/* The same in float, what a soft-float driver would compute.*/
+static void pt_float(const prom_t c, uint32_t d1, uint32_t d2,
+                     float *t, float *p) {
+  float dT = (float)d2 - c[5] * 256.0f;
+  float TEMP = 2000 + dT * c[6] / 8388608.0f;
+  float T2, OFF2, SENS2;
+
+  if (TEMP < 2000) {
+    T2 = 3 * dT * dT / 8589934592.0f;
+    OFF2 = 61 * (TEMP - 2000) * (TEMP - 2000) / 16;
+    SENS2 = 29 * (TEMP - 2000) * (TEMP - 2000) / 16;
+    if (TEMP < -1500) {
+      OFF2 += 17 * (TEMP + 1500) * (TEMP + 1500);
+      SENS2 += 9 * (TEMP + 1500) * (TEMP + 1500);
+    }
+  }
+  else {
+    T2 = 5 * dT * dT / 274877906944.0f;
+    OFF2 = 0;
+    SENS2 = 0;
+  }
+  float OFF = c[2] * 131072.0f + c[4] * dT / 64 - OFF2;
+  float SENS = c[1] * 65536.0f + c[3] * dT / 128 - SENS2;
+  *t = 10 * (TEMP - T2);
+  *p = 10 * ((d1 * SENS / 2097152 - OFF) / 32768);
+}
+
+/*===========================================================================*/
+/* Humidity and dew point.                                                   */
+/*===========================================================================*/
+
+typedef Fixed<8, 16> Celsius;
+typedef Fixed<8, 16> Percent;
+
+/* RH = -6 + 125 * adc / 2^16.*/
+static Percent rh_fixed(uint16_t adc) {
+  return (Fixed<17, 0>::FromInt(adc).Shr<16>() * Fixed<8, 0>(125.0) +
+          Fixed<4, 0>(-6.0)).As<8, 16>();
+}
+
+static float rh_float(uint16_t adc) {
+  return (float)adc * 125 / 65536 - 6;
+}
+
+/* Compensated RH = RH + (25 - T) * -0.15, all in 32 bits.*/
+static Percent rhc_fixed(Percent rh, Celsius t) {
+  Fixed<9, 8> dt = (Fixed<6, 0>(25.0) - t).As<9, 8>();
+
+  return (rh + dt * Fixed<1, 14>(-0.15)).As<8, 16>();
+}
+
+static float rhc_float(float rh, float t) {
+  return rh + (25 - t) * -0.15f;
+}
+
+/* Dew point of ms8607_get_dew_point(), with the partial pressure folded
+   in: Td = -B / (log10(RH / 100) - B / (T + C)) - C, brought over one
+   denominator, Td = B (T + C) / (B - log10(RH / 100) (T + C)) - C, so it
+   takes a single division. The denominator stays above B.*/
+static const Fixed<12, 8> dp_b(1762.39);
+static const Fixed<9, 8> dp_c(235.66);
+
+static Celsius dp_fixed(Celsius t, Percent rh) {
+  FixedLog lrh = Log10((rh * Fixed<1, 24>(0.01)).Round<2, 24>());
+  Fixed<10, 16> u = t + dp_c;
+  Fixed<13, 16> den = dp_b - (lrh * u).Round<11, 16>();
+
+  return (Div<16, 16>(dp_b * u, den) - dp_c).As<8, 16>();
+}
+
+static float dp_float(float t, float rh) {
+  double pp = pow(10, 8.1332f - 1762.39f / (t + 235.66f));
+
+  return -1762.39f / (log10(rh * pp / 100) - 8.1332f) - 235.66f;
+}
+
+static double dp_double(double t, double rh) {
+  double pp = pow(10, 8.1332 - 1762.39 / (t + 235.66));
+
+  return -1762.39 / (log10(rh * pp / 100) - 8.1332) - 235.66;
+}
+
+/*===========================================================================*/
+/* Filtering.                                                                */
+/*===========================================================================*/
+
+/* Exponential moving average of pressure in Pa, y += (x - y) * alpha.*/
+typedef Fixed<19, 12> Pascal;
+
+static const Fixed<1, 24> ema_alpha(0.05);
+
+static Pascal ema_fixed(Pascal y, Pascal x) {
+  return (y + ((x - y) * ema_alpha).Round<20, 12>()).As<19, 12>();
+}
+
+static float ema_float(float y, float x) {
+  return y + (x - y) * 0.05f;
+}
+
+/*===========================================================================*/
+/* Test driver.                                                              */
+/*===========================================================================*/
+
+#define SAMPLES     100000
+
+static uint32_t seed = 1;
+
+static uint32_t rnd(void) {
+  seed = seed * 1664525 + 1013904223;
+  return seed >> 8;
+}
+
+static double urand(double lo, double hi) {
+  return lo + (hi - lo) * (rnd() & 0xFFFFFF) / 16777216.0;
+}
+
+static struct {
+  uint32_t d1, d2;
+  uint16_t adc;
+  float tf, rhf, pf;
+  Celsius t;
+  Percent rh;
+  Pascal p;
+} in[SAMPLES];
+
+static volatile int32_t sink_i;
+static volatile float sink_f;
+
+static void report_time(const char *what, uint64_t fx, uint64_t fl) {
+  printf("  %-24s fixed %7.1f  float %7.1f " CYCLES_UNIT "/eval\n", what,
+         (double)fx / SAMPLES, (double)fl / SAMPLES);
+}
+
+int main(void) {
+  /* Datasheet example calibration, TEMP 20.00 degC and P 1100.02 mbar for
+     its D1 and D2.*/
+  static const prom_t prom = {0, 46372, 43981, 29059, 27842, 31553, 28165};
+  double e_int = 0, e_fix = 0, e_fine = 0, e_flt = 0;
+  int mismatches = 0;
+  uint64_t t0, t1, t2, t3;
+  int i;
+
+  printf("fixed point reference\n");
+  for (i = 0; i < SAMPLES; i++) {
+    /* Conversions spanning about -40..85 degC and 10..2000 mbar.*/
+    in[i].d2 = (uint32_t)((int32_t)(prom[5] << 8) + (int32_t)urand(-4.2e6, 4.0e6));
+    in[i].d1 = (uint32_t)urand(4.5e5, 9.0e6);
+    in[i].adc = (uint16_t)(rnd() & 0xFFFF);
+    in[i].tf = (float)urand(-20, 60);
+    in[i].rhf = (float)urand(5, 100);
+    in[i].pf = (float)(101325 + 400 * sin(i / 5000.0) + urand(-20, 20));
+    in[i].t = Celsius::FromRaw((int32_t)lrint(in[i].tf * 65536.0));
+    in[i].rh = Percent::FromRaw((int32_t)lrint(in[i].rhf * 65536.0));
+    in[i].p = Pascal::FromRaw((int32_t)lrint(in[i].pf * 4096.0));
+  }
+
+  printf("pressure and temperature compensation\n");
+  {
+    int32_t ti, pi;
+
+    pt_fixed(prom, 6465444, 8077636, &ti, &pi);
+    check(ti == 20000 && pi == 1100020, "datasheet example", 0, 0);
+  }
+  for (i = 0; i < SAMPLES; i++) {
+    int32_t ti, pi, tx, px;
+    Fixed<20, 8> tq;
+    Fixed<32, 8> pq;
+    double td, pd;
+    float tf, pf;
+
+    pt_integer(prom, in[i].d1, in[i].d2, &ti, &pi);
+    pt_fixed(prom, in[i].d1, in[i].d2, &tx, &px);
+    pt_fixed_fine(prom, in[i].d1, in[i].d2, &tq, &pq);
+    pt_double(prom, in[i].d1, in[i].d2, &td, &pd);
+    pt_float(prom, in[i].d1, in[i].d2, &tf, &pf);
+    if ((ti != tx) || (pi != px))
+      mismatches++;
+    e_int = fmax(e_int, fabs(pi - pd));
+    e_fix = fmax(e_fix, fabs(px - pd));
+    e_fine = fmax(e_fine, fabs(pq.ToDouble() - pd));
+    e_flt = fmax(e_flt, fabs(pf - pd));
+  }
+  check(mismatches == 0, "fixed vs driver integer mismatches", mismatches, 0);
+  check(e_fine <= 1, "fixed fine pressure error, ubar", e_fine, 1);
+  printf("  %-44s %12.6g\n", "fixed and driver pressure error, ubar", e_fix);
+  printf("  %-44s %12.6g\n", "float pressure error, ubar", e_flt);
+
+  t0 = cycles();
+  for (i = 0; i < SAMPLES; i++) {
+    int32_t tx, px;
+
+    pt_fixed(prom, in[i].d1, in[i].d2, &tx, &px);
+    sink_i = px;
+  }
+  t1 = cycles();
+  for (i = 0; i < SAMPLES; i++) {
+    float tf, pf;
+
+    pt_float(prom, in[i].d1, in[i].d2, &tf, &pf);
+    sink_f = pf;
+  }
+  t2 = cycles();
+  for (i = 0; i < SAMPLES; i++) {
+    Fixed<20, 8> tq;
+    Fixed<32, 8> pq;
+
+    pt_fixed_fine(prom, in[i].d1, in[i].d2, &tq, &pq);
+    sink_i = pq.Raw();
+  }
+  t3 = cycles();
+  report_time("compensation", t1 - t0, t2 - t1);
+  report_time("compensation, fine", t3 - t2, t2 - t1);
+
+  printf("relative humidity\n");
+  e_fix = e_flt = 0;
+  for (i = 0; i < SAMPLES; i++) {
+    double ref = in[i].adc * 125.0 / 65536 - 6;
+
+    e_fix = fmax(e_fix, fabs(rh_fixed(in[i].adc).ToDouble() - ref));
+    e_flt = fmax(e_flt, fabs(rh_float(in[i].adc) - ref));
+  }
+  check(e_fix <= 1.0 / 65536, "fixed RH error, %", e_fix, 1.0 / 65536);
+  printf("  %-44s %12.6g\n", "float RH error, %", e_flt);
+
+  e_fix = e_flt = 0;
+  for (i = 0; i < SAMPLES; i++) {
+    double ref = in[i].rh.ToDouble() +
+                 (25 - in[i].t.ToDouble()) * -0.15;
+
+    e_fix = fmax(e_fix, fabs(rhc_fixed(in[i].rh, in[i].t).ToDouble() - ref));
+    e_flt = fmax(e_flt, fabs(rhc_float(in[i].rhf, in[i].tf) - ref));
+  }
+  check(e_fix <= 0.002, "fixed compensated RH error, %", e_fix, 0.002);
+  printf("  %-44s %12.6g\n", "float compensated RH error, %", e_flt);
+
+  t0 = cycles();
+  for (i = 0; i < SAMPLES; i++)
+    sink_i = rhc_fixed(rh_fixed(in[i].adc), in[i].t).Raw();
+  t1 = cycles();
+  for (i = 0; i < SAMPLES; i++)
+    sink_f = rhc_float(rh_float(in[i].adc), in[i].tf);
+  t2 = cycles();
+  report_time("humidity", t1 - t0, t2 - t1);
+
+  printf("dew point\n");
+  e_fix = e_flt = 0;
+  for (i = 0; i < SAMPLES; i++) {
+    double ref = dp_double(in[i].t.ToDouble(), in[i].rh.ToDouble());
+
+    e_fix = fmax(e_fix, fabs(dp_fixed(in[i].t, in[i].rh).ToDouble() - ref));
+    e_flt = fmax(e_flt, fabs(dp_float(in[i].tf, in[i].rhf) - ref));
+  }
+  check(e_fix <= 0.005, "fixed dew point error, degC", e_fix, 0.005);
+  printf("  %-44s %12.6g\n", "float dew point error, degC", e_flt);
+
+  t0 = cycles();
+  for (i = 0; i < SAMPLES; i++)
+    sink_i = dp_fixed(in[i].t, in[i].rh).Raw();
+  t1 = cycles();
+  for (i = 0; i < SAMPLES; i++)
+    sink_f = dp_float(in[i].tf, in[i].rhf);
+  t2 = cycles();
+  report_time("dew point", t1 - t0, t2 - t1);
+
+  printf("moving average\n");
+  {
+    Pascal yx = in[0].p;
+    float yf = in[0].pf;
+    double yd = in[0].p.ToDouble();
+
+    e_fix = e_flt = 0;
+    for (i = 1; i < SAMPLES; i++) {
+      yx = ema_fixed(yx, in[i].p);
+      yf = ema_float(yf, in[i].pf);
+      yd += (in[i].p.ToDouble() - yd) * 0.05;
+      e_fix = fmax(e_fix, fabs(yx.ToDouble() - yd));
+      e_flt = fmax(e_flt, fabs(yf - yd));
+    }
+    check(e_fix <= 0.01, "fixed EMA error, Pa", e_fix, 0.01);
+    printf("  %-44s %12.6g\n", "float EMA error, Pa", e_flt);
+
+    t0 = cycles();
+    for (i = 1; i < SAMPLES; i++)
+      yx = ema_fixed(yx, in[i].p);
+    t1 = cycles();
+    for (i = 1; i < SAMPLES; i++)
+      yf = ema_float(yf, in[i].pf);
+    t2 = cycles();
+    sink_i = yx.Raw();
+    sink_f = yf;
+    report_time("moving average", t1 - t0, t2 - t1);
+  }
+
+  printf("timings: host " CYCLES_UNIT ", float in hardware; the firmware is "
+         "soft-float, measure on the target\n");
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * Hot code placement for the BCM2835 linker script.
+ *
+ * A profile is a list of function names, hottest first, one per line,
+ * optionally followed by a sample count; '#' starts a comment. It can be
+ * written by hand or resolved from the PC samples of the pcprof shell
+ * command:
+ *
+ *   hotcold -s kernel.sym [-b bytes] samples.txt > hotcold.prof
+ *   hotcold -l hotcold.prof > hotcold.ld
+ *
+ * kernel.sym is the "nm -S" listing of the image the samples were taken
+ * on. Resolution keeps the hottest functions that fit in the budget,
+ * 16 KB by default, the size of the ARM1176 instruction cache. The linker
+ * fragment lists their sections in profile order, for the INCLUDE in
+ * BCM2835.ld; it needs the image built with -ffunction-sections.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_BUDGET              16384
+
+typedef struct {
+  unsigned long     addr, size;
+  unsigned long     samples;
+  char              *name;
+} func_t;
+
+static func_t *funcs;
+static size_t nfuncs;
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: hotcold -s symbols [-b bytes] samples\n"
+          "       hotcold -l profile\n");
+  exit(2);
+}
+
+static FILE *open_or_die(const char *path) {
+  FILE *f = fopen(path, "r");
+
+  if (f == NULL) {
+    perror(path);
+    exit(1);
+  }
+  return f;
+}
+
+static int by_addr(const void *a, const void *b) {
+  const func_t *fa = a, *fb = b;
+
+  return (fa->addr > fb->addr) - (fa->addr < fb->addr);
+}
+
+static int by_samples(const void *a, const void *b) {
+  const func_t *fa = a, *fb = b;
+
+  if (fa->samples != fb->samples)
+    return (fa->samples < fb->samples) - (fa->samples > fb->samples);
+  return by_addr(a, b);
+}
+
+/* Reads the code symbols of an "nm -S" listing. Symbols without a size,
+   the assembly ones, extend to the next symbol.*/
+static void read_symbols(const char *path) {
+  FILE *f = open_or_die(path);
+  char line[512], name[256], type[4];
+  unsigned long addr, size;
+  size_t cap = 0, i;
+
+  while (fgets(line, sizeof line, f) != NULL) {
+    if (sscanf(line, "%lx %lx %3s %255s", &addr, &size, type, name) != 4) {
+      size = 0;
+      if (sscanf(line, "%lx %3s %255s", &addr, type, name) != 3)
+        continue;
+    }
+    if (strchr("tTwW", type[0]) == NULL || type[1] != '\0' ||
+        name[0] == '$')
+      continue;
+    if (nfuncs == cap) {
+      cap = cap ? 2 * cap : 256;
+      funcs = realloc(funcs, cap * sizeof *funcs);
+      if (funcs == NULL) {
+        perror("realloc");
+        exit(1);
+      }
+    }
+    funcs[nfuncs].addr = addr & ~1UL;         /* Thumb bit.*/
+    funcs[nfuncs].size = size;
+    funcs[nfuncs].samples = 0;
+    funcs[nfuncs].name = strdup(name);
+    nfuncs++;
+  }
+  fclose(f);
+  qsort(funcs, nfuncs, sizeof *funcs, by_addr);
+  for (i = 0; i + 1 < nfuncs; i++)
+    if (funcs[i].size == 0)
+      funcs[i].size = funcs[i + 1].addr - funcs[i].addr;
+}
+
+static func_t *lookup(unsigned long pc) {
+  size_t lo = 0, hi = nfuncs;
+
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+
+    if (funcs[mid].addr <= pc)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == 0 || pc - funcs[lo - 1].addr >= funcs[lo - 1].size)
+    return NULL;
+  return &funcs[lo - 1];
+}
+
+/* Samples are the lines starting with a 0x prefixed address, the rest of
+   the console capture is skipped.*/
+static void resolve(const char *path, unsigned long budget) {
+  FILE *f = open_or_die(path);
+  char line[256], *end;
+  unsigned long total = 0, missed = 0, used = 0;
+  size_t i;
+
+  while (fgets(line, sizeof line, f) != NULL) {
+    unsigned long pc;
+    func_t *fp;
+
+    if (line[0] != '0' || line[1] != 'x')
+      continue;
+    pc = strtoul(line, &end, 16);
+    if (end == line + 2 || (*end != '\0' && !isspace((unsigned char)*end)))
+      continue;
+    total++;
+    if ((fp = lookup(pc)) != NULL)
+      fp->samples++;
+    else
+      missed++;
+  }
+  fclose(f);
+
+  qsort(funcs, nfuncs, sizeof *funcs, by_samples);
+  printf("# %lu samples, %lu outside any function\n", total, missed);
+  for (i = 0; i < nfuncs && funcs[i].samples > 0; i++) {
+    if (used + funcs[i].size > budget)
+      continue;
+    used += funcs[i].size;
+    printf("%s %lu\n", funcs[i].name, funcs[i].samples);
+  }
+  printf("# %lu of %lu bytes\n", used, budget);
+}
+
+static void emit_order(const char *path) {
+  FILE *f = open_or_die(path);
+  char line[512], name[256];
+
+  printf("/* Generated by tools/hotcold from %s.*/\n", path);
+  while (fgets(line, sizeof line, f) != NULL) {
+    char *p = strchr(line, '#');
+
+    if (p != NULL)
+      *p = '\0';
+    if (sscanf(line, "%255s", name) == 1)
+      printf("*(.text.%s .text.hot.%s)\n", name, name);
+  }
+  fclose(f);
+}
+
+int main(int argc, char *argv[]) {
+  const char *symbols = NULL;
+  unsigned long budget = DEFAULT_BUDGET;
+  int order = 0, i;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+      symbols = argv[++i];
+    else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+      budget = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "-l") == 0)
+      order = 1;
+    else
+      usage();
+  }
+  if (i != argc - 1 || order == (symbols != NULL))
+    usage();
+
+  if (order)
+    emit_order(argv[i]);
+  else {
+    read_symbols(symbols);
+    resolve(argv[i], budget);
+  }
+  return 0;
+}
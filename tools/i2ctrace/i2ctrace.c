@@ -0,0 +1,190 @@
+/*
+ * Decoder for the I2C capture traces, see I2C_TRACE_MAGIC in
+ * os/hal/include/i2c.h.
+ *
+ * Prints one line per transaction and a summary per slave address. The
+ * trace is captured on the target with the i2ctrace shell command, which
+ * sends it as a bulk transfer received by tools/bxrecv, and can be
+ * replayed with demos/Posix-I2CREPLAY:
+ *
+ *   bxrecv /dev/ttyUSB0 trace.bin
+ *   i2ctrace [-q] trace.bin
+ *
+ * ms8607sim writes the trace of the MS8607 driver with a simulated sensor,
+ * the fixture of the replay demo and of "make check".
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Mirrors os/hal/include/i2c.h.*/
+#define I2C_TRACE_MAGIC             "I2CT"
+#define I2C_TRACE_VERSION           1
+#define I2C_TRACE_HEADER_SIZE       5
+#define I2C_TRACE_END               0xFF
+#define I2C_TRACE_KIND_MASK         0x03
+#define I2C_TRACE_TX                0x01
+#define I2C_TRACE_RX                0x02
+#define I2C_TRACE_STATUS_MASK       0x0C
+#define I2C_TRACE_OK                0x00
+#define I2C_TRACE_RESET             0x04
+#define I2C_TRACE_TIMEOUT           0x08
+#define I2C_TRACE_ERRORS            0x10
+#define I2C_TRACE_GAP               0x20
+
+#define I2CD_ACK_FAILURE            0x04
+
+typedef struct {
+  unsigned long     count, nacks, errors, timeouts;
+  unsigned long     min, max;
+  unsigned long long total;
+} addr_stats_t;
+
+static const uint8_t *trace, *end;
+static addr_stats_t stats[128];
+
+static int get_varint(unsigned long *vp) {
+  unsigned shift = 0;
+  uint8_t b;
+
+  *vp = 0;
+  do {
+    if ((shift > 28) || (trace >= end))
+      return 0;
+    b = *trace++;
+    *vp |= (unsigned long)(b & 0x7F) << shift;
+    shift += 7;
+  } while (b & 0x80);
+  return 1;
+}
+
+static int get_bytes(const uint8_t **pp, unsigned long *np) {
+
+  if (!get_varint(np) || (*np > (unsigned long)(end - trace)))
+    return 0;
+  *pp = trace;
+  trace += *np;
+  return 1;
+}
+
+static void print_bytes(const char *label, const uint8_t *p, unsigned long n) {
+
+  printf(" %s", label);
+  while (n-- > 0)
+    printf(" %02x", *p++);
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long records = 0, gaps = 0;
+  unsigned long long now = 0;
+  const uint8_t *buf;
+  int quiet = 0, ended = 0;
+  unsigned a;
+  FILE *f;
+  long size;
+
+  if ((argc == 3) && (strcmp(argv[1], "-q") == 0))
+    quiet = 1;
+  else if (argc != 2) {
+    fprintf(stderr, "usage: %s [-q] trace\n", argv[0]);
+    return 2;
+  }
+  if (((f = fopen(argv[argc - 1], "rb")) == NULL) ||
+      (fseek(f, 0, SEEK_END) != 0) || ((size = ftell(f)) < 0) ||
+      (fseek(f, 0, SEEK_SET) != 0) ||
+      ((buf = malloc((size_t)size + 1)) == NULL) ||
+      (fread((void *)buf, 1, (size_t)size, f) != (size_t)size)) {
+    perror(argv[argc - 1]);
+    return 2;
+  }
+  fclose(f);
+  if ((size < I2C_TRACE_HEADER_SIZE) ||
+      (memcmp(buf, I2C_TRACE_MAGIC, 4) != 0) ||
+      (buf[4] != I2C_TRACE_VERSION)) {
+    fprintf(stderr, "%s: not a version %d trace\n",
+            argv[argc - 1], I2C_TRACE_VERSION);
+    return 2;
+  }
+  trace = buf + I2C_TRACE_HEADER_SIZE;
+  end = buf + size;
+
+  while (trace < end) {
+    unsigned long start, duration, txlen = 0, rxlen;
+    const uint8_t *tx = NULL, *rx, *rec = trace;
+    uint8_t tag, addr, errors = 0;
+    addr_stats_t *sp;
+
+    tag = *trace++;
+    if (tag == I2C_TRACE_END) {
+      ended = 1;
+      break;
+    }
+    if ((trace >= end) || ((addr = *trace++) > 127) ||
+        !get_varint(&start) || !get_varint(&duration) ||
+        ((tag & I2C_TRACE_ERRORS) &&
+         ((trace >= end) || ((errors = *trace++), 0))) ||
+        (((tag & I2C_TRACE_KIND_MASK) == I2C_TRACE_TX) &&
+         !get_bytes(&tx, &txlen)) ||
+        !get_bytes(&rx, &rxlen)) {
+      fprintf(stderr, "truncated or malformed record at offset %ld\n",
+              (long)(rec - buf));
+      return 1;
+    }
+
+    now += start;
+    records++;
+    sp = &stats[addr];
+    if (sp->count++ == 0)
+      sp->min = duration;
+    if (duration < sp->min)
+      sp->min = duration;
+    if (duration > sp->max)
+      sp->max = duration;
+    sp->total += duration;
+    if ((tag & I2C_TRACE_STATUS_MASK) == I2C_TRACE_TIMEOUT)
+      sp->timeouts++;
+    else if ((tag & I2C_TRACE_STATUS_MASK) != I2C_TRACE_OK) {
+      if (errors == I2CD_ACK_FAILURE)
+        sp->nacks++;
+      else
+        sp->errors++;
+    }
+    if (tag & I2C_TRACE_GAP)
+      gaps++;
+
+    if (quiet)
+      continue;
+    if (tag & I2C_TRACE_GAP)
+      printf("-- records dropped --\n");
+    printf("%10llu.%06llu %02x %s %6lu us %-7s",
+           now / 1000000, now % 1000000, addr,
+           (tag & I2C_TRACE_KIND_MASK) == I2C_TRACE_TX ? "W" : "R", duration,
+           (tag & I2C_TRACE_STATUS_MASK) == I2C_TRACE_OK ? "ok" :
+           (tag & I2C_TRACE_STATUS_MASK) == I2C_TRACE_TIMEOUT ? "timeout" :
+           "reset");
+    if (tag & I2C_TRACE_ERRORS)
+      printf(" errors %02x", errors);
+    if (txlen > 0)
+      print_bytes("tx", tx, txlen);
+    if (rxlen > 0)
+      print_bytes("rx", rx, rxlen);
+    printf("\n");
+  }
+
+  printf("%lu records over %llu.%06llu s, %lu after dropped records%s\n",
+         records, now / 1000000, now % 1000000, gaps,
+         ended ? "" : ", no end tag");
+  printf("addr   count  nacks errors timeouts  min us  avg us  max us\n");
+  for (a = 0; a < 128; a++) {
+    addr_stats_t *sp = &stats[a];
+
+    if (sp->count == 0)
+      continue;
+    printf("  %02x %7lu %6lu %6lu %8lu %7lu %7llu %7lu\n", a, sp->count,
+           sp->nacks, sp->errors, sp->timeouts, sp->min,
+           sp->total / sp->count, sp->max);
+  }
+  return 0;
+}
@@ -0,0 +1,313 @@
+/*
+ * Writes the I2C trace of the MS8607 driver, depends/drivers/MS8607,
+ * talking to a simulated sensor, in the format of the i2ctrace shell
+ * command. It runs the sequence of demos/Posix-I2CREPLAY, so the trace is
+ * the fixture that demo replays and i2ctrace checks its output against.
+ * With -s the readings take the split-phase sequence of MS8607Sensor, for
+ * the fixture of demos/Posix-SENSORS.
+ *
+ *   ms8607sim [-s] [-n readings] trace.bin
+ *
+ * The clock is simulated: transactions take their time at 100 kHz and the
+ * driver sleeps advance it. The humidity part NACKs the first read of the
+ * second reading, as one still converting does.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ms8607.h"
+
+/* Mirrors os/hal/include/i2c.h.*/
+#define I2C_TRACE_MAGIC             "I2CT"
+#define I2C_TRACE_VERSION           1
+#define I2C_TRACE_END               0xFF
+#define I2C_TRACE_TX                0x01
+#define I2C_TRACE_RX                0x02
+#define I2C_TRACE_RESET             0x04
+#define I2C_TRACE_ERRORS            0x10
+
+#define I2CD_ACK_FAILURE            0x04
+
+#define PT_ADDR                     0x76
+#define RH_ADDR                     0x40
+
+/* Pause between readings, as in the demo.*/
+#define READING_PERIOD_MS           1000
+/* Wait after a NACKed humidity collect, MS8607S_RETRY_US.*/
+#define RETRY_US                    1000
+
+/* Datasheet example calibration and conversions, 20.00 degC and
+   1100.02 mbar. The CRC nibble of word 0 is filled in at start.*/
+static uint16_t prom[8] = {0x0B00, 46372, 43981, 29059, 27842, 31553, 28165,
+                           0};
+#define D1                          6465444
+#define D2                          8077636
+/* About 25 %RH, the int32 conversion of the driver overflows above 26.*/
+#define RH_ADC                      0x4000
+
+static FILE *out;
+static unsigned long long now, last;
+static unsigned reading;
+
+/* Sensor state.*/
+static uint8_t pt_cmd, pt_conv, user_reg = 0x02;
+static int rh_nack;
+
+static void put_varint(unsigned long v) {
+
+  while (v >= 0x80) {
+    fputc((int)(v & 0x7F) | 0x80, out);
+    v >>= 7;
+  }
+  fputc((int)v, out);
+}
+
+static void put_bytes(const uint8_t *p, size_t n) {
+
+  put_varint(n);
+  fwrite(p, 1, n, out);
+}
+
+/* Address byte plus data, nine bits each, and the start and stop.*/
+static void record(uint8_t kind, uint8_t addr, const uint8_t *p, size_t n,
+                   int nack) {
+  unsigned long duration = (1 + (nack ? 0 : n)) * 90 + 20;
+  uint8_t tag = kind;
+
+  if (nack)
+    tag |= I2C_TRACE_RESET | I2C_TRACE_ERRORS;
+  fputc(tag, out);
+  fputc(addr, out);
+  put_varint((unsigned long)(now - last));
+  put_varint(duration);
+  if (nack)
+    fputc(I2CD_ACK_FAILURE, out);
+  if (kind == I2C_TRACE_TX) {
+    put_bytes(p, n);
+    put_varint(0);
+  }
+  else
+    put_bytes(p, n);
+  last = now;
+  now += duration;
+}
+
+static uint8_t rh_crc(uint16_t value) {
+  uint32_t polynom = 0x988000, msb = 0x800000, mask = 0xFF8000;
+  uint32_t result = (uint32_t)value << 8;
+
+  while (msb != 0x80) {
+    if (result & msb)
+      result = ((result ^ polynom) & mask) | (result & ~mask);
+    msb >>= 1;
+    mask >>= 1;
+    polynom >>= 1;
+  }
+  return (uint8_t)result;
+}
+
+static uint8_t prom_crc(void) {
+  uint16_t rem = 0;
+  unsigned cnt, bit;
+
+  for (cnt = 0; cnt < 16; cnt++) {
+    uint16_t w = cnt < 2 ? prom[0] & 0x0FFF : prom[cnt >> 1];
+
+    rem ^= cnt & 1 ? w & 0xFF : w >> 8;
+    for (bit = 0; bit < 8; bit++)
+      rem = rem & 0x8000 ? (uint16_t)((rem << 1) ^ 0x3000) : (uint16_t)(rem << 1);
+  }
+  return (uint8_t)(rem >> 12);
+}
+
+static enum ms8607_status i2c_write(void *ctx,
+                                    ms8607_i2c_controller_packet *const pp) {
+
+  (void)ctx;
+  record(I2C_TRACE_TX, pp->address, pp->data, pp->data_length, 0);
+  if (pp->address == PT_ADDR) {
+    pt_cmd = pp->data[0];
+    if ((pt_cmd & 0xE0) == 0x40)
+      pt_conv = pt_cmd;
+  }
+  else if ((pp->data[0] == 0xE6) && (pp->data_length == 2))
+    user_reg = pp->data[1];
+  else if (pp->data[0] == 0xF5)
+    rh_nack = reading == 1;
+  return ms8607_status_ok;
+}
+
+static enum ms8607_status i2c_read(void *ctx,
+                                   ms8607_i2c_controller_packet *const pp) {
+  uint8_t *d = pp->data;
+  uint32_t v;
+
+  (void)ctx;
+  memset(d, 0, pp->data_length);
+  if (pp->address == RH_ADDR) {
+    if (rh_nack) {
+      rh_nack = 0;
+      record(I2C_TRACE_RX, pp->address, d, pp->data_length, 1);
+      return ms8607_status_callback_i2c_nack;
+    }
+    if (pp->data_length == 1)
+      d[0] = user_reg;
+    else {
+      v = RH_ADC + reading * 0x100;
+      d[0] = (uint8_t)(v >> 8);
+      d[1] = (uint8_t)v;
+      d[2] = rh_crc((uint16_t)v);
+    }
+  }
+  else if ((pt_cmd & 0xF0) == 0xA0) {
+    v = prom[(pt_cmd >> 1) & 7];
+    d[0] = (uint8_t)(v >> 8);
+    d[1] = (uint8_t)v;
+  }
+  else {
+    /* Result of the last conversion, pressure or temperature.*/
+    v = (pt_conv & 0xF0) == 0x40 ? D1 + reading * 50 : D2 + reading * 20;
+    d[0] = (uint8_t)(v >> 16);
+    d[1] = (uint8_t)(v >> 8);
+    d[2] = (uint8_t)v;
+  }
+  record(I2C_TRACE_RX, pp->address, d, pp->data_length, 0);
+  return ms8607_status_ok;
+}
+
+static enum ms8607_status i2c_write_no_stop(void *ctx,
+                                            ms8607_i2c_controller_packet *const pp) {
+
+  (void)ctx;
+  (void)pp;
+  return ms8607_status_callback_error;
+}
+
+static enum ms8607_status sleep_ms(void *ctx, uint32_t ms) {
+
+  (void)ctx;
+  now += ms * 1000ULL;
+  return ms8607_status_ok;
+}
+
+static void print_string(void *ctx, const char *text) {
+
+  (void)ctx;
+  fputs(text, stderr);
+}
+
+static void print_int64(void *ctx, int64_t number, uint8_t pad_width,
+                        ms8607_bool pad_with_zeroes) {
+
+  (void)ctx;
+  fprintf(stderr, pad_with_zeroes ? "%0*lld" : "%*lld", pad_width,
+          (long long)number);
+}
+
+static void assign_functions(ms8607_host_functions *deps, void *ctx) {
+
+  (void)ctx;
+  deps->i2c_controller_read          = i2c_read;
+  deps->i2c_controller_write         = i2c_write;
+  deps->i2c_controller_write_no_stop = i2c_write_no_stop;
+  deps->sleep_ms                     = sleep_ms;
+  deps->print_string                 = print_string;
+  deps->print_int64                  = print_int64;
+}
+
+static void step(const char *what, enum ms8607_status status) {
+
+  if (status != ms8607_status_ok) {
+    fprintf(stderr, "%s: %s\n", what, ms8607_stringize_error(status));
+    exit(1);
+  }
+}
+
+/* One measurement in the order of MS8607Sensor, the humidity conversion
+   runs alongside the other two. The waits are those it asks for.*/
+static void split_reading(ms8607_sensor *sp, int32_t *t, int32_t *p,
+                          int32_t *h) {
+  uint32_t p_us = ms8607_get_conversion_time(sp, ms8607_conversion_pressure);
+  uint32_t h_us = ms8607_get_conversion_time(sp, ms8607_conversion_humidity);
+  uint32_t adc[3];
+  enum ms8607_status status;
+
+  step("start", ms8607_start_conversion(sp, ms8607_conversion_humidity, NULL));
+  step("start", ms8607_start_conversion(sp, ms8607_conversion_temperature,
+                                        NULL));
+  now += p_us;
+  step("collect", ms8607_read_conversion(sp, ms8607_conversion_temperature,
+                                         &adc[0], NULL));
+  step("start", ms8607_start_conversion(sp, ms8607_conversion_pressure,
+                                        NULL));
+  now += p_us;
+  step("collect", ms8607_read_conversion(sp, ms8607_conversion_pressure,
+                                         &adc[1], NULL));
+  now += h_us > 2 * p_us ? h_us - 2 * p_us : 0;
+  while ((status = ms8607_read_conversion(sp, ms8607_conversion_humidity,
+                                          &adc[2], NULL)) ==
+         ms8607_status_waiting)
+    now += RETRY_US;
+  step("collect", status);
+  step("convert", ms8607_compensate_int32(sp, adc[0], adc[1], adc[2],
+                                          t, p, h));
+}
+
+int main(int argc, char *argv[]) {
+  ms8607_host_functions host_funcs;
+  ms8607_sensor sensor;
+  unsigned readings = 3;
+  int split = 0, i;
+
+  for (i = 1; i < argc - 1; i++) {
+    if (strcmp(argv[i], "-s") == 0)
+      split = 1;
+    else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc - 1))
+      readings = (unsigned)strtoul(argv[++i], NULL, 0);
+    else
+      break;
+  }
+  if (i != argc - 1) {
+    fprintf(stderr, "usage: ms8607sim [-s] [-n readings] trace.bin\n");
+    return 2;
+  }
+  if ((out = fopen(argv[argc - 1], "wb")) == NULL) {
+    perror(argv[argc - 1]);
+    return 1;
+  }
+  prom[0] |= (uint16_t)(prom_crc() << 12);
+  fwrite(I2C_TRACE_MAGIC, 1, 4, out);
+  fputc(I2C_TRACE_VERSION, out);
+  now = 100;
+
+  step("init", ms8607_init_and_assign_host_functions(&host_funcs, NULL,
+                                                     assign_functions));
+  step("init", ms8607_init_sensor(&sensor, &host_funcs));
+  step("reset", ms8607_reset(&sensor, NULL));
+  step("heater", ms8607_disable_heater(&sensor, NULL));
+  step("humidity resolution",
+       ms8607_set_humidity_resolution(&sensor, ms8607_humidity_resolution_12b,
+                                      NULL));
+  ms8607_set_pressure_resolution(&sensor, ms8607_pressure_resolution_osr_2048,
+                                 NULL);
+  ms8607_set_humidity_i2c_controller_mode(&sensor, ms8607_i2c_no_hold, NULL);
+
+  for (reading = 0; reading < readings; reading++) {
+    int32_t t, p, h;
+
+    if (split)
+      split_reading(&sensor, &t, &p, &h);
+    else
+      step("reading", ms8607_read_temperature_pressure_humidity_int32(
+                          &sensor, &t, &p, &h, NULL));
+    fprintf(stderr, "%.3f degC  %.3f mbar  %.3f %%RH\n",
+            t / 1000.0, p / 1000.0, h / 1000.0);
+    now += READING_PERIOD_MS * 1000ULL;
+  }
+  fputc(I2C_TRACE_END, out);
+  fclose(out);
+  return 0;
+}